@@ -73,6 +73,7 @@
 
 /* Earth */
 #define REQ_EARTH      6378.14
+#define FLAT_EARTH        (1./298.257223563)
 #define SMA_EARTH         1.00000011*AU
 #define I_EARTH           0.00005*D2R
 #define E_EARTH           0.01671022
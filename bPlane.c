@@ -0,0 +1,377 @@
+/*
+ *  bPlane.c
+ *  OrbitalMotion
+ *
+ *  The B-plane quantities follow from the angular momentum h = r x v,
+ *  the eccentricity vector and the hyperbolic excess speed
+ *
+ *      S = e_hat / e + sqrt(1 - 1/e^2) (h_hat x e_hat)
+ *      B = (h / vInf) (S x h_hat)
+ *
+ *  The Jacobian is obtained by differentiating this chain term by
+ *  term.  The time to periapsis uses sinh(H) = (r.v) vInf / (mu e),
+ *  whose derivative stays regular at periapsis.
+ *
+ *  References:
+ *  W. Kizner, "A Method of Describing Miss Distances for Lunar and
+ *  Interplanetary Trajectories", JPL External Publication 674, 1959.
+ *  D. A. Vallado, "Fundamentals of Astrodynamics and Applications",
+ *  3rd ed., 2007, section 12.4.
+ */
+
+#include "bPlane.h"
+
+/*
+ *  bpRow(a, M, out)
+ *
+ *  out = a^T M
+ */
+static void bpRow(double *a, double M[4][4], double *out)
+{
+    int j;
+
+    for(j = 1; j <= 3; j++) {
+        out[j] = a[1] * M[1][j] + a[2] * M[2][j] + a[3] * M[3][j];
+    }
+
+    return;
+}
+
+/*
+ *  bpProject(u, M, s, out)
+ *
+ *  out = (I - u u^T) M / s, the derivative of the unit vector u of
+ *  a vector of length s with derivative M.
+ */
+static void bpProject(double *u, double M[4][4], double s, double out[4][4])
+{
+    double uM[3+1];
+    int    i;
+    int    j;
+
+    bpRow(u, M, uM);
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            out[i][j] = (M[i][j] - u[i] * uM[j]) / s;
+        }
+    }
+
+    return;
+}
+
+/*
+ *  status = bpCompute(mu, r, v, B, STR, J)
+ *
+ *  Evaluates the B-plane coordinates B, the frame STR if not NULL
+ *  and the Jacobian J = dB/dv if not NULL.  Returns -1 for a non
+ *  hyperbolic or rectilinear approach, or an asymptote along K.
+ */
+static int bpCompute(double mu, double *r, double *v, double *B, double STR[4][4], double J[4][4])
+{
+    double K[3+1] = {0., 0., 0., 1.};
+    double h[3+1];
+    double hHat[3+1];
+    double ev[3+1];
+    double eHat[3+1];
+    double p[3+1];
+    double S[3+1];
+    double u[3+1];
+    double T[3+1];
+    double R[3+1];
+    double Bv[3+1];
+    double SxH[3+1];
+    double Dh[4][4];
+    double De[4][4];
+    double DeHat[4][4];
+    double DhHat[4][4];
+    double DS[4][4];
+    double DB[4][4];
+    double Du[4][4];
+    double DT[4][4];
+    double DR[4][4];
+    double M1[4][4];
+    double M2[4][4];
+    double M3[4][4];
+    double de[3+1];
+    double dvInf[3+1];
+    double db[3+1];
+    double dsh[3+1];
+    double dH[3+1];
+    double dN[3+1];
+    double row1[3+1];
+    double row2[3+1];
+    double rr;
+    double hn;
+    double sigma;
+    double vInf;
+    double e;
+    double s;
+    double b;
+    double un;
+    double f;
+    double H;
+    double N;
+    double sh;
+    double n;
+    int    i;
+    int    j;
+
+    rr    = norm(r);
+    sigma = dot(r, v);
+    vInf  = dot(v, v) - 2. * mu / rr;
+    cross(r, v, h);
+    hn = norm(h);
+    if((vInf <= 0.) || (hn <= 0.)) {
+        return -1;
+    }
+    vInf = sqrt(vInf);
+    for(i = 1; i <= 3; i++) {
+        ev[i] = ((vInf * vInf + mu / rr) * r[i] - sigma * v[i]) / mu;
+    }
+    e = norm(ev);
+    mult(1. / e, ev, eHat);
+    mult(1. / hn, h, hHat);
+    cross(hHat, eHat, p);
+    s = sqrt(1. - 1. / (e * e));
+    for(i = 1; i <= 3; i++) {
+        S[i] = eHat[i] / e + s * p[i];
+    }
+    cross(S, K, u);
+    un = norm(u);
+    if(un < 1e-12) {
+        return -1;
+    }
+    mult(1. / un, u, T);
+    cross(S, T, R);
+    b = hn / vInf;
+    cross(S, hHat, SxH);
+    mult(b, SxH, Bv);
+
+    f = acos(fmax(-1., fmin(1., dot(eHat, r) / rr)));
+    if(sigma < 0.) {
+        f = -f;
+    }
+    H = f2H(f, e);
+    N = H2N(H, e);
+    n = vInf * vInf * vInf / mu;
+    B[1] = dot(Bv, T);
+    B[2] = dot(Bv, R);
+    B[3] = -N / n;
+
+    if(STR != NULL) {
+        equal(S, STR[1]);
+        equal(T, STR[2]);
+        equal(R, STR[3]);
+    }
+    if(J == NULL) {
+        return 0;
+    }
+
+    /* angular momentum and eccentricity vector */
+    tilde(r, Dh);
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            De[i][j] = (2. * r[i] * v[j] - v[i] * r[j] - (i == j ? sigma : 0.)) / mu;
+        }
+    }
+    bpRow(eHat, De, de);
+    bpProject(eHat, De, e, DeHat);
+    bpProject(hHat, Dh, hn, DhHat);
+    mult(1. / vInf, v, dvInf);
+    bpRow(hHat, Dh, db);
+    for(j = 1; j <= 3; j++) {
+        db[j] = db[j] / vInf - hn / (vInf * vInf) * dvInf[j];
+    }
+
+    /* asymptote S */
+    tilde(eHat, M3);
+    MdotM(M3, DhHat, M1);
+    tilde(hHat, M3);
+    MdotM(M3, DeHat, M2);
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            DS[i][j] = DeHat[i][j] / e - eHat[i] * de[j] / (e * e)
+                       + p[i] * de[j] / (e * e * e * s)
+                       + s * (M2[i][j] - M1[i][j]);
+        }
+    }
+
+    /* B vector */
+    tilde(hHat, M3);
+    MdotM(M3, DS, M1);
+    tilde(S, M3);
+    MdotM(M3, DhHat, M2);
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            DB[i][j] = SxH[i] * db[j] + b * (M2[i][j] - M1[i][j]);
+        }
+    }
+
+    /* T and R */
+    tilde(K, M3);
+    MdotM(M3, DS, Du);
+    Mmult(-1., Du, Du);
+    bpProject(T, Du, un, DT);
+    tilde(T, M3);
+    MdotM(M3, DS, M1);
+    tilde(S, M3);
+    MdotM(M3, DT, M2);
+    Msub(M2, M1, DR);
+
+    bpRow(T, DB, row1);
+    bpRow(Bv, DT, row2);
+    add(row1, row2, J[1]);
+    bpRow(R, DB, row1);
+    bpRow(Bv, DR, row2);
+    add(row1, row2, J[2]);
+
+    /* time to periapsis */
+    sh = sinh(H);
+    for(j = 1; j <= 3; j++) {
+        dsh[j] = (r[j] * vInf + sigma * dvInf[j]) / (mu * e) - sh * de[j] / e;
+        dH[j]  = dsh[j] / cosh(H);
+        dN[j]  = sh * de[j] + e * dsh[j] - dH[j];
+        J[3][j] = -dN[j] / n + N / (n * n) * 3. * vInf * vInf / mu * dvInf[j];
+    }
+
+    return 0;
+}
+
+/*
+ *  status = rv2BPlane(mu, r, v, B, STR)
+ *
+ *  Maps the approach state r, v relative to a body of gravitational
+ *  constant mu into the B-plane coordinates B = [B.T B.R LTOF].  If
+ *  STR is not NULL its rows return the unit vectors S, T and R.
+ *  Returns -1 if the approach is not hyperbolic.
+ */
+int rv2BPlane(double mu, double *r, double *v, double *B, double STR[4][4])
+{
+    if(bpCompute(mu, r, v, B, STR, NULL) != 0) {
+        B[1] = B[2] = B[3] = NAN;
+        printf("ERROR: rv2BPlane() received a state with energy %g \n", dot(v, v) / 2. - mu / norm(r));
+        printf("The approach should be hyperbolic with the asymptote off the K axis. \n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ *  status = BPlaneJacobian(mu, r, v, B, J)
+ *
+ *  Same as rv2BPlane(), also returning the Jacobian J[i][j] =
+ *  dB[i]/dv[j] of the B-plane coordinates with respect to the
+ *  approach velocity.
+ */
+int BPlaneJacobian(double mu, double *r, double *v, double *B, double J[4][4])
+{
+    if(bpCompute(mu, r, v, B, NULL, J) != 0) {
+        B[1] = B[2] = B[3] = NAN;
+        printf("ERROR: BPlaneJacobian() received a state with energy %g \n", dot(v, v) / 2. - mu / norm(r));
+        printf("The approach should be hyperbolic with the asymptote off the K axis. \n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ *  iter = BPlaneTarget(mu, r, v, BT, BR, tol, vOut)
+ *
+ *  Corrects the approach velocity v to reach the B-plane target BT,
+ *  BR within tol with minimum norm Newton steps on the first two
+ *  rows of the B-plane Jacobian.  Returns the number of iterations,
+ *  or -1 if the correction did not converge.  vOut may alias v.
+ */
+int BPlaneTarget(double mu, double *r, double *v, double BT, double BR, double tol, double *vOut)
+{
+    double B[3+1];
+    double J[4][4];
+    double w[3+1];
+    double A11;
+    double A12;
+    double A22;
+    double det;
+    double d1;
+    double d2;
+    double y1;
+    double y2;
+    int    iter;
+    int    j;
+
+    equal(v, w);
+    for(iter = 0; iter < BPLANE_MAX_ITER; iter++) {
+        if(bpCompute(mu, r, w, B, NULL, J) != 0) {
+            break;
+        }
+        d1 = BT - B[1];
+        d2 = BR - B[2];
+        if(sqrt(d1 * d1 + d2 * d2) < tol) {
+            equal(w, vOut);
+            return iter;
+        }
+        A11 = dot(J[1], J[1]);
+        A12 = dot(J[1], J[2]);
+        A22 = dot(J[2], J[2]);
+        det = A11 * A22 - A12 * A12;
+        if(det == 0.) {
+            break;
+        }
+        y1 = ( A22 * d1 - A12 * d2) / det;
+        y2 = (-A12 * d1 + A11 * d2) / det;
+        for(j = 1; j <= 3; j++) {
+            w[j] += J[1][j] * y1 + J[2][j] * y2;
+        }
+    }
+
+    printf("ERROR: BPlaneTarget() did not reach B.T = %g, B.R = %g \n", BT, BR);
+    printf("The target should be reachable from the approach state. \n");
+    return -1;
+}
+
+/*
+ *  BPlaneCovariance(J, Pv, PB)
+ *
+ *  Maps the approach velocity covariance Pv into the B-plane
+ *  delivery covariance PB = J Pv J^T.
+ */
+void BPlaneCovariance(double J[4][4], double Pv[4][4], double PB[4][4])
+{
+    double M[4][4];
+
+    MdotM(J, Pv, M);
+    MdotMT(M, J, PB);
+
+    return;
+}
+
+/*
+ *  batchBPlane(mu, n, r, v, B)
+ *
+ *  SoA version of rv2BPlane() for the n approach states r[1..3][k],
+ *  v[1..3][k], returning B[1..3][k].  Non hyperbolic states return
+ *  NAN without a message.
+ */
+void batchBPlane(double mu, int n, double *r[3+1], double *v[3+1], double *B[3+1])
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= BPLANE_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double rk[3+1];
+        double vk[3+1];
+        double Bk[3+1];
+
+        set3(r[1][k], r[2][k], r[3][k], rk);
+        set3(v[1][k], v[2][k], v[3][k], vk);
+        if(bpCompute(mu, rk, vk, Bk, NULL, NULL) != 0) {
+            Bk[1] = Bk[2] = Bk[3] = NAN;
+        }
+        B[1][k] = Bk[1];
+        B[2][k] = Bk[2];
+        B[3][k] = Bk[3];
+    }
+
+    return;
+}
@@ -0,0 +1,46 @@
+/*
+ *  bPlane.h
+ *  OrbitalMotion
+ *
+ *  Hyperbolic B-plane targeting.  The approach state r, v relative
+ *  to the flyby body is mapped to the B-plane coordinates
+ *
+ *      B = [B.T  B.R  LTOF]
+ *
+ *  where S is the incoming asymptote, T = S x K / |S x K| with K the
+ *  third axis of the frame of r and v, R = S x T, and LTOF is the
+ *  time until periapsis passage from the hyperbolic anomaly.  The
+ *  Jacobian dB/dv with respect to the approach velocity is
+ *  evaluated analytically and is used to retarget the approach
+ *  velocity and to map velocity dispersions into B-plane delivery
+ *  errors.  The batch routine operates on SoA approach states
+ *  r[1..3][k], v[1..3][k].
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "orbitalMotion.h"
+
+#ifndef _B_PLANE_H_
+#define _B_PLANE_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define BPLANE_PARALLEL_MIN 4096    /* smallest batch processed with several threads */
+    #define BPLANE_MAX_ITER     20
+
+    int     rv2BPlane(double mu, double *r, double *v, double *B, double STR[4][4]);
+    int     BPlaneJacobian(double mu, double *r, double *v, double *B, double J[4][4]);
+    int     BPlaneTarget(double mu, double *r, double *v, double BT, double BR, double tol, double *vOut);
+    void    BPlaneCovariance(double J[4][4], double Pv[4][4], double PB[4][4]);
+
+    void    batchBPlane(double mu, int n, double *r[3+1], double *v[3+1], double *B[3+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
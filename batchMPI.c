@@ -0,0 +1,584 @@
+/*
+ *  batchMPI.c
+ *  OrbitalMotion
+ *
+ *  MPI domain decomposition of catalog x sample propagations.
+ *  Global work item g corresponds to catalog object g / numSamples
+ *  and dispersion sample g % numSamples, and rank i owns the items
+ *  [first_i, first_i + count_i) given by batchMpiRange().  Inside a
+ *  rank the items are propagated by the (NUMA-aware, threaded)
+ *  batch engine.  Conjunction screening instead decomposes space
+ *  into one slab along x per rank and exchanges only the halo of
+ *  items near the slab boundaries between neighbouring ranks.
+ *
+ *  The module can be exercised on a single machine, e.g. with the
+ *  screening check examples/batchMpiScreen.c,
+ *      mpirun -np 4 ./batchMpiScreen
+ *
+ */
+
+#include <string.h>
+#include "batchMPI.h"
+
+/*
+ *  batchMpiRange(numItems, rank, size, *first, *count)
+ *
+ *  Returns the block of global work items owned by a rank when
+ *  numItems items are balanced over size ranks.
+ */
+void batchMpiRange(int numItems, int rank, int size, int *first, int *count)
+{
+    *first = (int)((long)rank * numItems / size);
+    *count = (int)((long)(rank + 1) * numItems / size) - *first;
+
+    return;
+}
+
+/*
+ *  status = batchMpiCreate(comm, numObjects, numSamples, numParts, cat)
+ *
+ *  Collective.  Decomposes numObjects x numSamples work items over
+ *  the ranks of comm and allocates the local batch state with
+ *  numParts partitions (see batchCreate()).  Returns 0 on success
+ *  and -1 if the decomposition or allocation failed on any rank.
+ */
+int batchMpiCreate(MPI_Comm comm, int numObjects, int numSamples, int numParts, batchMpiCatalog *cat)
+{
+    int ok;
+    int allOk;
+
+    memset(cat, 0, sizeof(batchMpiCatalog));
+    if((numObjects < 1) || (numSamples < 1) || ((double)numObjects * numSamples > 2147483647.)) {
+        printf("ERROR: batchMpiCreate() received numObjects = %d, numSamples = %d \n", numObjects, numSamples);
+        printf("The number of work items should be positive and fit into an int. \n");
+        return -1;
+    }
+
+    cat->comm       = comm;
+    cat->numObjects = numObjects;
+    cat->numSamples = numSamples;
+    cat->numItems   = numObjects * numSamples;
+    MPI_Comm_rank(comm, &cat->rank);
+    MPI_Comm_size(comm, &cat->size);
+    batchMpiRange(cat->numItems, cat->rank, cat->size, &cat->first, &cat->count);
+
+    cat->state = batchCreate(cat->count, numParts);
+    ok = (cat->state != NULL);
+    MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, comm);
+    if(!allOk) {
+        batchFree(cat->state);
+        cat->state = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ *  batchMpiFree(cat)
+ *
+ *  Releases the local batch state of a distributed catalog.
+ */
+void batchMpiFree(batchMpiCatalog *cat)
+{
+    batchFree(cat->state);
+    cat->state = NULL;
+
+    return;
+}
+
+/*
+ *  batchMpiInit(cat, fcn, data)
+ *
+ *  Sets the initial state of every local work item by calling
+ *  fcn(object, sample, rVec, vVec, &CdAm, &Am, data) for it.
+ */
+void batchMpiInit(batchMpiCatalog *cat, batchItemInit fcn, void *data)
+{
+    double rVec[3+1];
+    double vVec[3+1];
+    double CdAm;
+    double Am;
+    int    g;
+    int    k;
+
+    for(k = 0; k < cat->count; k++) {
+        g    = cat->first + k;
+        CdAm = 0.;
+        Am   = 0.;
+        fcn(g / cat->numSamples, g % cat->numSamples, rVec, vVec, &CdAm, &Am, data);
+        batchSet(cat->state, k, rVec, vVec, CdAm, Am);
+    }
+
+    return;
+}
+
+/*
+ *  batchMpiPropagate(cat, fm, dt, numSteps)
+ *
+ *  Propagates the local work items of every rank.  No
+ *  communication is required since the items are independent.
+ */
+void batchMpiPropagate(batchMpiCatalog *cat, batchForceModel *fm, double dt, int numSteps)
+{
+    batchPropagate(cat->state, fm, dt, numSteps);
+
+    return;
+}
+
+/*
+ *  batchMpiCounts(cat, scale, counts, displs)
+ *
+ *  Fills the MPI_Gatherv() counts and displacements of all ranks,
+ *  each scaled by the number of values per work item.
+ */
+static void batchMpiCounts(batchMpiCatalog *cat, int scale, int *counts, int *displs)
+{
+    int i;
+
+    for(i = 0; i < cat->size; i++) {
+        batchMpiRange(cat->numItems, i, cat->size, &displs[i], &counts[i]);
+        counts[i] *= scale;
+        displs[i] *= scale;
+    }
+
+    return;
+}
+
+/*
+ *  batchMpiLocal(cat, r, v)
+ *
+ *  Allocates flat local SoA arrays and gathers the local batch
+ *  state into them.  Returns -1 if the allocation failed.
+ */
+static int batchMpiLocal(batchMpiCatalog *cat, double *r[3+1], double *v[3+1])
+{
+    double *mem;
+    int     i;
+
+    mem = (double *)malloc((6 * (size_t)cat->count + 1) * sizeof(double));
+    if(mem == NULL) {
+        return -1;
+    }
+    for(i = 1; i <= 3; i++) {
+        r[i] = mem + (i - 1) * (size_t)cat->count;
+        v[i] = mem + (i + 2) * (size_t)cat->count;
+    }
+    r[0] = mem;
+    batchGather(cat->state, r, v);
+
+    return 0;
+}
+
+/*
+ *  status = batchMpiGather(cat, root, r, v)
+ *
+ *  Collective.  Gathers the states of all work items onto rank
+ *  root into the flat SoA arrays r[1..3][0..numItems-1] and
+ *  v[1..3][0..numItems-1], ordered by global item index.  The
+ *  output arrays are only accessed on root.  Returns 0 on success.
+ */
+int batchMpiGather(batchMpiCatalog *cat, int root, double *r[3+1], double *v[3+1])
+{
+    double *lr[3+1];
+    double *lv[3+1];
+    int    *counts;
+    int    *displs;
+    int     ok;
+    int     allOk;
+    int     i;
+
+    counts = (int *)malloc(2 * cat->size * sizeof(int));
+    ok = (counts != NULL) && (batchMpiLocal(cat, lr, lv) == 0);
+    MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, cat->comm);
+    if(!allOk) {
+        if(ok) {
+            free(lr[0]);
+        }
+        free(counts);
+        return -1;
+    }
+    displs = counts + cat->size;
+    batchMpiCounts(cat, 1, counts, displs);
+
+    for(i = 1; i <= 3; i++) {
+        MPI_Gatherv(lr[i], cat->count, MPI_DOUBLE, cat->rank == root ? r[i] : NULL,
+                    counts, displs, MPI_DOUBLE, root, cat->comm);
+        MPI_Gatherv(lv[i], cat->count, MPI_DOUBLE, cat->rank == root ? v[i] : NULL,
+                    counts, displs, MPI_DOUBLE, root, cat->comm);
+    }
+
+    free(lr[0]);
+    free(counts);
+
+    return 0;
+}
+
+/*
+ *  status = batchMpiWriteEphemeris(cat, prefix)
+ *
+ *  Appends the current states of the local work items to the
+ *  per-rank ephemeris file "<prefix>.<rank>.txt".  Each line holds
+ *      object sample t x y z vx vy vz
+ *  in units of sec, km and km/s.  No communication is performed.
+ *  Returns 0 on success and -1 if the file could not be written.
+ */
+int batchMpiWriteEphemeris(batchMpiCatalog *cat, const char *prefix)
+{
+    char    name[1024];
+    double *r[3+1];
+    double *v[3+1];
+    FILE   *fp;
+    int     g;
+    int     k;
+
+    snprintf(name, sizeof(name), "%s.%04d.txt", prefix, cat->rank);
+    fp = fopen(name, "a");
+    if(fp == NULL) {
+        printf("ERROR: batchMpiWriteEphemeris() could not open %s \n", name);
+        return -1;
+    }
+    if(batchMpiLocal(cat, r, v) != 0) {
+        fclose(fp);
+        return -1;
+    }
+
+    for(k = 0; k < cat->count; k++) {
+        g = cat->first + k;
+        fprintf(fp, "%d %d %20.15g %20.15g %20.15g %20.15g %20.15g %20.15g %20.15g\n",
+                g / cat->numSamples, g % cat->numSamples, cat->state->t,
+                r[1][k], r[2][k], r[3][k], v[1][k], v[2][k], v[3][k]);
+    }
+
+    free(r[0]);
+    if(fclose(fp) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+typedef struct batchScreenItemStruct {
+    double x;                       /* inertial position (km) */
+    double y;
+    double z;
+    int    item;                    /* global item index */
+    int    owned;                   /* 1 in the slab of the rank, 0 in its halo */
+} batchScreenItem;
+
+static int batchScreenItemCompare(const void *a, const void *b)
+{
+    double xa = ((const batchScreenItem *)a)->x;
+    double xb = ((const batchScreenItem *)b)->x;
+
+    return (xa > xb) - (xa < xb);
+}
+
+static int batchDoubleCompare(const void *a, const void *b)
+{
+    double xa = *(const double *)a;
+    double xb = *(const double *)b;
+
+    return (xa > xb) - (xa < xb);
+}
+
+/*
+ *  slab = batchMpiSlab(split, size, x)
+ *
+ *  Returns the slab k with split[k] <= x < split[k + 1], where
+ *  split[0] = -inf and split[size] = +inf.
+ */
+static int batchMpiSlab(double *split, int size, double x)
+{
+    int lo;
+    int hi;
+    int mid;
+
+    lo = 0;
+    hi = size;
+    while(hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        if(x < split[mid]) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+ *  batchMpiSplit(cat, mine, split, counts, displs)
+ *
+ *  Collective.  Sets the slab boundaries split[1..size-1] along x
+ *  from up to size regular samples of the x-sorted local items mine
+ *  of every rank, so that the slabs hold about equal numbers of
+ *  items.  samples must hold (size + 1) * size doubles.
+ */
+static void batchMpiSplit(batchMpiCatalog *cat, batchScreenItem *mine, double *split, double *samples,
+                          int *counts, int *displs)
+{
+    double *local;
+    int     ns;
+    int     total;
+    int     i;
+
+    local = samples + (size_t)cat->size * cat->size;
+    ns    = cat->count < cat->size ? cat->count : cat->size;
+    for(i = 0; i < ns; i++) {
+        local[i] = mine[(int)((long)i * cat->count / ns)].x;
+    }
+    MPI_Allgather(&ns, 1, MPI_INT, counts, 1, MPI_INT, cat->comm);
+    total = 0;
+    for(i = 0; i < cat->size; i++) {
+        displs[i] = total;
+        total    += counts[i];
+    }
+    MPI_Allgatherv(local, ns, MPI_DOUBLE, samples, counts, displs, MPI_DOUBLE, cat->comm);
+    qsort(samples, total, sizeof(double), batchDoubleCompare);
+
+    split[0]         = -HUGE_VAL;
+    split[cat->size] = HUGE_VAL;
+    for(i = 1; i < cat->size; i++) {
+        split[i] = samples[(int)((long)i * total / cat->size)];
+    }
+
+    return;
+}
+
+/*
+ *  status = batchMpiScreen(cat, dist, *list, *num)
+ *
+ *  Collective conjunction screening of all work items at the
+ *  current epoch.  Space is cut into one slab along x per rank,
+ *  with boundaries sampled so that the slabs hold about equal
+ *  numbers of items.  Every item moves to the rank of its slab,
+ *  and each rank receives from the rank above it the halo of items
+ *  less than dist beyond its upper boundary, forwarded over more
+ *  ranks where the slabs are thinner than dist.  Each rank then
+ *  sweeps its items and halo in x and keeps the pairs whose lower
+ *  x item lies in its slab, so that every pair is found on exactly
+ *  one rank.  Work items that are samples of the same catalog
+ *  object are not screened against each other.
+ *
+ *  Input is
+ *      cat  - distributed catalog
+ *      dist - screening distance (km)
+ *
+ *  Output is
+ *      list - malloc'ed array of the candidate pairs owned by this
+ *             rank, free() after use
+ *      num  - number of candidate pairs owned by this rank
+ *
+ *  The union of the lists of all ranks is the complete candidate
+ *  list.  Returns 0 on success and -1 if memory could not be
+ *  allocated on any rank.
+ */
+int batchMpiScreen(batchMpiCatalog *cat, double dist, batchConjunction **list, int *num)
+{
+    double           *lr[3+1];
+    double           *lv[3+1];
+    double           *split;
+    double           *samples;
+    int              *counts;
+    int              *sendCounts;
+    int              *sendDispls;
+    int              *recvCounts;
+    int              *recvDispls;
+    batchScreenItem  *mine;
+    batchScreenItem  *item;
+    batchScreenItem  *tmpItem;
+    batchConjunction *local;
+    batchConjunction *tmp;
+    int               numItem;
+    int               maxItem;
+    int               numLocal;
+    int               maxLocal;
+    int               numSend;
+    int               numRecv;
+    int               numMoved;
+    int               below;
+    int               above;
+    int               lo;
+    int               ok;
+    int               allOk;
+    int               a;
+    int               b;
+    int               i;
+    int               k;
+    int               i1;
+    int               i2;
+    double            d[3+1];
+    double            dd;
+
+    *list = NULL;
+    *num  = 0;
+
+    counts  = (int *)malloc(4 * cat->size * sizeof(int));
+    split   = (double *)malloc((cat->size + 1) * sizeof(double));
+    samples = (double *)malloc(((size_t)cat->size + 1) * cat->size * sizeof(double));
+    mine    = (batchScreenItem *)malloc(((size_t)cat->count + 1) * sizeof(batchScreenItem));
+    ok = (counts != NULL) && (split != NULL) && (samples != NULL) && (mine != NULL)
+         && (batchMpiLocal(cat, lr, lv) == 0);
+    MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, cat->comm);
+    if(!allOk) {
+        if(ok) {
+            free(lr[0]);
+        }
+        free(counts);
+        free(split);
+        free(samples);
+        free(mine);
+        return -1;
+    }
+    sendCounts = counts;
+    sendDispls = counts + cat->size;
+    recvCounts = counts + 2 * cat->size;
+    recvDispls = counts + 3 * cat->size;
+
+    /* local items sorted along x */
+    for(i = 0; i < cat->count; i++) {
+        mine[i].x     = lr[1][i];
+        mine[i].y     = lr[2][i];
+        mine[i].z     = lr[3][i];
+        mine[i].item  = cat->first + i;
+        mine[i].owned = 1;
+    }
+    free(lr[0]);
+    qsort(mine, cat->count, sizeof(batchScreenItem), batchScreenItemCompare);
+    batchMpiSplit(cat, mine, split, samples, recvCounts, recvDispls);
+    free(samples);
+
+    /* move every item to the rank of its slab; the sorted local
+       items of each slab are contiguous */
+    for(k = 0; k < cat->size; k++) {
+        sendCounts[k] = 0;
+    }
+    for(i = 0; i < cat->count; i++) {
+        sendCounts[batchMpiSlab(split, cat->size, mine[i].x)]++;
+    }
+    MPI_Alltoall(sendCounts, 1, MPI_INT, recvCounts, 1, MPI_INT, cat->comm);
+    numItem = 0;
+    lo      = 0;
+    for(k = 0; k < cat->size; k++) {
+        sendDispls[k]  = lo * (int)sizeof(batchScreenItem);
+        recvDispls[k]  = numItem * (int)sizeof(batchScreenItem);
+        lo            += sendCounts[k];
+        numItem       += recvCounts[k];
+        sendCounts[k] *= (int)sizeof(batchScreenItem);
+        recvCounts[k] *= (int)sizeof(batchScreenItem);
+    }
+    maxItem = 2 * numItem + 16;
+    item    = (batchScreenItem *)malloc(maxItem * sizeof(batchScreenItem));
+    ok      = (item != NULL);
+    MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, cat->comm);
+    if(!allOk) {
+        free(item);
+        free(mine);
+        free(counts);
+        free(split);
+        return -1;
+    }
+    MPI_Alltoallv(mine, sendCounts, sendDispls, MPI_BYTE, item, recvCounts, recvDispls, MPI_BYTE, cat->comm);
+    free(mine);
+
+    /* halo exchange with the neighbouring slabs: pass the items
+       less than dist above the lower boundary of the slab down one
+       rank, and repeat with the received items until none is left */
+    below    = cat->rank > 0 ? cat->rank - 1 : MPI_PROC_NULL;
+    above    = cat->rank < cat->size - 1 ? cat->rank + 1 : MPI_PROC_NULL;
+    lo       = 0;
+    numMoved = 1;
+    while(numMoved > 0) {
+        qsort(item + lo, numItem - lo, sizeof(batchScreenItem), batchScreenItemCompare);
+        numSend = 0;
+        if(below != MPI_PROC_NULL) {
+            while((lo + numSend < numItem) && (item[lo + numSend].x < split[cat->rank] + dist)) {
+                numSend++;
+            }
+        }
+        numRecv = 0;
+        MPI_Sendrecv(&numSend, 1, MPI_INT, below, 0, &numRecv, 1, MPI_INT, above, 0,
+                     cat->comm, MPI_STATUS_IGNORE);
+        ok = 1;
+        if(numItem + numRecv > maxItem) {
+            maxItem = 2 * (numItem + numRecv);
+            tmpItem = (batchScreenItem *)realloc(item, maxItem * sizeof(batchScreenItem));
+            ok      = (tmpItem != NULL);
+            if(ok) {
+                item = tmpItem;
+            }
+        }
+        MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, cat->comm);
+        if(!allOk) {
+            free(item);
+            free(counts);
+            free(split);
+            return -1;
+        }
+        MPI_Sendrecv(item + lo, numSend * (int)sizeof(batchScreenItem), MPI_BYTE, below, 1,
+                     item + numItem, numRecv * (int)sizeof(batchScreenItem), MPI_BYTE, above, 1,
+                     cat->comm, MPI_STATUS_IGNORE);
+        for(i = numItem; i < numItem + numRecv; i++) {
+            item[i].owned = 0;
+        }
+        lo       = numItem;
+        numItem += numRecv;
+        MPI_Allreduce(&numRecv, &numMoved, 1, MPI_INT, MPI_SUM, cat->comm);
+    }
+    free(split);
+    free(counts);
+
+    /* sweep along x, keeping the pairs whose lower x item is owned;
+       halo items lie above all owned items */
+    qsort(item, numItem, sizeof(batchScreenItem), batchScreenItemCompare);
+    numLocal = 0;
+    maxLocal = 16;
+    local    = (batchConjunction *)malloc(maxLocal * sizeof(batchConjunction));
+    ok       = (local != NULL);
+    for(a = 0; ok && (a < numItem); a++) {
+        if(!item[a].owned) {
+            continue;
+        }
+        for(b = a + 1; b < numItem; b++) {
+            if(item[b].x - item[a].x > dist) {
+                break;
+            }
+            i1 = item[a].item < item[b].item ? item[a].item : item[b].item;
+            i2 = item[a].item < item[b].item ? item[b].item : item[a].item;
+            if(i1 / cat->numSamples == i2 / cat->numSamples) {
+                continue;
+            }
+            set3(item[b].x - item[a].x, item[b].y - item[a].y, item[b].z - item[a].z, d);
+            dd = norm(d);
+            if(dd > dist) {
+                continue;
+            }
+            if(numLocal == maxLocal) {
+                maxLocal *= 2;
+                tmp = (batchConjunction *)realloc(local, maxLocal * sizeof(batchConjunction));
+                if(tmp == NULL) {
+                    ok = 0;
+                    break;
+                }
+                local = tmp;
+            }
+            local[numLocal].item1 = i1;
+            local[numLocal].item2 = i2;
+            local[numLocal].dist  = dd;
+            numLocal++;
+        }
+    }
+    free(item);
+
+    MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, cat->comm);
+    if(!allOk) {
+        free(local);
+        return -1;
+    }
+    *list = local;
+    *num  = numLocal;
+
+    return 0;
+}
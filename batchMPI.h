@@ -0,0 +1,63 @@
+/*
+ *  batchMPI.h
+ *  OrbitalMotion
+ *
+ *  Optional MPI driver for the batch propagation engine.  The
+ *  work items (catalog object x dispersion sample) are split into
+ *  contiguous blocks across the ranks of a communicator, and every
+ *  rank propagates its block with the local batch engine.  The
+ *  conjunction screening splits space into slabs, one per rank.
+ *
+ *  Only build this module when an MPI implementation is available,
+ *  e.g. mpicc -fopenmp -c batchMPI.c
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "batchPropagation.h"
+
+#ifndef _BATCH_MPI_H_
+#define _BATCH_MPI_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    typedef struct batchMpiCatalogStruct {
+        MPI_Comm    comm;
+        int         rank;
+        int         size;
+        int         numObjects;     /* number of catalog objects */
+        int         numSamples;     /* number of dispersion samples per object */
+        int         numItems;       /* numObjects * numSamples */
+        int         first;          /* global item index of the first local item */
+        int         count;          /* number of items propagated by this rank */
+        batchState *state;          /* local items, item first + k is object k */
+    } batchMpiCatalog;
+
+    typedef struct batchConjunctionStruct {
+        int    item1;               /* global item index, item1 < item2 */
+        int    item2;
+        double dist;                /* separation distance (km) */
+    } batchConjunction;
+
+    typedef void (*batchItemInit)(int object, int sample, double *rVec, double *vVec,
+                                  double *CdAm, double *Am, void *data);
+
+    void batchMpiRange(int numItems, int rank, int size, int *first, int *count);
+    int  batchMpiCreate(MPI_Comm comm, int numObjects, int numSamples, int numParts, batchMpiCatalog *cat);
+    void batchMpiFree(batchMpiCatalog *cat);
+    void batchMpiInit(batchMpiCatalog *cat, batchItemInit fcn, void *data);
+    void batchMpiPropagate(batchMpiCatalog *cat, batchForceModel *fm, double dt, int numSteps);
+    int  batchMpiGather(batchMpiCatalog *cat, int root, double *r[3+1], double *v[3+1]);
+    int  batchMpiWriteEphemeris(batchMpiCatalog *cat, const char *prefix);
+    int  batchMpiScreen(batchMpiCatalog *cat, double dist, batchConjunction **list, int *num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,832 @@
+/*
+ *  batchPropagation.c
+ *  OrbitalMotion
+ *
+ *  Structure-of-arrays catalog propagation.  Each partition of the
+ *  catalog lives in one memory block that is allocated and zeroed
+ *  (first touched) by the worker thread that later propagates it.
+ *  With the OpenMP threads pinned (OMP_PROC_BIND=close, OMP_PLACES=cores)
+ *  the pages of every partition thus end up on the NUMA node of the
+ *  thread that uses them.  When compiled with -DHAVE_LIBNUMA (link
+ *  with -lnuma) the partitions are additionally spread evenly over
+ *  the available nodes, allocated with numa_alloc_onnode() and the
+ *  worker threads are bound to the node owning their partition.
+ *
+ *  Catalogs created with batchCreateInArena() carve their partitions
+ *  and recorded step histories out of per-thread memory arenas
+ *  instead, which are released in bulk by memArenaSetReset().
+ *
+ *  Compile with -fopenmp to propagate the partitions in parallel;
+ *  without it the same code runs serially.
+ *
+ */
+
+#include <string.h>
+#include "batchPropagation.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+/*
+ *  n = batchNumaNodes()
+ *
+ *  Returns the number of NUMA nodes the catalog partitions are
+ *  spread over.  Without libnuma support this is always 1.
+ */
+int batchNumaNodes(void)
+{
+#ifdef HAVE_LIBNUMA
+    if(numa_available() < 0) {
+        return 1;
+    }
+    return numa_num_configured_nodes();
+#else
+    return 1;
+#endif
+}
+
+/*
+ *  batchBindThread(state, p)
+ *
+ *  Binds the calling thread to the NUMA node owning partition p.
+ *  Without libnuma support the thread placement is left to the
+ *  OpenMP runtime (OMP_PROC_BIND/OMP_PLACES).
+ */
+void batchBindThread(batchState *state, int p)
+{
+#ifdef HAVE_LIBNUMA
+    if(state->numNodes > 1) {
+        numa_run_on_node(state->part[p].node);
+    }
+#else
+    (void)state;
+    (void)p;
+#endif
+    return;
+}
+
+/*
+ *  stride = batchStride(n)
+ *
+ *  Returns the length of the SoA arrays of a partition of n objects,
+ *  padded to a multiple of 8 doubles (64 bytes).  Empty partitions,
+ *  which occur when there are fewer objects than partitions, still
+ *  get one cache line per array so that their block is not empty.
+ */
+static size_t batchStride(int n)
+{
+    return ((size_t)(n > 0 ? n : 1) + 7) & ~(size_t)7;
+}
+
+/*
+ *  batchPartLayout(part, mem)
+ *
+ *  Carves the SoA arrays of a partition out of its memory block.
+ */
+static void batchPartLayout(batchPartition *part, double *mem)
+{
+    size_t stride;
+    int    i;
+
+    stride = batchStride(part->n);
+    for(i = 1; i <= 3; i++) {
+        part->r[i] = mem + (i - 1) * stride;
+        part->v[i] = mem + (i + 2) * stride;
+    }
+    part->CdAm    = mem + 6 * stride;
+    part->Am      = mem + 7 * stride;
+    part->scratch = mem + 8 * stride;
+}
+
+static size_t batchPartBytes(int n)
+{
+    return (8 + BATCH_SCRATCH_ARRAYS) * batchStride(n) * sizeof(double);
+}
+
+/*
+ *  mem = batchAlloc(state, p, bytes)
+ *
+ *  Allocates memory for partition p, either from the arena of the
+ *  thread owning the partition or from the system.  Must be called
+ *  by the owning thread so that the memory is first touched there.
+ */
+static void *batchAlloc(batchState *state, int p, size_t bytes)
+{
+    if(state->arenas != NULL) {
+        return memArenaAlloc(&state->arenas->arena[p % state->arenas->num], bytes);
+    }
+#ifdef HAVE_LIBNUMA
+    if(state->numNodes > 1) {
+        return numa_alloc_onnode(bytes, state->part[p].node);
+    }
+#endif
+    return malloc(bytes);
+}
+
+/*
+ *  batchRelease(state, mem, bytes)
+ *
+ *  Returns memory obtained by batchAlloc().  Arena memory is only
+ *  released in bulk by resetting the arenas.
+ */
+static void batchRelease(batchState *state, void *mem, size_t bytes)
+{
+    if((state->arenas != NULL) || (mem == NULL)) {
+        return;
+    }
+#ifdef HAVE_LIBNUMA
+    if(state->numNodes > 1) {
+        numa_free(mem, bytes);
+        return;
+    }
+#endif
+    (void)bytes;
+    free(mem);
+
+    return;
+}
+
+/*
+ *  state = batchCreateWith(n, numParts, arenas)
+ *
+ *  Common implementation of batchCreate() and batchCreateInArena().
+ */
+static batchState *batchCreateWith(int n, int numParts, memArenaSet *arenas)
+{
+    batchState *state;
+    int         p;
+    int         failed;
+
+    if(n < 0) {
+        printf("ERROR: batchCreate() received n = %d \n", n);
+        printf("The value of n should be n >= 0. \n");
+        return NULL;
+    }
+    if(numParts <= 0) {
+#ifdef _OPENMP
+        numParts = omp_get_max_threads();
+#else
+        numParts = 1;
+#endif
+    }
+
+    state = (batchState *)malloc(sizeof(batchState));
+    if(state == NULL) {
+        return NULL;
+    }
+    state->part = (batchPartition *)calloc(numParts, sizeof(batchPartition));
+    if(state->part == NULL) {
+        free(state);
+        return NULL;
+    }
+    state->n          = n;
+    state->numParts   = numParts;
+    state->numNodes   = batchNumaNodes();
+    state->t          = 0.;
+    state->numRecords = 0;
+    state->arenas     = arenas;
+
+    for(p = 0; p < numParts; p++) {
+        state->part[p].first = (int)((long)p * n / numParts);
+        state->part[p].n     = (int)((long)(p + 1) * n / numParts) - state->part[p].first;
+        state->part[p].node  = p * state->numNodes / numParts;
+        state->part[p].bytes = batchPartBytes(state->part[p].n);
+    }
+
+    /* first touch: each block is zeroed by the thread that owns it */
+    failed = 0;
+    #pragma omp parallel for schedule(static, 1) num_threads(numParts) reduction(+:failed)
+    for(p = 0; p < numParts; p++) {
+        batchPartition *part = &state->part[p];
+        double         *mem;
+
+        batchBindThread(state, p);
+        mem = (double *)batchAlloc(state, p, part->bytes);
+        if(mem == NULL) {
+            failed++;
+            continue;
+        }
+        memset(mem, 0, part->bytes);
+        batchPartLayout(part, mem);
+    }
+
+    if(failed) {
+        printf("ERROR: batchCreate() could not allocate %d partitions \n", failed);
+        batchFree(state);
+        return NULL;
+    }
+
+    return state;
+}
+
+/*
+ *  state = batchCreate(n, numParts)
+ *
+ *  Allocates a SoA catalog of n objects split into numParts
+ *  contiguous partitions.  If numParts <= 0 one partition per
+ *  OpenMP thread is used.  Every partition is allocated and
+ *  zeroed by the thread that later propagates it.  Returns NULL
+ *  if the memory could not be allocated.
+ */
+batchState *batchCreate(int n, int numParts)
+{
+    return batchCreateWith(n, numParts, NULL);
+}
+
+/*
+ *  state = batchCreateInArena(n, arenas)
+ *
+ *  Same as batchCreate() with one partition per arena of the set.
+ *  Partition p and its step history are carved from arena p by
+ *  the thread owning the partition.  batchFree() then only
+ *  releases the catalog header; the state memory itself is
+ *  released in bulk with memArenaSetReset() or memArenaSetFree().
+ */
+batchState *batchCreateInArena(int n, memArenaSet *arenas)
+{
+    return batchCreateWith(n, arenas->num, arenas);
+}
+
+/*
+ *  batchFree(state)
+ *
+ *  Releases all partitions of a catalog, its recorded history and
+ *  the catalog itself.
+ */
+void batchFree(batchState *state)
+{
+    int p;
+
+    if(state == NULL) {
+        return;
+    }
+    batchHistoryClear(state);
+    for(p = 0; p < state->numParts; p++) {
+        batchRelease(state, state->part[p].r[1], state->part[p].bytes);
+    }
+    free(state->part);
+    free(state);
+
+    return;
+}
+
+/*
+ *  p = batchFind(state, k, &idx)
+ *
+ *  Locates catalog object k.  Returns the partition number p and
+ *  sets idx to the index of the object inside that partition.
+ *  Returns -1 if k is not part of the catalog.
+ */
+int batchFind(batchState *state, int k, int *idx)
+{
+    int lo;
+    int hi;
+    int mid;
+
+    if((k < 0) || (k >= state->n)) {
+        printf("ERROR: batchFind() received k = %d \n", k);
+        printf("The value of k should be 0 <= k < %d. \n", state->n);
+        return -1;
+    }
+
+    lo = 0;
+    hi = state->numParts - 1;
+    while(lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if(state->part[mid].first <= k) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *idx = k - state->part[lo].first;
+
+    return lo;
+}
+
+/*
+ *  batchSet(state, k, rVec, vVec, CdAm, Am)
+ *
+ *  Stores the inertial state and the drag and solar radiation
+ *  parameters of catalog object k.
+ */
+void batchSet(batchState *state, int k, double *rVec, double *vVec, double CdAm, double Am)
+{
+    batchPartition *part;
+    int             p;
+    int             idx;
+    int             i;
+
+    p = batchFind(state, k, &idx);
+    if(p < 0) {
+        return;
+    }
+    part = &state->part[p];
+    for(i = 1; i <= 3; i++) {
+        part->r[i][idx] = rVec[i];
+        part->v[i][idx] = vVec[i];
+    }
+    part->CdAm[idx] = CdAm;
+    part->Am[idx]   = Am;
+
+    return;
+}
+
+/*
+ *  batchGet(state, k, rVec, vVec)
+ *
+ *  Returns the inertial state of catalog object k.
+ */
+void batchGet(batchState *state, int k, double *rVec, double *vVec)
+{
+    batchPartition *part;
+    int             p;
+    int             idx;
+    int             i;
+
+    p = batchFind(state, k, &idx);
+    if(p < 0) {
+        set3(NAN, NAN, NAN, rVec);
+        set3(NAN, NAN, NAN, vVec);
+        return;
+    }
+    part = &state->part[p];
+    for(i = 1; i <= 3; i++) {
+        rVec[i] = part->r[i][idx];
+        vVec[i] = part->v[i][idx];
+    }
+
+    return;
+}
+
+/*
+ *  batchScatter(state, r, v, CdAm, Am)
+ *
+ *  Loads the whole catalog from flat SoA arrays r[1..3][0..n-1],
+ *  v[1..3][0..n-1], CdAm[0..n-1] and Am[0..n-1].  CdAm and Am may
+ *  be NULL, in which case the parameters are left unchanged.
+ *  Each partition is written by the thread that owns it.
+ */
+void batchScatter(batchState *state, double *r[3+1], double *v[3+1], double *CdAm, double *Am)
+{
+    int p;
+
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts)
+    for(p = 0; p < state->numParts; p++) {
+        batchPartition *part = &state->part[p];
+        size_t          bytes = (size_t)part->n * sizeof(double);
+        int             i;
+
+        if(part->n == 0) {
+            continue;
+        }
+        batchBindThread(state, p);
+        for(i = 1; i <= 3; i++) {
+            memcpy(part->r[i], r[i] + part->first, bytes);
+            memcpy(part->v[i], v[i] + part->first, bytes);
+        }
+        if(CdAm != NULL) {
+            memcpy(part->CdAm, CdAm + part->first, bytes);
+        }
+        if(Am != NULL) {
+            memcpy(part->Am, Am + part->first, bytes);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  batchGather(state, r, v)
+ *
+ *  Copies the partitioned catalog state back into flat SoA arrays
+ *  r[1..3][0..n-1] and v[1..3][0..n-1] in catalog order.  Each
+ *  partition is read by the thread that owns it, so the reads are
+ *  node-local and only the writes cross the interconnect.
+ */
+void batchGather(batchState *state, double *r[3+1], double *v[3+1])
+{
+    int p;
+
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts)
+    for(p = 0; p < state->numParts; p++) {
+        batchPartition *part = &state->part[p];
+        size_t          bytes = (size_t)part->n * sizeof(double);
+        int             i;
+
+        if(part->n == 0) {
+            continue;
+        }
+        batchBindThread(state, p);
+        for(i = 1; i <= 3; i++) {
+            memcpy(r[i] + part->first, part->r[i], bytes);
+            memcpy(v[i] + part->first, part->v[i], bytes);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  batchInitForceModel(fm)
+ *
+ *  Sets up a point mass Earth force model without perturbations.
+ */
+void batchInitForceModel(batchForceModel *fm)
+{
+    fm->mu   = MU_EARTH;
+    fm->jnum = 0;
+    fm->drag = 0;
+    fm->srp  = 0;
+    set3(1., 0., 0., fm->sunvec);
+    fm->lattice = NULL;
+
+    return;
+}
+
+/*
+ *  batchAccel(fm, n, r, v, CdAm, Am, a)
+ *
+ *  Evaluates the force model for n objects given in SoA form.
+ *
+ *  Input is
+ *      fm   - force model
+ *      n    - number of objects
+ *      r    - inertial position components r[1..3][0..n-1] (km)
+ *      v    - inertial velocity components v[1..3][0..n-1] (km/s)
+ *      CdAm - drag ballistic factors Cd*A/m (m^2/kg), only used with fm->drag
+ *      Am   - area to mass ratios A/m (m^2/kg), only used with fm->srp
+ *
+ *  Output is
+ *      a    - inertial accelerations a[1..3][0..n-1] (km/s^2)
+ *
+ *  Note: the zonal and drag perturbations are those of JPerturb()
+ *  and AtmosphericDrag() and are therefore only valid for the Earth.
+ *  If fm->lattice is set and was built for the harmonics fm->jnum
+ *  the zonal perturbation is interpolated from it inside its shells
+ *  and evaluated with JPerturb() outside.  A lattice of other
+ *  harmonics is ignored.
+ */
+void batchAccel(batchForceModel *fm, int n, double *r[3+1], double *v[3+1],
+                double *CdAm, double *Am, double *a[3+1])
+{
+    double       rvec[3+1];
+    double       vvec[3+1];
+    double       ap[3+1];
+    double       rm;
+    double       g;
+    int          k;
+    JPerturbFcn  jfcn;
+    gravLattice *lattice;
+
+    /* the zonal degree is fixed for the whole batch */
+    jfcn    = JPerturbSelect(fm->jnum);
+    lattice = NULL;
+    if((fm->lattice != NULL) && (fm->lattice->jnum == fm->jnum)) {
+        lattice = fm->lattice;
+    }
+    for(k = 0; k < n; k++) {
+        set3(r[1][k], r[2][k], r[3][k], rvec);
+        rm = norm(rvec);
+        g  = -fm->mu / (rm * rm * rm);
+        a[1][k] = g * rvec[1];
+        a[2][k] = g * rvec[2];
+        a[3][k] = g * rvec[3];
+
+        if(fm->jnum) {
+            if((lattice == NULL) || (gravLatticeAccel(lattice, rvec, ap) != 0)) {
+                if(jfcn != NULL) {
+                    jfcn(rvec, ap);
+                } else {
+                    JPerturb(rvec, fm->jnum, ap);
+                }
+            }
+            a[1][k] += ap[1];
+            a[2][k] += ap[2];
+            a[3][k] += ap[3];
+        }
+        if(fm->drag) {
+            set3(v[1][k], v[2][k], v[3][k], vvec);
+            AtmosphericDrag(CdAm[k], 1., 1., rvec, vvec, ap);
+            a[1][k] += ap[1];
+            a[2][k] += ap[2];
+            a[3][k] += ap[3];
+        }
+        if(fm->srp) {
+            SolarRad(Am[k], 1., fm->sunvec, ap);
+            a[1][k] += ap[1];
+            a[2][k] += ap[2];
+            a[3][k] += ap[3];
+        }
+    }
+
+    return;
+}
+
+/*
+ *  batchStepRK4(fm, part, dt)
+ *
+ *  Advances all objects of one partition by a fixed 4th order
+ *  Runge-Kutta step of dt seconds.  All intermediate stages are
+ *  kept in the partition's own scratch arrays.
+ */
+void batchStepRK4(batchForceModel *fm, batchPartition *part, double dt)
+{
+    double *rt[3+1];
+    double *vt[3+1];
+    double *kr[3+1];
+    double *kv[3+1];
+    double *a[3+1];
+    double  h2;
+    double  h6;
+    size_t  stride;
+    int     n;
+    int     i;
+    int     k;
+
+    n = part->n;
+    if(n == 0) {
+        return;
+    }
+    stride = batchStride(n);
+    for(i = 1; i <= 3; i++) {
+        rt[i] = part->scratch + (i - 1) * stride;
+        vt[i] = part->scratch + (i + 2) * stride;
+        kr[i] = part->scratch + (i + 5) * stride;
+        kv[i] = part->scratch + (i + 8) * stride;
+        a[i]  = part->scratch + (i + 11) * stride;
+    }
+    h2 = dt / 2.;
+    h6 = dt / 6.;
+
+    /* stage 1 */
+    batchAccel(fm, n, part->r, part->v, part->CdAm, part->Am, a);
+    for(i = 1; i <= 3; i++) {
+        for(k = 0; k < n; k++) {
+            kr[i][k] = part->v[i][k];
+            kv[i][k] = a[i][k];
+            rt[i][k] = part->r[i][k] + h2 * part->v[i][k];
+            vt[i][k] = part->v[i][k] + h2 * a[i][k];
+        }
+    }
+
+    /* stage 2 */
+    batchAccel(fm, n, rt, vt, part->CdAm, part->Am, a);
+    for(i = 1; i <= 3; i++) {
+        for(k = 0; k < n; k++) {
+            kr[i][k] += 2. * vt[i][k];
+            kv[i][k] += 2. * a[i][k];
+            rt[i][k]  = part->r[i][k] + h2 * vt[i][k];
+            vt[i][k]  = part->v[i][k] + h2 * a[i][k];
+        }
+    }
+
+    /* stage 3 */
+    batchAccel(fm, n, rt, vt, part->CdAm, part->Am, a);
+    for(i = 1; i <= 3; i++) {
+        for(k = 0; k < n; k++) {
+            kr[i][k] += 2. * vt[i][k];
+            kv[i][k] += 2. * a[i][k];
+            rt[i][k]  = part->r[i][k] + dt * vt[i][k];
+            vt[i][k]  = part->v[i][k] + dt * a[i][k];
+        }
+    }
+
+    /* stage 4 */
+    batchAccel(fm, n, rt, vt, part->CdAm, part->Am, a);
+    for(i = 1; i <= 3; i++) {
+        for(k = 0; k < n; k++) {
+            part->r[i][k] += h6 * (kr[i][k] + vt[i][k]);
+            part->v[i][k] += h6 * (kv[i][k] + a[i][k]);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  batchPropagate(state, fm, dt, numSteps)
+ *
+ *  Propagates the whole catalog by numSteps fixed RK4 steps of dt
+ *  seconds.  Each partition is stepped to the final epoch by its
+ *  owning thread without any synchronization between partitions.
+ */
+void batchPropagate(batchState *state, batchForceModel *fm, double dt, int numSteps)
+{
+    int p;
+
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts)
+    for(p = 0; p < state->numParts; p++) {
+        int j;
+
+        batchBindThread(state, p);
+        for(j = 0; j < numSteps; j++) {
+            batchStepRK4(fm, &state->part[p], dt);
+        }
+    }
+    state->t += numSteps * dt;
+
+    return;
+}
+
+/*
+ *  status = batchRecordPart(state, p, t)
+ *
+ *  Appends the current state of partition p to its step history,
+ *  starting a new segment when the last one is full.  Returns -1
+ *  if no segment could be allocated.
+ */
+static int batchRecordPart(batchState *state, int p, double t)
+{
+    batchPartition *part;
+    batchSegment   *seg;
+    size_t          head;
+    size_t          bytes;
+    int             n;
+    int             j;
+    int             c;
+
+    part = &state->part[p];
+    n    = part->n;
+    seg  = part->histTail;
+    if((seg == NULL) || (seg->numRecords == BATCH_SEGMENT_RECORDS)) {
+        head  = (sizeof(batchSegment) + 63) & ~(size_t)63;
+        bytes = head + 6 * BATCH_SEGMENT_RECORDS * (size_t)n * sizeof(double);
+        seg   = (batchSegment *)batchAlloc(state, p, bytes);
+        if(seg == NULL) {
+            return -1;
+        }
+        seg->next       = NULL;
+        seg->numRecords = 0;
+        seg->data       = (double *)((char *)seg + head);
+        if(part->histTail == NULL) {
+            part->histHead = seg;
+        } else {
+            part->histTail->next = seg;
+        }
+        part->histTail = seg;
+    }
+
+    j = seg->numRecords;
+    seg->t[j] = t;
+    for(c = 1; c <= 3; c++) {
+        memcpy(seg->data + (6 * (size_t)j + c - 1) * n, part->r[c], n * sizeof(double));
+        memcpy(seg->data + (6 * (size_t)j + c + 2) * n, part->v[c], n * sizeof(double));
+    }
+    seg->numRecords++;
+
+    return 0;
+}
+
+/*
+ *  status = batchRecord(state)
+ *
+ *  Appends the current catalog state to the step history.
+ *  Returns 0 on success and -1 if the history could not grow.
+ */
+int batchRecord(batchState *state)
+{
+    int p;
+    int failed;
+
+    failed = 0;
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts) reduction(+:failed)
+    for(p = 0; p < state->numParts; p++) {
+        batchBindThread(state, p);
+        if(batchRecordPart(state, p, state->t) != 0) {
+            failed++;
+        }
+    }
+    if(failed) {
+        printf("ERROR: batchRecord() could not extend the step history \n");
+        return -1;
+    }
+    state->numRecords++;
+
+    return 0;
+}
+
+/*
+ *  status = batchPropagateHistory(state, fm, dt, numSteps, every)
+ *
+ *  Same as batchPropagate(), but appends the catalog state to the
+ *  step history after every "every" steps.  The partitions advance
+ *  together from one record to the next.  Returns 0 on success and
+ *  -1 if the history could not grow, in which case the catalog
+ *  stops at the epoch of the failed record and the history is
+ *  incomplete and should be cleared.
+ */
+int batchPropagateHistory(batchState *state, batchForceModel *fm, double dt, int numSteps, int every)
+{
+    double t0;
+    int    steps;
+    int    len;
+    int    p;
+    int    failed;
+
+    if(every < 1) {
+        printf("ERROR: batchPropagateHistory() received every = %d \n", every);
+        printf("The value of every should be every >= 1. \n");
+        return -1;
+    }
+
+    t0     = state->t;
+    steps  = 0;
+    failed = 0;
+    while((steps < numSteps) && !failed) {
+        len = (numSteps - steps < every) ? numSteps - steps : every;
+        #pragma omp parallel for schedule(static, 1) num_threads(state->numParts) reduction(+:failed)
+        for(p = 0; p < state->numParts; p++) {
+            int j;
+
+            batchBindThread(state, p);
+            for(j = 0; j < len; j++) {
+                batchStepRK4(fm, &state->part[p], dt);
+            }
+            if((len == every) && (batchRecordPart(state, p, t0 + (steps + len) * dt) != 0)) {
+                failed++;
+            }
+        }
+        steps   += len;
+        state->t = t0 + steps * dt;
+        if((len == every) && !failed) {
+            state->numRecords++;
+        }
+    }
+    if(failed) {
+        printf("ERROR: batchPropagateHistory() could not extend the step history \n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ *  status = batchHistoryGet(state, k, j, *t, rVec, vVec)
+ *
+ *  Returns the epoch t and inertial state of catalog object k at
+ *  recorded history epoch j.  Returns -1 if k or j is invalid.
+ */
+int batchHistoryGet(batchState *state, int k, int j, double *t, double *rVec, double *vVec)
+{
+    batchPartition *part;
+    batchSegment   *seg;
+    int             p;
+    int             idx;
+    int             c;
+
+    p = batchFind(state, k, &idx);
+    if(p < 0) {
+        return -1;
+    }
+    if((j < 0) || (j >= state->numRecords)) {
+        printf("ERROR: batchHistoryGet() received j = %d \n", j);
+        printf("The value of j should be 0 <= j < %d. \n", state->numRecords);
+        return -1;
+    }
+    part = &state->part[p];
+    seg  = part->histHead;
+    while(j >= BATCH_SEGMENT_RECORDS) {
+        seg = seg->next;
+        j  -= BATCH_SEGMENT_RECORDS;
+    }
+
+    *t = seg->t[j];
+    for(c = 1; c <= 3; c++) {
+        rVec[c] = seg->data[(6 * (size_t)j + c - 1) * part->n + idx];
+        vVec[c] = seg->data[(6 * (size_t)j + c + 2) * part->n + idx];
+    }
+
+    return 0;
+}
+
+/*
+ *  batchHistoryClear(state)
+ *
+ *  Drops the recorded step history.  Segments carved from arenas
+ *  are reclaimed with the next arena reset.
+ */
+void batchHistoryClear(batchState *state)
+{
+    batchSegment *seg;
+    batchSegment *next;
+    size_t        bytes;
+    int           p;
+
+    for(p = 0; p < state->numParts; p++) {
+        bytes = ((sizeof(batchSegment) + 63) & ~(size_t)63)
+                + 6 * BATCH_SEGMENT_RECORDS * (size_t)state->part[p].n * sizeof(double);
+        for(seg = state->part[p].histHead; seg != NULL; seg = next) {
+            next = seg->next;
+            batchRelease(state, seg, bytes);
+        }
+        state->part[p].histHead = NULL;
+        state->part[p].histTail = NULL;
+    }
+    state->numRecords = 0;
+
+    return;
+}
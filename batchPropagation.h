@@ -0,0 +1,96 @@
+/*
+ *  batchPropagation.h
+ *  OrbitalMotion
+ *
+ *  Propagates a catalog of spacecraft in structure-of-arrays (SoA)
+ *  form.  The catalog is split into contiguous partitions, each of
+ *  which is allocated, first-touched and propagated by the same
+ *  worker thread so that its state buffers stay local to the NUMA
+ *  node that thread runs on.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "astroConstants.h"
+#include "vector3D.h"
+#include "orbitalMotion.h"
+#include "memArena.h"
+#include "gravityLattice.h"
+
+#ifndef _BATCH_PROPAGATION_H_
+#define _BATCH_PROPAGATION_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define BATCH_SCRATCH_ARRAYS    15
+    #define BATCH_SEGMENT_RECORDS   64
+
+    typedef struct batchSegmentStruct {
+        struct batchSegmentStruct *next;
+        int     numRecords;                     /* records stored in this segment */
+        double  t[BATCH_SEGMENT_RECORDS];       /* epoch of each record (sec) */
+        double *data;                           /* data[(6*j + c)*n + k]: state component c of object k, record j */
+    } batchSegment;
+
+    typedef struct batchPart {
+        int           node;         /* NUMA node the partition was first touched on */
+        int           first;        /* catalog index of the first object */
+        int           n;            /* number of objects in the partition */
+        double       *r[3+1];       /* inertial position components r[1..3][k] (km) */
+        double       *v[3+1];       /* inertial velocity components v[1..3][k] (km/s) */
+        double       *CdAm;         /* drag ballistic factor Cd*A/m (m^2/kg) */
+        double       *Am;           /* solar radiation area to mass ratio A/m (m^2/kg) */
+        double       *scratch;      /* integrator work space */
+        size_t        bytes;        /* size of the block backing all arrays above */
+        batchSegment *histHead;     /* recorded step history of the partition */
+        batchSegment *histTail;
+    } batchPartition;
+
+    typedef struct batchStateStruct {
+        int             n;          /* total number of catalog objects */
+        int             numParts;   /* number of partitions (= worker threads) */
+        int             numNodes;   /* NUMA nodes the partitions are spread over */
+        double          t;          /* current epoch (sec) */
+        int             numRecords; /* number of recorded history epochs */
+        memArenaSet    *arenas;     /* per-thread arenas, NULL if malloc() is used */
+        batchPartition *part;
+    } batchState;
+
+    typedef struct batchForce {
+        double mu;              /* gravitational constant (km^3/s^2) */
+        int    jnum;            /* zonal harmonics as in JPerturb(), 0 to disable */
+        int    drag;            /* non-zero to include AtmosphericDrag() */
+        int    srp;             /* non-zero to include SolarRad() */
+        double sunvec[3+1];     /* Sun to planet position vector (AU) for SolarRad() */
+        gravLattice *lattice;   /* zonal lattice, used if its jnum equals jnum, or NULL */
+    } batchForceModel;
+
+    int         batchNumaNodes(void);
+    void        batchBindThread(batchState *state, int p);
+    batchState *batchCreate(int n, int numParts);
+    batchState *batchCreateInArena(int n, memArenaSet *arenas);
+    void        batchFree(batchState *state);
+    int         batchFind(batchState *state, int k, int *idx);
+    void        batchSet(batchState *state, int k, double *rVec, double *vVec, double CdAm, double Am);
+    void        batchGet(batchState *state, int k, double *rVec, double *vVec);
+    void        batchScatter(batchState *state, double *r[3+1], double *v[3+1], double *CdAm, double *Am);
+    void        batchGather(batchState *state, double *r[3+1], double *v[3+1]);
+    void        batchInitForceModel(batchForceModel *fm);
+    void        batchAccel(batchForceModel *fm, int n, double *r[3+1], double *v[3+1],
+                           double *CdAm, double *Am, double *a[3+1]);
+    void        batchStepRK4(batchForceModel *fm, batchPartition *part, double dt);
+    void        batchPropagate(batchState *state, batchForceModel *fm, double dt, int numSteps);
+    int         batchRecord(batchState *state);
+    int         batchPropagateHistory(batchState *state, batchForceModel *fm, double dt, int numSteps, int every);
+    int         batchHistoryGet(batchState *state, int k, int j, double *t, double *rVec, double *vVec);
+    void        batchHistoryClear(batchState *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
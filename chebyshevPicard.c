@@ -0,0 +1,438 @@
+/*
+ *  chebyshevPicard.c
+ *  OrbitalMotion
+ *
+ *  On a segment [t0, t0 + dt] the time is mapped to tau in [-1 1] with
+ *  t = t0 + w (tau + 1), w = dt/2, and the equations of motion become
+ *  the Picard integrals
+ *
+ *      v(tau) = v0 + w int_-1^tau a(r, v) dtau
+ *      r(tau) = r0 + w int_-1^tau v dtau
+ *
+ *  The integrands are sampled at the Chebyshev-Gauss-Lobatto nodes
+ *  tau_j = -cos(j pi / N), fitted by the discrete cosine transform
+ *  of degree N and integrated term by term with
+ *
+ *      int T_0 = T_1,  int T_1 = T_2 / 4,
+ *      int T_k = T_(k+1) / (2(k+1)) - T_(k-1) / (2(k-1))
+ *
+ *  the constant making the integral vanish at tau = -1.  Fit and
+ *  integration are linear in the samples and are folded into the
+ *  matrix K, giving the N+2 coefficients of the integral, and the
+ *  matrix P = T K, giving its values at the nodes.  An iteration
+ *  then costs one force evaluation per node and two matrix-vector
+ *  products per component; the forces of all nodes are independent.
+ *  The iteration converges for segments that are short compared to
+ *  the orbit period, a quarter orbit being used by default.
+ *
+ *  References:
+ *  X. Bai and J. L. Junkins, "Modified Chebyshev-Picard Iteration
+ *  Methods for Orbit Propagation", J. Astronautical Sciences, 58(4),
+ *  2011.
+ */
+
+#include <string.h>
+#include "chebyshevPicard.h"
+#include "symplectic.h"
+
+/*
+ *  mc = mcpiCreate(fm, CdAm, Am, N, segment)
+ *
+ *  Sets up a propagator with polynomials of degree N (N+1 nodes per
+ *  segment) for the force model fm and the object parameters CdAm
+ *  and Am.  The segments are segment seconds long, or a quarter of
+ *  the osculating period at the start of each segment if segment is
+ *  not positive.  Returns NULL on failure.
+ */
+mcpiState *mcpiCreate(batchForceModel *fm, double CdAm, double Am, int N, double segment)
+{
+    mcpiState *mc;
+    double    *c;
+    double    *m;
+    double     s;
+    int        n1;
+    int        n2;
+    int        i;
+    int        j;
+    int        k;
+
+    if(N < 2) {
+        printf("ERROR: mcpiCreate() received N = %d \n", N);
+        printf("The value of N should be N >= 2. \n");
+        return NULL;
+    }
+    mc = (mcpiState *)malloc(sizeof(mcpiState));
+    if(mc == NULL) {
+        return NULL;
+    }
+    n1 = N + 1;
+    n2 = N + 2;
+    mc->mem = (double *)calloc((size_t)n1 * (n1 + n2 + 12) + (size_t)6 * n2, sizeof(double));
+    c = (double *)calloc((size_t)n2 + 1, sizeof(double));
+    if(mc->mem == NULL || c == NULL) {
+        free(mc->mem);
+        free(c);
+        free(mc);
+        return NULL;
+    }
+    mc->fm      = *fm;
+    mc->CdAm    = CdAm;
+    mc->Am      = Am;
+    mc->N       = N;
+    mc->segment = segment;
+    mc->tol     = 1e-12;
+    mc->maxIter = MCPI_MAX_ITER;
+    mc->t0      = 0.;
+    mc->t1      = 0.;
+    mc->numIter = 0;
+    mc->numEval = 0;
+
+    m = mc->mem;
+    mc->tau = m;
+    m += n1;
+    mc->K = m;
+    m += (size_t)n2 * n1;
+    mc->P = m;
+    m += (size_t)n1 * n1;
+    for(i = 1; i <= 3; i++) {
+        mc->r[i] = m;
+        mc->v[i] = m + n1;
+        mc->a[i] = m + 2 * n1;
+        m += 3 * n1;
+    }
+    for(i = 1; i <= 3; i++) {
+        mc->cr[i] = m;
+        mc->cv[i] = m + n2;
+        m += 2 * n2;
+    }
+    mc->CdAmNode = m;
+    mc->AmNode   = m + n1;
+    for(j = 0; j < n1; j++) {
+        mc->tau[j]      = -cos(j * M_PI / N);
+        mc->CdAmNode[j] = CdAm;
+        mc->AmNode[j]   = Am;
+    }
+
+    /* column j of K integrates the unit sample at node j */
+    for(j = 0; j < n1; j++) {
+        s = (j == 0 || j == N) ? 1. / N : 2. / N;
+        for(k = 0; k < n1; k++) {
+            c[k] = s * cos(k * (M_PI - j * M_PI / N));
+        }
+        c[0] *= 0.5;
+        c[N] *= 0.5;
+        c[n1] = 0.;
+        c[n2] = 0.;
+
+        mc->K[n1 + j] = c[0] - 0.5 * c[2];
+        s = mc->K[n1 + j];
+        for(k = 2; k < n2; k++) {
+            mc->K[k * n1 + j] = (c[k - 1] - c[k + 1]) / (2. * k);
+            s += (k % 2) ? mc->K[k * n1 + j] : -mc->K[k * n1 + j];
+        }
+        mc->K[j] = s;
+    }
+    for(i = 0; i < n1; i++) {
+        for(j = 0; j < n1; j++) {
+            s = 0.;
+            for(k = 0; k < n2; k++) {
+                s += cos(k * (M_PI - i * M_PI / N)) * mc->K[k * n1 + j];
+            }
+            mc->P[i * n1 + j] = s;
+        }
+    }
+    free(c);
+
+    return mc;
+}
+
+/*
+ *  mcpiFree(mc)
+ *
+ *  Releases a propagator created by mcpiCreate().
+ */
+void mcpiFree(mcpiState *mc)
+{
+    if(mc == NULL) {
+        return;
+    }
+    free(mc->mem);
+    free(mc);
+
+    return;
+}
+
+/*
+ *  mcpiAccel(mc)
+ *
+ *  Evaluates the force model at all nodes, in chunks of MCPI_CHUNK
+ *  nodes that are distributed over the threads.
+ */
+static void mcpiAccel(mcpiState *mc)
+{
+    int n1;
+    int numChunks;
+    int c;
+
+    n1        = mc->N + 1;
+    numChunks = (n1 + MCPI_CHUNK - 1) / MCPI_CHUNK;
+    #pragma omp parallel for schedule(static) if(n1 >= MCPI_PARALLEL_MIN)
+    for(c = 0; c < numChunks; c++) {
+        double *rs[3+1];
+        double *vs[3+1];
+        double *as[3+1];
+        int     k0;
+        int     cnt;
+        int     i;
+
+        k0  = c * MCPI_CHUNK;
+        cnt = (n1 - k0 < MCPI_CHUNK) ? n1 - k0 : MCPI_CHUNK;
+        for(i = 1; i <= 3; i++) {
+            rs[i] = mc->r[i] + k0;
+            vs[i] = mc->v[i] + k0;
+            as[i] = mc->a[i] + k0;
+        }
+        batchAccel(&mc->fm, cnt, rs, vs, mc->CdAmNode + k0, mc->AmNode + k0, as);
+    }
+    mc->numEval += n1;
+
+    return;
+}
+
+/*
+ *  change = mcpiIntegrate(mc, x0, w, f, x)
+ *
+ *  Replaces the node values x by x0 + w times the integral of the
+ *  samples f from tau = -1 and returns the largest change of x.
+ */
+static double mcpiIntegrate(mcpiState *mc, double x0, double w, double *f, double *x)
+{
+    double change;
+    int    n1;
+    int    i;
+
+    n1     = mc->N + 1;
+    change = 0.;
+    #pragma omp parallel for schedule(static) if(n1 >= MCPI_PARALLEL_MIN) reduction(max:change)
+    for(i = 0; i < n1; i++) {
+        double *p;
+        double  s;
+        int     j;
+
+        p = mc->P + (size_t)i * n1;
+        s = 0.;
+        for(j = 0; j < n1; j++) {
+            s += p[j] * f[j];
+        }
+        s = x0 + w * s;
+        if(fabs(s - x[i]) > change) {
+            change = fabs(s - x[i]);
+        }
+        x[i] = s;
+    }
+
+    return change;
+}
+
+/*
+ *  mcpiCoefficients(mc, x0, w, f, c)
+ *
+ *  Chebyshev coefficients c[0..N+1] of x0 + w times the integral of
+ *  the samples f from tau = -1.
+ */
+static void mcpiCoefficients(mcpiState *mc, double x0, double w, double *f, double *c)
+{
+    double s;
+    int    n1;
+    int    j;
+    int    k;
+
+    n1 = mc->N + 1;
+    for(k = 0; k <= n1; k++) {
+        s = 0.;
+        for(j = 0; j < n1; j++) {
+            s += mc->K[k * n1 + j] * f[j];
+        }
+        c[k] = w * s;
+    }
+    c[0] += x0;
+
+    return;
+}
+
+/*
+ *  iter = mcpiSegment(mc, t0, r0, v0, dt)
+ *
+ *  Integrates the segment from the state r0, v0 at time t0 over dt
+ *  seconds (dt may be negative).  The nodes are initialized with the
+ *  Kepler solution and iterated until the largest change of the node
+ *  positions and velocities falls below tol times |r0| and |v0|.
+ *  Returns the number of iterations, or -1 if the iteration did not
+ *  converge within maxIter, in which case the last iterate is kept.
+ */
+int mcpiSegment(mcpiState *mc, double t0, double *r0, double *v0, double dt)
+{
+    double w;
+    double dr;
+    double dv;
+    double x;
+    int    converged;
+    int    n1;
+    int    it;
+    int    i;
+    int    j;
+
+    if(dt == 0.) {
+        printf("ERROR: mcpiSegment() received dt = %g \n", dt);
+        printf("The value of dt should be non-zero. \n");
+        return -1;
+    }
+    n1 = mc->N + 1;
+    w  = dt / 2.;
+
+    #pragma omp parallel for schedule(static) if(n1 >= MCPI_PARALLEL_MIN)
+    for(j = 0; j < n1; j++) {
+        double rj[3+1];
+        double vj[3+1];
+        int    k;
+
+        equal(r0, rj);
+        equal(v0, vj);
+        symKeplerDrift(mc->fm.mu, rj, vj, w * (mc->tau[j] + 1.));
+        for(k = 1; k <= 3; k++) {
+            mc->r[k][j] = rj[k];
+            mc->v[k][j] = vj[k];
+        }
+    }
+
+    converged = 0;
+    for(it = 1; it <= mc->maxIter; it++) {
+        mcpiAccel(mc);
+        dr = 0.;
+        dv = 0.;
+        for(i = 1; i <= 3; i++) {
+            x = mcpiIntegrate(mc, v0[i], w, mc->a[i], mc->v[i]);
+            if(x > dv) {
+                dv = x;
+            }
+        }
+        for(i = 1; i <= 3; i++) {
+            x = mcpiIntegrate(mc, r0[i], w, mc->v[i], mc->r[i]);
+            if(x > dr) {
+                dr = x;
+            }
+        }
+        if(dr <= mc->tol * norm(r0) && dv <= mc->tol * norm(v0)) {
+            converged = 1;
+            break;
+        }
+    }
+    mc->numIter = converged ? it : mc->maxIter;
+
+    for(i = 1; i <= 3; i++) {
+        mcpiCoefficients(mc, v0[i], w, mc->a[i], mc->cv[i]);
+        mcpiCoefficients(mc, r0[i], w, mc->v[i], mc->cr[i]);
+    }
+    mc->t0 = t0;
+    mc->t1 = t0 + dt;
+
+    return converged ? it : -1;
+}
+
+/*
+ *  status = mcpiEval(mc, t, r, v)
+ *
+ *  Evaluates the polynomials of the last segment at time t.  Returns
+ *  -1 if t lies outside of the segment.
+ */
+int mcpiEval(mcpiState *mc, double t, double *r, double *v)
+{
+    double tau;
+    double br0;
+    double br1;
+    double bv0;
+    double bv1;
+    double b;
+    int    i;
+    int    k;
+
+    tau = 2. * (t - mc->t0) / (mc->t1 - mc->t0) - 1.;
+    if(mc->t1 == mc->t0 || fabs(tau) > 1. + 1e-12) {
+        printf("ERROR: mcpiEval() received t = %g \n", t);
+        printf("The value of t should lie in the segment [%g %g]. \n", mc->t0, mc->t1);
+        return -1;
+    }
+
+    /* Clenshaw recurrence */
+    for(i = 1; i <= 3; i++) {
+        br0 = 0.;
+        br1 = 0.;
+        bv0 = 0.;
+        bv1 = 0.;
+        for(k = mc->N + 1; k >= 1; k--) {
+            b   = 2. * tau * br0 - br1 + mc->cr[i][k];
+            br1 = br0;
+            br0 = b;
+            b   = 2. * tau * bv0 - bv1 + mc->cv[i][k];
+            bv1 = bv0;
+            bv0 = b;
+        }
+        r[i] = tau * br0 - br1 + mc->cr[i][0];
+        v[i] = tau * bv0 - bv1 + mc->cv[i][0];
+    }
+
+    return 0;
+}
+
+/*
+ *  iter = mcpiPropagate(mc, t0, t, r, v)
+ *
+ *  Propagates the state r, v from t0 to t segment by segment, the
+ *  last segment being shortened to end at t.  Returns the total
+ *  number of Picard iterations, or -1 if any segment did not
+ *  converge.  The polynomials of the last segment remain available
+ *  to mcpiEval().
+ */
+int mcpiPropagate(mcpiState *mc, double t0, double t, double *r, double *v)
+{
+    double tc;
+    double seg;
+    double rm;
+    double E;
+    double sma;
+    int    failed;
+    int    total;
+    int    it;
+    int    i;
+
+    failed = 0;
+    total  = 0;
+    tc     = t0;
+    while((t > t0) ? (tc < t) : (tc > t)) {
+        seg = mc->segment;
+        if(seg <= 0.) {
+            rm  = norm(r);
+            E   = dot(v, v) / 2. - mc->fm.mu / rm;
+            sma = (E < 0.) ? -mc->fm.mu / (2. * E) : rm;
+            seg = 0.5 * M_PI * sqrt(sma * sma * sma / mc->fm.mu);
+        }
+        if(seg >= fabs(t - tc)) {
+            seg = fabs(t - tc);
+        }
+        if(t < t0) {
+            seg = -seg;
+        }
+        it = mcpiSegment(mc, tc, r, v, seg);
+        if(it < 0) {
+            failed = 1;
+        }
+        total += mc->numIter;
+        for(i = 1; i <= 3; i++) {
+            r[i] = mc->r[i][mc->N];
+            v[i] = mc->v[i][mc->N];
+        }
+        tc = (seg == t - tc) ? t : tc + seg;
+    }
+
+    return failed ? -1 : total;
+}
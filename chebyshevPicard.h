@@ -0,0 +1,69 @@
+/*
+ *  chebyshevPicard.h
+ *  OrbitalMotion
+ *
+ *  Modified Chebyshev-Picard iteration (MCPI) of the batch force
+ *  model.  The trajectory is cut into segments, each approximated by
+ *  Chebyshev polynomials sampled at the N+1 Chebyshev-Gauss-Lobatto
+ *  nodes of the segment.  Every Picard iteration evaluates the force
+ *  model at all nodes with batchAccel(), the nodes being independent
+ *  and spread over the threads, and then integrates the fitted
+ *  acceleration twice with precomputed matrices.  The iteration of
+ *  each segment is warm started from the Kepler solution through the
+ *  segment's initial state.  The converged polynomials of the last
+ *  segment give the state anywhere inside it.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "batchPropagation.h"
+
+#ifndef _CHEBYSHEV_PICARD_H_
+#define _CHEBYSHEV_PICARD_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define MCPI_PARALLEL_MIN   32      /* smallest node set evaluated with several threads */
+    #define MCPI_CHUNK          8       /* nodes per batchAccel() call */
+    #define MCPI_MAX_ITER       40      /* default Picard iteration limit per segment */
+
+    typedef struct mcpiStateStruct {
+        batchForceModel fm;             /* force model */
+        double  CdAm;                   /* drag ballistic factor Cd*A/m (m^2/kg) */
+        double  Am;                     /* area to mass ratio A/m (m^2/kg) */
+        int     N;                      /* polynomial degree, N+1 nodes per segment */
+        double  segment;                /* segment length (sec), 0 for a quarter orbit */
+        double  tol;                    /* node change relative to |r0| that ends the iteration */
+        int     maxIter;                /* Picard iterations allowed per segment */
+        double *tau;                    /* tau[0..N], nodes on [-1 1] in increasing order */
+        double *K;                      /* K[k*(N+1)+j], coefficients of the integral from -1 */
+        double *P;                      /* P[i*(N+1)+j], node values of the integral from -1 */
+        double *r[3+1];                 /* r[i][j], node positions (km) */
+        double *v[3+1];                 /* v[i][j], node velocities (km/s) */
+        double *a[3+1];                 /* a[i][j], node accelerations (km/s^2) */
+        double *cr[3+1];                /* cr[i][0..N+1], Chebyshev coefficients of r */
+        double *cv[3+1];                /* cv[i][0..N+1], Chebyshev coefficients of v */
+        double *CdAmNode;               /* CdAm repeated for every node */
+        double *AmNode;                 /* Am repeated for every node */
+        double  t0;                     /* start of the last segment (sec) */
+        double  t1;                     /* end of the last segment (sec) */
+        int     numIter;                /* iterations of the last segment */
+        long    numEval;                /* force evaluations so far */
+        double *mem;                    /* block holding all the arrays */
+    } mcpiState;
+
+    mcpiState *mcpiCreate(batchForceModel *fm, double CdAm, double Am, int N, double segment);
+    void       mcpiFree(mcpiState *mc);
+    int        mcpiSegment(mcpiState *mc, double t0, double *r0, double *v0, double dt);
+    int        mcpiEval(mcpiState *mc, double t, double *r, double *v);
+    int        mcpiPropagate(mcpiState *mc, double t0, double t, double *r, double *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
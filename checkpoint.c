@@ -0,0 +1,576 @@
+/*
+ *  checkpoint.c
+ *  OrbitalMotion
+ *
+ *  Checkpoint file layout (native byte order):
+ *
+ *      header (64 bytes)
+ *           0  char[8]  magic "OMCKPT01"
+ *           8  uint32   number of sections
+ *          12  uint32   number of partitions of the writer
+ *          16  int64    number of catalog objects n
+ *          24  double   catalog epoch t (sec)
+ *          32  zero padding
+ *          60  uint32   CRC-32 of bytes 0..59
+ *      sections, each
+ *           0  char[8]  tag, zero padded
+ *           8  uint64   payload size in bytes
+ *          16  uint32   CRC-32 of the payload
+ *          20  uint32   0
+ *          24  payload
+ *
+ *  Every partition is stored in its own "PART" section holding the
+ *  int32 catalog index of its first object, the int32 number of
+ *  objects m, and the arrays x, y, z, vx, vy, vz, CdAm, Am of m
+ *  doubles each.  The caller's sections follow the partitions.
+ *
+ *  The section offsets only depend on the partition sizes, so every
+ *  worker writes its own partition at a known offset, without any
+ *  synchronization with the other workers.  The last worker to
+ *  finish a checkpoint writes the header and caller sections and
+ *  atomically renames the temporary file into place, so an
+ *  interrupted write never destroys the previous checkpoint.
+ *  Restoring the state recovers the exact bits written, so a
+ *  resumed propagation continues bit-identically.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC        "OMCKPT01"
+#define CHECKPOINT_HEADER       64
+#define CHECKPOINT_SECTION      24
+
+static uint32_t       crcTable[256];
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+static void checkpointCrcInit(void)
+{
+    uint32_t c;
+    int      i;
+    int      j;
+
+    for(i = 0; i < 256; i++) {
+        c = (uint32_t)i;
+        for(j = 0; j < 8; j++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[i] = c;
+    }
+
+    return;
+}
+
+/*
+ *  crc = checkpointCrc32(data, bytes, crc)
+ *
+ *  Updates the CRC-32 (IEEE 802.3) crc with bytes bytes of data.
+ *  Start with crc = 0.
+ */
+uint32_t checkpointCrc32(const void *data, size_t bytes, uint32_t crc)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t               i;
+
+    pthread_once(&crcOnce, checkpointCrcInit);
+    crc = ~crc;
+    for(i = 0; i < bytes; i++) {
+        crc = crcTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+/*
+ *  checkpointSetSection(sec, tag, data, bytes)
+ *
+ *  Describes a caller section.  Only the first 8 characters of tag
+ *  are used, and "PART" is reserved for the catalog partitions.
+ */
+void checkpointSetSection(checkpointSection *sec, const char *tag, void *data, size_t bytes)
+{
+    int i;
+
+    memset(sec->tag, 0, CHECKPOINT_TAG_LENGTH);
+    for(i = 0; (i < CHECKPOINT_TAG_LENGTH) && (tag[i] != '\0'); i++) {
+        sec->tag[i] = tag[i];
+    }
+    sec->data  = data;
+    sec->bytes = bytes;
+
+    return;
+}
+
+static size_t checkpointPartBytes(int n)
+{
+    return 2 * sizeof(int32_t) + 8 * (size_t)n * sizeof(double);
+}
+
+/*
+ *  status = checkpointPwrite(fd, data, bytes, offset)
+ *
+ *  pwrite() that retries after partial writes.
+ */
+static int checkpointPwrite(int fd, const void *data, size_t bytes, off_t offset)
+{
+    const char *p = (const char *)data;
+    ssize_t     n;
+
+    while(bytes > 0) {
+        n = pwrite(fd, p, bytes, offset);
+        if(n <= 0) {
+            return -1;
+        }
+        p      += n;
+        bytes  -= n;
+        offset += n;
+    }
+
+    return 0;
+}
+
+static int checkpointWriteSection(int fd, off_t offset, const char *tag, uint32_t crc, size_t bytes)
+{
+    unsigned char head[CHECKPOINT_SECTION];
+    uint64_t      len;
+
+    memset(head, 0, CHECKPOINT_SECTION);
+    memcpy(head, tag, CHECKPOINT_TAG_LENGTH);
+    len = (uint64_t)bytes;
+    memcpy(head + 8, &len, sizeof(len));
+    memcpy(head + 16, &crc, sizeof(crc));
+
+    return checkpointPwrite(fd, head, CHECKPOINT_SECTION, offset);
+}
+
+/*
+ *  status = checkpointWritePart(fd, offset, part)
+ *
+ *  Writes the "PART" section of one partition straight from the
+ *  partition arrays.  Called by the thread owning the partition.
+ */
+static int checkpointWritePart(int fd, off_t offset, batchPartition *part)
+{
+    char     tag[CHECKPOINT_TAG_LENGTH] = "PART";
+    int32_t  id[2];
+    double  *arr[8];
+    size_t   bytes;
+    uint32_t crc;
+    int      i;
+
+    id[0]  = part->first;
+    id[1]  = part->n;
+    for(i = 1; i <= 3; i++) {
+        arr[i - 1] = part->r[i];
+        arr[i + 2] = part->v[i];
+    }
+    arr[6] = part->CdAm;
+    arr[7] = part->Am;
+    bytes  = (size_t)part->n * sizeof(double);
+
+    crc = checkpointCrc32(id, sizeof(id), 0);
+    for(i = 0; i < 8; i++) {
+        crc = checkpointCrc32(arr[i], bytes, crc);
+    }
+    if(checkpointWriteSection(fd, offset, tag, crc, checkpointPartBytes(part->n)) != 0) {
+        return -1;
+    }
+    offset += CHECKPOINT_SECTION;
+    if(checkpointPwrite(fd, id, sizeof(id), offset) != 0) {
+        return -1;
+    }
+    offset += sizeof(id);
+    for(i = 0; i < 8; i++) {
+        if(checkpointPwrite(fd, arr[i], bytes, offset) != 0) {
+            return -1;
+        }
+        offset += bytes;
+    }
+
+    return 0;
+}
+
+/*
+ *  status = checkpointWriteTail(fd, offset, state, t, extra, numExtra)
+ *
+ *  Writes the caller sections starting at offset, the header,
+ *  truncates the file to its final length and flushes it to disk.
+ */
+static int checkpointWriteTail(int fd, off_t offset, batchState *state, double t,
+                               checkpointSection *extra, int numExtra)
+{
+    unsigned char head[CHECKPOINT_HEADER];
+    uint32_t      u;
+    int64_t       n;
+    uint32_t      crc;
+    int           i;
+
+    for(i = 0; i < numExtra; i++) {
+        crc = checkpointCrc32(extra[i].data, extra[i].bytes, 0);
+        if(checkpointWriteSection(fd, offset, extra[i].tag, crc, extra[i].bytes) != 0) {
+            return -1;
+        }
+        offset += CHECKPOINT_SECTION;
+        if(checkpointPwrite(fd, extra[i].data, extra[i].bytes, offset) != 0) {
+            return -1;
+        }
+        offset += extra[i].bytes;
+    }
+
+    memset(head, 0, CHECKPOINT_HEADER);
+    memcpy(head, CHECKPOINT_MAGIC, 8);
+    u = (uint32_t)(state->numParts + numExtra);
+    memcpy(head + 8, &u, sizeof(u));
+    u = (uint32_t)state->numParts;
+    memcpy(head + 12, &u, sizeof(u));
+    n = state->n;
+    memcpy(head + 16, &n, sizeof(n));
+    memcpy(head + 24, &t, sizeof(t));
+    crc = checkpointCrc32(head, CHECKPOINT_HEADER - 4, 0);
+    memcpy(head + CHECKPOINT_HEADER - 4, &crc, sizeof(crc));
+    if(checkpointPwrite(fd, head, CHECKPOINT_HEADER, 0) != 0) {
+        return -1;
+    }
+    if(ftruncate(fd, offset) != 0) {
+        return -1;
+    }
+
+    return fsync(fd);
+}
+
+/*
+ *  checkpointOffsets(state, offset)
+ *
+ *  Returns the file offset of every partition section in
+ *  offset[0..numParts-1] and of the caller sections in
+ *  offset[numParts].
+ */
+static void checkpointOffsets(batchState *state, off_t *offset)
+{
+    int p;
+
+    offset[0] = CHECKPOINT_HEADER;
+    for(p = 0; p < state->numParts; p++) {
+        offset[p + 1] = offset[p] + CHECKPOINT_SECTION + checkpointPartBytes(state->part[p].n);
+    }
+
+    return;
+}
+
+/*
+ *  status = checkpointWrite(fileName, state, extra, numExtra)
+ *
+ *  Writes a checkpoint of the catalog state together with numExtra
+ *  caller sections.  Each partition is written by the thread that
+ *  owns it.  The file is first written as "<fileName>.tmp" and then
+ *  renamed.  Returns 0 on success and -1 otherwise.
+ */
+int checkpointWrite(const char *fileName, batchState *state, checkpointSection *extra, int numExtra)
+{
+    char   tmpName[1024];
+    off_t *offset;
+    int    fd;
+    int    p;
+    int    failed;
+
+    pthread_once(&crcOnce, checkpointCrcInit);
+    snprintf(tmpName, sizeof(tmpName), "%s.tmp", fileName);
+    offset = (off_t *)malloc((state->numParts + 1) * sizeof(off_t));
+    fd     = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if((offset == NULL) || (fd < 0)) {
+        printf("ERROR: checkpointWrite() could not create %s \n", tmpName);
+        if(fd >= 0) {
+            close(fd);
+        }
+        free(offset);
+        return -1;
+    }
+    checkpointOffsets(state, offset);
+
+    failed = 0;
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts) reduction(+:failed)
+    for(p = 0; p < state->numParts; p++) {
+        batchBindThread(state, p);
+        if(checkpointWritePart(fd, offset[p], &state->part[p]) != 0) {
+            failed++;
+        }
+    }
+    if(!failed && (checkpointWriteTail(fd, offset[state->numParts], state, state->t, extra, numExtra) != 0)) {
+        failed++;
+    }
+    if(close(fd) != 0) {
+        failed++;
+    }
+    free(offset);
+    if(failed || (rename(tmpName, fileName) != 0)) {
+        printf("ERROR: checkpointWrite() could not write %s \n", fileName);
+        unlink(tmpName);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ *  state = checkpointRead(fileName, numParts, extra, numExtra)
+ *
+ *  Restores a catalog written by checkpointWrite() or
+ *  checkpointPropagate() into a new batch state with numParts
+ *  partitions (see batchCreate()), which may differ from the
+ *  partitioning of the writer.  The caller sections are matched by
+ *  tag and copied into extra[i].data, whose size must equal the
+ *  stored size.  Returns NULL if the file is corrupt (CRC mismatch),
+ *  incomplete, or a requested section is missing.
+ */
+batchState *checkpointRead(const char *fileName, int numParts, checkpointSection *extra, int numExtra)
+{
+    unsigned char head[CHECKPOINT_HEADER];
+    unsigned char sec[CHECKPOINT_SECTION];
+    batchState   *state;
+    FILE         *fp;
+    double       *flat;
+    double       *r[3+1];
+    double       *v[3+1];
+    char         *buf;
+    int          *found;
+    uint32_t      numSections;
+    uint32_t      crc;
+    uint64_t      bytes;
+    int64_t       n;
+    int32_t       id[2];
+    double        t;
+    long          covered;
+    uint32_t      s;
+    int           ok;
+    int           i;
+    int           j;
+
+    fp = fopen(fileName, "rb");
+    if(fp == NULL) {
+        printf("ERROR: checkpointRead() could not open %s \n", fileName);
+        return NULL;
+    }
+    if(fread(head, CHECKPOINT_HEADER, 1, fp) != 1) {
+        fclose(fp);
+        return NULL;
+    }
+    memcpy(&crc, head + CHECKPOINT_HEADER - 4, sizeof(crc));
+    if((memcmp(head, CHECKPOINT_MAGIC, 8) != 0) || (crc != checkpointCrc32(head, CHECKPOINT_HEADER - 4, 0))) {
+        printf("ERROR: checkpointRead() found a corrupt header in %s \n", fileName);
+        fclose(fp);
+        return NULL;
+    }
+    memcpy(&numSections, head + 8, sizeof(numSections));
+    memcpy(&n, head + 16, sizeof(n));
+    memcpy(&t, head + 24, sizeof(t));
+
+    flat  = (double *)malloc((8 * (size_t)n + 1) * sizeof(double));
+    found = (int *)calloc(numExtra + 1, sizeof(int));
+    buf   = NULL;
+    ok    = (flat != NULL) && (found != NULL);
+    covered = 0;
+
+    for(s = 0; ok && (s < numSections); s++) {
+        if(fread(sec, CHECKPOINT_SECTION, 1, fp) != 1) {
+            ok = 0;
+            break;
+        }
+        memcpy(&bytes, sec + 8, sizeof(bytes));
+        memcpy(&crc, sec + 16, sizeof(crc));
+        free(buf);
+        buf = (char *)malloc(bytes + 1);
+        if((buf == NULL) || (fread(buf, 1, bytes, fp) != bytes) || (checkpointCrc32(buf, bytes, 0) != crc)) {
+            printf("ERROR: checkpointRead() found a corrupt section %d in %s \n", (int)s, fileName);
+            ok = 0;
+            break;
+        }
+
+        if(memcmp(sec, "PART\0\0\0\0", CHECKPOINT_TAG_LENGTH) == 0) {
+            memcpy(id, buf, sizeof(id));
+            if((id[0] < 0) || (id[1] < 0) || ((int64_t)id[0] + id[1] > n)
+                    || (bytes != checkpointPartBytes(id[1]))) {
+                ok = 0;
+                break;
+            }
+            for(j = 0; j < 8; j++) {
+                memcpy(flat + j * n + id[0], buf + sizeof(id) + j * (size_t)id[1] * sizeof(double),
+                       (size_t)id[1] * sizeof(double));
+            }
+            covered += id[1];
+            continue;
+        }
+        for(i = 0; i < numExtra; i++) {
+            if(memcmp(sec, extra[i].tag, CHECKPOINT_TAG_LENGTH) == 0) {
+                if(bytes != extra[i].bytes) {
+                    printf("ERROR: checkpointRead() section %.8s holds %lu bytes, expected %lu \n",
+                           extra[i].tag, (unsigned long)bytes, (unsigned long)extra[i].bytes);
+                    ok = 0;
+                    break;
+                }
+                memcpy(extra[i].data, buf, bytes);
+                found[i] = 1;
+            }
+        }
+    }
+    free(buf);
+    fclose(fp);
+
+    for(i = 0; i < numExtra; i++) {
+        if(ok && !found[i]) {
+            printf("ERROR: checkpointRead() found no section %.8s in %s \n", extra[i].tag, fileName);
+            ok = 0;
+        }
+    }
+    if(ok && (covered != n)) {
+        printf("ERROR: checkpointRead() found %ld of %ld objects in %s \n", covered, (long)n, fileName);
+        ok = 0;
+    }
+
+    state = NULL;
+    if(ok) {
+        state = batchCreate((int)n, numParts);
+    }
+    if(state != NULL) {
+        for(i = 1; i <= 3; i++) {
+            r[i] = flat + (i - 1) * n;
+            v[i] = flat + (i + 2) * n;
+        }
+        batchScatter(state, r, v, flat + 6 * n, flat + 7 * n);
+        state->t = t;
+    }
+    free(flat);
+    free(found);
+
+    return state;
+}
+
+/*
+ *  status = checkpointPropagate(state, fm, dt, numSteps, every, fileName, extra, numExtra)
+ *
+ *  Same as batchPropagate(), but writes a checkpoint to fileName
+ *  after every "every" steps.  A worker only pauses to write its
+ *  own partition; the other workers keep propagating.  Checkpoint
+ *  c is assembled in "<fileName>.<c>.tmp" and renamed to fileName
+ *  once all partitions are written, unless writing failed or a later
+ *  checkpoint was already completed.  The caller sections must not change during
+ *  the propagation.  Returns 0 on success and -1 if any checkpoint
+ *  could not be written.
+ */
+int checkpointPropagate(batchState *state, batchForceModel *fm, double dt, int numSteps, int every,
+                        const char *fileName, checkpointSection *extra, int numExtra)
+{
+    off_t *offset;
+    int   *remaining;
+    int   *bad;
+    int    numCheckpoints;
+    int    lastDone;
+    int    failed;
+    double t0;
+    int    p;
+    int    c;
+
+    if(every < 1) {
+        printf("ERROR: checkpointPropagate() received every = %d \n", every);
+        printf("The value of every should be every >= 1. \n");
+        return -1;
+    }
+    pthread_once(&crcOnce, checkpointCrcInit);
+
+    numCheckpoints = numSteps / every;
+    offset    = (off_t *)malloc((state->numParts + 1) * sizeof(off_t));
+    remaining = (int *)malloc((2 * numCheckpoints + 1) * sizeof(int));
+    if((offset == NULL) || (remaining == NULL)) {
+        free(offset);
+        free(remaining);
+        return -1;
+    }
+    checkpointOffsets(state, offset);
+    bad = remaining + numCheckpoints;
+    for(c = 0; c < numCheckpoints; c++) {
+        remaining[c] = state->numParts;
+        bad[c]       = 0;
+    }
+
+    t0       = state->t;
+    lastDone = -1;
+    failed   = 0;
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts) reduction(+:failed)
+    for(p = 0; p < state->numParts; p++) {
+        char tmpName[1024];
+        int  fd;
+        int  left;
+        int  error;
+        int  j;
+        int  k;
+
+        batchBindThread(state, p);
+        for(j = 1; j <= numSteps; j++) {
+            batchStepRK4(fm, &state->part[p], dt);
+            if(j % every != 0) {
+                continue;
+            }
+            k = j / every - 1;
+            snprintf(tmpName, sizeof(tmpName), "%s.%d.tmp", fileName, k);
+
+            /* write this partition's section */
+            error = 0;
+            fd = open(tmpName, O_WRONLY | O_CREAT, 0644);
+            if((fd < 0) || (checkpointWritePart(fd, offset[p], &state->part[p]) != 0)) {
+                error = 1;
+            }
+            if((fd >= 0) && (close(fd) != 0)) {
+                error = 1;
+            }
+            if(error) {
+                failed++;
+                #pragma omp atomic write
+                bad[k] = 1;
+            }
+
+            #pragma omp atomic capture
+            left = --remaining[k];
+
+            /* the last partition to finish completes the checkpoint */
+            if(left == 0) {
+                #pragma omp atomic read
+                error = bad[k];
+                fd = -1;
+                if(!error) {
+                    fd = open(tmpName, O_WRONLY, 0644);
+                    if((fd < 0) || (checkpointWriteTail(fd, offset[state->numParts], state, t0 + j * dt,
+                                                        extra, numExtra) != 0)) {
+                        error = 1;
+                        failed++;
+                    }
+                }
+                if((fd >= 0) && (close(fd) != 0)) {
+                    error = 1;
+                    failed++;
+                }
+                #pragma omp critical(checkpointRename)
+                {
+                    if(!error && (k > lastDone) && (rename(tmpName, fileName) == 0)) {
+                        lastDone = k;
+                    } else {
+                        unlink(tmpName);
+                    }
+                }
+            }
+        }
+    }
+    state->t += numSteps * dt;
+
+    free(offset);
+    free(remaining);
+    if(failed) {
+        printf("ERROR: checkpointPropagate() could not write all checkpoints to %s \n", fileName);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ *  checkpoint.h
+ *  OrbitalMotion
+ *
+ *  Binary checkpoint/restart snapshots of batch propagations.  A
+ *  checkpoint holds the catalog epoch and SoA state of every
+ *  partition, plus any number of caller supplied tagged sections
+ *  (RNG streams, integrator step sizes, event detector state, ...).
+ *  Every section carries its own CRC-32.
+ *
+ *  Requires POSIX threads (link with -lpthread).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "batchPropagation.h"
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define CHECKPOINT_TAG_LENGTH   8
+
+    typedef struct checkpointSectionStruct {
+        char   tag[CHECKPOINT_TAG_LENGTH];  /* section name, zero padded */
+        void  *data;                        /* section payload */
+        size_t bytes;                       /* payload size */
+    } checkpointSection;
+
+    uint32_t    checkpointCrc32(const void *data, size_t bytes, uint32_t crc);
+    void        checkpointSetSection(checkpointSection *sec, const char *tag, void *data, size_t bytes);
+    int         checkpointWrite(const char *fileName, batchState *state, checkpointSection *extra, int numExtra);
+    batchState *checkpointRead(const char *fileName, int numParts, checkpointSection *extra, int numExtra);
+    int         checkpointPropagate(batchState *state, batchForceModel *fm, double dt, int numSteps, int every,
+                                    const char *fileName, checkpointSection *extra, int numExtra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
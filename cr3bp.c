@@ -0,0 +1,746 @@
+/*
+ *  cr3bp.c
+ *  OrbitalMotion
+ *
+ *  CR3BP dynamics, propagation and periodic orbit families.
+ *
+ *  The frame is centered at the barycenter, with the primary of
+ *  mass 1-mu at x = -mu and the secondary of mass mu at x = 1-mu;
+ *  lengths are scaled by the primary distance and times by the
+ *  inverse mean motion.  The propagated vector X[1..42] holds the
+ *  state in X[1..6] followed by the row-major state transition
+ *  matrix, Phi[i][j] = X[6 + 6*(i-1) + j].
+ *
+ *  Symmetric periodic orbits start on the x-z plane perpendicular
+ *  to it, x0 = [x 0 z 0 ydot 0], and cross it again perpendicularly
+ *  after half a period.  The shooting function drives y, xdot (and
+ *  zdot for spatial orbits) to zero at the free half period time.
+ *
+ *  Continuation: each step predicts numPar members along the family
+ *  tangent at 1, 2, ... numPar pseudo-arclength steps from the last
+ *  converged member and corrects all of them concurrently, each
+ *  with its own arclength constraint.  The converged members up to
+ *  the first failure are kept; if the first member fails the step
+ *  is halved.
+ *
+ *  References:
+ *  V. Szebehely, "Theory of Orbits", Academic Press, 1967.
+ *  K. C. Howell, "Three-Dimensional, Periodic, 'Halo' Orbits",
+ *  Celestial Mechanics 32, 1984, pp. 53-71.
+ *  J. R. Dormand and P. J. Prince, "A family of embedded Runge-Kutta
+ *  formulae", J. Comp. Appl. Math. 6, 1980, pp. 19-26.
+ */
+
+#include <string.h>
+#include "cr3bp.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define CR3BP_NX    42
+#define CR3BP_NV    4
+
+/* state components driven to zero and varied by the shooting */
+static const int cr3bpRows[2][3]  = {{2, 4, 0}, {2, 4, 6}};
+static const int cr3bpCols[2][3]  = {{1, 5, 0}, {1, 3, 5}};
+
+/*
+ *  mu = cr3bpMassRatio(mu1, mu2)
+ *
+ *  Returns the CR3BP mass ratio of the primary and secondary with
+ *  the gravitational constants mu1 and mu2.
+ */
+double cr3bpMassRatio(double mu1, double mu2)
+{
+    return mu2 / (mu1 + mu2);
+}
+
+/*
+ *  cr3bpEOM(mu, X, withSTM, dX)
+ *
+ *  Returns the time derivative dX of the CR3BP state X[1..6] and,
+ *  if withSTM is set, of the state transition matrix X[7..42].
+ */
+void cr3bpEOM(double mu, double *X, int withSTM, double *dX)
+{
+    double x;
+    double y;
+    double z;
+    double d1;
+    double d2;
+    double r1;
+    double r2;
+    double r13;
+    double r23;
+    double r15;
+    double r25;
+    double U[4][4];
+    double A;
+    int    i;
+    int    j;
+
+    x   = X[1];
+    y   = X[2];
+    z   = X[3];
+    d1  = x + mu;
+    d2  = x - 1. + mu;
+    r1  = sqrt(d1 * d1 + y * y + z * z);
+    r2  = sqrt(d2 * d2 + y * y + z * z);
+    r13 = (1. - mu) / (r1 * r1 * r1);
+    r23 = mu / (r2 * r2 * r2);
+
+    dX[1] = X[4];
+    dX[2] = X[5];
+    dX[3] = X[6];
+    dX[4] = 2. * X[5] + x - r13 * d1 - r23 * d2;
+    dX[5] = -2. * X[4] + y - r13 * y - r23 * y;
+    dX[6] = -r13 * z - r23 * z;
+    if(!withSTM) {
+        return;
+    }
+
+    r15 = 3. * r13 / (r1 * r1);
+    r25 = 3. * r23 / (r2 * r2);
+    U[1][1] = 1. - r13 - r23 + r15 * d1 * d1 + r25 * d2 * d2;
+    U[2][2] = 1. - r13 - r23 + (r15 + r25) * y * y;
+    U[3][3] = -r13 - r23 + (r15 + r25) * z * z;
+    U[1][2] = r15 * d1 * y + r25 * d2 * y;
+    U[1][3] = r15 * d1 * z + r25 * d2 * z;
+    U[2][3] = (r15 + r25) * y * z;
+    U[2][1] = U[1][2];
+    U[3][1] = U[1][3];
+    U[3][2] = U[2][3];
+
+    /* dPhi = [0 I; U 2W] Phi */
+    for(j = 1; j <= 6; j++) {
+        for(i = 1; i <= 3; i++) {
+            dX[6 + 6 * (i - 1) + j] = X[6 + 6 * (i + 2) + j];
+        }
+        for(i = 1; i <= 3; i++) {
+            A = U[i][1] * X[6 + j] + U[i][2] * X[12 + j] + U[i][3] * X[18 + j];
+            if(i == 1) {
+                A += 2. * X[30 + j];
+            } else if(i == 2) {
+                A -= 2. * X[24 + j];
+            }
+            dX[6 + 6 * (i + 2) + j] = A;
+        }
+    }
+
+    return;
+}
+
+/*
+ *  C = cr3bpJacobi(mu, x)
+ *
+ *  Returns the Jacobi constant of the state x[1..6].
+ */
+double cr3bpJacobi(double mu, double *x)
+{
+    double r1;
+    double r2;
+
+    r1 = sqrt((x[1] + mu) * (x[1] + mu) + x[2] * x[2] + x[3] * x[3]);
+    r2 = sqrt((x[1] - 1. + mu) * (x[1] - 1. + mu) + x[2] * x[2] + x[3] * x[3]);
+
+    return x[1] * x[1] + x[2] * x[2] + 2. * (1. - mu) / r1 + 2. * mu / r2
+           - (x[4] * x[4] + x[5] * x[5] + x[6] * x[6]);
+}
+
+/*
+ *  cr3bpLagrangePoints(mu, L)
+ *
+ *  Returns the positions L[k][1..3] of the five Lagrange points.
+ *  L1 lies between the primaries and L2 beyond the secondary.
+ */
+void cr3bpLagrangePoints(double mu, double L[5+1][3+1])
+{
+    double x;
+    double f;
+    double df;
+    double d1;
+    double d2;
+    double s1;
+    double s2;
+    double guess[3+1];
+    int    k;
+    int    i;
+
+    guess[1] = 1. - mu - cbrt(mu / 3.);
+    guess[2] = 1. - mu + cbrt(mu / 3.);
+    guess[3] = -mu - 1. + 5. * mu / 12.;
+    for(k = 1; k <= 3; k++) {
+        x = guess[k];
+        for(i = 0; i < 50; i++) {
+            d1 = x + mu;
+            d2 = x - 1. + mu;
+            s1 = d1 > 0. ? 1. : -1.;
+            s2 = d2 > 0. ? 1. : -1.;
+            f  = x - (1. - mu) * s1 / (d1 * d1) - mu * s2 / (d2 * d2);
+            df = 1. + 2. * (1. - mu) / fabs(d1 * d1 * d1) + 2. * mu / fabs(d2 * d2 * d2);
+            x -= f / df;
+            if(fabs(f / df) < 1e-15) {
+                break;
+            }
+        }
+        L[k][1] = x;
+        L[k][2] = 0.;
+        L[k][3] = 0.;
+    }
+    L[4][1] = 0.5 - mu;
+    L[4][2] = sqrt(3.) / 2.;
+    L[4][3] = 0.;
+    L[5][1] = 0.5 - mu;
+    L[5][2] = -sqrt(3.) / 2.;
+    L[5][3] = 0.;
+
+    return;
+}
+
+/*
+ *  status = cr3bpIntegrate(mu, X, nx, t, tol)
+ *
+ *  Integrates the state (nx = 6) or state and STM (nx = 42) vector
+ *  X over the time t with the Dormand-Prince 5(4) method and a
+ *  mixed absolute/relative error tolerance tol.
+ */
+static int cr3bpIntegrate(double mu, double *X, int nx, double t, double tol)
+{
+    static const double a[8][7] = {
+        {0.},
+        {0.},
+        {0., 1./5.},
+        {0., 3./40., 9./40.},
+        {0., 44./45., -56./15., 32./9.},
+        {0., 19372./6561., -25360./2187., 64448./6561., -212./729.},
+        {0., 9017./3168., -355./33., 46732./5247., 49./176., -5103./18656.},
+        {0., 35./384., 0., 500./1113., 125./192., -2187./6784., 11./84.}
+    };
+    static const double e[8] = {0., 71./57600., 0., -71./16695., 71./1920.,
+                                -17253./339200., 22./525., -1./40.};
+    double k[8][CR3BP_NX+1];
+    double Y[CR3BP_NX+1];
+    double tNow;
+    double h;
+    double err;
+    double sc;
+    double d;
+    double dir;
+    int    steps;
+    int    i;
+    int    j;
+    int    s;
+
+    if(t == 0.) {
+        return 0;
+    }
+    dir  = t > 0. ? 1. : -1.;
+    h    = dir * fmin(fabs(t), 1e-2);
+    tNow = 0.;
+    cr3bpEOM(mu, X, nx == CR3BP_NX, k[1]);
+
+    for(steps = 0; steps < CR3BP_MAX_STEPS; steps++) {
+        if(dir * (tNow + h - t) > 0.) {
+            h = t - tNow;
+        }
+        for(s = 2; s <= 7; s++) {
+            for(i = 1; i <= nx; i++) {
+                d = 0.;
+                for(j = 1; j < s; j++) {
+                    d += a[s][j] * k[j][i];
+                }
+                Y[i] = X[i] + h * d;
+            }
+            cr3bpEOM(mu, Y, nx == CR3BP_NX, k[s]);
+        }
+
+        err = 0.;
+        for(i = 1; i <= nx; i++) {
+            d = 0.;
+            for(s = 1; s <= 7; s++) {
+                d += e[s] * k[s][i];
+            }
+            sc   = tol * (1. + fmax(fabs(X[i]), fabs(Y[i])));
+            err += (h * d / sc) * (h * d / sc);
+        }
+        err = sqrt(err / nx);
+
+        if(err <= 1.) {
+            tNow += h;
+            memcpy(X, Y, (nx + 1) * sizeof(double));
+            memcpy(k[1], k[7], (nx + 1) * sizeof(double));
+            if(dir * (tNow - t) >= 0.) {
+                return 0;
+            }
+        }
+        h *= fmin(5., fmax(0.2, 0.9 * pow(err > 0. ? err : 1e-10, -0.2)));
+    }
+
+    printf("ERROR: cr3bpIntegrate() exceeded %d steps \n", CR3BP_MAX_STEPS);
+    printf("The tolerance tol = %g may be too small. \n", tol);
+
+    return -1;
+}
+
+/*
+ *  status = cr3bpPropagate(mu, x0, t, tol, xf, Phi)
+ *
+ *  Propagates the CR3BP state x0[1..6] over the nondimensional time
+ *  t (negative for backward propagation) to xf[1..6].  If Phi is
+ *  not NULL, the 6x6 state transition matrix Phi[1..6][1..6] is
+ *  integrated alongside.  Returns 0 on success.
+ */
+int cr3bpPropagate(double mu, double *x0, double t, double tol, double *xf, double Phi[7][7])
+{
+    double X[CR3BP_NX+1];
+    int    nx;
+    int    i;
+    int    j;
+
+    memset(X, 0, sizeof(X));
+    for(i = 1; i <= 6; i++) {
+        X[i] = x0[i];
+    }
+    nx = 6;
+    if(Phi != NULL) {
+        nx = CR3BP_NX;
+        for(i = 1; i <= 6; i++) {
+            X[6 + 6 * (i - 1) + i] = 1.;
+        }
+    }
+    if(cr3bpIntegrate(mu, X, nx, t, tol) != 0) {
+        return -1;
+    }
+    for(i = 1; i <= 6; i++) {
+        xf[i] = X[i];
+    }
+    if(Phi != NULL) {
+        for(i = 1; i <= 6; i++) {
+            for(j = 1; j <= 6; j++) {
+                Phi[i][j] = X[6 + 6 * (i - 1) + j];
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ *  cr3bpVars2Orbit(mu, type, V, orbit)
+ *
+ *  Maps the free variables V into the orbit initial state.
+ */
+static void cr3bpVars2Orbit(double mu, int type, double *V, cr3bpOrbit *orbit)
+{
+    int m;
+    int j;
+
+    m = type == CR3BP_SPATIAL ? 3 : 2;
+    memset(orbit->x0, 0, sizeof(orbit->x0));
+    for(j = 1; j <= m; j++) {
+        orbit->x0[cr3bpCols[type][j - 1]] = V[j];
+    }
+    orbit->T = 2. * V[m + 1];
+    orbit->C = cr3bpJacobi(mu, orbit->x0);
+
+    return;
+}
+
+/*
+ *  status = cr3bpShoot(mu, type, V, tol, F, DF)
+ *
+ *  Evaluates the half period shooting function F[1..m] and its
+ *  m x (m+1) Jacobian DF with respect to the free variables V.
+ */
+static int cr3bpShoot(double mu, int type, double *V, double tol, double *F, double DF[CR3BP_NV+1][CR3BP_NV+1])
+{
+    cr3bpOrbit orbit;
+    double     xf[6+1];
+    double     f[6+1];
+    double     Phi[7][7];
+    int        m;
+    int        i;
+    int        j;
+
+    m = type == CR3BP_SPATIAL ? 3 : 2;
+    cr3bpVars2Orbit(mu, type, V, &orbit);
+    if(cr3bpPropagate(mu, orbit.x0, V[m + 1], tol, xf, Phi) != 0) {
+        return -1;
+    }
+    cr3bpEOM(mu, xf, 0, f);
+    for(i = 1; i <= m; i++) {
+        F[i] = xf[cr3bpRows[type][i - 1]];
+        for(j = 1; j <= m; j++) {
+            DF[i][j] = Phi[cr3bpRows[type][i - 1]][cr3bpCols[type][j - 1]];
+        }
+        DF[i][m + 1] = f[cr3bpRows[type][i - 1]];
+    }
+
+    return 0;
+}
+
+/*
+ *  status = cr3bpSolve(n, A, b, x)
+ *
+ *  Solves the n x n linear system A x = b (n <= CR3BP_NV) by
+ *  Gaussian elimination with partial pivoting.  A and b are
+ *  overwritten.  Returns -1 if A is singular.
+ */
+static int cr3bpSolve(int n, double A[CR3BP_NV+1][CR3BP_NV+1], double *b, double *x)
+{
+    double t;
+    int    p;
+    int    i;
+    int    j;
+    int    k;
+
+    for(k = 1; k <= n; k++) {
+        p = k;
+        for(i = k + 1; i <= n; i++) {
+            if(fabs(A[i][k]) > fabs(A[p][k])) {
+                p = i;
+            }
+        }
+        if(A[p][k] == 0.) {
+            return -1;
+        }
+        for(j = 1; j <= n; j++) {
+            t       = A[k][j];
+            A[k][j] = A[p][j];
+            A[p][j] = t;
+        }
+        t    = b[k];
+        b[k] = b[p];
+        b[p] = t;
+        for(i = k + 1; i <= n; i++) {
+            t = A[i][k] / A[k][k];
+            for(j = k; j <= n; j++) {
+                A[i][j] -= t * A[k][j];
+            }
+            b[i] -= t * b[k];
+        }
+    }
+    for(k = n; k >= 1; k--) {
+        t = b[k];
+        for(j = k + 1; j <= n; j++) {
+            t -= A[k][j] * x[j];
+        }
+        x[k] = t / A[k][k];
+    }
+
+    return 0;
+}
+
+/*
+ *  cr3bpTangent(m, DF, ref, t)
+ *
+ *  Returns the unit null vector t[1..m+1] of the m x (m+1) matrix
+ *  DF from its signed minors, oriented along ref (or with
+ *  t[1] >= 0 if ref is NULL).
+ */
+static void cr3bpTangent(int m, double DF[CR3BP_NV+1][CR3BP_NV+1], double *ref, double *t)
+{
+    double M[CR3BP_NV+1][CR3BP_NV+1];
+    double det;
+    double s;
+    double d;
+    int    col;
+    int    i;
+    int    j;
+    int    k;
+    int    c;
+    int    p;
+
+    for(col = 1; col <= m + 1; col++) {
+        for(i = 1; i <= m; i++) {
+            c = 1;
+            for(j = 1; j <= m + 1; j++) {
+                if(j != col) {
+                    M[i][c++] = DF[i][j];
+                }
+            }
+        }
+        /* determinant by elimination with partial pivoting */
+        det = 1.;
+        for(k = 1; k <= m; k++) {
+            p = k;
+            for(i = k + 1; i <= m; i++) {
+                if(fabs(M[i][k]) > fabs(M[p][k])) {
+                    p = i;
+                }
+            }
+            if(p != k) {
+                for(j = 1; j <= m; j++) {
+                    d       = M[k][j];
+                    M[k][j] = M[p][j];
+                    M[p][j] = d;
+                }
+                det = -det;
+            }
+            det *= M[k][k];
+            if(M[k][k] == 0.) {
+                break;
+            }
+            for(i = k + 1; i <= m; i++) {
+                d = M[i][k] / M[k][k];
+                for(j = k; j <= m; j++) {
+                    M[i][j] -= d * M[k][j];
+                }
+            }
+        }
+        t[col] = (col % 2 ? 1. : -1.) * det;
+    }
+
+    s = 0.;
+    d = 0.;
+    for(j = 1; j <= m + 1; j++) {
+        s += t[j] * t[j];
+        d += ref != NULL ? t[j] * ref[j] : (j == 1 ? t[j] : 0.);
+    }
+    s = (d < 0. ? -1. : 1.) / sqrt(s);
+    for(j = 1; j <= m + 1; j++) {
+        t[j] *= s;
+    }
+
+    return;
+}
+
+/*
+ *  status = cr3bpCorrect(mu, orbit, type, fix, tol)
+ *
+ *  Single-shooting differential correction of a symmetric periodic
+ *  orbit.  The initial guess orbit->x0 and orbit->T are corrected
+ *  while keeping x0 (fix = CR3BP_FIX_X0) or, for spatial orbits, z0
+ *  (fix = CR3BP_FIX_Z0) constant.  The integration tolerance is tol
+ *  and the orbit is converged when the half period crossing
+ *  residuals are below 100 tol.  Returns 0 on convergence and -1
+ *  if the iteration fails or the half period becomes non-positive.
+ */
+int cr3bpCorrect(double mu, cr3bpOrbit *orbit, int type, int fix, double tol)
+{
+    double V[CR3BP_NV+1];
+    double F[CR3BP_NV+1];
+    double DF[CR3BP_NV+1][CR3BP_NV+1];
+    double A[CR3BP_NV+1][CR3BP_NV+1];
+    double b[CR3BP_NV+1];
+    double dV[CR3BP_NV+1];
+    double res;
+    int    m;
+    int    skip;
+    int    iter;
+    int    i;
+    int    j;
+    int    c;
+
+    if((type != CR3BP_PLANAR) && (type != CR3BP_SPATIAL)) {
+        printf("ERROR: cr3bpCorrect() received type = %d \n", type);
+        printf("The value of type should be CR3BP_PLANAR or CR3BP_SPATIAL. \n");
+        return -1;
+    }
+    m    = type == CR3BP_SPATIAL ? 3 : 2;
+    skip = 1;
+    if((fix == CR3BP_FIX_Z0) && (type == CR3BP_SPATIAL)) {
+        skip = 2;
+    } else if(fix != CR3BP_FIX_X0) {
+        printf("ERROR: cr3bpCorrect() received fix = %d \n", fix);
+        printf("The value of fix should be CR3BP_FIX_X0, or CR3BP_FIX_Z0 for spatial orbits. \n");
+        return -1;
+    }
+    for(j = 1; j <= m; j++) {
+        V[j] = orbit->x0[cr3bpCols[type][j - 1]];
+    }
+    V[m + 1] = orbit->T / 2.;
+
+    for(iter = 0; iter < CR3BP_MAX_ITER; iter++) {
+        if((V[m + 1] <= 0.) || (cr3bpShoot(mu, type, V, tol, F, DF) != 0)) {
+            return -1;
+        }
+        res = 0.;
+        for(i = 1; i <= m; i++) {
+            res = fmax(res, fabs(F[i]));
+        }
+        if(res < 100. * tol) {
+            cr3bpVars2Orbit(mu, type, V, orbit);
+            return 0;
+        }
+        for(i = 1; i <= m; i++) {
+            c = 1;
+            for(j = 1; j <= m + 1; j++) {
+                if(j != skip) {
+                    A[i][c++] = DF[i][j];
+                }
+            }
+            b[i] = -F[i];
+        }
+        if(cr3bpSolve(m, A, b, dV) != 0) {
+            return -1;
+        }
+        c = 1;
+        for(j = 1; j <= m + 1; j++) {
+            if(j != skip) {
+                V[j] += dV[c++];
+            }
+        }
+    }
+
+    return -1;
+}
+
+/*
+ *  status = cr3bpArclength(mu, type, Vs, ts, ds, tol, V, DF)
+ *
+ *  Corrects V onto the family with the pseudo-arclength constraint
+ *  (V - Vs).ts = ds.  Returns the Jacobian DF at the solution.
+ */
+static int cr3bpArclength(double mu, int type, double *Vs, double *ts, double ds, double tol,
+                          double *V, double DF[CR3BP_NV+1][CR3BP_NV+1])
+{
+    double F[CR3BP_NV+1];
+    double A[CR3BP_NV+1][CR3BP_NV+1];
+    double b[CR3BP_NV+1];
+    double dV[CR3BP_NV+1];
+    double res;
+    int    m;
+    int    iter;
+    int    i;
+    int    j;
+
+    m = type == CR3BP_SPATIAL ? 3 : 2;
+    for(iter = 0; iter < CR3BP_MAX_ITER; iter++) {
+        if((V[m + 1] <= 0.) || (cr3bpShoot(mu, type, V, tol, F, DF) != 0)) {
+            return -1;
+        }
+        F[m + 1] = -ds;
+        for(j = 1; j <= m + 1; j++) {
+            F[m + 1] += (V[j] - Vs[j]) * ts[j];
+        }
+        res = 0.;
+        for(i = 1; i <= m + 1; i++) {
+            res = fmax(res, fabs(F[i]));
+        }
+        if(res < 100. * tol) {
+            return 0;
+        }
+        for(i = 1; i <= m + 1; i++) {
+            for(j = 1; j <= m + 1; j++) {
+                A[i][j] = i <= m ? DF[i][j] : ts[j];
+            }
+            b[i] = -F[i];
+        }
+        if(cr3bpSolve(m + 1, A, b, dV) != 0) {
+            return -1;
+        }
+        for(j = 1; j <= m + 1; j++) {
+            V[j] += dV[j];
+        }
+    }
+
+    return -1;
+}
+
+/*
+ *  count = cr3bpFamily(mu, seed, type, ds, num, numPar, tol, family)
+ *
+ *  Pseudo-arclength continuation of the family of symmetric
+ *  periodic orbits through the converged orbit seed (see
+ *  cr3bpCorrect()).  Up to num members, starting with the seed, are
+ *  returned in family[0..count-1], spaced by the pseudo-arclength
+ *  ds in the free variables (x0, [z0,] ydot0, T/2).  ds > 0
+ *  continues in the direction of increasing x0.  numPar members are
+ *  predicted and corrected concurrently per step (the number of
+ *  OpenMP threads if numPar <= 0); the results depend on numPar but
+ *  not on the thread count.
+ */
+int cr3bpFamily(double mu, cr3bpOrbit *seed, int type, double ds, int num, int numPar,
+                double tol, cr3bpOrbit *family)
+{
+    double  Vs[CR3BP_NV+1];
+    double  ts[CR3BP_NV+1];
+    double  F[CR3BP_NV+1];
+    double  DF[CR3BP_NV+1][CR3BP_NV+1];
+    double (*V)[CR3BP_NV+1];
+    double (*DFk)[CR3BP_NV+1][CR3BP_NV+1];
+    int    *ok;
+    int     count;
+    int     accepted;
+    int     m;
+    int     K;
+    int     k;
+    int     j;
+
+    if((type != CR3BP_PLANAR) && (type != CR3BP_SPATIAL)) {
+        printf("ERROR: cr3bpFamily() received type = %d \n", type);
+        printf("The value of type should be CR3BP_PLANAR or CR3BP_SPATIAL. \n");
+        return 0;
+    }
+    if(num < 1) {
+        return 0;
+    }
+    if(numPar <= 0) {
+#ifdef _OPENMP
+        numPar = omp_get_max_threads();
+#else
+        numPar = 1;
+#endif
+    }
+    V   = malloc(numPar * sizeof(*V));
+    DFk = malloc(numPar * sizeof(*DFk));
+    ok  = malloc(numPar * sizeof(int));
+    if((V == NULL) || (DFk == NULL) || (ok == NULL)) {
+        free(V);
+        free(DFk);
+        free(ok);
+        return 0;
+    }
+
+    m = type == CR3BP_SPATIAL ? 3 : 2;
+    for(j = 1; j <= m; j++) {
+        Vs[j] = seed->x0[cr3bpCols[type][j - 1]];
+    }
+    Vs[m + 1] = seed->T / 2.;
+    family[0] = *seed;
+    count     = 1;
+    if(cr3bpShoot(mu, type, Vs, tol, F, DF) != 0) {
+        num = 1;
+    }
+    cr3bpTangent(m, DF, NULL, ts);
+
+    while(count < num) {
+        K = numPar < num - count ? numPar : num - count;
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(k = 0; k < K; k++) {
+            int i;
+
+            for(i = 1; i <= m + 1; i++) {
+                V[k][i] = Vs[i] + (k + 1) * ds * ts[i];
+            }
+            ok[k] = cr3bpArclength(mu, type, Vs, ts, (k + 1) * ds, tol, V[k], DFk[k]) == 0;
+        }
+
+        accepted = 0;
+        while((accepted < K) && ok[accepted]) {
+            cr3bpVars2Orbit(mu, type, V[accepted], &family[count++]);
+            accepted++;
+        }
+        if(accepted == 0) {
+            ds /= 2.;
+            if(fabs(ds) < 1e-9) {
+                break;
+            }
+            continue;
+        }
+        for(j = 1; j <= m + 1; j++) {
+            Vs[j] = V[accepted - 1][j];
+        }
+        memcpy(F, ts, sizeof(F));
+        cr3bpTangent(m, DFk[accepted - 1], F, ts);
+    }
+
+    free(V);
+    free(DFk);
+    free(ok);
+
+    return count;
+}
@@ -0,0 +1,58 @@
+/*
+ *  cr3bp.h
+ *  OrbitalMotion
+ *
+ *  Circular restricted three-body problem (CR3BP) in the
+ *  nondimensional rotating frame: equations of motion with the
+ *  state transition matrix, an adaptive Dormand-Prince propagator,
+ *  Lagrange points, single-shooting correction of periodic orbits
+ *  that are symmetric about the x-z plane (planar Lyapunov and halo
+ *  orbits) and pseudo-arclength continuation of their families,
+ *  with the members of each continuation step corrected in
+ *  parallel.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "astroConstants.h"
+
+#ifndef _CR3BP_H_
+#define _CR3BP_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define CR3BP_EARTH_MOON    (MU_MOON / (MU_EARTH + MU_MOON))
+
+    #define CR3BP_PLANAR        0       /* planar orbit, free variables x0, ydot0, T/2 */
+    #define CR3BP_SPATIAL       1       /* spatial orbit, free variables x0, z0, ydot0, T/2 */
+
+    #define CR3BP_FIX_X0        1       /* single shooting keeps x0 */
+    #define CR3BP_FIX_Z0        3       /* single shooting keeps z0 */
+
+    #define CR3BP_MAX_STEPS     1000000
+    #define CR3BP_MAX_ITER      25
+
+    typedef struct cr3bpOrbitStruct {
+        double x0[6+1];             /* initial state on the x-z plane, y0 = xdot0 = zdot0 = 0 */
+        double T;                   /* period */
+        double C;                   /* Jacobi constant */
+    } cr3bpOrbit;
+
+    double cr3bpMassRatio(double mu1, double mu2);
+    void   cr3bpEOM(double mu, double *X, int withSTM, double *dX);
+    double cr3bpJacobi(double mu, double *x);
+    void   cr3bpLagrangePoints(double mu, double L[5+1][3+1]);
+    int    cr3bpPropagate(double mu, double *x0, double t, double tol, double *xf, double Phi[7][7]);
+    int    cr3bpCorrect(double mu, cr3bpOrbit *orbit, int type, int fix, double tol);
+    int    cr3bpFamily(double mu, cr3bpOrbit *seed, int type, double ds, int num, int numPar,
+                       double tol, cr3bpOrbit *family);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
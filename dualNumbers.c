@@ -0,0 +1,1141 @@
+/*
+ *  dualNumbers.c
+ *  OrbitalMotion
+ *
+ *  Every operation c = f(a, b) sets c.v = f(a.v, b.v) and applies
+ *  the chain rule c.d = df/da a.d + df/db b.d to the fixed width
+ *  tangent arrays, whose loops the compiler unrolls and vectorizes.
+ *  All operations allow the output to alias an input.  Branches of
+ *  the kernels are taken on the values, so derivatives are those of
+ *  the branch in effect; at the branch points (circular, equatorial
+ *  or parabolic orbits) the elements are not differentiable.
+ *
+ *  The zonal accelerations of dualJPerturb() and dualAccel() are
+ *  written with rho = 1/r and s = z/r as
+ *
+ *      a_x,y = rho^4 PX(rho, s) (x, y)/r,    a_z = rho^4 PZ(rho, s)
+ *      PX    = sum_n JP_Cn rho^(n-2) Px_n(s)
+ *
+ *  with the constants JP_Cn of orbitalMotion.h and the polynomials of
+ *  JPerturb() tabulated in dualZonalPx/Pz, and PZ likewise.  PX, PZ
+ *  and their derivatives in rho and s are summed by Horner's rule, so
+ *  the 3x3 gradient of the acceleration costs a few dozen products
+ *  and the tangents follow from it by the chain rule.
+ *
+ *  References:
+ *  L. B. Rall, "Automatic Differentiation: Techniques and
+ *  Applications", Springer, 1981.
+ *  A. Griewank and A. Walther, "Evaluating Derivatives", 2nd ed.,
+ *  SIAM, 2008, chapter 3.
+ */
+
+#include <string.h>
+#include "dualNumbers.h"
+#include "orbitalMotion.h"
+
+#define DUAL_EPS    0.000000000001
+
+/* JPerturb() polynomial coefficients in u = z/r, lowest power first */
+static const double dualZonalPx[6+1][7+1] = {
+    {0.},
+    {0.},
+    {1., 0., -5.},
+    {0., -15., 0., 35.},
+    {3., 0., -42., 0., 63.},
+    {0., 105., 0., -630., 0., 693.},
+    {35., 0., -945., 0., 3465., 0., -3003.}
+};
+static const double dualZonalPz[6+1][7+1] = {
+    {0.},
+    {0.},
+    {0., 3., 0., -5.},
+    {3., 0., -30., 0., 35.},
+    {0., 15., 0., -70., 0., 63.},
+    {-15., 0., 315., 0., -945., 0., 693.},
+    {0., 245., 0., -2205., 0., 4851., 0., -3003.}
+};
+
+/*
+ *  dualSet(v, c)
+ *
+ *  Sets c to the constant v.
+ */
+void dualSet(double v, dual *c)
+{
+    int k;
+
+    c->v = v;
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = 0.;
+    }
+
+    return;
+}
+
+/*
+ *  dualVar(v, k, c)
+ *
+ *  Sets c to the independent input number k (1..DUAL_WIDTH) with
+ *  value v.
+ */
+void dualVar(double v, int k, dual *c)
+{
+    dualSet(v, c);
+    if((k < 1) || (k > DUAL_WIDTH)) {
+        printf("ERROR: dualVar() received k = %d \n", k);
+        printf("The value of k should be 1 <= k <= %d. \n", DUAL_WIDTH);
+        return;
+    }
+    c->d[k] = 1.;
+
+    return;
+}
+
+/*
+ *  dualAdd(a, b, c)
+ *
+ *  c = a + b
+ */
+void dualAdd(dual *a, dual *b, dual *c)
+{
+    int k;
+
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = a->d[k] + b->d[k];
+    }
+    c->v = a->v + b->v;
+
+    return;
+}
+
+/*
+ *  dualSub(a, b, c)
+ *
+ *  c = a - b
+ */
+void dualSub(dual *a, dual *b, dual *c)
+{
+    int k;
+
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = a->d[k] - b->d[k];
+    }
+    c->v = a->v - b->v;
+
+    return;
+}
+
+/*
+ *  dualMul(a, b, c)
+ *
+ *  c = a b
+ */
+void dualMul(dual *a, dual *b, dual *c)
+{
+    double av;
+    double bv;
+    int    k;
+
+    av = a->v;
+    bv = b->v;
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = av * b->d[k] + bv * a->d[k];
+    }
+    c->v = av * bv;
+
+    return;
+}
+
+/*
+ *  dualDiv(a, b, c)
+ *
+ *  c = a / b
+ */
+void dualDiv(dual *a, dual *b, dual *c)
+{
+    double q;
+    double bi;
+    int    k;
+
+    bi = 1. / b->v;
+    q  = a->v * bi;
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = (a->d[k] - q * b->d[k]) * bi;
+    }
+    c->v = q;
+
+    return;
+}
+
+/*
+ *  dualScale(s, a, c)
+ *
+ *  c = s a for the constant s.
+ */
+void dualScale(double s, dual *a, dual *c)
+{
+    int k;
+
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = s * a->d[k];
+    }
+    c->v = s * a->v;
+
+    return;
+}
+
+/*
+ *  dualShift(s, a, c)
+ *
+ *  c = a + s for the constant s.
+ */
+void dualShift(double s, dual *a, dual *c)
+{
+    int k;
+
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = a->d[k];
+    }
+    c->v = a->v + s;
+
+    return;
+}
+
+/*
+ *  dualChain(f, df, a, c)
+ *
+ *  c = g(a) for any scalar function g with f = g(a.v) and
+ *  df = g'(a.v).
+ */
+void dualChain(double f, double df, dual *a, dual *c)
+{
+    int k;
+
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = df * a->d[k];
+    }
+    c->v = f;
+
+    return;
+}
+
+/*
+ *  dualSqrt(a, c)
+ *
+ *  c = sqrt(a)
+ */
+void dualSqrt(dual *a, dual *c)
+{
+    double s;
+
+    s = sqrt(a->v);
+    dualChain(s, 0.5 / s, a, c);
+
+    return;
+}
+
+/*
+ *  dualPow(a, p, c)
+ *
+ *  c = a^p for the constant exponent p.
+ */
+void dualPow(dual *a, double p, dual *c)
+{
+    double s;
+
+    s = pow(a->v, p - 1.);
+    dualChain(s * a->v, p * s, a, c);
+
+    return;
+}
+
+/*
+ *  dualExp(a, c)
+ *
+ *  c = exp(a)
+ */
+void dualExp(dual *a, dual *c)
+{
+    double s;
+
+    s = exp(a->v);
+    dualChain(s, s, a, c);
+
+    return;
+}
+
+/*
+ *  dualLog(a, c)
+ *
+ *  c = log(a)
+ */
+void dualLog(dual *a, dual *c)
+{
+    dualChain(log(a->v), 1. / a->v, a, c);
+
+    return;
+}
+
+/*
+ *  dualSin(a, c)
+ *
+ *  c = sin(a)
+ */
+void dualSin(dual *a, dual *c)
+{
+    dualChain(sin(a->v), cos(a->v), a, c);
+
+    return;
+}
+
+/*
+ *  dualCos(a, c)
+ *
+ *  c = cos(a)
+ */
+void dualCos(dual *a, dual *c)
+{
+    dualChain(cos(a->v), -sin(a->v), a, c);
+
+    return;
+}
+
+/*
+ *  dualAcos(a, c)
+ *
+ *  c = acos(a)
+ */
+void dualAcos(dual *a, dual *c)
+{
+    dualChain(acos(a->v), -1. / sqrt(1. - a->v * a->v), a, c);
+
+    return;
+}
+
+/*
+ *  dualAtan2(y, x, c)
+ *
+ *  c = atan2(y, x)
+ */
+void dualAtan2(dual *y, dual *x, dual *c)
+{
+    double r2;
+    double xv;
+    double yv;
+    int    k;
+
+    xv = x->v;
+    yv = y->v;
+    r2 = xv * xv + yv * yv;
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = (xv * y->d[k] - yv * x->d[k]) / r2;
+    }
+    c->v = atan2(yv, xv);
+
+    return;
+}
+
+/*
+ *  dualNorm(v, c)
+ *
+ *  c = |v| of the vector v[1..3].
+ */
+void dualNorm(dual *v, dual *c)
+{
+    dual s;
+
+    dualDot(v, v, &s);
+    dualSqrt(&s, c);
+
+    return;
+}
+
+/*
+ *  dualDot(v1, v2, c)
+ *
+ *  c = v1 . v2
+ */
+void dualDot(dual *v1, dual *v2, dual *c)
+{
+    dual s;
+    dual t;
+    int  i;
+
+    dualMul(&v1[1], &v2[1], &s);
+    for(i = 2; i <= 3; i++) {
+        dualMul(&v1[i], &v2[i], &t);
+        dualAdd(&s, &t, &s);
+    }
+    *c = s;
+
+    return;
+}
+
+/*
+ *  dualCross(v1, v2, ans)
+ *
+ *  ans = v1 x v2
+ */
+void dualCross(dual *v1, dual *v2, dual *ans)
+{
+    dual w[3+1];
+    dual t;
+
+    dualMul(&v1[2], &v2[3], &w[1]);
+    dualMul(&v1[3], &v2[2], &t);
+    dualSub(&w[1], &t, &w[1]);
+    dualMul(&v1[3], &v2[1], &w[2]);
+    dualMul(&v1[1], &v2[3], &t);
+    dualSub(&w[2], &t, &w[2]);
+    dualMul(&v1[1], &v2[2], &w[3]);
+    dualMul(&v1[2], &v2[1], &t);
+    dualSub(&w[3], &t, &w[3]);
+    ans[1] = w[1];
+    ans[2] = w[2];
+    ans[3] = w[3];
+
+    return;
+}
+
+/*
+ *  dualMult(s, v, ans)
+ *
+ *  ans = s v for the scalar s and the vector v[1..3].
+ */
+void dualMult(dual *s, dual *v, dual *ans)
+{
+    dual t;
+    int  i;
+
+    t = *s;
+    for(i = 1; i <= 3; i++) {
+        dualMul(&t, &v[i], &ans[i]);
+    }
+
+    return;
+}
+
+/*
+ *  dualHorner(x, coef, deg, c)
+ *
+ *  c = coef[0] + coef[1] x + ... + coef[deg] x^deg
+ */
+static void dualHorner(dual *x, const double *coef, int deg, dual *c)
+{
+    dual s;
+    int  k;
+
+    dualSet(coef[deg], &s);
+    for(k = deg - 1; k >= 0; k--) {
+        dualMul(&s, x, &s);
+        dualShift(coef[k], &s, &s);
+    }
+    *c = s;
+
+    return;
+}
+
+/*
+ *  dualPoly(x, coef, deg, p, dp)
+ *
+ *  p = coef[0] + coef[1] x + ... + coef[deg] x^deg and its derivative
+ *  dp = dp/dx.
+ */
+static void dualPoly(double x, const double *coef, int deg, double *p, double *dp)
+{
+    int k;
+
+    *p  = coef[deg];
+    *dp = 0.;
+    for(k = deg - 1; k >= 0; k--) {
+        *dp = *dp * x + *p;
+        *p  = *p * x + coef[k];
+    }
+
+    return;
+}
+
+/*
+ *  dualZonal(r, num, a, G)
+ *
+ *  Zonal acceleration a[1..3] of the degrees 2..num at r and its
+ *  gradient G[i][j] = da_i/dr_j.  num is not checked.
+ */
+static void dualZonal(double *r, int num, double *a, double G[3+1][3+1])
+{
+    static const double C[6+1] = {0., 0., JP_C2, JP_C3, JP_C4, JP_C5, JP_C6};
+    double u[3+1];
+    double dX[3+1];
+    double dZ[3+1];
+    double ri;
+    double s;
+    double f4;
+    double f5;
+    double X;
+    double Xr;
+    double Xs;
+    double Z;
+    double Zr;
+    double Zs;
+    double p;
+    double dp;
+    double ds;
+    int    n;
+    int    i;
+    int    j;
+
+    ri = 1. / norm(r);
+    s  = r[3] * ri;
+    f4 = ri * ri * ri * ri;
+    f5 = f4 * ri;
+    for(i = 1; i <= 3; i++) {
+        u[i] = r[i] * ri;
+    }
+
+    /* X = sum C_n ri^(n-2) Px_n(s) with Xr = dX/dri and Xs = dX/ds, Z likewise */
+    X  = Xr = Xs = 0.;
+    Z  = Zr = Zs = 0.;
+    for(n = num; n >= 2; n--) {
+        dualPoly(s, dualZonalPx[n], n, &p, &dp);
+        Xr = Xr * ri + X;
+        X  = X * ri + C[n] * p;
+        Xs = Xs * ri + C[n] * dp;
+        dualPoly(s, dualZonalPz[n], n + 1, &p, &dp);
+        Zr = Zr * ri + Z;
+        Z  = Z * ri + C[n] * p;
+        Zs = Zs * ri + C[n] * dp;
+    }
+
+    /* dri/dr_j = -ri^2 u_j, ds/dr_j = ri (delta_3j - s u_j) */
+    for(j = 1; j <= 3; j++) {
+        ds    = ri * ((j == 3) - s * u[j]);
+        dX[j] = -Xr * ri * ri * u[j] + Xs * ds;
+        dZ[j] = -Zr * ri * ri * u[j] + Zs * ds;
+    }
+
+    a[1] = f4 * u[1] * X;
+    a[2] = f4 * u[2] * X;
+    a[3] = f4 * Z;
+    for(j = 1; j <= 3; j++) {
+        for(i = 1; i <= 2; i++) {
+            G[i][j] = f5 * X * ((i == j) - 5. * u[i] * u[j]) + f4 * u[i] * dX[j];
+        }
+        G[3][j] = -4. * f5 * Z * u[j] + f4 * dZ[j];
+    }
+
+    return;
+}
+
+/*
+ *  dualAtmosphericDensity(alt, density)
+ *
+ *  Dual version of AtmosphericDensity().
+ */
+void dualAtmosphericDensity(dual *alt, dual *density)
+{
+    static const double coef[6+1] = {-12.575, -2.3024, 0.60713, 1.0036, -0.5269, -0.5889, 0.34047};
+    dual logdensity;
+    dual val;
+
+    if(alt->v > 1000.) {
+        dualScale(-7e-05, alt, &logdensity);
+        dualShift(-14.464, &logdensity, &logdensity);
+    } else {
+        dualShift(-526.8000, alt, &val);
+        dualScale(1. / 292.8563, &val, &val);
+        dualHorner(&val, coef, 6, &logdensity);
+    }
+    dualScale(log(10.), &logdensity, &logdensity);
+    dualExp(&logdensity, density);
+
+    return;
+}
+
+/*
+ *  dualAtmosphericDrag(Cd, A, m, rvec, vvec, advec)
+ *
+ *  Dual version of AtmosphericDrag() with a differentiable drag
+ *  coefficient.
+ */
+void dualAtmosphericDrag(dual *Cd, double A, double m, dual *rvec, dual *vvec, dual *advec)
+{
+    dual r;
+    dual v;
+    dual alt;
+    dual density;
+    dual ad;
+    int  i;
+
+    dualNorm(rvec, &r);
+    dualNorm(vvec, &v);
+    dualShift(-REQ_EARTH, &r, &alt);
+
+    if(alt.v <= 0.) {
+        printf("ERROR: dualAtmosphericDrag() received rvec = [%g %g %g] \n", rvec[1].v, rvec[2].v, rvec[3].v);
+        printf("The value of rvec should produce a positive altitude for the Earth.\n");
+        for(i = 1; i <= 3; i++) {
+            dualSet(NAN, &advec[i]);
+        }
+        return;
+    }
+
+    dualAtmosphericDensity(&alt, &density);
+
+    /* ad / v = -0.5 density Cd A / m (1000 v)^2 / 1000 / v */
+    dualMul(&density, Cd, &ad);
+    dualMul(&ad, &v, &ad);
+    dualScale(-500. * A / m, &ad, &ad);
+    dualMult(&ad, vvec, advec);
+
+    return;
+}
+
+/*
+ *  dualJPerturb(rvec, num, ajtot)
+ *
+ *  Dual version of JPerturb().
+ */
+void dualJPerturb(dual *rvec, int num, dual *ajtot)
+{
+    double G[3+1][3+1];
+    double r[3+1];
+    double a[3+1];
+    dual   t[3+1];
+    int    i;
+    int    k;
+
+    if((num < 2) || (num > 6)) {
+        printf("ERROR: dualJPerturb() received num = %d \n", num);
+        printf("The value of num should be 2 <= num <= 6. \n");
+        for(i = 1; i <= 3; i++) {
+            dualSet(NAN, &ajtot[i]);
+        }
+        return;
+    }
+
+    for(i = 1; i <= 3; i++) {
+        r[i] = rvec[i].v;
+    }
+    dualZonal(r, num, a, G);
+    for(i = 1; i <= 3; i++) {
+        t[i].v = a[i];
+        for(k = 1; k <= DUAL_WIDTH; k++) {
+            t[i].d[k] = G[i][1] * rvec[1].d[k] + G[i][2] * rvec[2].d[k] + G[i][3] * rvec[3].d[k];
+        }
+    }
+    for(i = 1; i <= 3; i++) {
+        ajtot[i] = t[i];
+    }
+
+    return;
+}
+
+/*
+ *  dualSolarRad(A, m, sunvec, arvec)
+ *
+ *  Dual version of SolarRad() with a differentiable area A.
+ */
+void dualSolarRad(dual *A, double m, double *sunvec, dual *arvec)
+{
+    double flux;
+    double c;
+    double Cr;
+    double sundist;
+    dual   s;
+    int    i;
+
+    flux    = 1372.5398;
+    c       = 2.997e8;
+    Cr      = 1.3;
+    sundist = norm(sunvec);
+
+    dualScale(-Cr * flux / (m * c * pow(sundist, 3)) / 1000., A, &s);
+    for(i = 1; i <= 3; i++) {
+        dualScale(sunvec[i], &s, &arvec[i]);
+    }
+
+    return;
+}
+
+/*
+ *  dualComb(a, x, b, y, c)
+ *
+ *  c = a x + b y for the constants a and b.
+ */
+static void dualComb(double a, dual *x, double b, dual *y, dual *c)
+{
+    int k;
+
+    for(k = 1; k <= DUAL_WIDTH; k++) {
+        c->d[k] = a * x->d[k] + b * y->d[k];
+    }
+    c->v = a * x->v + b * y->v;
+
+    return;
+}
+
+/*
+ *  dualElem2rv(mu, elements, rVec, vVec)
+ *
+ *  Dual version of elem2rv(), including its rectilinear and
+ *  parabolic conventions.
+ */
+void dualElem2rv(double mu, dualElements *elements, dual *rVec, dual *vVec)
+{
+    dual cAN;
+    dual sAN;
+    dual cAP;
+    dual sAP;
+    dual ci;
+    dual si;
+    dual cth;
+    dual sth;
+    dual theta;
+    dual r;
+    dual v;
+    dual p;
+    dual h;
+    dual s;
+    dual t;
+    dual u;
+    dual ir[3+1];
+    int  k;
+
+    dualCos(&elements->Omega, &cAN);
+    dualSin(&elements->Omega, &sAN);
+    dualCos(&elements->omega, &cAP);
+    dualSin(&elements->omega, &sAP);
+    dualCos(&elements->i, &ci);
+    dualSin(&elements->i, &si);
+
+    if((elements->e.v == 1) && (elements->a.v > 0)) {   /* rectilinear elliptic orbit case */
+        dualCos(&elements->anom, &t);                   /* anom is the ecc. anomaly */
+        dualMul(&elements->e, &t, &t);
+        dualMul(&elements->a, &t, &t);
+        dualSub(&elements->a, &t, &r);              /* r = a (1 - e cos(E)) */
+        dualSet(2. * mu, &s);
+        dualDiv(&s, &r, &s);
+        dualSet(mu, &t);
+        dualDiv(&t, &elements->a, &t);
+        dualSub(&s, &t, &v);
+        dualSqrt(&v, &v);
+
+        dualMul(&sAN, &sAP, &t);
+        dualMul(&t, &ci, &t);
+        dualMul(&cAN, &cAP, &ir[1]);
+        dualSub(&ir[1], &t, &ir[1]);
+        dualMul(&cAN, &sAP, &t);
+        dualMul(&t, &ci, &t);
+        dualMul(&sAN, &cAP, &ir[2]);
+        dualAdd(&ir[2], &t, &ir[2]);
+        dualMul(&sAP, &si, &ir[3]);
+        dualMult(&r, ir, rVec);
+        if(sin(elements->anom.v) > 0) {
+            dualScale(-1., &v, &v);
+        }
+        dualMult(&v, ir, vVec);
+        return;
+    }
+
+    if((elements->e.v == 1) && (elements->a.v < 0)) {   /* parabolic case */
+        dualScale(-2., &elements->a, &p);
+    } else {                                            /* elliptic and hyperbolic cases */
+        dualMul(&elements->e, &elements->e, &t);
+        dualMul(&elements->a, &t, &t);
+        dualSub(&elements->a, &t, &p);
+    }
+
+    dualCos(&elements->anom, &t);
+    dualMul(&elements->e, &t, &t);
+    dualShift(1., &t, &t);
+    dualDiv(&p, &t, &r);
+    dualAdd(&elements->omega, &elements->anom, &theta);
+    dualCos(&theta, &cth);
+    dualSin(&theta, &sth);
+    dualScale(mu, &p, &h);
+    dualSqrt(&h, &h);
+
+    /* rVec = r [cAN cth - sAN sth ci, sAN cth + cAN sth ci, sth si] */
+    dualMul(&sth, &ci, &u);
+    dualMul(&cAN, &cth, &s);
+    dualMul(&sAN, &u, &t);
+    dualSub(&s, &t, &rVec[1]);
+    dualMul(&sAN, &cth, &s);
+    dualMul(&cAN, &u, &t);
+    dualAdd(&s, &t, &rVec[2]);
+    dualMul(&sth, &si, &rVec[3]);
+    for(k = 1; k <= 3; k++) {
+        dualMul(&r, &rVec[k], &rVec[k]);
+    }
+
+    /* vVec = -mu/h [cAN S + sAN C ci, sAN S - cAN C ci, -C si] */
+    dualMul(&elements->e, &sAP, &s);
+    dualAdd(&sth, &s, &s);                              /* S = sin(theta) + e sin(AP) */
+    dualMul(&elements->e, &cAP, &u);
+    dualAdd(&cth, &u, &u);                              /* C = cos(theta) + e cos(AP) */
+    dualMul(&u, &ci, &t);
+    dualMul(&cAN, &s, &vVec[1]);
+    dualMul(&sAN, &t, &v);
+    dualAdd(&vVec[1], &v, &vVec[1]);
+    dualMul(&sAN, &s, &vVec[2]);
+    dualMul(&cAN, &t, &v);
+    dualSub(&vVec[2], &v, &vVec[2]);
+    dualMul(&u, &si, &vVec[3]);
+    dualScale(-1., &vVec[3], &vVec[3]);
+    dualSet(-mu, &t);
+    dualDiv(&t, &h, &t);
+    for(k = 1; k <= 3; k++) {
+        dualMul(&t, &vVec[k], &vVec[k]);
+    }
+
+    return;
+}
+
+/*
+ *  dualRv2elem(mu, rVec, vVec, elements)
+ *
+ *  Dual version of rv2elem(), including its circular, rectilinear
+ *  and parabolic conventions.
+ */
+void dualRv2elem(double mu, dual *rVec, dual *vVec, dualElements *elements)
+{
+    dual r;
+    dual h;
+    dual ai;
+    dual s;
+    dual t;
+    dual ir[3+1];
+    dual hVec[3+1];
+    dual cVec[3+1];
+    dual dum[3+1];
+    dual dum2[3+1];
+    dual ih[3+1];
+    dual ie[3+1];
+    dual ip[3+1];
+    int  k;
+
+    /* compute orbit radius */
+    dualNorm(rVec, &r);
+    for(k = 1; k <= 3; k++) {
+        dualDiv(&rVec[k], &r, &ir[k]);
+    }
+
+    /* compute the angular momentum vector */
+    dualCross(rVec, vVec, hVec);
+    dualNorm(hVec, &h);
+
+    /* compute the eccentricity vector */
+    dualCross(vVec, hVec, cVec);
+    dualSet(-mu, &t);
+    dualDiv(&t, &r, &t);
+    for(k = 1; k <= 3; k++) {
+        dualMul(&t, &rVec[k], &s);
+        dualAdd(&cVec[k], &s, &cVec[k]);
+    }
+    dualNorm(cVec, &elements->e);
+    dualScale(1. / mu, &elements->e, &elements->e);
+
+    /* compute semi-major axis */
+    dualSet(2., &t);
+    dualDiv(&t, &r, &ai);
+    dualDot(vVec, vVec, &s);
+    dualComb(1., &ai, -1. / mu, &s, &ai);
+    if(fabs(ai.v) > DUAL_EPS) {
+        /* elliptic or hyperbolic case */
+        dualSet(1., &t);
+        dualDiv(&t, &ai, &elements->a);
+    } else {
+        /* parabolic case, -rp is returned instead of a */
+        dualMul(&h, &h, &t);
+        dualScale(-0.5 / mu, &t, &elements->a);
+        dualSet(1., &elements->e);
+    }
+
+    if(h.v < DUAL_EPS) {    /* rectilinear motion case */
+        for(k = 1; k <= 3; k++) {
+            ie[k] = ir[k];
+            dualSet(k == 3 ? 1. : 0., &dum[k]);
+            dualSet(k == 2 ? 1. : 0., &dum2[k]);
+        }
+        dualCross(ie, dum,  ih);
+        dualCross(ie, dum2, ip);
+        dualNorm(ih, &s);
+        dualNorm(ip, &t);
+        if(s.v > t.v) {
+            for(k = 1; k <= 3; k++) {
+                dualDiv(&ih[k], &s, &ih[k]);
+            }
+        } else {
+            for(k = 1; k <= 3; k++) {
+                dualDiv(&ip[k], &t, &ih[k]);
+            }
+        }
+        dualCross(ih, ie, ip);
+    } else {
+        /* compute perifocal frame unit direction vectors */
+        for(k = 1; k <= 3; k++) {
+            dualDiv(&hVec[k], &h, &ih[k]);
+        }
+        if(fabs(elements->e.v) > DUAL_EPS) {
+            /* non-circular case */
+            dualScale(mu, &elements->e, &t);
+            for(k = 1; k <= 3; k++) {
+                dualDiv(&cVec[k], &t, &ie[k]);
+            }
+        } else {
+            /* circular orbit case */
+            for(k = 1; k <= 3; k++) {
+                ie[k] = ir[k];
+            }
+        }
+        dualCross(ih, ie, ip);
+    }
+
+    /* compute the 3-1-3 orbit plane orientation angles */
+    dualScale(-1., &ih[2], &t);
+    dualAtan2(&ih[1], &t, &elements->Omega);
+    dualAcos(&ih[3], &elements->i);
+    dualAtan2(&ie[3], &ip[3], &elements->omega);
+
+    if(h.v < DUAL_EPS) {                /* rectilinear motion case */
+        dualMul(&r, &ai, &t);
+        dualDot(rVec, vVec, &s);
+        if(ai.v > 0) {                  /* elliptic case, eccentric anomaly */
+            dualScale(-1., &t, &t);
+            dualShift(1., &t, &t);
+            dualAcos(&t, &elements->anom);
+            if(s.v > 0) {
+                dualScale(-1., &elements->anom, &elements->anom);
+                dualShift(2 * M_PI, &elements->anom, &elements->anom);
+            }
+        } else {                        /* hyperbolic case, hyperbolic anomaly */
+            dualShift(1., &t, &t);
+            dualChain(arc_cosh(t.v), 1. / sqrt(t.v * t.v - 1.), &t, &elements->anom);
+            if(s.v < 0) {
+                dualScale(-1., &elements->anom, &elements->anom);
+                dualShift(2 * M_PI, &elements->anom, &elements->anom);
+            }
+        }
+    } else {
+        /* compute true anomaly */
+        dualCross(ie, ir, dum);
+        dualDot(dum, ih, &s);
+        dualDot(ie, ir, &t);
+        dualAtan2(&s, &t, &elements->anom);
+    }
+
+    return;
+}
+
+/*
+ *  dualMRP2EP(q1, q)
+ *
+ *  Dual version of MRP2EP().
+ */
+void dualMRP2EP(dual *q1, dual *q)
+{
+    dual s;
+    dual ps;
+    int  i;
+
+    dualDot(q1, q1, &s);
+    dualShift(1., &s, &ps);
+    dualScale(-1., &s, &s);
+    dualShift(1., &s, &s);
+    dualDiv(&s, &ps, &q[1]);
+    for(i = 1; i <= 3; i++) {
+        dualDiv(&q1[i], &ps, &q[i + 1]);
+        dualScale(2., &q[i + 1], &q[i + 1]);
+    }
+
+    return;
+}
+
+/*
+ *  dualEP2MRP(q1, q)
+ *
+ *  Dual version of EP2MRP().
+ */
+void dualEP2MRP(dual *q1, dual *q)
+{
+    dual s;
+    int  i;
+
+    dualShift(1., &q1[1], &s);
+    for(i = 1; i <= 3; i++) {
+        dualDiv(&q1[i + 1], &s, &q[i]);
+    }
+
+    return;
+}
+
+/*
+ *  dualMRP2C(q, C)
+ *
+ *  Dual version of MRP2C().
+ */
+void dualMRP2C(dual *q, dual C[4][4])
+{
+    dual d1;
+    dual S;
+    dual d;
+    dual t;
+    dual u;
+    int  i;
+    int  j;
+    int  k;
+
+    dualDot(q, q, &d1);
+    dualScale(-1., &d1, &S);
+    dualShift(1., &S, &S);
+    dualShift(1., &d1, &d);
+    dualMul(&d, &d, &d);
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            dualMul(&q[i], &q[j], &t);
+            if(i == j) {
+                dualMul(&S, &S, &u);
+                dualComb(8., &t, -4., &d1, &t);
+                dualAdd(&t, &u, &C[i][j]);
+            } else {
+                /* k completes i, j to a cyclic or anticyclic triple */
+                k = 6 - i - j;
+                dualMul(&q[k], &S, &u);
+                dualComb(8., &t, ((j - i + 3) % 3 == 1) ? 4. : -4., &u, &C[i][j]);
+            }
+        }
+    }
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            dualDiv(&C[i][j], &d, &C[i][j]);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  dualEP2C(q, C)
+ *
+ *  Dual version of EP2C().
+ */
+void dualEP2C(dual *q, dual C[4][4])
+{
+    dual Q[4+1][4+1];
+    int  i;
+    int  j;
+
+    for(i = 1; i <= 4; i++) {
+        for(j = i; j <= 4; j++) {
+            dualMul(&q[i], &q[j], &Q[i][j]);
+        }
+    }
+
+    dualSub(&Q[1][1], &Q[3][3], &C[1][1]);
+    dualSub(&C[1][1], &Q[4][4], &C[1][1]);
+    dualAdd(&C[1][1], &Q[2][2], &C[1][1]);
+    dualComb(2., &Q[2][3], 2., &Q[1][4], &C[1][2]);
+    dualComb(2., &Q[2][4], -2., &Q[1][3], &C[1][3]);
+    dualComb(2., &Q[2][3], -2., &Q[1][4], &C[2][1]);
+    dualSub(&Q[1][1], &Q[2][2], &C[2][2]);
+    dualSub(&C[2][2], &Q[4][4], &C[2][2]);
+    dualAdd(&C[2][2], &Q[3][3], &C[2][2]);
+    dualComb(2., &Q[3][4], 2., &Q[1][2], &C[2][3]);
+    dualComb(2., &Q[2][4], 2., &Q[1][3], &C[3][1]);
+    dualComb(2., &Q[3][4], -2., &Q[1][2], &C[3][2]);
+    dualSub(&Q[1][1], &Q[2][2], &C[3][3]);
+    dualSub(&C[3][3], &Q[3][3], &C[3][3]);
+    dualAdd(&C[3][3], &Q[4][4], &C[3][3]);
+
+    return;
+}
+
+/*
+ *  dualAccel(fm, CdAm, Am, r, v, a, A)
+ *
+ *  Acceleration a[1..3] of the batch force model, as in batchAccel(),
+ *  and its partials A[1..3][1..6] with respect to [r v].  The partials
+ *  of the two-body and zonal terms are analytic, those of the drag
+ *  take the density slope from dualAtmosphericDensity(), and the
+ *  solar radiation pressure does not depend on [r v].  Where
+ *  batchAccel() interpolates the zonal perturbation from fm->lattice,
+ *  the acceleration takes the same lattice value, while the partials
+ *  are those of JPerturb().
+ */
+void dualAccel(batchForceModel *fm, double CdAm, double Am, double *r, double *v, double *a,
+               double A[3+1][6+1])
+{
+    double G[3+1][3+1];
+    double ap[3+1];
+    double al[3+1];
+    double u[3+1];
+    double rm;
+    double vm;
+    double g;
+    double k;
+    dual   alt;
+    dual   density;
+    int    i;
+    int    j;
+
+    rm = norm(r);
+    g  = -fm->mu / (rm * rm * rm);
+    for(i = 1; i <= 3; i++) {
+        u[i] = r[i] * (1. / rm);
+        a[i] = g * r[i];
+    }
+    for(i = 1; i <= 3; i++) {
+        for(j = 1; j <= 3; j++) {
+            A[i][j]     = g * ((i == j) - 3. * u[i] * u[j]);
+            A[i][j + 3] = 0.;
+        }
+    }
+
+    if(fm->jnum) {
+        if((fm->jnum < 2) || (fm->jnum > 6)) {
+            printf("ERROR: dualAccel() received fm->jnum = %d \n", fm->jnum);
+            printf("The value of fm->jnum should be 0 or 2 <= jnum <= 6. \n");
+            for(i = 1; i <= 3; i++) {
+                a[i] = NAN;
+                for(j = 1; j <= 6; j++) {
+                    A[i][j] = NAN;
+                }
+            }
+            return;
+        }
+        dualZonal(r, fm->jnum, ap, G);
+        if((fm->lattice != NULL) && (fm->lattice->jnum == fm->jnum)
+           && (gravLatticeAccel(fm->lattice, r, al) == 0)) {
+            equal(al, ap);
+        }
+        for(i = 1; i <= 3; i++) {
+            a[i] += ap[i];
+            for(j = 1; j <= 3; j++) {
+                A[i][j] += G[i][j];
+            }
+        }
+    }
+    if(fm->drag) {
+        /* ad = -500 CdAm rho(|r| - req) |v| v */
+        AtmosphericDrag(CdAm, 1., 1., r, v, ap);
+        dualVar(rm - REQ_EARTH, 1, &alt);
+        dualAtmosphericDensity(&alt, &density);
+        vm = norm(v);
+        k  = -500. * CdAm;
+        for(i = 1; i <= 3; i++) {
+            a[i] += ap[i];
+            for(j = 1; j <= 3; j++) {
+                A[i][j]     += k * density.d[1] * u[j] * vm * v[i];
+                A[i][j + 3] += k * density.v * ((i == j) * vm + v[i] * v[j] / vm);
+            }
+        }
+    }
+    if(fm->srp) {
+        SolarRad(Am, 1., fm->sunvec, ap);
+        for(i = 1; i <= 3; i++) {
+            a[i] += ap[i];
+        }
+    }
+
+    return;
+}
@@ -0,0 +1,85 @@
+/*
+ *  dualNumbers.h
+ *  OrbitalMotion
+ *
+ *  Forward mode automatic differentiation.  A dual number carries a
+ *  value and its derivatives with respect to DUAL_WIDTH independent
+ *  inputs, so the exact Jacobian of a kernel follows from a single
+ *  evaluation.  Inputs are seeded with dualVar(), constants with
+ *  dualSet(), and the tangents d[1..DUAL_WIDTH] of the outputs are
+ *  the Jacobian rows.  The dual versions of JPerturb(),
+ *  AtmosphericDensity(), AtmosphericDrag(), SolarRad(), elem2rv(),
+ *  rv2elem() and the MRP/EP conversions follow the plain ones line
+ *  by line.  dualAccel() returns the acceleration of the batch force
+ *  model together with its partials with respect to [r v].
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "batchPropagation.h"
+
+#ifndef _DUAL_NUMBERS_H_
+#define _DUAL_NUMBERS_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define DUAL_WIDTH          8       /* tangent directions, [r v] and two parameters */
+
+    typedef struct dualStruct {
+        double v;                       /* value */
+        double d[DUAL_WIDTH+1];         /* derivatives d[1..DUAL_WIDTH] */
+    } dual;
+
+    typedef struct dualElemStruct {
+        dual a;
+        dual e;
+        dual i;
+        dual Omega;
+        dual omega;
+        dual anom;
+    } dualElements;
+
+    void dualSet(double v, dual *c);
+    void dualVar(double v, int k, dual *c);
+    void dualAdd(dual *a, dual *b, dual *c);
+    void dualSub(dual *a, dual *b, dual *c);
+    void dualMul(dual *a, dual *b, dual *c);
+    void dualDiv(dual *a, dual *b, dual *c);
+    void dualScale(double s, dual *a, dual *c);
+    void dualShift(double s, dual *a, dual *c);
+    void dualChain(double f, double df, dual *a, dual *c);
+    void dualSqrt(dual *a, dual *c);
+    void dualPow(dual *a, double p, dual *c);
+    void dualExp(dual *a, dual *c);
+    void dualLog(dual *a, dual *c);
+    void dualSin(dual *a, dual *c);
+    void dualCos(dual *a, dual *c);
+    void dualAcos(dual *a, dual *c);
+    void dualAtan2(dual *y, dual *x, dual *c);
+    void dualNorm(dual *v, dual *c);
+    void dualDot(dual *v1, dual *v2, dual *c);
+    void dualCross(dual *v1, dual *v2, dual *ans);
+    void dualMult(dual *s, dual *v, dual *ans);
+
+    void dualAtmosphericDensity(dual *alt, dual *density);
+    void dualAtmosphericDrag(dual *Cd, double A, double m, dual *rvec, dual *vvec, dual *advec);
+    void dualJPerturb(dual *rvec, int num, dual *ajtot);
+    void dualSolarRad(dual *A, double m, double *sunvec, dual *arvec);
+    void dualElem2rv(double mu, dualElements *elements, dual *rVec, dual *vVec);
+    void dualRv2elem(double mu, dual *rVec, dual *vVec, dualElements *elements);
+    void dualMRP2EP(dual *q1, dual *q);
+    void dualEP2MRP(dual *q1, dual *q);
+    void dualMRP2C(dual *q, dual C[4][4]);
+    void dualEP2C(dual *q, dual C[4][4]);
+
+    void dualAccel(batchForceModel *fm, double CdAm, double Am, double *r, double *v, double *a,
+                   double A[3+1][6+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
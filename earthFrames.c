@@ -0,0 +1,508 @@
+/*
+ *  earthFrames.c
+ *  OrbitalMotion
+ *
+ *  ECI/ECEF rotations and geodetic coordinates.
+ *
+ *  The ECI to ECEF rotation is C = R3(theta) N P, where theta is
+ *  the Greenwich sidereal angle and N, P are the nutation and
+ *  precession matrices (both identity for FRAME_ROTATION).  Polar
+ *  motion is not modeled.  The Earth rotation rate OMEGA_EARTH is
+ *  used for the ECI/ECEF velocity transport term.
+ *
+ *  The geodetic conversion is the closed form solution of
+ *  Vermeille, which is exact to round-off for all points more than
+ *  about 45 km from the geocenter and needs no iterations, so that
+ *  the batch loops have no data dependent branches.
+ *
+ *  References:
+ *  D. A. Vallado, "Fundamentals of Astrodynamics and Applications",
+ *  3rd ed., 2007, sections 3.7 and 3.7.1.
+ *  H. Vermeille, "Computing geodetic coordinates from geocentric
+ *  coordinates", Journal of Geodesy 78, 2004, pp. 94-95.
+ */
+
+#include "earthFrames.h"
+#include "astroConstants.h"
+#include "RigidBodyKinematics.h"
+#include "vector3D.h"
+
+#define ARCSEC2RAD  (M_PI / 648000.)
+#define JD_J2000    2451545.0
+
+/*
+ *  IAU 1980 nutation series truncated to the 20 largest terms.  The
+ *  columns are the multipliers of the Delaunay arguments l, l', F,
+ *  D and Omega, followed by the longitude coefficients A, B and the
+ *  obliquity coefficients C, D in units of 0.0001 arcsec, with
+ *  dpsi = (A + B T) sin(arg) and deps = (C + D T) cos(arg).  The
+ *  largest omitted term is 0.0038 arcsec.
+ */
+static const double nutationTerms[20][9] = {
+    { 0,  0,  0,  0,  1, -171996., -174.2, 92025.,  8.9},
+    { 0,  0,  2, -2,  2,  -13187.,   -1.6,  5736., -3.1},
+    { 0,  0,  2,  0,  2,   -2274.,   -0.2,   977., -0.5},
+    { 0,  0,  0,  0,  2,    2062.,    0.2,  -895.,  0.5},
+    { 0,  1,  0,  0,  0,    1426.,   -3.4,    54., -0.1},
+    { 1,  0,  0,  0,  0,     712.,    0.1,    -7.,  0.0},
+    { 0,  1,  2, -2,  2,    -517.,    1.2,   224., -0.6},
+    { 0,  0,  2,  0,  1,    -386.,   -0.4,   200.,  0.0},
+    { 1,  0,  2,  0,  2,    -301.,    0.0,   129., -0.1},
+    { 0, -1,  2, -2,  2,     217.,   -0.5,   -95.,  0.3},
+    { 1,  0,  0, -2,  0,    -158.,    0.0,    -1.,  0.0},
+    { 0,  0,  2, -2,  1,     129.,    0.1,   -70.,  0.0},
+    {-1,  0,  2,  0,  2,     123.,    0.0,   -53.,  0.0},
+    { 1,  0,  0,  0,  1,      63.,    0.1,   -33.,  0.0},
+    { 0,  0,  0,  2,  0,      63.,    0.0,    -2.,  0.0},
+    {-1,  0,  2,  2,  2,     -59.,    0.0,    26.,  0.0},
+    {-1,  0,  0,  0,  1,     -58.,   -0.1,    32.,  0.0},
+    { 1,  0,  2,  0,  1,     -51.,    0.0,    27.,  0.0},
+    { 2,  0,  0, -2,  0,      48.,    0.0,     1.,  0.0},
+    {-2,  0,  2,  0,  1,      46.,    0.0,   -24.,  0.0}
+};
+
+/*
+ *  theta = GMST(jdUT1)
+ *
+ *  Returns the IAU 1982 Greenwich mean sidereal angle (rad) in
+ *  [0, 2 pi) for the UT1 Julian date jdUT1.
+ */
+double GMST(double jdUT1)
+{
+    double T;
+    double s;
+
+    T = (jdUT1 - JD_J2000) / 36525.;
+    s = 67310.54841 + (876600. * 3600. + 8640184.812866) * T
+        + 0.093104 * T * T - 6.2e-6 * T * T * T;
+    s = fmod(s, 86400.);
+    if(s < 0.) {
+        s += 86400.;
+    }
+
+    return s * 2. * M_PI / 86400.;
+}
+
+/*
+ *  precessionIAU76(jdTT, P)
+ *
+ *  Returns the IAU 1976 precession matrix P that maps mean
+ *  equator and equinox of J2000 coordinates into mean of date
+ *  coordinates for the terrestrial time Julian date jdTT.
+ */
+void precessionIAU76(double jdTT, double P[4][4])
+{
+    double T;
+    double zeta;
+    double theta;
+    double z;
+    double m1[4][4];
+    double m2[4][4];
+    double m3[4][4];
+
+    T     = (jdTT - JD_J2000) / 36525.;
+    zeta  = (2306.2181 * T + 0.30188 * T * T + 0.017998 * T * T * T) * ARCSEC2RAD;
+    theta = (2004.3109 * T - 0.42665 * T * T - 0.041833 * T * T * T) * ARCSEC2RAD;
+    z     = (2306.2181 * T + 1.09468 * T * T + 0.018203 * T * T * T) * ARCSEC2RAD;
+
+    Mi(-zeta, 3, m1);
+    Mi(theta, 2, m2);
+    MdotM(m2, m1, m3);
+    Mi(-z, 3, m1);
+    MdotM(m1, m3, P);
+
+    return;
+}
+
+/*
+ *  nutationIAU80(jdTT, N, dpsi, eps)
+ *
+ *  Returns the nutation matrix N that maps mean of date
+ *  coordinates into true of date coordinates, along with the
+ *  nutation in longitude dpsi (rad) and the true obliquity of the
+ *  ecliptic eps (rad), using the truncated IAU 1980 series.
+ */
+void nutationIAU80(double jdTT, double N[4][4], double *dpsi, double *eps)
+{
+    double T;
+    double epsm;
+    double deps;
+    double f[5];
+    double arg;
+    double m1[4][4];
+    double m2[4][4];
+    double m3[4][4];
+    int    i;
+    int    j;
+
+    T    = (jdTT - JD_J2000) / 36525.;
+    epsm = (84381.448 - 46.8150 * T - 0.00059 * T * T + 0.001813 * T * T * T) * ARCSEC2RAD;
+
+    /* Delaunay arguments */
+    f[0] = fmod(485866.733 + (1325. * 1296000. + 715922.633) * T
+                + 31.310 * T * T + 0.064 * T * T * T, 1296000.) * ARCSEC2RAD;
+    f[1] = fmod(1287099.804 + (99. * 1296000. + 1292581.224) * T
+                - 0.577 * T * T - 0.012 * T * T * T, 1296000.) * ARCSEC2RAD;
+    f[2] = fmod(335778.877 + (1342. * 1296000. + 295263.137) * T
+                - 13.257 * T * T + 0.011 * T * T * T, 1296000.) * ARCSEC2RAD;
+    f[3] = fmod(1072261.307 + (1236. * 1296000. + 1105601.328) * T
+                - 6.891 * T * T + 0.019 * T * T * T, 1296000.) * ARCSEC2RAD;
+    f[4] = fmod(450160.280 - (5. * 1296000. + 482890.539) * T
+                + 7.455 * T * T + 0.008 * T * T * T, 1296000.) * ARCSEC2RAD;
+
+    *dpsi = 0.;
+    deps  = 0.;
+    for(i = 0; i < 20; i++) {
+        arg = 0.;
+        for(j = 0; j < 5; j++) {
+            arg += nutationTerms[i][j] * f[j];
+        }
+        *dpsi += (nutationTerms[i][5] + nutationTerms[i][6] * T) * sin(arg);
+        deps  += (nutationTerms[i][7] + nutationTerms[i][8] * T) * cos(arg);
+    }
+    *dpsi *= 1.e-4 * ARCSEC2RAD;
+    deps  *= 1.e-4 * ARCSEC2RAD;
+    *eps   = epsm + deps;
+
+    Mi(epsm, 1, m1);
+    Mi(-*dpsi, 3, m2);
+    MdotM(m2, m1, m3);
+    Mi(-*eps, 1, m1);
+    MdotM(m1, m3, N);
+
+    return;
+}
+
+/*
+ *  eqeq = equationEquinoxes(jdTT, dpsi, eps)
+ *
+ *  Returns the equation of the equinoxes (rad), the difference
+ *  between the apparent and mean sidereal angles, for the nutation
+ *  in longitude dpsi and true obliquity eps of nutationIAU80().
+ */
+double equationEquinoxes(double jdTT, double dpsi, double eps)
+{
+    double Om;
+
+    Om = (125.04455501 - 1934.1361851 * (jdTT - JD_J2000) / 36525.) * M_PI / 180.;
+
+    return dpsi * cos(eps) + (0.00264 * sin(Om) + 0.000063 * sin(2. * Om)) * ARCSEC2RAD;
+}
+
+/*
+ *  ECI2ECEFMatrix(jdUT1, jdTT, model, C)
+ *
+ *  Returns the rotation matrix C from ECI (J2000) to ECEF
+ *  coordinates at the UT1 Julian date jdUT1 (terrestrial time
+ *  jdTT).  For model FRAME_ROTATION only the Earth rotation by
+ *  GMST is applied, while FRAME_IAU76 also applies precession and
+ *  nutation and rotates by the apparent sidereal angle.
+ */
+void ECI2ECEFMatrix(double jdUT1, double jdTT, int model, double C[4][4])
+{
+    double theta;
+    double dpsi;
+    double eps;
+    double P[4][4];
+    double N[4][4];
+    double NP[4][4];
+    double R[4][4];
+
+    theta = GMST(jdUT1);
+    if(model == FRAME_ROTATION) {
+        Mi(theta, 3, C);
+        return;
+    }
+    if(model != FRAME_IAU76) {
+        printf("ERROR: ECI2ECEFMatrix() received model = %d \n", model);
+        printf("The value of model should be FRAME_ROTATION or FRAME_IAU76. \n");
+        setMatrix(NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN, C);
+        return;
+    }
+
+    precessionIAU76(jdTT, P);
+    nutationIAU80(jdTT, N, &dpsi, &eps);
+    MdotM(N, P, NP);
+
+    theta += equationEquinoxes(jdTT, dpsi, eps);
+    Mi(theta, 3, R);
+    MdotM(R, NP, C);
+
+    return;
+}
+
+/*
+ *  ECI2ECEF(C, rECI, vECI, rECEF, vECEF)
+ *
+ *  Maps the ECI position and velocity into ECEF coordinates using
+ *  the rotation C of ECI2ECEFMatrix().  The ECEF velocity is taken
+ *  relative to the rotating Earth.
+ */
+void ECI2ECEF(double C[4][4], double *rECI, double *vECI, double *rECEF, double *vECEF)
+{
+    double r[3+1];
+    double w[3+1];
+    double wxr[3+1];
+
+    Mdot(C, rECI, r);
+    Mdot(C, vECI, vECEF);
+    set3(0., 0., OMEGA_EARTH, w);
+    cross(w, r, wxr);
+    sub(vECEF, wxr, vECEF);
+    equal(r, rECEF);
+
+    return;
+}
+
+/*
+ *  ECEF2ECI(C, rECEF, vECEF, rECI, vECI)
+ *
+ *  Inverse of ECI2ECEF().
+ */
+void ECEF2ECI(double C[4][4], double *rECEF, double *vECEF, double *rECI, double *vECI)
+{
+    double CT[4][4];
+    double w[3+1];
+    double u[3+1];
+
+    transpose(C, CT);
+    set3(0., 0., OMEGA_EARTH, w);
+    cross(w, rECEF, u);
+    add(vECEF, u, u);
+    Mdot(CT, u, vECI);
+    Mdot(CT, rECEF, rECI);
+
+    return;
+}
+
+/*
+ *  frameGeodetic(x, y, z, lat, lon, alt)
+ *
+ *  Vermeille's closed form ECEF to geodetic conversion.
+ */
+static void frameGeodetic(double x, double y, double z, double *lat, double *lon, double *alt)
+{
+    double a2;
+    double e2;
+    double e4;
+    double rho;
+    double p;
+    double q;
+    double r;
+    double s;
+    double t;
+    double u;
+    double v;
+    double w;
+    double k;
+    double D;
+
+    a2  = REQ_EARTH * REQ_EARTH;
+    e2  = FLAT_EARTH * (2. - FLAT_EARTH);
+    e4  = e2 * e2;
+    rho = sqrt(x * x + y * y);
+    p   = rho * rho / a2;
+    q   = (1. - e2) / a2 * z * z;
+    r   = (p + q - e4) / 6.;
+    s   = e4 * p * q / (4. * r * r * r);
+    t   = cbrt(1. + s + sqrt(s * (2. + s)));
+    u   = r * (1. + t + 1. / t);
+    v   = sqrt(u * u + e4 * q);
+    w   = e2 * (u + v - q) / (2. * v);
+    k   = sqrt(u + v + w * w) - w;
+    D   = k * rho / (k + e2);
+
+    *lat = 2. * atan2(z, D + sqrt(D * D + z * z));
+    *lon = atan2(y, x);
+    *alt = (k + e2 - 1.) / k * sqrt(D * D + z * z);
+
+    return;
+}
+
+/*
+ *  ECEF2geodetic(r, lat, lon, alt)
+ *
+ *  Returns the geodetic latitude and longitude (rad) and the
+ *  altitude (km) above the REQ_EARTH/FLAT_EARTH ellipsoid of the
+ *  ECEF position r.  Valid for |r| > 45 km.
+ */
+void ECEF2geodetic(double *r, double *lat, double *lon, double *alt)
+{
+    frameGeodetic(r[1], r[2], r[3], lat, lon, alt);
+
+    return;
+}
+
+/*
+ *  geodetic2ECEF(lat, lon, alt, r)
+ *
+ *  Returns the ECEF position r of the geodetic latitude and
+ *  longitude (rad) and altitude (km).
+ */
+void geodetic2ECEF(double lat, double lon, double alt, double *r)
+{
+    double e2;
+    double sl;
+    double N;
+
+    e2 = FLAT_EARTH * (2. - FLAT_EARTH);
+    sl = sin(lat);
+    N  = REQ_EARTH / sqrt(1. - e2 * sl * sl);
+    r[1] = (N + alt) * cos(lat) * cos(lon);
+    r[2] = (N + alt) * cos(lat) * sin(lon);
+    r[3] = (N * (1. - e2) + alt) * sl;
+
+    return;
+}
+
+/*
+ *  batchECI2ECEF(C, n, r, v, rOut, vOut)
+ *
+ *  SoA version of ECI2ECEF() for the n states r[1..3][k], v[1..3][k].
+ *  The velocities are skipped if v or vOut is NULL.  The outputs
+ *  may alias the inputs.
+ */
+void batchECI2ECEF(double C[4][4], int n, double *r[3+1], double *v[3+1],
+                   double *rOut[3+1], double *vOut[3+1])
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= FRAME_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double x;
+        double y;
+        double z;
+        double vx;
+        double vy;
+        double vz;
+
+        x = C[1][1] * r[1][k] + C[1][2] * r[2][k] + C[1][3] * r[3][k];
+        y = C[2][1] * r[1][k] + C[2][2] * r[2][k] + C[2][3] * r[3][k];
+        z = C[3][1] * r[1][k] + C[3][2] * r[2][k] + C[3][3] * r[3][k];
+        if((v != NULL) && (vOut != NULL)) {
+            vx = C[1][1] * v[1][k] + C[1][2] * v[2][k] + C[1][3] * v[3][k] + OMEGA_EARTH * y;
+            vy = C[2][1] * v[1][k] + C[2][2] * v[2][k] + C[2][3] * v[3][k] - OMEGA_EARTH * x;
+            vz = C[3][1] * v[1][k] + C[3][2] * v[2][k] + C[3][3] * v[3][k];
+            vOut[1][k] = vx;
+            vOut[2][k] = vy;
+            vOut[3][k] = vz;
+        }
+        rOut[1][k] = x;
+        rOut[2][k] = y;
+        rOut[3][k] = z;
+    }
+
+    return;
+}
+
+/*
+ *  batchECEF2ECI(C, n, r, v, rOut, vOut)
+ *
+ *  SoA version of ECEF2ECI(), see batchECI2ECEF().
+ */
+void batchECEF2ECI(double C[4][4], int n, double *r[3+1], double *v[3+1],
+                   double *rOut[3+1], double *vOut[3+1])
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= FRAME_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double x;
+        double y;
+        double z;
+        double ux;
+        double uy;
+        double uz;
+
+        x = r[1][k];
+        y = r[2][k];
+        z = r[3][k];
+        if((v != NULL) && (vOut != NULL)) {
+            ux = v[1][k] - OMEGA_EARTH * y;
+            uy = v[2][k] + OMEGA_EARTH * x;
+            uz = v[3][k];
+            vOut[1][k] = C[1][1] * ux + C[2][1] * uy + C[3][1] * uz;
+            vOut[2][k] = C[1][2] * ux + C[2][2] * uy + C[3][2] * uz;
+            vOut[3][k] = C[1][3] * ux + C[2][3] * uy + C[3][3] * uz;
+        }
+        rOut[1][k] = C[1][1] * x + C[2][1] * y + C[3][1] * z;
+        rOut[2][k] = C[1][2] * x + C[2][2] * y + C[3][2] * z;
+        rOut[3][k] = C[1][3] * x + C[2][3] * y + C[3][3] * z;
+    }
+
+    return;
+}
+
+/*
+ *  batchECEF2geodetic(n, r, lat, lon, alt)
+ *
+ *  SoA version of ECEF2geodetic() for the n positions r[1..3][k].
+ */
+void batchECEF2geodetic(int n, double *r[3+1], double *lat, double *lon, double *alt)
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= FRAME_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        frameGeodetic(r[1][k], r[2][k], r[3][k], &lat[k], &lon[k], &alt[k]);
+    }
+
+    return;
+}
+
+/*
+ *  batchGeodetic2ECEF(n, lat, lon, alt, r)
+ *
+ *  SoA version of geodetic2ECEF().
+ */
+void batchGeodetic2ECEF(int n, double *lat, double *lon, double *alt, double *r[3+1])
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= FRAME_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double rk[3+1];
+
+        geodetic2ECEF(lat[k], lon[k], alt[k], rk);
+        r[1][k] = rk[1];
+        r[2][k] = rk[2];
+        r[3][k] = rk[3];
+    }
+
+    return;
+}
+
+/*
+ *  batchStateGeodetic(state, C, lat, lon, alt)
+ *
+ *  Returns the geodetic coordinates lat[k], lon[k], alt[k] of
+ *  every object k of the batch state, whose ECI positions are
+ *  rotated into ECEF with C.  Each partition is converted by its
+ *  owning thread.
+ */
+void batchStateGeodetic(batchState *state, double C[4][4], double *lat, double *lon, double *alt)
+{
+    int p;
+
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts)
+    for(p = 0; p < state->numParts; p++) {
+        batchPartition *part;
+        double          x;
+        double          y;
+        double          z;
+        int             i;
+        int             k;
+
+        batchBindThread(state, p);
+        part = &state->part[p];
+        for(i = 0; i < part->n; i++) {
+            k = part->first + i;
+            x = C[1][1] * part->r[1][i] + C[1][2] * part->r[2][i] + C[1][3] * part->r[3][i];
+            y = C[2][1] * part->r[1][i] + C[2][2] * part->r[2][i] + C[2][3] * part->r[3][i];
+            z = C[3][1] * part->r[1][i] + C[3][2] * part->r[2][i] + C[3][3] * part->r[3][i];
+            frameGeodetic(x, y, z, &lat[k], &lon[k], &alt[k]);
+        }
+    }
+
+    return;
+}
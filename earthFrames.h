@@ -0,0 +1,50 @@
+/*
+ *  earthFrames.h
+ *  OrbitalMotion
+ *
+ *  Earth centered inertial (ECI) to Earth centered, Earth fixed
+ *  (ECEF) frame rotations and geodetic latitude, longitude and
+ *  altitude on the REQ_EARTH/FLAT_EARTH ellipsoid, for single
+ *  states and for SoA batches of states.
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "batchPropagation.h"
+
+#ifndef _EARTH_FRAMES_H_
+#define _EARTH_FRAMES_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define FRAME_ROTATION      0       /* Earth rotation about the ECI z axis only */
+    #define FRAME_IAU76         1       /* IAU 1976 precession and truncated IAU 1980 nutation */
+
+    #define FRAME_PARALLEL_MIN  4096    /* smallest batch converted with several threads */
+
+    double GMST(double jdUT1);
+    void   precessionIAU76(double jdTT, double P[4][4]);
+    void   nutationIAU80(double jdTT, double N[4][4], double *dpsi, double *eps);
+    double equationEquinoxes(double jdTT, double dpsi, double eps);
+    void   ECI2ECEFMatrix(double jdUT1, double jdTT, int model, double C[4][4]);
+    void   ECI2ECEF(double C[4][4], double *rECI, double *vECI, double *rECEF, double *vECEF);
+    void   ECEF2ECI(double C[4][4], double *rECEF, double *vECEF, double *rECI, double *vECI);
+    void   ECEF2geodetic(double *r, double *lat, double *lon, double *alt);
+    void   geodetic2ECEF(double lat, double lon, double alt, double *r);
+
+    void   batchECI2ECEF(double C[4][4], int n, double *r[3+1], double *v[3+1],
+                         double *rOut[3+1], double *vOut[3+1]);
+    void   batchECEF2ECI(double C[4][4], int n, double *r[3+1], double *v[3+1],
+                         double *rOut[3+1], double *vOut[3+1]);
+    void   batchECEF2geodetic(int n, double *r[3+1], double *lat, double *lon, double *alt);
+    void   batchGeodetic2ECEF(int n, double *lat, double *lon, double *alt, double *r[3+1]);
+    void   batchStateGeodetic(batchState *state, double C[4][4], double *lat, double *lon, double *alt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
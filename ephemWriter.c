@@ -0,0 +1,563 @@
+/*
+ *  ephemWriter.c
+ *  OrbitalMotion
+ *
+ *  Lock-free SPSC ring buffers feeding a background ephemeris
+ *  writer thread.  Each ring has exactly one producer (a worker
+ *  thread) and one consumer (the writer thread), so head and tail
+ *  are plain C11 atomics with acquire/release ordering and no locks.
+ *  The producer and consumer indices live on separate cache lines,
+ *  and each side caches the other side's index to avoid touching
+ *  the shared line on every record.
+ *
+ *  The writer drains up to EPHEM_WRITE_BATCH records per ring and
+ *  pass, serializes them into a per-ring staging buffer and submits
+ *  the buffers of all rings with a single writev() call.
+ *
+ *  File formats:
+ *      EPHEM_BINARY - 8 byte header "OMEPH001" followed by 88 byte
+ *                     records in native byte order:
+ *                     int32 object, int32 0, double t, x, y, z,
+ *                     vx, vy, vz, sigma1, sigma2, sigma3
+ *      EPHEM_CSV    - header line followed by one line per record:
+ *                     object,t,x,y,z,vx,vy,vz,s1,s2,s3
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "ephemWriter.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define EPHEM_CACHE_LINE    64
+#define EPHEM_CSV_RECORD    320     /* upper bound of the bytes per CSV line */
+#define EPHEM_MAX_IOV       256     /* buffers submitted per writev() call */
+
+typedef struct ephemRingStruct {
+    /* producer side */
+    _Atomic size_t tail;
+    size_t         headCache;
+    _Atomic size_t stalls;
+    char           pad1[EPHEM_CACHE_LINE - 3 * sizeof(size_t)];
+    /* consumer side */
+    _Atomic size_t head;
+    size_t         tailCache;
+    char           pad2[EPHEM_CACHE_LINE - 2 * sizeof(size_t)];
+    /* shared, read only */
+    size_t         mask;
+    ephemRecord   *rec;             /* record ring, start of the ring's memory block */
+    char          *buf;             /* writer staging buffer, in the same block */
+    char           pad3[EPHEM_CACHE_LINE - sizeof(size_t) - 2 * sizeof(void *)];
+} ephemRing;
+
+struct ephemWriterStruct {
+    int            fd;
+    int            format;
+    int            numWorkers;
+    ephemRing     *ring;
+    memPool       *pool;            /* source of the ring blocks, NULL for malloc() */
+    pthread_t      thread;
+    int            running;         /* non-zero once the writer thread was started */
+    _Atomic int    stop;
+    _Atomic int    error;
+    _Atomic size_t numRecords;
+    _Atomic size_t numBytes;
+    _Atomic size_t numWrites;
+};
+
+/*
+ *  status = ephemWriteAll(fd, iov, num)
+ *
+ *  Submits num buffers with writev(), resubmitting the remainder
+ *  after partial writes.  Returns the number of bytes written or
+ *  -1 on error.
+ */
+static long ephemWriteAll(int fd, struct iovec *iov, int num)
+{
+    long    total;
+    ssize_t n;
+
+    total = 0;
+    while(num > 0) {
+        n = writev(fd, iov, num);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        total += n;
+        while((num > 0) && ((size_t)n >= iov->iov_len)) {
+            n -= iov->iov_len;
+            iov++;
+            num--;
+        }
+        if(num > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return total;
+}
+
+/*
+ *  len = ephemSerialize(format, rec, buf)
+ *
+ *  Serializes one record into buf and returns its length.
+ */
+static size_t ephemSerialize(int format, ephemRecord *rec, char *buf)
+{
+    int32_t id[2];
+    double  val[10];
+    int     i;
+
+    if(format == EPHEM_CSV) {
+        return (size_t)snprintf(buf, EPHEM_CSV_RECORD,
+                                "%d,%.15g,%.15g,%.15g,%.15g,%.15g,%.15g,%.15g,%.15g,%.15g,%.15g\n",
+                                rec->object, rec->t, rec->r[1], rec->r[2], rec->r[3],
+                                rec->v[1], rec->v[2], rec->v[3],
+                                rec->sigma[1], rec->sigma[2], rec->sigma[3]);
+    }
+
+    id[0]  = (int32_t)rec->object;
+    id[1]  = 0;
+    val[0] = rec->t;
+    for(i = 1; i <= 3; i++) {
+        val[i]     = rec->r[i];
+        val[i + 3] = rec->v[i];
+        val[i + 6] = rec->sigma[i];
+    }
+    memcpy(buf, id, sizeof(id));
+    memcpy(buf + sizeof(id), val, sizeof(val));
+
+    return EPHEM_BINARY_RECORD;
+}
+
+/*
+ *  ephemFlush(w, iov, numIov, records)
+ *
+ *  Submits the staged buffers of one writer pass.
+ */
+static void ephemFlush(ephemWriter *w, struct iovec *iov, int numIov, size_t records)
+{
+    long bytes;
+
+    if(atomic_load_explicit(&w->error, memory_order_relaxed)) {
+        return;
+    }
+    bytes = ephemWriteAll(w->fd, iov, numIov);
+    if(bytes < 0) {
+        atomic_store(&w->error, 1);
+        return;
+    }
+    atomic_fetch_add_explicit(&w->numBytes, (size_t)bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&w->numWrites, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&w->numRecords, records, memory_order_relaxed);
+
+    return;
+}
+
+/*
+ *  ephemWriterMain(writer)
+ *
+ *  Background writer thread.  Drains all rings round-robin until
+ *  the writer is stopped and every ring is empty.  After a write
+ *  error the records are still drained, but discarded, so that the
+ *  producers never block forever.
+ */
+static void *ephemWriterMain(void *arg)
+{
+    ephemWriter    *w = (ephemWriter *)arg;
+    ephemRing      *ring;
+    struct iovec    iov[EPHEM_MAX_IOV];
+    struct timespec idle;
+    size_t          head;
+    size_t          n;
+    size_t          j;
+    size_t          len;
+    size_t          records;
+    size_t          drained;
+    int             stop;
+    int             numIov;
+    int             i;
+
+    idle.tv_sec  = 0;
+    idle.tv_nsec = 50000;
+
+    for(;;) {
+        /* read the stop flag first: all records pushed before it was
+           raised are then guaranteed to be seen by this pass */
+        stop    = atomic_load_explicit(&w->stop, memory_order_acquire);
+        drained = 0;
+        records = 0;
+        numIov  = 0;
+
+        for(i = 0; i < w->numWorkers; i++) {
+            ring = &w->ring[i];
+            head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            if(ring->tailCache == head) {
+                ring->tailCache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            }
+            n = ring->tailCache - head;
+            if(n == 0) {
+                continue;
+            }
+            if(n > EPHEM_WRITE_BATCH) {
+                n = EPHEM_WRITE_BATCH;
+            }
+
+            len = 0;
+            for(j = 0; j < n; j++) {
+                len += ephemSerialize(w->format, &ring->rec[(head + j) & ring->mask], ring->buf + len);
+            }
+            atomic_store_explicit(&ring->head, head + n, memory_order_release);
+
+            iov[numIov].iov_base = ring->buf;
+            iov[numIov].iov_len  = len;
+            numIov++;
+            records += n;
+            drained += n;
+
+            if(numIov == EPHEM_MAX_IOV) {
+                ephemFlush(w, iov, numIov, records);
+                numIov  = 0;
+                records = 0;
+            }
+        }
+        if(numIov > 0) {
+            ephemFlush(w, iov, numIov, records);
+        }
+
+        if(drained == 0) {
+            if(stop) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ *  cap = ephemRingCapacity(capacity)
+ *
+ *  Returns the ring size in records: capacity rounded up to a power
+ *  of 2, or EPHEM_RING_CAPACITY if capacity is 0.
+ */
+static size_t ephemRingCapacity(int capacity)
+{
+    size_t cap;
+
+    cap = 1;
+    while(cap < (size_t)(capacity > 0 ? capacity : EPHEM_RING_CAPACITY)) {
+        cap <<= 1;
+    }
+
+    return cap;
+}
+
+/*
+ *  bytes = ephemWriterRingBytes(format, capacity)
+ *
+ *  Returns the size of the memory block of one ring, holding the
+ *  records and the staging buffer.  A memPool handed to
+ *  ephemWriterOpenInPool() needs objects of at least this size.
+ */
+size_t ephemWriterRingBytes(int format, int capacity)
+{
+    size_t recArray;
+
+    recArray = (ephemRingCapacity(capacity) * sizeof(ephemRecord) + EPHEM_CACHE_LINE - 1)
+               & ~(size_t)(EPHEM_CACHE_LINE - 1);
+
+    return recArray + EPHEM_WRITE_BATCH * (size_t)(format == EPHEM_CSV ? EPHEM_CSV_RECORD : EPHEM_BINARY_RECORD);
+}
+
+/*
+ *  writer = ephemWriterOpen(fileName, format, numWorkers, capacity)
+ *
+ *  Same as ephemWriterOpenInPool() with the ring memory taken from
+ *  malloc().
+ */
+ephemWriter *ephemWriterOpen(const char *fileName, int format, int numWorkers, int capacity)
+{
+    return ephemWriterOpenInPool(fileName, format, numWorkers, capacity, NULL);
+}
+
+/*
+ *  writer = ephemWriterOpenInPool(fileName, format, numWorkers, capacity, pool)
+ *
+ *  Creates the ephemeris file fileName, one ring of capacity
+ *  records (rounded up to a power of 2, EPHEM_RING_CAPACITY if 0)
+ *  per worker, and starts the background writer thread.  The
+ *  records and staging buffer of each ring share one memory block
+ *  taken from pool, whose objects must hold ephemWriterRingBytes()
+ *  bytes.  ephemWriterClose() returns the blocks to the pool, so
+ *  the writers of successive runs recycle the same memory, which
+ *  is released in bulk with the pool's arena.  The pool must not
+ *  be used by other threads while the writer is opened or closed.
+ *
+ *  Input is
+ *      fileName   - output file, truncated if it exists
+ *      format     - EPHEM_BINARY or EPHEM_CSV
+ *      numWorkers - number of producer threads
+ *      capacity   - ring size in records
+ *      pool       - pool of ring blocks, NULL for malloc()
+ *
+ *  Returns NULL if the file, memory or thread could not be created.
+ */
+ephemWriter *ephemWriterOpenInPool(const char *fileName, int format, int numWorkers, int capacity,
+                                   memPool *pool)
+{
+    ephemWriter *w;
+    void        *mem;
+    size_t       cap;
+    size_t       bytes;
+    size_t       recArray;
+    const char  *header;
+    struct iovec iov;
+    int          i;
+
+    if((numWorkers < 1) || ((format != EPHEM_BINARY) && (format != EPHEM_CSV))) {
+        printf("ERROR: ephemWriterOpen() received numWorkers = %d, format = %d \n", numWorkers, format);
+        printf("numWorkers should be >= 1 and format EPHEM_BINARY or EPHEM_CSV. \n");
+        return NULL;
+    }
+    cap      = ephemRingCapacity(capacity);
+    bytes    = ephemWriterRingBytes(format, capacity);
+    recArray = bytes - EPHEM_WRITE_BATCH * (size_t)(format == EPHEM_CSV ? EPHEM_CSV_RECORD : EPHEM_BINARY_RECORD);
+    if((pool != NULL) && (pool->objSize < bytes)) {
+        printf("ERROR: ephemWriterOpen() received a pool of %lu byte objects \n", (unsigned long)pool->objSize);
+        printf("The pool objects should hold ephemWriterRingBytes() = %lu bytes. \n", (unsigned long)bytes);
+        return NULL;
+    }
+
+    w = (ephemWriter *)calloc(1, sizeof(ephemWriter));
+    if(w == NULL) {
+        return NULL;
+    }
+    w->fd = -1;
+    mem = NULL;
+    if(posix_memalign(&mem, EPHEM_CACHE_LINE, numWorkers * sizeof(ephemRing)) != 0) {
+        free(w);
+        return NULL;
+    }
+    w->ring = (ephemRing *)mem;
+    memset(w->ring, 0, numWorkers * sizeof(ephemRing));
+    w->numWorkers = numWorkers;
+    w->format     = format;
+    w->pool       = pool;
+    for(i = 0; i < numWorkers; i++) {
+        mem = (pool != NULL) ? memPoolAlloc(pool) : malloc(bytes);
+        if(mem == NULL) {
+            w->numWorkers = i;
+            ephemWriterClose(w);
+            return NULL;
+        }
+        w->ring[i].mask = cap - 1;
+        w->ring[i].rec  = (ephemRecord *)mem;
+        w->ring[i].buf  = (char *)mem + recArray;
+    }
+
+    w->fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(w->fd < 0) {
+        printf("ERROR: ephemWriterOpen() could not open %s \n", fileName);
+        ephemWriterClose(w);
+        return NULL;
+    }
+    header = format == EPHEM_CSV ? "object,t,x,y,z,vx,vy,vz,s1,s2,s3\n" : "OMEPH001";
+    iov.iov_base = (void *)header;
+    iov.iov_len  = strlen(header);
+    if(ephemWriteAll(w->fd, &iov, 1) < 0) {
+        ephemWriterClose(w);
+        return NULL;
+    }
+
+    if(pthread_create(&w->thread, NULL, ephemWriterMain, w) != 0) {
+        printf("ERROR: ephemWriterOpen() could not start the writer thread \n");
+        ephemWriterClose(w);
+        return NULL;
+    }
+    w->running = 1;
+
+    return w;
+}
+
+/*
+ *  status = ephemWriterPush(writer, worker, rec)
+ *
+ *  Hands one record to the writer through the ring of worker.
+ *  Must only be called by the thread owning that ring.  Waits
+ *  (yielding the CPU) while the ring is full.  Returns -1 if the
+ *  writer has failed to write earlier records.
+ */
+int ephemWriterPush(ephemWriter *writer, int worker, ephemRecord *rec)
+{
+    ephemRing *ring;
+    size_t     tail;
+
+    ring = &writer->ring[worker];
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if(tail - ring->headCache > ring->mask) {
+        ring->headCache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while(tail - ring->headCache > ring->mask) {
+            atomic_fetch_add_explicit(&ring->stalls, 1, memory_order_relaxed);
+            sched_yield();
+            ring->headCache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        }
+    }
+    ring->rec[tail & ring->mask] = *rec;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return atomic_load_explicit(&writer->error, memory_order_relaxed) ? -1 : 0;
+}
+
+/*
+ *  status = ephemWriterPushState(writer, worker, object, t, rVec, vVec, sigma)
+ *
+ *  Convenience wrapper of ephemWriterPush().  sigma may be NULL
+ *  if no attitude is propagated, in which case zeros are written.
+ */
+int ephemWriterPushState(ephemWriter *writer, int worker, int object, double t,
+                         double *rVec, double *vVec, double *sigma)
+{
+    ephemRecord rec;
+
+    rec.object = object;
+    rec.t      = t;
+    equal(rVec, rec.r);
+    equal(vVec, rec.v);
+    if(sigma != NULL) {
+        equal(sigma, rec.sigma);
+    } else {
+        setZero(rec.sigma);
+    }
+
+    return ephemWriterPush(writer, worker, &rec);
+}
+
+/*
+ *  ephemWriterPropagate(writer, state, fm, dt, numSteps, every)
+ *
+ *  Same as batchPropagate(), but streams the states of all objects
+ *  to the writer after every "every" steps.  Partition p is pushed
+ *  through ring p, so the writer needs at least state->numParts
+ *  workers.
+ */
+void ephemWriterPropagate(ephemWriter *writer, batchState *state, batchForceModel *fm,
+                          double dt, int numSteps, int every)
+{
+    double t0;
+    int    p;
+
+    if((writer->numWorkers < state->numParts) || (every < 1)) {
+        printf("ERROR: ephemWriterPropagate() received %d workers for %d partitions, every = %d \n",
+               writer->numWorkers, state->numParts, every);
+        printf("The writer needs one worker per partition and every should be >= 1. \n");
+        return;
+    }
+
+    t0 = state->t;
+    #pragma omp parallel for schedule(static, 1) num_threads(state->numParts)
+    for(p = 0; p < state->numParts; p++) {
+        batchPartition *part = &state->part[p];
+        ephemRecord     rec;
+        int             j;
+        int             k;
+        int             i;
+
+        batchBindThread(state, p);
+        setZero(rec.sigma);
+        for(j = 1; j <= numSteps; j++) {
+            batchStepRK4(fm, part, dt);
+            if(j % every != 0) {
+                continue;
+            }
+            rec.t = t0 + j * dt;
+            for(k = 0; k < part->n; k++) {
+                rec.object = part->first + k;
+                for(i = 1; i <= 3; i++) {
+                    rec.r[i] = part->r[i][k];
+                    rec.v[i] = part->v[i][k];
+                }
+                ephemWriterPush(writer, p, &rec);
+            }
+        }
+    }
+    state->t += numSteps * dt;
+
+    return;
+}
+
+/*
+ *  ephemWriterGetStats(writer, stats)
+ *
+ *  Returns the output statistics of the writer so far.
+ */
+void ephemWriterGetStats(ephemWriter *writer, ephemWriterStatistics *stats)
+{
+    int i;
+
+    stats->numRecords = atomic_load(&writer->numRecords);
+    stats->numBytes   = atomic_load(&writer->numBytes);
+    stats->numWrites  = atomic_load(&writer->numWrites);
+    stats->numStalls  = 0;
+    for(i = 0; i < writer->numWorkers; i++) {
+        stats->numStalls += atomic_load(&writer->ring[i].stalls);
+    }
+
+    return;
+}
+
+/*
+ *  status = ephemWriterClose(writer)
+ *
+ *  Waits until all pushed records are written, stops the writer
+ *  thread, closes the file and releases the writer, returning the
+ *  ring blocks to the pool if it was opened with one.  All producers
+ *  must have finished pushing.  Returns 0 if every record was
+ *  written and -1 otherwise.
+ */
+int ephemWriterClose(ephemWriter *writer)
+{
+    int status;
+    int i;
+
+    if(writer == NULL) {
+        return -1;
+    }
+    if(writer->running) {
+        atomic_store_explicit(&writer->stop, 1, memory_order_release);
+        pthread_join(writer->thread, NULL);
+    }
+    status = atomic_load(&writer->error) ? -1 : 0;
+    if(writer->fd >= 0) {
+        if(close(writer->fd) != 0) {
+            status = -1;
+        }
+    }
+    for(i = 0; i < writer->numWorkers; i++) {
+        if(writer->pool != NULL) {
+            memPoolRelease(writer->pool, writer->ring[i].rec);
+        } else {
+            free(writer->ring[i].rec);
+        }
+    }
+    free(writer->ring);
+    free(writer);
+
+    return status;
+}
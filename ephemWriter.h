@@ -0,0 +1,69 @@
+/*
+ *  ephemWriter.h
+ *  OrbitalMotion
+ *
+ *  Asynchronous ephemeris output.  Every worker thread owns a
+ *  lock-free single-producer/single-consumer ring buffer into which
+ *  it hands propagated states (t, r, v, MRP attitude).  A background
+ *  writer thread drains all rings in batches and serializes them to
+ *  a binary or CSV file, submitting the data of all rings with one
+ *  writev() call per batch.  The compute threads thus never block
+ *  on I/O, only on a full ring.  The ring memory can be taken from a
+ *  memPool, so that the writers of successive runs recycle it.
+ *
+ *  Requires POSIX threads and C11 atomics (link with -lpthread).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "batchPropagation.h"
+
+#ifndef _EPHEM_WRITER_H_
+#define _EPHEM_WRITER_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define EPHEM_BINARY            0
+    #define EPHEM_CSV               1
+    #define EPHEM_RING_CAPACITY     4096
+    #define EPHEM_WRITE_BATCH       512
+    #define EPHEM_BINARY_RECORD     88      /* bytes per binary record */
+
+    typedef struct ephemRec {
+        int    object;          /* catalog object number */
+        double t;               /* epoch (sec) */
+        double r[3+1];          /* inertial position vector (km) */
+        double v[3+1];          /* inertial velocity vector (km/s) */
+        double sigma[3+1];      /* attitude MRP vector */
+    } ephemRecord;
+
+    typedef struct ephemWriterStats {
+        size_t numRecords;      /* records written to the file */
+        size_t numBytes;        /* bytes written to the file */
+        size_t numWrites;       /* writev() system calls */
+        size_t numStalls;       /* producer waits on a full ring */
+    } ephemWriterStatistics;
+
+    typedef struct ephemWriterStruct ephemWriter;
+
+    size_t       ephemWriterRingBytes(int format, int capacity);
+    ephemWriter *ephemWriterOpen(const char *fileName, int format, int numWorkers, int capacity);
+    ephemWriter *ephemWriterOpenInPool(const char *fileName, int format, int numWorkers, int capacity,
+                                       memPool *pool);
+    int          ephemWriterPush(ephemWriter *writer, int worker, ephemRecord *rec);
+    int          ephemWriterPushState(ephemWriter *writer, int worker, int object, double t,
+                                      double *rVec, double *vVec, double *sigma);
+    void         ephemWriterPropagate(ephemWriter *writer, batchState *state, batchForceModel *fm,
+                                      double dt, int numSteps, int every);
+    void         ephemWriterGetStats(ephemWriter *writer, ephemWriterStatistics *stats);
+    int          ephemWriterClose(ephemWriter *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ *  batchMpiScreen.c
+ *  OrbitalMotion
+ *
+ *  Checks the distributed conjunction screening of batchMPI.c
+ *  against a serial all-pairs screen.  A dispersed catalog is
+ *  propagated on all ranks, screened with batchMpiScreen() at a
+ *  short and at a long screening distance, and rank 0 compares the
+ *  union of the candidate lists of all ranks with the serial screen
+ *  of the gathered states.  Exits with 0 if all lists agree.
+ *
+ *  Build and run from this directory, e.g.
+ *      mpicc -std=c99 -O2 -fopenmp -D_DEFAULT_SOURCE -I.. -o batchMpiScreen batchMpiScreen.c \
+ *          ../batchMPI.c ../batchPropagation.c ../memArena.c ../gravityLattice.c ../dualNumbers.c \
+ *          ../monteCarlo.c ../orbitalMotion.c ../vector3D.c ../RigidBodyKinematics.c -lm
+ *      mpirun -np 4 ./batchMpiScreen
+ *
+ */
+
+#include <string.h>
+#include "batchMPI.h"
+#include "monteCarlo.h"
+
+#define SCREEN_OBJECTS      800
+#define SCREEN_SAMPLES      3
+#define SCREEN_SEED         20260601
+
+/*
+ *  screenInit(object, sample, rVec, vVec, CdAm, Am, data)
+ *
+ *  Low Earth orbits spread over a 400 km shell, with sample 0 the
+ *  nominal state of an object and the other samples dispersed by
+ *  1 km and 1 m/s (1 sigma) about it.
+ */
+static void screenInit(int object, int sample, double *rVec, double *vVec, double *CdAm, double *Am,
+                       void *data)
+{
+    classicElements el;
+    double          u1;
+    double          u2;
+    int             j;
+
+    (void)data;
+    mcUniform2(SCREEN_SEED, object, 0, 0, &u1, &u2);
+    el.a     = REQ_EARTH + 500. + 400. * u1;
+    el.e     = 0.001 * u2;
+    mcUniform2(SCREEN_SEED, object, 0, 1, &u1, &u2);
+    el.i     = acos(1. - 2. * u1);
+    el.Omega = 2. * M_PI * u2;
+    mcUniform2(SCREEN_SEED, object, 0, 2, &u1, &u2);
+    el.omega = 2. * M_PI * u1;
+    el.anom  = 2. * M_PI * u2;
+    elem2rv(MU_EARTH, &el, rVec, vVec);
+    if(sample > 0) {
+        for(j = 1; j <= 3; j++) {
+            rVec[j] += mcNormal(SCREEN_SEED, sample, object, j);
+            vVec[j] += 0.001 * mcNormal(SCREEN_SEED, sample, object, j + 3);
+        }
+    }
+    *CdAm = 0.01;
+    *Am   = 0.01;
+
+    return;
+}
+
+static int screenCompare(const void *a, const void *b)
+{
+    const batchConjunction *ca = (const batchConjunction *)a;
+    const batchConjunction *cb = (const batchConjunction *)b;
+
+    if(ca->item1 != cb->item1) {
+        return (ca->item1 > cb->item1) - (ca->item1 < cb->item1);
+    }
+    return (ca->item2 > cb->item2) - (ca->item2 < cb->item2);
+}
+
+/*
+ *  num = screenSerial(numItems, numSamples, r, dist, list)
+ *
+ *  All-pairs screen of the states r[1..3][0..numItems-1], with the
+ *  same rules as batchMpiScreen().  list must hold all pairs.
+ */
+static int screenSerial(int numItems, int numSamples, double *r[3+1], double dist, batchConjunction *list)
+{
+    double d[3+1];
+    double dd;
+    int    num;
+    int    i1;
+    int    i2;
+
+    num = 0;
+    for(i1 = 0; i1 < numItems; i1++) {
+        for(i2 = i1 + 1; i2 < numItems; i2++) {
+            if(i1 / numSamples == i2 / numSamples) {
+                continue;
+            }
+            set3(r[1][i2] - r[1][i1], r[2][i2] - r[2][i1], r[3][i2] - r[3][i1], d);
+            dd = norm(d);
+            if(dd <= dist) {
+                list[num].item1 = i1;
+                list[num].item2 = i2;
+                list[num].dist  = dd;
+                num++;
+            }
+        }
+    }
+
+    return num;
+}
+
+/*
+ *  fail = screenCheck(cat, r, dist)
+ *
+ *  Collective.  Screens the catalog with batchMpiScreen(), collects
+ *  the candidates of all ranks on rank 0 and compares them with the
+ *  serial screen of the gathered states r.  Returns 1 on all ranks
+ *  if the lists differ or the screening failed.
+ */
+static int screenCheck(batchMpiCatalog *cat, double *r[3+1], double dist)
+{
+    batchConjunction *list;
+    batchConjunction *all;
+    batchConjunction *ref;
+    int              *counts;
+    int              *displs;
+    int               num;
+    int               numAll;
+    int               numRef;
+    int               fail;
+    int               i;
+
+    if(batchMpiScreen(cat, dist, &list, &num) != 0) {
+        return 1;
+    }
+    counts = (int *)malloc(2 * cat->size * sizeof(int));
+    displs = counts + cat->size;
+    MPI_Gather(&num, 1, MPI_INT, counts, 1, MPI_INT, 0, cat->comm);
+    numAll = 0;
+    for(i = 0; i < cat->size; i++) {
+        displs[i]  = numAll * (int)sizeof(batchConjunction);
+        numAll    += cat->rank == 0 ? counts[i] : 0;
+        counts[i] *= (int)sizeof(batchConjunction);
+    }
+    all = (batchConjunction *)malloc(((size_t)numAll + 1) * sizeof(batchConjunction));
+    MPI_Gatherv(list, num * (int)sizeof(batchConjunction), MPI_BYTE, all, counts, displs, MPI_BYTE, 0,
+                cat->comm);
+
+    fail = 0;
+    if(cat->rank == 0) {
+        ref    = (batchConjunction *)malloc(((size_t)cat->numItems * (cat->numItems - 1) / 2 + 1)
+                                            * sizeof(batchConjunction));
+        numRef = screenSerial(cat->numItems, cat->numSamples, r, dist, ref);
+        qsort(all, numAll, sizeof(batchConjunction), screenCompare);
+        qsort(ref, numRef, sizeof(batchConjunction), screenCompare);
+        fail = (numAll != numRef);
+        for(i = 0; !fail && (i < numRef); i++) {
+            fail = (all[i].item1 != ref[i].item1) || (all[i].item2 != ref[i].item2)
+                   || (fabs(all[i].dist - ref[i].dist) > 1e-9);
+        }
+        printf("dist = %7.1f km: %d ranks, %d pairs, serial screen %d pairs  %s\n",
+               dist, cat->size, numAll, numRef, fail ? "FAILED" : "ok");
+        free(ref);
+    }
+    MPI_Bcast(&fail, 1, MPI_INT, 0, cat->comm);
+
+    free(all);
+    free(counts);
+    free(list);
+
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    batchMpiCatalog cat;
+    batchForceModel fm;
+    double         *r[3+1];
+    double         *v[3+1];
+    double         *mem;
+    int             fail;
+    int             i;
+
+    MPI_Init(&argc, &argv);
+    if(batchMpiCreate(MPI_COMM_WORLD, SCREEN_OBJECTS, SCREEN_SAMPLES, 1, &cat) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    batchInitForceModel(&fm);
+    fm.jnum = 2;
+    batchMpiInit(&cat, screenInit, NULL);
+    batchMpiPropagate(&cat, &fm, 10., 30);
+
+    mem = (double *)malloc(6 * (size_t)cat.numItems * sizeof(double));
+    for(i = 1; i <= 3; i++) {
+        r[i] = mem + (i - 1) * (size_t)cat.numItems;
+        v[i] = mem + (i + 2) * (size_t)cat.numItems;
+    }
+    if(batchMpiGather(&cat, 0, r, v) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* slabs are thinner than the long distance on a few ranks, so
+       its halo is forwarded over several ranks */
+    fail  = screenCheck(&cat, r, 50.);
+    fail |= screenCheck(&cat, r, 2000.);
+
+    free(mem);
+    batchMpiFree(&cat);
+    MPI_Finalize();
+
+    return fail;
+}
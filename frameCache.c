@@ -0,0 +1,286 @@
+/*
+ *  frameCache.c
+ *  OrbitalMotion
+ *
+ *  Grid evaluation and SLERP interpolation of the ECI to ECEF
+ *  rotation C = W R3(theta) N P.  The relative node rotations are
+ *  formed with subEP() and applied with addEP(); the principal
+ *  rotation vectors are evaluated locally with atan2() because the
+ *  node-to-node rotations are below an arcsecond, where the acos()
+ *  of EP2PRV() loses most of its precision and PRV2EP() is
+ *  singular for a zero rotation.
+ *
+ */
+
+#include "frameCache.h"
+#include "RigidBodyKinematics.h"
+#include "vector3D.h"
+
+/*
+ *  frameRelativePRV(q0, q1, phi)
+ *
+ *  Returns the principal rotation vector phi of the shortest
+ *  rotation from the EP q0 to the EP q1.
+ */
+static void frameRelativePRV(double *q0, double *q1, double *phi)
+{
+    double dq[4+1];
+    double s;
+    double f;
+
+    subEP(q1, q0, dq);
+    if(dq[1] < 0.) {
+        dq[1] = -dq[1];
+        dq[2] = -dq[2];
+        dq[3] = -dq[3];
+        dq[4] = -dq[4];
+    }
+    s = sqrt(dq[2] * dq[2] + dq[3] * dq[3] + dq[4] * dq[4]);
+    f = s > 0. ? 2. * atan2(s, dq[1]) / s : 2.;
+    set3(f * dq[2], f * dq[3], f * dq[4], phi);
+
+    return;
+}
+
+/*
+ *  frameSlerp(q0, phi, tau, q)
+ *
+ *  Returns the EP q reached after the fraction tau of the
+ *  principal rotation phi away from the EP q0.
+ */
+static void frameSlerp(double *q0, double *phi, double tau, double *q)
+{
+    double dq[4+1];
+    double p;
+    double f;
+
+    p = tau * norm(phi);
+    f = p > 0. ? tau * sin(p / 2.) / p : tau / 2.;
+    dq[1] = cos(p / 2.);
+    dq[2] = f * phi[1];
+    dq[3] = f * phi[2];
+    dq[4] = f * phi[3];
+    addEP(q0, dq, q);
+
+    return;
+}
+
+/*
+ *  frameNodeEval(jdTT, polar, data, qNP, qW, eqeq)
+ *
+ *  Evaluates the precession-nutation and polar motion rotations
+ *  and the equation of the equinoxes at the TT Julian date jdTT.
+ */
+static void frameNodeEval(double jdTT, framePolarMotion polar, void *data,
+                          double *qNP, double *qW, double *eqeq)
+{
+    double P[4][4];
+    double N[4][4];
+    double NP[4][4];
+    double m1[4][4];
+    double m2[4][4];
+    double W[4][4];
+    double dpsi;
+    double eps;
+    double xp;
+    double yp;
+
+    precessionIAU76(jdTT, P);
+    nutationIAU80(jdTT, N, &dpsi, &eps);
+    MdotM(N, P, NP);
+    C2EP(NP, qNP);
+    *eqeq = equationEquinoxes(jdTT, dpsi, eps);
+
+    xp = 0.;
+    yp = 0.;
+    if(polar != NULL) {
+        polar(jdTT, &xp, &yp, data);
+    }
+    Mi(-yp, 1, m1);
+    Mi(-xp, 2, m2);
+    MdotM(m1, m2, W);
+    C2EP(W, qW);
+
+    return;
+}
+
+/*
+ *  frameCompose(qNP, qW, theta, C)
+ *
+ *  Returns C = W R3(theta) NP.
+ */
+static void frameCompose(double *qNP, double *qW, double theta, double C[4][4])
+{
+    double NP[4][4];
+    double W[4][4];
+    double R[4][4];
+    double m[4][4];
+
+    EP2C(qNP, NP);
+    EP2C(qW, W);
+    Mi(theta, 3, R);
+    MdotM(R, NP, m);
+    MdotM(W, m, C);
+
+    return;
+}
+
+/*
+ *  frameCacheInterp(cache, jdTT, qNP, qW, eqeq)
+ *
+ *  Interpolates the cached rotations at the TT Julian date jdTT.
+ *  Returns -1 if jdTT is outside of the cached time span.
+ */
+static int frameCacheInterp(const frameCache *cache, double jdTT, double *qNP, double *qW, double *eqeq)
+{
+    frameNode *node;
+    double     x;
+    double     tau;
+    int        i;
+
+    x = (jdTT - cache->jd0) / cache->step;
+    if((x < 0.) || (x > cache->num - 1)) {
+        return -1;
+    }
+    i = (int)x;
+    if(i > cache->num - 2) {
+        i = cache->num - 2;
+    }
+    tau  = x - i;
+    node = &cache->node[i];
+
+    frameSlerp(node->qNP, node->dNP, tau, qNP);
+    frameSlerp(node->qW, node->dW, tau, qW);
+    *eqeq = node->eqeq + tau * (node[1].eqeq - node->eqeq);
+
+    return 0;
+}
+
+/*
+ *  cache = frameCacheCreate(jdStart, jdEnd, step, polar, data)
+ *
+ *  Builds the rotation cache for the TT Julian dates jdStart to
+ *  jdEnd with the node spacing step (days).  The optional function
+ *  polar(jdTT, &xp, &yp, data) returns the pole coordinates; it is
+ *  called from several threads.  Returns NULL on failure.
+ */
+frameCache *frameCacheCreate(double jdStart, double jdEnd, double step,
+                             framePolarMotion polar, void *data)
+{
+    frameCache *cache;
+    double      maxErr;
+    int         num;
+    int         i;
+
+    if((step <= 0.) || (jdEnd <= jdStart)) {
+        printf("ERROR: frameCacheCreate() received step = %g, span = %g \n", step, jdEnd - jdStart);
+        printf("The step and the time span should be positive. \n");
+        return NULL;
+    }
+    num   = (int)ceil((jdEnd - jdStart) / step) + 1;
+    cache = (frameCache *)malloc(sizeof(frameCache));
+    if(cache == NULL) {
+        return NULL;
+    }
+    cache->node = (frameNode *)malloc(num * sizeof(frameNode));
+    if(cache->node == NULL) {
+        free(cache);
+        return NULL;
+    }
+    cache->jd0  = jdStart;
+    cache->step = step;
+    cache->num  = num;
+
+    #pragma omp parallel for schedule(static)
+    for(i = 0; i < num; i++) {
+        frameNode *node;
+
+        node = &cache->node[i];
+        frameNodeEval(jdStart + i * step, polar, data, node->qNP, node->qW, &node->eqeq);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(i = 0; i < num; i++) {
+        frameNode *node;
+
+        node = &cache->node[i];
+        if(i < num - 1) {
+            frameRelativePRV(node->qNP, node[1].qNP, node->dNP);
+            frameRelativePRV(node->qW, node[1].qW, node->dW);
+        } else {
+            setZero(node->dNP);
+            setZero(node->dW);
+        }
+    }
+
+    /* measure the interpolation error at the interval midpoints */
+    maxErr = 0.;
+    #pragma omp parallel for schedule(static) reduction(max:maxErr)
+    for(i = 0; i < num - 1; i++) {
+        double qNP[4+1];
+        double qW[4+1];
+        double q1[4+1];
+        double q2[4+1];
+        double phi[3+1];
+        double C1[4][4];
+        double C2[4][4];
+        double eqeq;
+        double jd;
+
+        jd = jdStart + (i + 0.5) * step;
+        frameNodeEval(jd, polar, data, qNP, qW, &eqeq);
+        frameCompose(qNP, qW, eqeq, C1);
+        frameCacheInterp(cache, jd, qNP, qW, &eqeq);
+        frameCompose(qNP, qW, eqeq, C2);
+        C2EP(C1, q1);
+        C2EP(C2, q2);
+        frameRelativePRV(q1, q2, phi);
+        if(norm(phi) > maxErr) {
+            maxErr = norm(phi);
+        }
+    }
+    cache->maxErr = maxErr;
+
+    return cache;
+}
+
+/*
+ *  frameCacheFree(cache)
+ *
+ *  Releases a rotation cache.
+ */
+void frameCacheFree(frameCache *cache)
+{
+    if(cache == NULL) {
+        return;
+    }
+    free(cache->node);
+    free(cache);
+
+    return;
+}
+
+/*
+ *  status = frameCacheMatrix(cache, jdUT1, jdTT, C)
+ *
+ *  Returns the ECI to ECEF rotation C at the UT1 Julian date jdUT1
+ *  (terrestrial time jdTT), interpolated from the cache.  Returns
+ *  -1 and a NAN matrix if jdTT is outside of the cached time span.
+ */
+int frameCacheMatrix(const frameCache *cache, double jdUT1, double jdTT, double C[4][4])
+{
+    double qNP[4+1];
+    double qW[4+1];
+    double eqeq;
+
+    if(frameCacheInterp(cache, jdTT, qNP, qW, &eqeq) != 0) {
+        printf("ERROR: frameCacheMatrix() received jdTT = %.6f \n", jdTT);
+        printf("The value of jdTT should be within %.6f and %.6f. \n",
+               cache->jd0, cache->jd0 + (cache->num - 1) * cache->step);
+        setMatrix(NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN, C);
+        return -1;
+    }
+    frameCompose(qNP, qW, GMST(jdUT1) + eqeq, C);
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ *  frameCache.h
+ *  OrbitalMotion
+ *
+ *  Cached ECI to ECEF rotation.  The precession-nutation and polar
+ *  motion rotations are evaluated on a coarse, uniform time grid and
+ *  stored as Euler parameters together with the node-to-node
+ *  principal rotation vectors; queries interpolate them with a
+ *  constant rate rotation (SLERP) and apply the Earth rotation
+ *  angle exactly.  A built cache is never written to again and may
+ *  be shared by any number of threads.
+ *
+ *  Interpolation error: SLERP is exact for a rotation at constant
+ *  angular rate, so the error is bounded by h^2/8 times the largest
+ *  angular acceleration of the cached rotation, where h is the node
+ *  spacing.  It is dominated by the 13.66 day nutation term and is
+ *  below 0.0045 h^2 arcsec (h in days), i.e. 0.07 mas for h = 1/8
+ *  day, 1.1 mas for h = 1/2 day and 4.2 mas for h = 1 day over
+ *  2000-2010.  The largest error at the interval midpoints is
+ *  measured when the cache is built and returned in maxErr.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "earthFrames.h"
+
+#ifndef _FRAME_CACHE_H_
+#define _FRAME_CACHE_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    /* returns the pole coordinates xp, yp (rad) at the TT Julian date jdTT */
+    typedef void (*framePolarMotion)(double jdTT, double *xp, double *yp, void *data);
+
+    typedef struct frameNodeStruct {
+        double qNP[4+1];            /* EP of the ECI to true of date rotation */
+        double dNP[3+1];            /* principal rotation vector to the next node */
+        double qW[4+1];             /* EP of the polar motion rotation */
+        double dW[3+1];             /* principal rotation vector to the next node */
+        double eqeq;                /* equation of the equinoxes (rad) */
+    } frameNode;
+
+    typedef struct frameCacheStruct {
+        double     jd0;             /* TT Julian date of the first node */
+        double     step;            /* node spacing (days) */
+        int        num;             /* number of nodes */
+        double     maxErr;          /* largest measured interpolation error (rad) */
+        frameNode *node;
+    } frameCache;
+
+    frameCache *frameCacheCreate(double jdStart, double jdEnd, double step,
+                                 framePolarMotion polar, void *data);
+    void        frameCacheFree(frameCache *cache);
+    int         frameCacheMatrix(const frameCache *cache, double jdUT1, double jdTT, double C[4][4]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,636 @@
+/*
+ *  gaussJackson.c
+ *  OrbitalMotion
+ *
+ *  With the backward difference operator del, the shift operator
+ *  E = 1/(1 - del) and the step h, the exact integrals of the second
+ *  derivatives a of the window are
+ *
+ *      y'_n / h   = (log E)^-1 a_n = s_n + G(del) a_n
+ *      y_n  / h^2 = (log E)^-2 a_n = S_n + H(del) a_n
+ *
+ *  where the first and second sums obey s_n - s_(n-1) = a_n and
+ *  S_n - S_(n-1) = s_(n-1), and G(x) = 1/(-log(1-x)) - 1/x and
+ *  H(x) = 1/log(1-x)^2 - 1/x^2 + 1/x are the Adams and Stormer
+ *  generating functions.  The point q steps back from the newest is
+ *  reached with E^-q = (1-del)^q, the predictor with E.  The series
+ *  are truncated after del^8 and the differences expanded into the
+ *  nine ordinates of the window, which gives the summed (ordinate)
+ *  form of Berry and Healy.  The coefficient matrices are generated
+ *  at run time from these series instead of being tabulated.
+ *
+ *  The sums are initialized at the middle of the startup window from
+ *  the exact epoch state.  Velocity dependent forces (drag and the
+ *  Sundman form) use the predicted and corrected velocities.  In the
+ *  Sundman mode the integrated variables are [r t] with
+ *
+ *      r'' = (r . v) v + |r|^2 a,  t'' = r . v,  v = r' / |r|
+ *
+ *  where ' denotes d/ds.  Dense output integrates the degree 8
+ *  Newton backward interpolant of a twice from the newest point.
+ *
+ *  References:
+ *  M. M. Berry and L. M. Healy, "Implementation of Gauss-Jackson
+ *  Integration for Orbit Propagation", J. Astronautical Sciences,
+ *  52(3), 2004.
+ *  O. Montenbruck and E. Gill, "Satellite Orbits", Springer, 2000,
+ *  section 4.2.6.
+ */
+
+#include <string.h>
+#include "gaussJackson.h"
+
+#define GJ_NUM_SERIES       (GJ_POINTS + 2)
+
+/*
+ *  gjOrdinates(P, q, c)
+ *
+ *  Multiplies the series P[0..8] in del by (1 - del)^q, truncates it
+ *  after del^8 and returns the ordinate coefficients c[0..8] of the
+ *  window, c[8] belonging to the newest point.
+ */
+static void gjOrdinates(double *P, int q, double *c)
+{
+    double F[GJ_POINTS];
+    double R[GJ_POINTS];
+    double b;
+    int    i;
+    int    j;
+
+    F[0] = 1.;
+    for(j = 1; j < GJ_POINTS; j++) {
+        F[j] = F[j - 1] * (j - 1 - q) / j;
+    }
+    for(j = 0; j < GJ_POINTS; j++) {
+        R[j] = 0.;
+        for(i = 0; i <= j; i++) {
+            R[j] += F[i] * P[j - i];
+        }
+    }
+
+    /* del^j a_n = sum_i (-1)^i binom(j, i) a_(n-i) */
+    for(i = 0; i < GJ_POINTS; i++) {
+        c[GJ_POINTS - 1 - i] = 0.;
+        b = 1.;
+        for(j = i; j < GJ_POINTS; j++) {
+            c[GJ_POINTS - 1 - i] += ((i % 2) ? -b : b) * R[j];
+            b = b * (j + 1) / (j + 1 - i);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  status = gjInit(gj, fm, CdAm, Am, mode, h)
+ *
+ *  Sets up the integrator for the force model fm and the object
+ *  parameters CdAm and Am.  The step h > 0 is in seconds for GJ_TIME
+ *  and in seconds per kilometer for GJ_SUNDMAN, where it spans about
+ *  h r seconds at the radius r.  One corrector pass is made per step.
+ *  Returns -1 if mode or h is invalid, in which case the state is
+ *  left unusable.
+ */
+int gjInit(gjState *gj, batchForceModel *fm, double CdAm, double Am, int mode, double h)
+{
+    double L[GJ_NUM_SERIES];
+    double Q[GJ_NUM_SERIES];
+    double Q2[GJ_NUM_SERIES];
+    double G[GJ_POINTS];
+    double H[GJ_POINTS];
+    double P[GJ_POINTS];
+    int    i;
+    int    k;
+
+    memset(gj, 0, sizeof(gjState));
+    if((mode != GJ_TIME) && (mode != GJ_SUNDMAN)) {
+        printf("ERROR: gjInit() received mode = %d \n", mode);
+        printf("The value of mode should be GJ_TIME or GJ_SUNDMAN. \n");
+        return -1;
+    }
+    if(h <= 0.) {
+        printf("ERROR: gjInit() received h = %g \n", h);
+        printf("The value of h should be h > 0. \n");
+        return -1;
+    }
+    gj->fm      = *fm;
+    gj->CdAm    = CdAm;
+    gj->Am      = Am;
+    gj->mode    = mode;
+    gj->dim     = (mode == GJ_SUNDMAN) ? 4 : 3;
+    gj->numCorr = 1;
+    gj->h       = h;
+
+    /* Q(x) = x / -log(1 - x) */
+    for(k = 0; k < GJ_NUM_SERIES; k++) {
+        L[k] = 1. / (k + 1);
+    }
+    Q[0] = 1.;
+    for(k = 1; k < GJ_NUM_SERIES; k++) {
+        Q[k] = 0.;
+        for(i = 1; i <= k; i++) {
+            Q[k] -= L[i] * Q[k - i];
+        }
+    }
+    for(k = 0; k < GJ_NUM_SERIES; k++) {
+        Q2[k] = 0.;
+        for(i = 0; i <= k; i++) {
+            Q2[k] += Q[i] * Q[k - i];
+        }
+    }
+    for(k = 0; k < GJ_POINTS; k++) {
+        G[k] = Q[k + 1];
+        H[k] = Q2[k + 2];
+    }
+
+    for(k = 0; k < GJ_POINTS; k++) {
+        gjOrdinates(G, GJ_POINTS - 1 - k, gj->beta[k]);
+        gjOrdinates(H, GJ_POINTS - 1 - k, gj->alpha[k]);
+    }
+    memcpy(P, G, sizeof(P));
+    P[0] += 1.;
+    gjOrdinates(P, -1, gj->beta[GJ_POINTS]);
+    gjOrdinates(H, -1, gj->alpha[GJ_POINTS]);
+
+    return 0;
+}
+
+/*
+ *  gjAccel(gj, y, yd, ydd)
+ *
+ *  Second derivatives ydd of the integrated variables.
+ */
+static void gjAccel(gjState *gj, double *y, double *yd, double *ydd)
+{
+    double a[3+1];
+    double v[3+1];
+    double *rp[3+1];
+    double *vp[3+1];
+    double *ap[3+1];
+    double r;
+    double rv;
+    int    i;
+
+    r = sqrt(y[1] * y[1] + y[2] * y[2] + y[3] * y[3]);
+    for(i = 1; i <= 3; i++) {
+        v[i]  = (gj->mode == GJ_SUNDMAN) ? yd[i] / r : yd[i];
+        rp[i] = &y[i];
+        vp[i] = &v[i];
+        ap[i] = &a[i];
+    }
+    batchAccel(&gj->fm, 1, rp, vp, &gj->CdAm, &gj->Am, ap);
+    gj->numEval++;
+
+    if(gj->mode == GJ_SUNDMAN) {
+        rv = y[1] * v[1] + y[2] * v[2] + y[3] * v[3];
+        for(i = 1; i <= 3; i++) {
+            ydd[i] = rv * v[i] + r * r * a[i];
+        }
+        ydd[4] = rv;
+    } else {
+        for(i = 1; i <= 3; i++) {
+            ydd[i] = a[i];
+        }
+    }
+
+    return;
+}
+
+/*
+ *  gjRK4(gj, y, yd, h)
+ *
+ *  One RK4 step of h for the second order system.
+ */
+static void gjRK4(gjState *gj, double *y, double *yd, double h)
+{
+    double k1[4+1];
+    double k2[4+1];
+    double k3[4+1];
+    double k4[4+1];
+    double yt[4+1];
+    double ydt[4+1];
+    int    i;
+    int    d;
+
+    d = gj->dim;
+    gjAccel(gj, y, yd, k1);
+    for(i = 1; i <= d; i++) {
+        yt[i]  = y[i] + h / 2. * yd[i];
+        ydt[i] = yd[i] + h / 2. * k1[i];
+    }
+    gjAccel(gj, yt, ydt, k2);
+    for(i = 1; i <= d; i++) {
+        yt[i]  = y[i] + h / 2. * yd[i] + h * h / 4. * k1[i];
+        ydt[i] = yd[i] + h / 2. * k2[i];
+    }
+    gjAccel(gj, yt, ydt, k3);
+    for(i = 1; i <= d; i++) {
+        yt[i]  = y[i] + h * yd[i] + h * h / 2. * k2[i];
+        ydt[i] = yd[i] + h * k3[i];
+    }
+    gjAccel(gj, yt, ydt, k4);
+    for(i = 1; i <= d; i++) {
+        y[i]  += h * yd[i] + h * h / 6. * (k1[i] + k2[i] + k3[i]);
+        yd[i] += h / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+    }
+
+    return;
+}
+
+/*
+ *  status = gjStart(gj, t0, r0, v0)
+ *
+ *  Starts the integration from the epoch state r0, v0 at time t0.
+ *  The window is filled from t0 - 4h to t0 + 4h with RK4 and refined
+ *  with the mid-corrector until the positions settle.  Returns -1 if
+ *  the refinement did not converge, in which case the RK4 based
+ *  window is used, or if gjInit() failed.
+ */
+int gjStart(gjState *gj, double t0, double *r0, double *v0)
+{
+    double s1[GJ_POINTS][4+1];
+    double s2[GJ_POINTS][4+1];
+    double yn;
+    double ydn;
+    double h;
+    double h2;
+    double r;
+    double change;
+    int    converged;
+    int    c;
+    int    m;
+    int    i;
+    int    k;
+    int    it;
+
+    if(gj->mode == 0) {
+        printf("ERROR: gjStart() received an integrator that was not set up \n");
+        printf("The integrator should be set up by gjInit(). \n");
+        return -1;
+    }
+    c  = GJ_POINTS / 2;
+    h  = gj->h;
+    h2 = h * h;
+    r  = norm(r0);
+    for(i = 1; i <= 3; i++) {
+        gj->y[c][i]  = r0[i];
+        gj->yd[c][i] = (gj->mode == GJ_SUNDMAN) ? r * v0[i] : v0[i];
+    }
+    gj->y[c][4]  = t0;
+    gj->yd[c][4] = r;
+
+    for(m = c + 1; m < GJ_POINTS; m++) {
+        memcpy(gj->y[m], gj->y[m - 1], sizeof(gj->y[m]));
+        memcpy(gj->yd[m], gj->yd[m - 1], sizeof(gj->yd[m]));
+        for(k = 0; k < GJ_START_SUBSTEPS; k++) {
+            gjRK4(gj, gj->y[m], gj->yd[m], h / GJ_START_SUBSTEPS);
+        }
+    }
+    for(m = c - 1; m >= 0; m--) {
+        memcpy(gj->y[m], gj->y[m + 1], sizeof(gj->y[m]));
+        memcpy(gj->yd[m], gj->yd[m + 1], sizeof(gj->yd[m]));
+        for(k = 0; k < GJ_START_SUBSTEPS; k++) {
+            gjRK4(gj, gj->y[m], gj->yd[m], -h / GJ_START_SUBSTEPS);
+        }
+    }
+
+    change    = 0.;
+    converged = 0;
+    for(it = 0; it <= GJ_START_ITER; it++) {
+        for(m = 0; m < GJ_POINTS; m++) {
+            gjAccel(gj, gj->y[m], gj->yd[m], gj->ydd[m]);
+        }
+
+        /* sums anchored at the epoch */
+        for(i = 1; i <= gj->dim; i++) {
+            s1[c][i] = gj->yd[c][i] / h;
+            s2[c][i] = gj->y[c][i] / h2;
+            for(k = 0; k < GJ_POINTS; k++) {
+                s1[c][i] -= gj->beta[c][k] * gj->ydd[k][i];
+                s2[c][i] -= gj->alpha[c][k] * gj->ydd[k][i];
+            }
+            for(m = c + 1; m < GJ_POINTS; m++) {
+                s1[m][i] = s1[m - 1][i] + gj->ydd[m][i];
+                s2[m][i] = s2[m - 1][i] + s1[m - 1][i];
+            }
+            for(m = c - 1; m >= 0; m--) {
+                s1[m][i] = s1[m + 1][i] - gj->ydd[m + 1][i];
+                s2[m][i] = s2[m + 1][i] - s1[m][i];
+            }
+        }
+        if((it > 0) && (change <= 1e-13 * r)) {
+            converged = 1;
+            break;
+        }
+        if(it == GJ_START_ITER) {
+            break;
+        }
+
+        change = 0.;
+        for(m = 0; m < GJ_POINTS; m++) {
+            if(m == c) {
+                continue;
+            }
+            for(i = 1; i <= gj->dim; i++) {
+                yn  = s2[m][i];
+                ydn = s1[m][i];
+                for(k = 0; k < GJ_POINTS; k++) {
+                    yn  += gj->alpha[m][k] * gj->ydd[k][i];
+                    ydn += gj->beta[m][k] * gj->ydd[k][i];
+                }
+                if(i <= 3) {
+                    change = fmax(change, fabs(h2 * yn - gj->y[m][i]));
+                }
+                gj->y[m][i]  = h2 * yn;
+                gj->yd[m][i] = h * ydn;
+            }
+        }
+    }
+
+    memcpy(gj->s1, s1[GJ_POINTS - 1], sizeof(gj->s1));
+    memcpy(gj->s2, s2[GJ_POINTS - 1], sizeof(gj->s2));
+    gj->t = (gj->mode == GJ_SUNDMAN) ? gj->y[GJ_POINTS - 1][4] : t0 + c * h;
+
+    return converged ? 0 : -1;
+}
+
+/*
+ *  gjStep(gj)
+ *
+ *  Advances the window by one step: predicts the new point,
+ *  evaluates the force and applies gj->numCorr corrector passes, each
+ *  followed by a force evaluation.
+ */
+void gjStep(gjState *gj)
+{
+    double s1[4+1];
+    double s2[4+1];
+    double h;
+    double h2;
+    double *a;
+    int    n;
+    int    c;
+    int    i;
+    int    k;
+
+    n  = GJ_POINTS - 1;
+    h  = gj->h;
+    h2 = h * h;
+
+    /* predict */
+    for(i = 1; i <= gj->dim; i++) {
+        s1[i] = gj->s1[i];
+        s2[i] = gj->s2[i] + gj->s1[i];
+        for(k = 0; k < GJ_POINTS; k++) {
+            s1[i] += gj->beta[GJ_POINTS][k] * gj->ydd[k][i];
+            s2[i] += gj->alpha[GJ_POINTS][k] * gj->ydd[k][i];
+        }
+    }
+    memmove(gj->y[0], gj->y[1], sizeof(gj->y[0]) * n);
+    memmove(gj->yd[0], gj->yd[1], sizeof(gj->yd[0]) * n);
+    memmove(gj->ydd[0], gj->ydd[1], sizeof(gj->ydd[0]) * n);
+    for(i = 1; i <= gj->dim; i++) {
+        gj->y[n][i]  = h2 * s2[i];
+        gj->yd[n][i] = h * s1[i];
+    }
+    a = gj->ydd[n];
+    gjAccel(gj, gj->y[n], gj->yd[n], a);
+
+    /* correct, S_(n+1) = S_n + s_n does not depend on the new point */
+    for(i = 1; i <= gj->dim; i++) {
+        s2[i] = gj->s2[i] + gj->s1[i];
+    }
+    for(c = 0; c < gj->numCorr; c++) {
+        for(i = 1; i <= gj->dim; i++) {
+            s1[i] = gj->s1[i] + a[i];
+            gj->y[n][i]  = s2[i];
+            gj->yd[n][i] = s1[i];
+            for(k = 0; k < GJ_POINTS; k++) {
+                gj->y[n][i]  += gj->alpha[n][k] * gj->ydd[k][i];
+                gj->yd[n][i] += gj->beta[n][k] * gj->ydd[k][i];
+            }
+            gj->y[n][i]  *= h2;
+            gj->yd[n][i] *= h;
+        }
+        gjAccel(gj, gj->y[n], gj->yd[n], a);
+    }
+    for(i = 1; i <= gj->dim; i++) {
+        gj->s1[i] = gj->s1[i] + a[i];
+        gj->s2[i] = s2[i];
+    }
+    gj->t = (gj->mode == GJ_SUNDMAN) ? gj->y[n][4] : gj->t + h;
+
+    return;
+}
+
+/*
+ *  gjGet(gj, t, r, v)
+ *
+ *  Returns the time and state of the newest point.
+ */
+void gjGet(gjState *gj, double *t, double *r, double *v)
+{
+    double rn;
+    int    i;
+
+    rn = norm(gj->y[GJ_POINTS - 1]);
+    for(i = 1; i <= 3; i++) {
+        r[i] = gj->y[GJ_POINTS - 1][i];
+        v[i] = gj->yd[GJ_POINTS - 1][i];
+        if(gj->mode == GJ_SUNDMAN) {
+            v[i] /= rn;
+        }
+    }
+    *t = gj->t;
+
+    return;
+}
+
+/*
+ *  gjInterpolate(gj, del, sigma, y, yd)
+ *
+ *  Integrates the Newton backward interpolant of the second
+ *  derivatives, with differences del[0..8] at the newest point,
+ *  from the newest point to sigma steps away.
+ */
+static void gjInterpolate(gjState *gj, double del[GJ_POINTS][4+1], double sigma, double *y, double *yd)
+{
+    double b[GJ_POINTS+1];
+    double P;
+    double Q;
+    double p;
+    int    n;
+    int    i;
+    int    j;
+    int    k;
+
+    n = GJ_POINTS - 1;
+    for(i = 1; i <= gj->dim; i++) {
+        y[i]  = gj->y[n][i] + sigma * gj->h * gj->yd[n][i];
+        yd[i] = gj->yd[n][i];
+    }
+
+    /* b_j(u) = u (u + 1) ... (u + j - 1) / j! */
+    b[0] = 1.;
+    for(j = 0; j < GJ_POINTS; j++) {
+        if(j > 0) {
+            b[j] = 0.;
+            for(k = j; k >= 1; k--) {
+                b[k] = (b[k - 1] + (j - 1) * b[k]) / j;
+            }
+            b[0] = (j - 1) * b[0] / j;
+        }
+        P = 0.;
+        Q = 0.;
+        p = sigma;
+        for(k = 0; k <= j; k++) {
+            Q += b[k] * p / (k + 1);
+            P += b[k] * p * sigma / ((k + 1) * (k + 2));
+            p *= sigma;
+        }
+        for(i = 1; i <= gj->dim; i++) {
+            y[i]  += gj->h * gj->h * P * del[j][i];
+            yd[i] += gj->h * Q * del[j][i];
+        }
+    }
+
+    return;
+}
+
+/*
+ *  status = gjDense(gj, t, r, v)
+ *
+ *  Interpolates the state at time t inside the current window.
+ *  Returns -1 if t lies outside of the window.
+ */
+int gjDense(gjState *gj, double t, double *r, double *v)
+{
+    double d[GJ_POINTS][4+1];
+    double del[GJ_POINTS][4+1];
+    double y[4+1];
+    double yd[4+1];
+    double t0;
+    double sigma;
+    double rn;
+    int    n;
+    int    i;
+    int    j;
+    int    m;
+    int    k;
+
+    n  = GJ_POINTS - 1;
+    t0 = (gj->mode == GJ_SUNDMAN) ? gj->y[0][4] : gj->t - n * gj->h;
+    if((t < t0 - 1e-9 * fabs(gj->t)) || (t > gj->t + 1e-9 * fabs(gj->t))) {
+        printf("ERROR: gjDense() received t = %.15g \n", t);
+        printf("The value of t should lie in the window [%.15g %.15g]. \n", t0, gj->t);
+        return -1;
+    }
+
+    memcpy(d, gj->ydd, sizeof(d));
+    memcpy(del[0], d[n], sizeof(del[0]));
+    for(j = 1; j < GJ_POINTS; j++) {
+        for(m = n; m >= j; m--) {
+            for(i = 1; i <= gj->dim; i++) {
+                d[m][i] -= d[m - 1][i];
+            }
+        }
+        memcpy(del[j], d[n], sizeof(del[j]));
+    }
+
+    if(gj->mode == GJ_SUNDMAN) {
+        /* solve t(sigma) = t, dt/dsigma = h r */
+        sigma = (t - gj->t) / (gj->h * gj->yd[n][4]);
+        for(k = 0; k < 20; k++) {
+            gjInterpolate(gj, del, sigma, y, yd);
+            sigma -= (y[4] - t) / (gj->h * yd[4]);
+            if(fabs(y[4] - t) <= 1e-12 * fmax(fabs(t), 1.)) {
+                break;
+            }
+        }
+    } else {
+        sigma = (t - gj->t) / gj->h;
+    }
+    gjInterpolate(gj, del, sigma, y, yd);
+
+    rn = sqrt(y[1] * y[1] + y[2] * y[2] + y[3] * y[3]);
+    for(i = 1; i <= 3; i++) {
+        r[i] = y[i];
+        v[i] = (gj->mode == GJ_SUNDMAN) ? yd[i] / rn : yd[i];
+    }
+
+    return 0;
+}
+
+/*
+ *  status = gjPropagate(gj, t, r, v)
+ *
+ *  Steps until the window covers the time t and returns the
+ *  interpolated state there.  Returns -1 if the integrator was not
+ *  set up by gjInit() and gjStart() or if t precedes the window.
+ */
+int gjPropagate(gjState *gj, double t, double *r, double *v)
+{
+    if((gj->mode == 0) || (gj->numEval == 0)) {
+        printf("ERROR: gjPropagate() received an integrator that was not set up \n");
+        printf("The integrator should be set up by gjInit() and gjStart(). \n");
+        return -1;
+    }
+    while(gj->t < t) {
+        gjStep(gj);
+    }
+
+    return gjDense(gj, t, r, v);
+}
+
+/*
+ *  failed = batchGaussJackson(fm, mode, h, n, t0, t, r, v, CdAm, Am)
+ *
+ *  Propagates the n objects of the SoA state r[1..3][k], v[1..3][k]
+ *  from t0 to t > t0 in parallel, each with its own integrator of
+ *  the given mode and step.  Returns the number of objects whose
+ *  startup did not converge, which are propagated anyway, or that
+ *  could not be propagated to t, whose states are set to NAN.
+ *  Returns -1 if mode or h is invalid.
+ */
+int batchGaussJackson(batchForceModel *fm, int mode, double h, int n, double t0, double t,
+                      double *r[3+1], double *v[3+1], double *CdAm, double *Am)
+{
+    gjState proto;
+    int     failed;
+    int     k;
+
+    /* the coefficients only depend on mode and h */
+    if(gjInit(&proto, fm, 0., 0., mode, h) != 0) {
+        return -1;
+    }
+    failed = 0;
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+:failed)
+    for(k = 0; k < n; k++) {
+        gjState gj;
+        double  rk[3+1];
+        double  vk[3+1];
+        int     bad;
+        int     i;
+
+        for(i = 1; i <= 3; i++) {
+            rk[i] = r[i][k];
+            vk[i] = v[i][k];
+        }
+        gj      = proto;
+        gj.CdAm = CdAm[k];
+        gj.Am   = Am[k];
+        bad = gjStart(&gj, t0, rk, vk) != 0;
+        if(gjPropagate(&gj, t, rk, vk) != 0) {
+            bad   = 1;
+            rk[1] = rk[2] = rk[3] = NAN;
+            vk[1] = vk[2] = vk[3] = NAN;
+        }
+        for(i = 1; i <= 3; i++) {
+            r[i][k] = rk[i];
+            v[i][k] = vk[i];
+        }
+        failed += bad;
+    }
+
+    return failed;
+}
@@ -0,0 +1,68 @@
+/*
+ *  gaussJackson.h
+ *  OrbitalMotion
+ *
+ *  Eighth order Gauss-Jackson (second sum) predictor-corrector
+ *  integration of the batch force model.  The nine point window is
+ *  started about the epoch with fine RK4 steps and refined by
+ *  iterating the mid-corrector.  Each step then costs one force
+ *  evaluation per corrector pass.  The integration runs either with
+ *  fixed steps in time or with fixed steps in the Sundman variable s,
+ *  dt = r ds, which concentrates the steps near perigee of eccentric
+ *  orbits.  Dense output interpolates the state anywhere inside the
+ *  current window.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "batchPropagation.h"
+
+#ifndef _GAUSS_JACKSON_H_
+#define _GAUSS_JACKSON_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define GJ_TIME             1       /* fixed steps in time */
+    #define GJ_SUNDMAN          2       /* fixed steps in s, dt = r ds */
+
+    #define GJ_POINTS           9       /* back points of the eighth order method */
+    #define GJ_START_SUBSTEPS   16      /* RK4 substeps per step of the startup */
+    #define GJ_START_ITER       20      /* mid-corrector iterations of the startup */
+
+    typedef struct gjStateStruct {
+        batchForceModel fm;                         /* force model */
+        double CdAm;                                /* drag ballistic factor Cd*A/m (m^2/kg) */
+        double Am;                                  /* area to mass ratio A/m (m^2/kg) */
+        int    mode;                                /* GJ_TIME or GJ_SUNDMAN */
+        int    dim;                                 /* integrated components, 3 or 4 with t */
+        int    numCorr;                             /* corrector passes per step */
+        double h;                                   /* step in t (sec) or s (sec/km) */
+        double alpha[GJ_POINTS+1][GJ_POINTS];       /* position ordinate coefficients */
+        double beta[GJ_POINTS+1][GJ_POINTS];        /* velocity ordinate coefficients */
+        double y[GJ_POINTS][4+1];                   /* window of [r t], newest last */
+        double yd[GJ_POINTS][4+1];                  /* first derivatives */
+        double ydd[GJ_POINTS][4+1];                 /* second derivatives */
+        double s1[4+1];                             /* first sum at the newest point */
+        double s2[4+1];                             /* second sum at the newest point */
+        double t;                                   /* time of the newest point (sec) */
+        long   numEval;                             /* force evaluations so far */
+    } gjState;
+
+    int  gjInit(gjState *gj, batchForceModel *fm, double CdAm, double Am, int mode, double h);
+    int  gjStart(gjState *gj, double t0, double *r0, double *v0);
+    void gjStep(gjState *gj);
+    void gjGet(gjState *gj, double *t, double *r, double *v);
+    int  gjDense(gjState *gj, double t, double *r, double *v);
+    int  gjPropagate(gjState *gj, double t, double *r, double *v);
+    int  batchGaussJackson(batchForceModel *fm, int mode, double h, int n, double t0, double t,
+                           double *r[3+1], double *v[3+1], double *CdAm, double *Am);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ *  geomagnetic.c
+ *  OrbitalMotion
+ *
+ *  The main field is B = -grad V with the potential
+ *
+ *      V = Re sum_n (Re/r)^(n+1) sum_m (g_nm cos(m lon) + h_nm sin(m lon)) P_nm(sin lat)
+ *
+ *  After converting the Schmidt semi-normalized coefficients to
+ *  unnormalized ones the potential has the form of the geopotential,
+ *  so the field follows from the recursions of the solid harmonics
+ *  V_nm, W_nm and the Cartesian gradient formulae of Montenbruck and
+ *  Gill.  These avoid the division by cos(lat) of the spherical
+ *  components at the poles.
+ *
+ *  The coefficient file is a WMM.COF style text file: a first line
+ *  starting with the epoch in decimal years, followed by lines
+ *
+ *      n  m  g  h  gDot  hDot
+ *
+ *  and optionally ended by a line starting with 9999.  Lines starting
+ *  with '#' are skipped, so single epochs of the IGRF table can be
+ *  stored in the same format.
+ *
+ *  References:
+ *  O. Montenbruck and E. Gill, "Satellite Orbits", Springer, 2000,
+ *  section 3.2.4.
+ *  P. Alken et al., "International Geomagnetic Reference Field: the
+ *  thirteenth generation", Earth, Planets and Space 73, 2021.
+ */
+
+#include <string.h>
+#include "geomagnetic.h"
+
+/*
+ *  status = geomagLoad(fileName, model)
+ *
+ *  Reads the coefficient file fileName into model.  Returns -1 if
+ *  the file could not be read or exceeds degree GEOMAG_MAX_DEG.
+ */
+int geomagLoad(const char *fileName, geomagModel *model)
+{
+    FILE  *fp;
+    char   line[256];
+    int    haveEpoch;
+    int    n;
+    int    m;
+    double g;
+    double h;
+    double gDot;
+    double hDot;
+
+    fp = fopen(fileName, "r");
+    if(fp == NULL) {
+        printf("ERROR: geomagLoad() could not open %s \n", fileName);
+        return -1;
+    }
+    memset(model, 0, sizeof(geomagModel));
+    haveEpoch = 0;
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        if((line[0] == '#') || (strspn(line, " \t\r\n") == strlen(line))) {
+            continue;
+        }
+        if(!haveEpoch) {
+            if(sscanf(line, "%lf", &model->epoch) != 1) {
+                break;
+            }
+            haveEpoch = 1;
+            continue;
+        }
+        if(strncmp(line + strspn(line, " \t"), "9999", 4) == 0) {
+            break;
+        }
+        if(sscanf(line, "%d %d %lf %lf %lf %lf", &n, &m, &g, &h, &gDot, &hDot) != 6) {
+            continue;
+        }
+        if((n < 1) || (n > GEOMAG_MAX_DEG) || (m < 0) || (m > n)) {
+            fclose(fp);
+            printf("ERROR: geomagLoad() read n = %d, m = %d from %s \n", n, m, fileName);
+            printf("The degree should satisfy 1 <= n <= %d and 0 <= m <= n. \n", GEOMAG_MAX_DEG);
+            return -1;
+        }
+        model->g[n][m]    = g;
+        model->h[n][m]    = h;
+        model->gDot[n][m] = gDot;
+        model->hDot[n][m] = hDot;
+        if(n > model->nMax) {
+            model->nMax = n;
+        }
+    }
+    fclose(fp);
+    if(!haveEpoch || (model->nMax == 0)) {
+        printf("ERROR: geomagLoad() found no coefficients in %s \n", fileName);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ *  nMax = gmCoefficients(model, year, nMax, G, H)
+ *
+ *  Returns the unnormalized coefficients G, H at the decimal year
+ *  year, and the degree used: nMax, or the model degree if nMax is
+ *  not between 1 and the model degree.
+ */
+static int gmCoefficients(geomagModel *model, double year, int nMax,
+                          double G[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1],
+                          double H[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1])
+{
+    double dt;
+    double s;
+    int    n;
+    int    m;
+    int    k;
+
+    if((nMax < 1) || (nMax > model->nMax)) {
+        nMax = model->nMax;
+    }
+    dt = year - model->epoch;
+    for(n = 1; n <= nMax; n++) {
+        for(m = 0; m <= n; m++) {
+            /* Schmidt factor sqrt(2 (n-m)!/(n+m)!) */
+            s = 1.;
+            if(m > 0) {
+                for(k = n - m + 1; k <= n + m; k++) {
+                    s /= k;
+                }
+                s = sqrt(2. * s);
+            }
+            G[n][m] = s * (model->g[n][m] + model->gDot[n][m] * dt);
+            H[n][m] = s * (model->h[n][m] + model->hDot[n][m] * dt);
+        }
+    }
+
+    return nMax;
+}
+
+/*
+ *  gmEvaluate(G, H, nMax, r, B)
+ *
+ *  Field B (nT) at the ECEF position r (km) of the unnormalized
+ *  coefficients G, H up to degree nMax.
+ */
+static void gmEvaluate(double G[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1],
+                       double H[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1], int nMax, double *r, double *B)
+{
+    double V[GEOMAG_MAX_DEG+3][GEOMAG_MAX_DEG+3];
+    double W[GEOMAG_MAX_DEG+3][GEOMAG_MAX_DEG+3];
+    double m1[3+1];
+    double r2;
+    double rr;
+    double x0;
+    double y0;
+    double z0;
+    double rho;
+    double s;
+    double C;
+    double S;
+    double f;
+    int    n;
+    int    m;
+
+    r2 = dot(r, r);
+    rr = sqrt(r2);
+
+    if(nMax == 1) {
+        /* centered tilted dipole */
+        set3(G[1][1], H[1][1], G[1][0], m1);
+        s = GEOMAG_RE * GEOMAG_RE * GEOMAG_RE / (r2 * rr);
+        f = 3. * dot(m1, r) / r2;
+        for(n = 1; n <= 3; n++) {
+            B[n] = s * (f * r[n] - m1[n]);
+        }
+        return;
+    }
+
+    rho = GEOMAG_RE * GEOMAG_RE / r2;
+    x0  = GEOMAG_RE * r[1] / r2;
+    y0  = GEOMAG_RE * r[2] / r2;
+    z0  = GEOMAG_RE * r[3] / r2;
+
+    V[0][0] = GEOMAG_RE / rr;
+    W[0][0] = 0.;
+    for(m = 0; m <= nMax + 1; m++) {
+        if(m > 0) {
+            V[m][m] = (2 * m - 1) * (x0 * V[m - 1][m - 1] - y0 * W[m - 1][m - 1]);
+            W[m][m] = (2 * m - 1) * (x0 * W[m - 1][m - 1] + y0 * V[m - 1][m - 1]);
+        }
+        if(m <= nMax) {
+            V[m + 1][m] = (2 * m + 1) * z0 * V[m][m];
+            W[m + 1][m] = (2 * m + 1) * z0 * W[m][m];
+        }
+        for(n = m + 2; n <= nMax + 1; n++) {
+            V[n][m] = ((2 * n - 1) * z0 * V[n - 1][m] - (n + m - 1) * rho * V[n - 2][m]) / (n - m);
+            W[n][m] = ((2 * n - 1) * z0 * W[n - 1][m] - (n + m - 1) * rho * W[n - 2][m]) / (n - m);
+        }
+    }
+
+    setZero(B);
+    for(n = 1; n <= nMax; n++) {
+        B[1] -= G[n][0] * V[n + 1][1];
+        B[2] -= G[n][0] * W[n + 1][1];
+        B[3] += (n + 1) * (-G[n][0] * V[n + 1][0]);
+        for(m = 1; m <= n; m++) {
+            C = G[n][m];
+            S = H[n][m];
+            f = (n - m + 2) * (n - m + 1);
+            B[1] += 0.5 * ((-C * V[n + 1][m + 1] - S * W[n + 1][m + 1])
+                           + f * (C * V[n + 1][m - 1] + S * W[n + 1][m - 1]));
+            B[2] += 0.5 * ((-C * W[n + 1][m + 1] + S * V[n + 1][m + 1])
+                           + f * (-C * W[n + 1][m - 1] + S * V[n + 1][m - 1]));
+            B[3] += (n - m + 1) * (-C * V[n + 1][m] - S * W[n + 1][m]);
+        }
+    }
+    mult(-1., B, B);
+
+    return;
+}
+
+/*
+ *  geomagDipole(model, year, r, B)
+ *
+ *  Returns the centered tilted dipole field B (nT) of the degree one
+ *  coefficients at the ECEF position r (km) and decimal year year.
+ */
+void geomagDipole(geomagModel *model, double year, double *r, double *B)
+{
+    geomagField(model, year, 1, r, B);
+
+    return;
+}
+
+/*
+ *  geomagField(model, year, nMax, r, B)
+ *
+ *  Returns the main field B (nT) in ECEF components at the ECEF
+ *  position r (km) and decimal year year, truncated at degree nMax.
+ *  nMax = 0 uses the full model.
+ */
+void geomagField(geomagModel *model, double year, int nMax, double *r, double *B)
+{
+    double G[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];
+    double H[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];
+
+    nMax = gmCoefficients(model, year, nMax, G, H);
+    gmEvaluate(G, H, nMax, r, B);
+
+    return;
+}
+
+/*
+ *  geomagNED(model, year, nMax, r, B)
+ *
+ *  Same as geomagField(), returning the geodetic north, east and
+ *  down components of the field, as tabulated by the WMM and IGRF
+ *  calculators.
+ */
+void geomagNED(geomagModel *model, double year, int nMax, double *r, double *B)
+{
+    double b[3+1];
+    double lat;
+    double lon;
+    double alt;
+    double sp;
+    double cp;
+    double sl;
+    double cl;
+
+    geomagField(model, year, nMax, r, b);
+    ECEF2geodetic(r, &lat, &lon, &alt);
+    sp = sin(lat);
+    cp = cos(lat);
+    sl = sin(lon);
+    cl = cos(lon);
+    B[1] = -sp * cl * b[1] - sp * sl * b[2] + cp * b[3];
+    B[2] = -sl * b[1] + cl * b[2];
+    B[3] = -cp * cl * b[1] - cp * sl * b[2] - sp * b[3];
+
+    return;
+}
+
+/*
+ *  geomagFieldECI(model, year, nMax, C, r, B)
+ *
+ *  Returns the field B (nT) in ECI components at the ECI position r
+ *  (km), with C the ECI to ECEF matrix of ECI2ECEFMatrix().
+ */
+void geomagFieldECI(geomagModel *model, double year, int nMax, double C[4][4], double *r, double *B)
+{
+    double rE[3+1];
+    double bE[3+1];
+    double CT[4][4];
+
+    Mdot(C, r, rE);
+    geomagField(model, year, nMax, rE, bE);
+    transpose(C, CT);
+    Mdot(CT, bE, B);
+
+    return;
+}
+
+/*
+ *  geomagFieldBody(model, year, nMax, C, r, sigma, B)
+ *
+ *  Same as geomagFieldECI(), returning the field in the body frame
+ *  of the attitude MRP sigma (body relative to ECI), i.e. the
+ *  reading of an ideal magnetometer.
+ */
+void geomagFieldBody(geomagModel *model, double year, int nMax, double C[4][4], double *r,
+                     double *sigma, double *B)
+{
+    double b[3+1];
+    double BN[4][4];
+
+    geomagFieldECI(model, year, nMax, C, r, b);
+    MRP2C(sigma, BN);
+    Mdot(BN, b, B);
+
+    return;
+}
+
+/*
+ *  batchGeomag(model, year, nMax, C, n, r, sigma, B)
+ *
+ *  SoA version of geomagFieldBody() for the n ECI positions
+ *  r[1..3][k] and attitudes sigma[1..3][k], returning B[1..3][k].
+ *  If sigma is NULL the field is returned in ECI components, if C
+ *  is NULL the positions and fields are ECEF.  The coefficients are
+ *  evaluated once for all states.  B may alias r.
+ */
+void batchGeomag(geomagModel *model, double year, int nMax, double C[4][4], int n,
+                 double *r[3+1], double *sigma[3+1], double *B[3+1])
+{
+    double G[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];
+    double H[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];
+    int    k;
+
+    nMax = gmCoefficients(model, year, nMax, G, H);
+
+    #pragma omp parallel for schedule(static) if(n >= GEOMAG_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double rk[3+1];
+        double rE[3+1];
+        double bE[3+1];
+        double b[3+1];
+        double s[3+1];
+        double BN[4][4];
+        int    i;
+
+        set3(r[1][k], r[2][k], r[3][k], rk);
+        if(C != NULL) {
+            Mdot(C, rk, rE);
+            gmEvaluate(G, H, nMax, rE, bE);
+            for(i = 1; i <= 3; i++) {
+                b[i] = C[1][i] * bE[1] + C[2][i] * bE[2] + C[3][i] * bE[3];
+            }
+        } else {
+            gmEvaluate(G, H, nMax, rk, b);
+        }
+        if(sigma != NULL) {
+            set3(sigma[1][k], sigma[2][k], sigma[3][k], s);
+            MRP2C(s, BN);
+            Mdot(BN, b, bE);
+            equal(bE, b);
+        }
+        B[1][k] = b[1];
+        B[2][k] = b[2];
+        B[3][k] = b[3];
+    }
+
+    return;
+}
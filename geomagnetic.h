@@ -0,0 +1,59 @@
+/*
+ *  geomagnetic.h
+ *  OrbitalMotion
+ *
+ *  Geomagnetic main field.  The spherical harmonic model with
+ *  Schmidt semi-normalized Gauss coefficients g, h and their secular
+ *  variation is read from a WMM/IGRF style coefficient file and
+ *  evaluated with the singularity free recursion of the solid
+ *  harmonics in Cartesian ECEF coordinates.  The centered tilted
+ *  dipole built from the degree one coefficients is a fast path.
+ *  Fields are in nT and are returned in the ECEF, local north, east
+ *  and down (NED), ECI or body frames, where ECI to ECEF uses the
+ *  matrices of earthFrames.h and the attitude is given by MRPs.  The
+ *  batch routine operates on SoA states r[1..3][k].
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "earthFrames.h"
+#include "RigidBodyKinematics.h"
+
+#ifndef _GEOMAGNETIC_H_
+#define _GEOMAGNETIC_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define GEOMAG_MAX_DEG      16      /* highest degree of the model */
+    #define GEOMAG_RE           6371.2  /* magnetic reference radius (km) */
+    #define GEOMAG_PARALLEL_MIN 4096    /* smallest batch evaluated with several threads */
+
+    typedef struct geomagModelStruct {
+        int    nMax;                                    /* degree of the model */
+        double epoch;                                   /* coefficient epoch (decimal year) */
+        double g[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];   /* g[n][m] (nT) */
+        double h[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];   /* h[n][m] (nT) */
+        double gDot[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];/* secular variation (nT/year) */
+        double hDot[GEOMAG_MAX_DEG+1][GEOMAG_MAX_DEG+1];
+    } geomagModel;
+
+    int  geomagLoad(const char *fileName, geomagModel *model);
+    void geomagDipole(geomagModel *model, double year, double *r, double *B);
+    void geomagField(geomagModel *model, double year, int nMax, double *r, double *B);
+    void geomagNED(geomagModel *model, double year, int nMax, double *r, double *B);
+    void geomagFieldECI(geomagModel *model, double year, int nMax, double C[4][4], double *r, double *B);
+    void geomagFieldBody(geomagModel *model, double year, int nMax, double C[4][4], double *r,
+                         double *sigma, double *B);
+
+    void batchGeomag(geomagModel *model, double year, int nMax, double C[4][4], int n,
+                     double *r[3+1], double *sigma[3+1], double *B[3+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
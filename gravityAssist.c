@@ -0,0 +1,645 @@
+/*
+ *  gravityAssist.c
+ *  OrbitalMotion
+ *
+ *  Branch-and-prune search of patched-conic gravity-assist tours.
+ *
+ *  All epochs and leg flight times lie on one grid of spacing
+ *  search->step, so a leg is identified by its two bodies, the grid
+ *  index of its departure and its flight time in grid steps.  The
+ *  legs are memoized in a direct mapped cache whose slots are
+ *  guarded by a sequence counter: a writer claims a slot by moving
+ *  the counter from even to odd with a compare-and-swap, and a
+ *  reader only accepts a slot whose counter is even and unchanged
+ *  across the read.  The slot contents are atomics accessed with
+ *  relaxed ordering, so that a torn read is discarded rather than a
+ *  data race.  Concurrent misses on the same leg simply solve it
+ *  twice.
+ *
+ *  The cost of a tour is the launch hyperbolic excess speed plus
+ *  the powered flyby maneuvers plus the arrival hyperbolic excess
+ *  speed.  Since every term is non-negative, a branch is pruned as
+ *  soon as its partial cost reaches the cost of the worst of the
+ *  best solutions found so far (or search->costMax).
+ *
+ *  References:
+ *  D. A. Vallado, "Fundamentals of Astrodynamics and Applications",
+ *  3rd ed., 2007, algorithm 58 (universal variable Lambert).
+ *  D. Izzo, "Global Optimization and Space Pruning for Spacecraft
+ *  Trajectory Design", in Spacecraft Trajectory Optimization,
+ *  Cambridge University Press, 2010.
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include "gravityAssist.h"
+
+#define GA_DAY  86400.
+
+typedef struct gaLegStruct {
+    _Atomic uint64_t seq;               /* even: stable, odd: being written */
+    _Atomic uint64_t key;               /* leg key + 1, 0 if empty */
+    _Atomic int      ok;                /* Lambert solution found */
+    _Atomic double   v[6];              /* departure and arrival velocities */
+} gaLeg;
+
+typedef struct gaNodeStruct {
+    int    depth;                       /* legs flown */
+    int    seq[GA_MAX_LEGS+1];          /* bodies */
+    int    idx[GA_MAX_LEGS+1];          /* encounter grid indices */
+    double vInf[3+1];                   /* arrival hyperbolic excess velocity */
+    double vInfLaunch;
+    double dvFlyby;
+} gaNode;
+
+typedef struct gaContextStruct {
+    gaSearch    *search;
+    gaLeg       *cache;
+    uint64_t     cacheMask;
+    int          tofLo[GA_NUM_BODIES+1][GA_NUM_BODIES+1];
+    int          tofHi[GA_NUM_BODIES+1][GA_NUM_BODIES+1];
+    int          next[GA_NUM_BODIES+1];
+    int          numNext;
+    gaSolution  *best;
+    int          numBest;
+    double       bound;
+    gaStatistics stats;
+} gaContext;
+
+/* gravitational constant (km^3/s^2), radius (km), orbit radius (km)
+   and J2000 mean longitude (deg) of the planets */
+static const double gaBody[GA_NUM_BODIES+1][4] = {
+    {0., 0., 0., 0.},
+    {MU_MERCURY, REQ_MERCURY, SMA_MERCURY, 252.25084},
+    {MU_VENUS,   REQ_VENUS,   SMA_VENUS,   181.97973},
+    {MU_EARTH,   REQ_EARTH,   SMA_EARTH,   100.46435},
+    {MU_MARS,    REQ_MARS,    SMA_MARS,    355.45332},
+    {MU_JUPITER, REQ_JUPITER, SMA_JUPITER,  34.40438},
+    {MU_SATURN,  REQ_SATURN,  SMA_SATURN,   49.94432},
+    {MU_URANUS,  REQ_URANUS,  SMA_URANUS,  313.23218},
+    {MU_NEPTUNE, REQ_NEPTUNE, SMA_NEPTUNE, 304.88003}
+};
+
+/*
+ *  gaInitSearch(search, depart, target)
+ *
+ *  Sets up a search from depart to target with default settings:
+ *  flybys of Venus, Earth and Mars, up to three flybys, a 10 day
+ *  grid over one year of launch dates, leg flight times between 0.3
+ *  and 1.5 Hohmann transfer times, a 6 km/s launch and a 20 km/s
+ *  total cost limit, 1.05 planet radii minimum periapsis, a 10 year
+ *  mission and the 10 best solutions.
+ */
+void gaInitSearch(gaSearch *search, int depart, int target)
+{
+    memset(search, 0, sizeof(gaSearch));
+    search->depart      = depart;
+    search->target      = target;
+    search->numBodies   = 3;
+    search->bodies[0]   = GA_VENUS;
+    search->bodies[1]   = GA_EARTH;
+    search->bodies[2]   = GA_MARS;
+    search->maxFlybys   = 3;
+    search->t0          = 0.;
+    search->step        = 10.;
+    search->numLaunch   = 37;
+    search->tofMin      = 0.3;
+    search->tofMax      = 1.5;
+    search->vInfMax     = 6.;
+    search->costMax     = 20.;
+    search->rpMin       = 1.05;
+    search->durationMax = 3652.5;
+    search->numResults  = 10;
+    search->cacheBits   = 18;
+
+    return;
+}
+
+/*
+ *  gaEphemeris(body, t, r, v)
+ *
+ *  Returns the heliocentric position r (km) and velocity v (km/s)
+ *  of the planet body at t days past J2000 on its circular,
+ *  ecliptic orbit.
+ */
+void gaEphemeris(int body, double t, double *r, double *v)
+{
+    double a;
+    double n;
+    double L;
+    double vc;
+
+    a  = gaBody[body][2];
+    vc = sqrt(MU_SUN / a);
+    n  = vc / a;
+    L  = gaBody[body][3] * M_PI / 180. + n * t * GA_DAY;
+    set3(a * cos(L), a * sin(L), 0., r);
+    set3(-vc * sin(L), vc * cos(L), 0., v);
+
+    return;
+}
+
+/*
+ *  gaStumpff(z, C, S)
+ *
+ *  Returns the Stumpff functions C(z) and S(z).
+ */
+static void gaStumpff(double z, double *C, double *S)
+{
+    double s;
+
+    if(z > 1e-6) {
+        s  = sqrt(z);
+        *C = (1. - cos(s)) / z;
+        *S = (s - sin(s)) / (s * z);
+    } else if(z < -1e-6) {
+        s  = sqrt(-z);
+        *C = (1. - cosh(s)) / z;
+        *S = (sinh(s) - s) / (s * -z);
+    } else {
+        *C = 0.5 - z / 24.;
+        *S = 1. / 6. - z / 120.;
+    }
+
+    return;
+}
+
+/*
+ *  status = lambert(mu, r1, r2, tof, v1, v2)
+ *
+ *  Solves the zero revolution Lambert problem for the transfer from
+ *  r1 to r2 in tof seconds, prograde about the +z axis, with the
+ *  universal variable method.  Returns the velocities v1 and v2 at
+ *  r1 and r2, and -1 if the transfer angle is 0 or 180 degrees or
+ *  no solution was found.
+ */
+int lambert(double mu, double *r1, double *r2, double tof, double *v1, double *v2)
+{
+    double R1;
+    double R2;
+    double cdn;
+    double A;
+    double z;
+    double lo;
+    double hi;
+    double C;
+    double S;
+    double y;
+    double chi;
+    double t;
+    double f;
+    double g;
+    double gd;
+    double c[3+1];
+    int    i;
+
+    R1  = norm(r1);
+    R2  = norm(r2);
+    cdn = dot(r1, r2) / (R1 * R2);
+    cross(r1, r2, c);
+    A = sqrt(R1 * R2 * (1. + cdn));
+    if(c[3] < 0.) {
+        A = -A;
+    }
+    if((fabs(A) < 1e-9 * sqrt(R1 * R2)) || (fabs(c[3]) < 1e-9 * R1 * R2) || (tof <= 0.)) {
+        return -1;
+    }
+
+    /* the flight time grows with z up to the single revolution
+       limit 4 pi^2; move the hyperbolic end of the bracket down
+       until it is shorter than tof */
+    lo = -4. * M_PI * M_PI;
+    hi = 4. * M_PI * M_PI;
+    for(i = 0; i < 12; i++) {
+        gaStumpff(lo, &C, &S);
+        y = R1 + R2 + A * (lo * S - 1.) / sqrt(C);
+        if(y < 0.) {
+            break;
+        }
+        chi = sqrt(y / C);
+        t   = (chi * chi * chi * S + A * sqrt(y)) / sqrt(mu);
+        if(t < tof) {
+            break;
+        }
+        hi  = lo;
+        lo *= 2.;
+    }
+
+    /* bisect until tof is met or the bracket can shrink no further,
+       in which case z is as close as the arithmetic allows */
+    y = 0.;
+    t = 0.;
+    for(i = 0; i < 200; i++) {
+        z = (lo + hi) / 2.;
+        if((z <= lo) || (z >= hi)) {
+            break;
+        }
+        gaStumpff(z, &C, &S);
+        y = R1 + R2 + A * (z * S - 1.) / sqrt(C);
+        if(y < 0.) {
+            lo = z;
+            continue;
+        }
+        chi = sqrt(y / C);
+        t   = (chi * chi * chi * S + A * sqrt(y)) / sqrt(mu);
+        if(fabs(t - tof) < 1e-10 * tof) {
+            break;
+        }
+        if(t < tof) {
+            lo = z;
+        } else {
+            hi = z;
+        }
+    }
+    if((y <= 0.) || (fabs(t - tof) > 1e-6 * tof)) {
+        return -1;
+    }
+
+    f  = 1. - y / R1;
+    g  = A * sqrt(y / mu);
+    gd = 1. - y / R2;
+    for(i = 1; i <= 3; i++) {
+        v1[i] = (r2[i] - f * r1[i]) / g;
+        v2[i] = (gd * r2[i] - r1[i]) / g;
+    }
+
+    return 0;
+}
+
+/*
+ *  status = gaFlyby(body, vInfIn, vInfOut, rpMin, dv, rp, tSOI)
+ *
+ *  Powered flyby of the planet body that turns the incoming
+ *  hyperbolic excess velocity vInfIn into vInfOut with a single
+ *  periapsis maneuver.  Returns the maneuver dv (km/s), the
+ *  periapsis radius rp (km) and, if tSOI is not NULL, the time
+ *  (sec) spent inside the sphere of influence on the incoming
+ *  hyperbola, evaluated with f2H() and H2N().  Returns -1 if the
+ *  turn requires a periapsis below rpMin planet radii.
+ */
+int gaFlyby(int body, double *vInfIn, double *vInfOut, double rpMin,
+            double *dv, double *rp, double *tSOI)
+{
+    double mu;
+    double vi;
+    double vo;
+    double delta;
+    double r;
+    double ei;
+    double eo;
+    double F;
+    double dF;
+    double step;
+    double rSOI;
+    double p;
+    double cf;
+    double a;
+    int    i;
+
+    mu    = gaBody[body][0];
+    vi    = norm(vInfIn);
+    vo    = norm(vInfOut);
+    delta = acos(fmax(-1., fmin(1., dot(vInfIn, vInfOut) / (vi * vo))));
+
+    /* the turn angle decreases with rp; Newton from rpMin converges monotonically */
+    r = rpMin * gaBody[body][1];
+    for(i = 0; i < 50; i++) {
+        ei = 1. + r * vi * vi / mu;
+        eo = 1. + r * vo * vo / mu;
+        F  = asin(1. / ei) + asin(1. / eo) - delta;
+        if((i == 0) && (F < 0.)) {
+            return -1;
+        }
+        dF = -vi * vi / mu / (ei * ei * sqrt(1. - 1. / (ei * ei)))
+             - vo * vo / mu / (eo * eo * sqrt(1. - 1. / (eo * eo)));
+        step = -F / dF;
+        r   += step;
+        if(fabs(step) < 1e-6) {
+            break;
+        }
+    }
+    *rp = r;
+    *dv = fabs(sqrt(vo * vo + 2. * mu / r) - sqrt(vi * vi + 2. * mu / r));
+
+    if(tSOI != NULL) {
+        rSOI  = gaBody[body][2] * pow(mu / MU_SUN, 0.4);
+        ei    = 1. + r * vi * vi / mu;
+        p     = r * (1. + ei);
+        cf    = (p / rSOI - 1.) / ei;
+        *tSOI = 0.;
+        if(cf < 1.) {
+            a     = mu / (vi * vi);
+            *tSOI = 2. * H2N(f2H(acos(cf), ei), ei) / sqrt(mu / (a * a * a));
+        }
+    }
+
+    return 0;
+}
+
+/*
+ *  status = gaGetLeg(ctx, from, to, dep, tof, v, numLambert)
+ *
+ *  Returns the departure and arrival velocities v[0..5] of the
+ *  Lambert leg from body from at grid index dep to body to after
+ *  tof grid steps, from the cache or by solving it, in which case
+ *  numLambert is incremented.
+ */
+static int gaGetLeg(gaContext *ctx, int from, int to, int dep, int tof, double *v,
+                    long long *numLambert)
+{
+    gaLeg   *slot;
+    uint64_t key;
+    uint64_t s1;
+    uint64_t s2;
+    double   r1[3+1];
+    double   r2[3+1];
+    double   w1[3+1];
+    double   w2[3+1];
+    double   t;
+    int      ok;
+    int      hit;
+    int      i;
+
+    key  = (((uint64_t)from << 56) | ((uint64_t)to << 48) | ((uint64_t)dep << 20) | (uint64_t)tof) + 1;
+    slot = &ctx->cache[(key * 0x9E3779B97F4A7C15ull) >> 32 & ctx->cacheMask];
+
+    s1  = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    hit = 0;
+    ok  = 0;
+    if(!(s1 & 1) && (atomic_load_explicit(&slot->key, memory_order_relaxed) == key)) {
+        ok = atomic_load_explicit(&slot->ok, memory_order_relaxed);
+        for(i = 0; i < 6; i++) {
+            v[i] = atomic_load_explicit(&slot->v[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        s2  = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        hit = s1 == s2;
+    }
+    if(hit) {
+        return ok ? 0 : -1;
+    }
+
+    t = ctx->search->t0 + dep * ctx->search->step;
+    gaEphemeris(from, t, r1, w1);
+    gaEphemeris(to, t + tof * ctx->search->step, r2, w2);
+    ok = lambert(MU_SUN, r1, r2, tof * ctx->search->step * GA_DAY, w1, w2) == 0;
+    (*numLambert)++;
+    v[0] = w1[1];
+    v[1] = w1[2];
+    v[2] = w1[3];
+    v[3] = w2[1];
+    v[4] = w2[2];
+    v[5] = w2[3];
+
+    s1 = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    if(!(s1 & 1) && atomic_compare_exchange_strong_explicit(&slot->seq, &s1, s1 + 1,
+                                                            memory_order_acquire, memory_order_relaxed)) {
+        atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+        atomic_store_explicit(&slot->ok, ok, memory_order_relaxed);
+        for(i = 0; i < 6; i++) {
+            atomic_store_explicit(&slot->v[i], v[i], memory_order_relaxed);
+        }
+        atomic_store_explicit(&slot->seq, s1 + 2, memory_order_release);
+    }
+
+    return ok ? 0 : -1;
+}
+
+/*
+ *  gaRecord(ctx, node, to, idx, vInfLaunch, dvFlyby, vInfArrive)
+ *
+ *  Inserts the completed tour into the sorted list of best
+ *  solutions and tightens the pruning bound.
+ */
+static void gaRecord(gaContext *ctx, gaNode *node, int to, int idx,
+                     double vInfLaunch, double dvFlyby, double vInfArrive)
+{
+    gaSolution sol;
+    int        n;
+    int        i;
+
+    memset(&sol, 0, sizeof(sol));
+    sol.numLegs = node->depth + 1;
+    for(i = 0; i <= node->depth; i++) {
+        sol.seq[i] = node->seq[i];
+        sol.t[i]   = ctx->search->t0 + node->idx[i] * ctx->search->step;
+    }
+    sol.seq[sol.numLegs] = to;
+    sol.t[sol.numLegs]   = ctx->search->t0 + idx * ctx->search->step;
+    sol.vInfLaunch       = vInfLaunch;
+    sol.dvFlyby          = dvFlyby;
+    sol.vInfArrive       = vInfArrive;
+    sol.cost             = vInfLaunch + dvFlyby + vInfArrive;
+
+    #pragma omp critical(gaRecord)
+    {
+        n = ctx->numBest;
+        if((n < ctx->search->numResults) || (sol.cost < ctx->best[n - 1].cost)) {
+            if(n == ctx->search->numResults) {
+                n--;
+            }
+            for(i = n; (i > 0) && (ctx->best[i - 1].cost > sol.cost); i--) {
+                ctx->best[i] = ctx->best[i - 1];
+            }
+            ctx->best[i] = sol;
+            ctx->numBest = n + 1;
+            if(ctx->numBest == ctx->search->numResults) {
+                #pragma omp atomic write
+                ctx->bound = ctx->best[ctx->numBest - 1].cost;
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ *  gaExpand(ctx, node)
+ *
+ *  Expands all legs leaving the last body of node.
+ */
+static void gaExpand(gaContext *ctx, gaNode *node)
+{
+    gaSearch *search;
+    gaNode    child;
+    double    R[3+1];
+    double    Vb[3+1];
+    double    Rn[3+1];
+    double    Vn[3+1];
+    double    vOut[3+1];
+    double    vIn[3+1];
+    double    v[6];
+    double    bound;
+    double    vInfLaunch;
+    double    dvFlyby;
+    double    dv;
+    double    rp;
+    long long numLegs;
+    long long numLambert;
+    long long numSequences;
+    int       body;
+    int       next;
+    int       dep;
+    int       last;
+    int       j;
+    int       k;
+
+    search       = ctx->search;
+    body         = node->seq[node->depth];
+    dep          = node->idx[node->depth];
+    last         = node->idx[0] + (int)floor(search->durationMax / search->step);
+    numLegs      = 0;
+    numLambert   = 0;
+    numSequences = 0;
+    gaEphemeris(body, search->t0 + dep * search->step, R, Vb);
+
+    for(j = 0; j < ctx->numNext; j++) {
+        next = ctx->next[j];
+        if((next == body) || ((next != search->target) && (node->depth >= search->maxFlybys))) {
+            continue;
+        }
+        for(k = ctx->tofLo[body][next]; (k <= ctx->tofHi[body][next]) && (dep + k <= last); k++) {
+            numLegs++;
+            if(gaGetLeg(ctx, body, next, dep, k, v, &numLambert) != 0) {
+                continue;
+            }
+            set3(v[0] - Vb[1], v[1] - Vb[2], v[2] - Vb[3], vOut);
+            #pragma omp atomic read
+            bound = ctx->bound;
+
+            if(node->depth == 0) {
+                vInfLaunch = norm(vOut);
+                dvFlyby    = 0.;
+                if(vInfLaunch > search->vInfMax) {
+                    continue;
+                }
+            } else {
+                if(gaFlyby(body, node->vInf, vOut, search->rpMin, &dv, &rp, NULL) != 0) {
+                    continue;
+                }
+                vInfLaunch = node->vInfLaunch;
+                dvFlyby    = node->dvFlyby + dv;
+            }
+            if(vInfLaunch + dvFlyby >= bound) {
+                continue;
+            }
+
+            gaEphemeris(next, search->t0 + (dep + k) * search->step, Rn, Vn);
+            set3(v[3] - Vn[1], v[4] - Vn[2], v[5] - Vn[3], vIn);
+            if(next == search->target) {
+                numSequences++;
+                if(vInfLaunch + dvFlyby + norm(vIn) < bound) {
+                    gaRecord(ctx, node, next, dep + k, vInfLaunch, dvFlyby, norm(vIn));
+                }
+                continue;
+            }
+
+            child                   = *node;
+            child.depth             = node->depth + 1;
+            child.seq[child.depth]  = next;
+            child.idx[child.depth]  = dep + k;
+            child.vInfLaunch        = vInfLaunch;
+            child.dvFlyby           = dvFlyby;
+            equal(vIn, child.vInf);
+            if(child.depth < GA_TASK_DEPTH) {
+                #pragma omp task firstprivate(child)
+                gaExpand(ctx, &child);
+            } else {
+                gaExpand(ctx, &child);
+            }
+        }
+    }
+
+    #pragma omp atomic
+    ctx->stats.numLegs += numLegs;
+    #pragma omp atomic
+    ctx->stats.numLambert += numLambert;
+    #pragma omp atomic
+    ctx->stats.numSequences += numSequences;
+
+    return;
+}
+
+/*
+ *  count = gaRun(search, best, stats)
+ *
+ *  Runs the sequence search and returns the number of solutions
+ *  stored in best[0..count-1], sorted by increasing cost.  best must
+ *  hold search->numResults entries.  If stats is not NULL the search
+ *  statistics are returned.  Returns -1 on invalid input or if the
+ *  leg cache could not be allocated.
+ */
+int gaRun(gaSearch *search, gaSolution *best, gaStatistics *stats)
+{
+    gaContext ctx;
+    double    th;
+    double    a1;
+    double    a2;
+    int       i;
+    int       j;
+    int       l;
+
+    if((search->depart < 1) || (search->depart > GA_NUM_BODIES)
+       || (search->target < 1) || (search->target > GA_NUM_BODIES)
+       || (search->maxFlybys < 0) || (search->maxFlybys >= GA_MAX_LEGS)
+       || (search->numResults < 1) || (search->numResults > GA_MAX_RESULTS)
+       || (search->step <= 0.) || (search->cacheBits < 1) || (search->cacheBits > 30)) {
+        printf("ERROR: gaRun() received an invalid search setup \n");
+        printf("Check the bodies, maxFlybys < %d, numResults <= %d, step and cacheBits. \n",
+               GA_MAX_LEGS, GA_MAX_RESULTS);
+        return -1;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.search    = search;
+    ctx.best      = best;
+    ctx.bound     = search->costMax;
+    ctx.cacheMask = ((uint64_t)1 << search->cacheBits) - 1;
+    ctx.cache     = (gaLeg *)calloc((size_t)1 << search->cacheBits, sizeof(gaLeg));
+    if(ctx.cache == NULL) {
+        return -1;
+    }
+
+    ctx.next[ctx.numNext++] = search->target;
+    for(i = 0; i < search->numBodies; i++) {
+        if((search->bodies[i] >= 1) && (search->bodies[i] <= GA_NUM_BODIES)
+           && (search->bodies[i] != search->target)) {
+            ctx.next[ctx.numNext++] = search->bodies[i];
+        }
+    }
+    for(i = 1; i <= GA_NUM_BODIES; i++) {
+        for(j = 1; j <= GA_NUM_BODIES; j++) {
+            a1 = gaBody[i][2];
+            a2 = gaBody[j][2];
+            th = M_PI * sqrt(pow((a1 + a2) / 2., 3) / MU_SUN) / GA_DAY;
+            ctx.tofLo[i][j] = (int)ceil(search->tofMin * th / search->step);
+            ctx.tofHi[i][j] = (int)floor(search->tofMax * th / search->step);
+            if(ctx.tofLo[i][j] < 1) {
+                ctx.tofLo[i][j] = 1;
+            }
+        }
+    }
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            for(l = 0; l < search->numLaunch; l++) {
+                gaNode root;
+
+                memset(&root, 0, sizeof(root));
+                root.seq[0] = search->depart;
+                root.idx[0] = l;
+                #pragma omp task firstprivate(root)
+                gaExpand(&ctx, &root);
+            }
+        }
+    }
+
+    if(stats != NULL) {
+        *stats = ctx.stats;
+    }
+    free(ctx.cache);
+
+    return ctx.numBest;
+}
@@ -0,0 +1,94 @@
+/*
+ *  gravityAssist.h
+ *  OrbitalMotion
+ *
+ *  Patched-conic gravity-assist sequence search.  Planet sequences
+ *  from a launch body to a target body are explored depth first over
+ *  a grid of launch epochs and leg flight times.  Every leg is a
+ *  heliocentric Lambert arc, every intermediate encounter a powered
+ *  flyby with a minimum periapsis radius, and branches whose
+ *  accumulated cost exceeds the current bound are pruned.  Branches
+ *  run as OpenMP tasks, so idle threads steal pending subtrees, and
+ *  Lambert legs are memoized in a lock-free cache shared by all
+ *  threads.
+ *
+ *  The planets move on circular, coplanar orbits of radius SMA_*
+ *  with their J2000 mean longitudes, which is adequate for sequence
+ *  and launch window screening.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "orbitalMotion.h"
+
+#ifndef _GRAVITY_ASSIST_H_
+#define _GRAVITY_ASSIST_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define GA_MERCURY          1
+    #define GA_VENUS            2
+    #define GA_EARTH            3
+    #define GA_MARS             4
+    #define GA_JUPITER          5
+    #define GA_SATURN           6
+    #define GA_URANUS           7
+    #define GA_NEPTUNE          8
+    #define GA_NUM_BODIES       8
+
+    #define GA_MAX_LEGS         8       /* legs per sequence */
+    #define GA_MAX_RESULTS      64      /* best solutions kept */
+    #define GA_TASK_DEPTH       2       /* tree depth down to which branches become tasks */
+
+    typedef struct gaSearchStruct {
+        int    depart;                  /* launch body */
+        int    target;                  /* arrival body */
+        int    numBodies;               /* number of flyby candidates */
+        int    bodies[GA_NUM_BODIES];   /* flyby candidates */
+        int    maxFlybys;               /* flybys per sequence (< GA_MAX_LEGS) */
+        double t0;                      /* first launch epoch (days past J2000) */
+        double step;                    /* epoch and flight time grid (days) */
+        int    numLaunch;               /* number of launch epochs */
+        double tofMin;                  /* leg flight time bounds as fractions */
+        double tofMax;                  /*   of the Hohmann transfer time */
+        double vInfMax;                 /* launch hyperbolic excess speed limit (km/s) */
+        double costMax;                 /* total cost limit (km/s) */
+        double rpMin;                   /* minimum flyby periapsis radius (planet radii) */
+        double durationMax;             /* mission duration limit (days) */
+        int    numResults;              /* solutions kept (<= GA_MAX_RESULTS) */
+        int    cacheBits;               /* log2 of the number of Lambert cache slots */
+    } gaSearch;
+
+    typedef struct gaSolutionStruct {
+        int    numLegs;
+        int    seq[GA_MAX_LEGS+1];      /* bodies seq[0..numLegs] */
+        double t[GA_MAX_LEGS+1];        /* encounter epochs (days past J2000) */
+        double vInfLaunch;              /* launch hyperbolic excess speed (km/s) */
+        double dvFlyby;                 /* sum of the powered flyby maneuvers (km/s) */
+        double vInfArrive;              /* arrival hyperbolic excess speed (km/s) */
+        double cost;                    /* vInfLaunch + dvFlyby + vInfArrive */
+    } gaSolution;
+
+    typedef struct gaStatisticsStruct {
+        long long numLegs;              /* legs evaluated */
+        long long numLambert;           /* Lambert problems solved */
+        long long numSequences;         /* complete sequences evaluated */
+    } gaStatistics;
+
+    void   gaInitSearch(gaSearch *search, int depart, int target);
+    void   gaEphemeris(int body, double t, double *r, double *v);
+    int    lambert(double mu, double *r1, double *r2, double tof, double *v1, double *v2);
+    int    gaFlyby(int body, double *vInfIn, double *vInfOut, double rpMin,
+                   double *dv, double *rp, double *tSOI);
+    int    gaRun(gaSearch *search, gaSolution *best, gaStatistics *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
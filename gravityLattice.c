@@ -0,0 +1,413 @@
+/*
+ *  gravityLattice.c
+ *  OrbitalMotion
+ *
+ *  In the meridian plane of a point at the radius r and latitude phi
+ *  the zonal acceleration has the horizontal component aH, directed
+ *  away from the polar axis, and the polar component aZ.  Both are
+ *  smooth functions of rho = 1/r and phi (each J_n term is rho^(n+2)
+ *  times a trigonometric polynomial in phi), so they are tabulated on
+ *  a rho-phi grid with the derivatives d/drho, d/dphi and the twist
+ *  d2/drho dphi.  The first derivatives are exact, obtained by
+ *  forward-mode differentiation of dualJPerturb(); the twist is the
+ *  central difference of d/drho in phi.  On a cell of widths hR, hP
+ *  and local coordinates u, w in [0 1] the interpolant is
+ *
+ *      f(u, w) = sum over the corners of
+ *                  f H(u) H(w) + hR f_rho K(u) H(w) + hP f_phi H(u) K(w)
+ *                  + hR hP f_rhophi K(u) K(w)
+ *
+ *  with the cubic Hermite basis functions H and K of each corner.
+ *  An evaluation reads the 32 doubles of one cell, typically from
+ *  the cache, and needs no pow() calls.  The error of the bicubic
+ *  interpolant falls as the fourth power of the cell size.
+ *
+ *  The file written by gravLatticeWrite() is a 64 byte header
+ *  followed by the nodes in native byte order, so that
+ *  gravLatticeMap() can use the mapped nodes in place.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gravityLattice.h"
+#include "dualNumbers.h"
+
+#define GRAV_MAGIC          "OMGRAV01"
+#define GRAV_HEADER         64
+#define GRAV_TWIST_STEP     1e-5    /* latitude step of the twist difference (rad) */
+
+/*
+ *  gravLatticeDerivs(jnum, rho, phi, f)
+ *
+ *  Horizontal and polar accelerations f[1], f[4] at rho and phi
+ *  with their derivatives in rho f[2], f[5] and phi f[3], f[6].
+ */
+static void gravLatticeDerivs(int jnum, double rho, double phi, double *f)
+{
+    dual R;
+    dual P;
+    dual one;
+    dual r;
+    dual c;
+    dual s;
+    dual rvec[3+1];
+    dual a[3+1];
+
+    dualVar(rho, 1, &R);
+    dualVar(phi, 2, &P);
+    dualSet(1., &one);
+    dualDiv(&one, &R, &r);
+    dualCos(&P, &c);
+    dualSin(&P, &s);
+    dualMul(&r, &c, &rvec[1]);
+    dualSet(0., &rvec[2]);
+    dualMul(&r, &s, &rvec[3]);
+    dualJPerturb(rvec, jnum, a);
+
+    f[1] = a[1].v;
+    f[2] = a[1].d[1];
+    f[3] = a[1].d[2];
+    f[4] = a[3].v;
+    f[5] = a[3].d[1];
+    f[6] = a[3].d[2];
+
+    return;
+}
+
+/*
+ *  gravLatticeNode(jnum, rho, phi, node)
+ *
+ *  Fills the GRAV_NUM_VALUES node values [aH aH_rho aH_phi aH_rhophi
+ *  aZ aZ_rho aZ_phi aZ_rhophi].
+ */
+static void gravLatticeNode(int jnum, double rho, double phi, double *node)
+{
+    double f[6+1];
+    double fp[6+1];
+    double fm[6+1];
+
+    gravLatticeDerivs(jnum, rho, phi, f);
+    gravLatticeDerivs(jnum, rho, phi + GRAV_TWIST_STEP, fp);
+    gravLatticeDerivs(jnum, rho, phi - GRAV_TWIST_STEP, fm);
+
+    node[0] = f[1];
+    node[1] = f[2];
+    node[2] = f[3];
+    node[3] = (fp[2] - fm[2]) / (2. * GRAV_TWIST_STEP);
+    node[4] = f[4];
+    node[5] = f[5];
+    node[6] = f[6];
+    node[7] = (fp[5] - fm[5]) / (2. * GRAV_TWIST_STEP);
+
+    return;
+}
+
+/*
+ *  gravLatticeSetup(gl)
+ *
+ *  Derives the grid spacings from the ranges and sizes.
+ */
+static void gravLatticeSetup(gravLattice *gl)
+{
+    gl->rho0 = 1. / gl->rMax;
+    gl->dRho = (1. / gl->rMin - 1. / gl->rMax) / (gl->numR - 1);
+    gl->dLat = M_PI / (gl->numLat - 1);
+
+    return;
+}
+
+/*
+ *  gl = gravLatticeBuild(jnum, rMin, rMax, numR, numLat)
+ *
+ *  Tabulates the zonal perturbation of JPerturb() with the
+ *  harmonics jnum between the radii rMin and rMax (km) on numR
+ *  shells and numLat latitudes, and measures the interpolation error
+ *  at the centre of every cell.  Returns NULL on failure.
+ */
+gravLattice *gravLatticeBuild(int jnum, double rMin, double rMax, int numR, int numLat)
+{
+    gravLattice *gl;
+    double       err;
+    int          i;
+
+    if((jnum < 2) || (jnum > 6)) {
+        printf("ERROR: gravLatticeBuild() received jnum = %d \n", jnum);
+        printf("The value of jnum should be 2 <= jnum <= 6. \n");
+        return NULL;
+    }
+    if((rMin <= 0.) || (rMax <= rMin)) {
+        printf("ERROR: gravLatticeBuild() received rMin = %g and rMax = %g \n", rMin, rMax);
+        printf("The values should be 0 < rMin < rMax. \n");
+        return NULL;
+    }
+    if((numR < 2) || (numLat < 3)) {
+        printf("ERROR: gravLatticeBuild() received numR = %d and numLat = %d \n", numR, numLat);
+        printf("The values should be numR >= 2 and numLat >= 3. \n");
+        return NULL;
+    }
+    gl = (gravLattice *)malloc(sizeof(gravLattice));
+    if(gl == NULL) {
+        return NULL;
+    }
+    gl->node = (double *)malloc(sizeof(double) * GRAV_NUM_VALUES * numR * numLat);
+    if(gl->node == NULL) {
+        free(gl);
+        return NULL;
+    }
+    gl->jnum     = jnum;
+    gl->numR     = numR;
+    gl->numLat   = numLat;
+    gl->rMin     = rMin;
+    gl->rMax     = rMax;
+    gl->map      = NULL;
+    gl->mapBytes = 0;
+    gravLatticeSetup(gl);
+
+    #pragma omp parallel for schedule(static)
+    for(i = 0; i < numR; i++) {
+        int j;
+
+        for(j = 0; j < numLat; j++) {
+            gravLatticeNode(jnum, gl->rho0 + i * gl->dRho, -M_PI / 2. + j * gl->dLat,
+                            gl->node + (size_t)GRAV_NUM_VALUES * (i * numLat + j));
+        }
+    }
+
+    /* the error of the interpolant peaks near the cell centres */
+    err = 0.;
+    #pragma omp parallel for schedule(static) reduction(max:err)
+    for(i = 0; i < numR - 1; i++) {
+        double rvec[3+1];
+        double a[3+1];
+        double aj[3+1];
+        double r;
+        double phi;
+        double d;
+        int    j;
+
+        r = 1. / (gl->rho0 + (i + 0.5) * gl->dRho);
+        for(j = 0; j < numLat - 1; j++) {
+            phi = -M_PI / 2. + (j + 0.5) * gl->dLat;
+            set3(r * cos(phi) * cos(j), r * cos(phi) * sin(j), r * sin(phi), rvec);
+            gravLatticeAccel(gl, rvec, a);
+            JPerturb(rvec, jnum, aj);
+            sub(a, aj, a);
+            d = norm(a);
+            if(d > err) {
+                err = d;
+            }
+        }
+    }
+    gl->maxErr = err;
+
+    return gl;
+}
+
+/*
+ *  gravLatticeFree(gl)
+ *
+ *  Releases a lattice from gravLatticeBuild() or gravLatticeMap().
+ */
+void gravLatticeFree(gravLattice *gl)
+{
+    if(gl == NULL) {
+        return;
+    }
+    if(gl->map != NULL) {
+        munmap(gl->map, gl->mapBytes);
+    } else {
+        free(gl->node);
+    }
+    free(gl);
+
+    return;
+}
+
+/*
+ *  status = gravLatticeWrite(fileName, gl)
+ *
+ *  Writes the lattice to the binary file fileName.  Returns -1 if
+ *  the file could not be written.
+ */
+int gravLatticeWrite(const char *fileName, gravLattice *gl)
+{
+    unsigned char head[GRAV_HEADER];
+    FILE         *fp;
+    int32_t       u;
+    size_t        num;
+    int           status;
+
+    fp = fopen(fileName, "wb");
+    if(fp == NULL) {
+        printf("ERROR: gravLatticeWrite() could not open %s \n", fileName);
+        return -1;
+    }
+    memset(head, 0, GRAV_HEADER);
+    memcpy(head, GRAV_MAGIC, 8);
+    u = gl->jnum;
+    memcpy(head + 8, &u, sizeof(u));
+    u = gl->numR;
+    memcpy(head + 12, &u, sizeof(u));
+    u = gl->numLat;
+    memcpy(head + 16, &u, sizeof(u));
+    u = GRAV_NUM_VALUES;
+    memcpy(head + 20, &u, sizeof(u));
+    memcpy(head + 24, &gl->rMin, sizeof(double));
+    memcpy(head + 32, &gl->rMax, sizeof(double));
+    memcpy(head + 40, &gl->maxErr, sizeof(double));
+
+    num    = (size_t)GRAV_NUM_VALUES * gl->numR * gl->numLat;
+    status = 0;
+    if((fwrite(head, 1, GRAV_HEADER, fp) != GRAV_HEADER)
+       || (fwrite(gl->node, sizeof(double), num, fp) != num)) {
+        status = -1;
+    }
+    if(fclose(fp) != 0) {
+        status = -1;
+    }
+    if(status != 0) {
+        printf("ERROR: gravLatticeWrite() could not write %s \n", fileName);
+    }
+
+    return status;
+}
+
+/*
+ *  gl = gravLatticeMap(fileName)
+ *
+ *  Maps a lattice file written by gravLatticeWrite() read-only and
+ *  shared, so that the page cache holds a single copy for all
+ *  processes that map it.  Returns NULL on failure.
+ */
+gravLattice *gravLatticeMap(const char *fileName)
+{
+    gravLattice   *gl;
+    unsigned char *head;
+    struct stat    st;
+    int32_t        u[4];
+    void          *map;
+    int            fd;
+
+    fd = open(fileName, O_RDONLY);
+    if(fd < 0) {
+        printf("ERROR: gravLatticeMap() could not open %s \n", fileName);
+        return NULL;
+    }
+    if((fstat(fd, &st) != 0) || (st.st_size < GRAV_HEADER)) {
+        printf("ERROR: gravLatticeMap() found no lattice in %s \n", fileName);
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        printf("ERROR: gravLatticeMap() could not map %s \n", fileName);
+        return NULL;
+    }
+
+    head = (unsigned char *)map;
+    memcpy(u, head + 8, sizeof(u));
+    if((memcmp(head, GRAV_MAGIC, 8) != 0) || (u[3] != GRAV_NUM_VALUES) || (u[0] < 2) || (u[0] > 6)
+       || (u[1] < 2) || (u[2] < 3)
+       || ((size_t)st.st_size != GRAV_HEADER + sizeof(double) * GRAV_NUM_VALUES * u[1] * u[2])) {
+        printf("ERROR: gravLatticeMap() found no lattice in %s \n", fileName);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    gl = (gravLattice *)malloc(sizeof(gravLattice));
+    if(gl == NULL) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    gl->jnum   = u[0];
+    gl->numR   = u[1];
+    gl->numLat = u[2];
+    memcpy(&gl->rMin, head + 24, sizeof(double));
+    memcpy(&gl->rMax, head + 32, sizeof(double));
+    memcpy(&gl->maxErr, head + 40, sizeof(double));
+    gl->node     = (double *)(head + GRAV_HEADER);
+    gl->map      = map;
+    gl->mapBytes = (size_t)st.st_size;
+    gravLatticeSetup(gl);
+
+    return gl;
+}
+
+/*
+ *  status = gravLatticeAccel(gl, rvec, a)
+ *
+ *  Interpolates the zonal perturbation acceleration a (km/s^2) at
+ *  the position rvec (km).  Returns -1, leaving a unchanged, if
+ *  rvec lies outside of the shells of the lattice.
+ */
+int gravLatticeAccel(gravLattice *gl, double *rvec, double *a)
+{
+    double *n0;
+    double *n1;
+    double  hu[4];
+    double  hw[4];
+    double  rc;
+    double  r;
+    double  u;
+    double  w;
+    double  aH;
+    double  aZ;
+    int     i;
+    int     j;
+
+    rc = sqrt(rvec[1] * rvec[1] + rvec[2] * rvec[2]);
+    r  = sqrt(rc * rc + rvec[3] * rvec[3]);
+    u  = (1. / r - gl->rho0) / gl->dRho;
+    if((u < -1e-9) || (u > gl->numR - 1 + 1e-9)) {
+        return -1;
+    }
+    w = (atan2(rvec[3], rc) + M_PI / 2.) / gl->dLat;
+    i = (int)u;
+    j = (int)w;
+    if(i < 0) {
+        i = 0;
+    } else if(i > gl->numR - 2) {
+        i = gl->numR - 2;
+    }
+    if(j > gl->numLat - 2) {
+        j = gl->numLat - 2;
+    }
+    u -= i;
+    w -= j;
+
+    /* value and scaled slope weights of the lower and upper nodes */
+    hu[0] = (1. + 2. * u) * (1. - u) * (1. - u);
+    hu[1] = gl->dRho * u * (1. - u) * (1. - u);
+    hu[2] = u * u * (3. - 2. * u);
+    hu[3] = -gl->dRho * u * u * (1. - u);
+    hw[0] = (1. + 2. * w) * (1. - w) * (1. - w);
+    hw[1] = gl->dLat * w * (1. - w) * (1. - w);
+    hw[2] = w * w * (3. - 2. * w);
+    hw[3] = -gl->dLat * w * w * (1. - w);
+
+    n0 = gl->node + (size_t)GRAV_NUM_VALUES * (i * gl->numLat + j);
+    n1 = n0 + (size_t)GRAV_NUM_VALUES * gl->numLat;
+    aH = hu[0] * (hw[0] * n0[0] + hw[1] * n0[2] + hw[2] * n0[8] + hw[3] * n0[10])
+         + hu[1] * (hw[0] * n0[1] + hw[1] * n0[3] + hw[2] * n0[9] + hw[3] * n0[11])
+         + hu[2] * (hw[0] * n1[0] + hw[1] * n1[2] + hw[2] * n1[8] + hw[3] * n1[10])
+         + hu[3] * (hw[0] * n1[1] + hw[1] * n1[3] + hw[2] * n1[9] + hw[3] * n1[11]);
+    aZ = hu[0] * (hw[0] * n0[4] + hw[1] * n0[6] + hw[2] * n0[12] + hw[3] * n0[14])
+         + hu[1] * (hw[0] * n0[5] + hw[1] * n0[7] + hw[2] * n0[13] + hw[3] * n0[15])
+         + hu[2] * (hw[0] * n1[4] + hw[1] * n1[6] + hw[2] * n1[12] + hw[3] * n1[14])
+         + hu[3] * (hw[0] * n1[5] + hw[1] * n1[7] + hw[2] * n1[13] + hw[3] * n1[15]);
+
+    if(rc > 0.) {
+        a[1] = aH * rvec[1] / rc;
+        a[2] = aH * rvec[2] / rc;
+    } else {
+        a[1] = 0.;
+        a[2] = 0.;
+    }
+    a[3] = aZ;
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *  gravityLattice.h
+ *  OrbitalMotion
+ *
+ *  Precomputed lattice of the zonal gravity perturbation of
+ *  JPerturb().  Since the zonal field is symmetric about the polar
+ *  axis, the lattice spans the meridian plane only: shells equally
+ *  spaced in 1/r, which crowds them towards the body where the field
+ *  varies fastest, times equally spaced latitudes.  Each node holds
+ *  the horizontal and polar components of the acceleration with
+ *  their derivatives in 1/r and latitude, and the acceleration is
+ *  recovered by bicubic Hermite interpolation and a rotation by the
+ *  longitude.  The lattice records the largest interpolation error
+ *  found at the cell centres when it is built.  Lattices can be
+ *  written to a file and mapped read-only, so that all processes of
+ *  a node share one copy.  Setting the lattice of a batchForceModel
+ *  with the same jnum makes batchAccel() use it in place of
+ *  JPerturb().
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "astroConstants.h"
+#include "vector3D.h"
+#include "orbitalMotion.h"
+
+#ifndef _GRAVITY_LATTICE_H_
+#define _GRAVITY_LATTICE_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define GRAV_NUM_VALUES     8       /* doubles per node */
+
+    typedef struct gravLatticeStruct {
+        int     jnum;                   /* zonal harmonics tabulated, as in JPerturb() */
+        int     numR;                   /* radial shells */
+        int     numLat;                 /* latitudes from -90 to 90 deg */
+        double  rMin;                   /* radius of the innermost shell (km) */
+        double  rMax;                   /* radius of the outermost shell (km) */
+        double  rho0;                   /* 1/rMax (1/km) */
+        double  dRho;                   /* shell spacing in 1/r (1/km) */
+        double  dLat;                   /* latitude spacing (rad) */
+        double  maxErr;                 /* largest error found at the cell centres (km/s^2) */
+        double *node;                   /* node[GRAV_NUM_VALUES*(i*numLat + j) + c], read-only if mapped */
+        void   *map;                    /* mapped file, NULL if the nodes were allocated */
+        size_t  mapBytes;               /* size of the mapping */
+    } gravLattice;
+
+    gravLattice *gravLatticeBuild(int jnum, double rMin, double rMax, int numR, int numLat);
+    void         gravLatticeFree(gravLattice *gl);
+    int          gravLatticeWrite(const char *fileName, gravLattice *gl);
+    gravLattice *gravLatticeMap(const char *fileName);
+    int          gravLatticeAccel(gravLattice *gl, double *rvec, double *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1386 @@
+/*
+ *  kalmanFilter.c
+ *  OrbitalMotion
+ *
+ *  The time and measurement updates process the instances in blocks
+ *  of KF_LANES, one block per thread at a time.  The work of a single
+ *  instance that does not vectorize (the orbit propagation and the
+ *  observation models) fills lane arrays A[i][j][l] of the block, and
+ *  the covariance algebra then runs directly on the SoA arrays with
+ *  the instance index l innermost in omp simd loops.  Every lane
+ *  carries out the same arithmetic: measurements of fewer than three
+ *  components are padded with zero rows, and skipped or rejected
+ *  instances get a zero gain, which leaves their state and covariance
+ *  unchanged.  Measurements are whitened by their noise standard
+ *  deviation (the right ascension residual is scaled by cos(dec) as
+ *  in odFit()), so the measurement covariance is the identity.
+ *  Covariance updates use the Joseph form.  An innovation whose
+ *  squared Mahalanobis distance exceeds gate^2 is rejected.
+ *
+ *  The orbit process noise is a white acceleration of spectral
+ *  density q (km^2/s^3) on each axis.  The unscented transform uses
+ *  alpha = 1, beta = 2, kappa = 0.  The attitude error is the MRP
+ *  dsigma with [BN] = [C(dsigma)] [C(q)], the gyro measures
+ *  omega + b + noise, and sigmaV (rad/s^0.5) and sigmaU (rad/s^1.5)
+ *  are the angle random walk and the bias random walk of the gyro.
+ *  After each attitude update the error is folded into the
+ *  reference and reset to zero.
+ *
+ *  References:
+ *  B. D. Tapley, B. E. Schutz and G. H. Born, "Statistical Orbit
+ *  Determination", Elsevier, 2004, chapter 4.
+ *  E. A. Wan and R. van der Merwe, "The Unscented Kalman Filter for
+ *  Nonlinear Estimation", IEEE AS-SPCC, 2000.
+ *  J. L. Crassidis and J. L. Junkins, "Optimal Estimation of Dynamic
+ *  Systems", 2nd ed., CRC Press, 2012, section 7.2.
+ *  F. L. Markley, "Attitude Error Representations for Kalman
+ *  Filtering", J. Guidance, Control and Dynamics, 26(2), 2003.
+ */
+
+#include "kalmanFilter.h"
+
+#define KF_UT_ALPHA     1.
+#define KF_UT_BETA      2.
+#define KF_UT_KAPPA     0.
+#define KF_SIGMA        13      /* sigma points of a 6 state filter */
+#define KF_LANES        32      /* instances of a block, the SIMD loop length */
+
+/*
+ *  mem = kfAlloc(n, num, P, stride)
+ *
+ *  Allocates num zeroed arrays of n doubles, each padded to a
+ *  multiple of 8 doubles, followed by the 21 arrays of a symmetric
+ *  6x6 covariance which are mapped into P.  Returns NULL if the
+ *  memory is not available.
+ */
+static double *kfAlloc(int n, int num, double *P[6+1][6+1], int *stride)
+{
+    double *mem;
+    double *c;
+    int     i;
+    int     j;
+
+    *stride = (n + 7) & ~7;
+    mem = (double *)calloc((size_t)(num + 21) * (*stride) + 1, sizeof(double));
+    if(mem == NULL) {
+        return NULL;
+    }
+    c = mem + (size_t)num * (*stride);
+    for(i = 1; i <= 6; i++) {
+        for(j = i; j <= 6; j++) {
+            P[i][j] = P[j][i] = c;
+            c += *stride;
+        }
+    }
+
+    return mem;
+}
+
+/*
+ *  kfLoadCov(P, k, A)
+ *
+ *  Gathers the covariance of instance k.
+ */
+static void kfLoadCov(double *P[6+1][6+1], int k, double A[7][7])
+{
+    int i;
+    int j;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            A[i][j] = P[i][j][k];
+        }
+    }
+
+    return;
+}
+
+/*
+ *  kfStoreCov(A, k, P)
+ *
+ *  Scatters the symmetric part of A to the covariance of instance k.
+ */
+static void kfStoreCov(double A[7][7], int k, double *P[6+1][6+1])
+{
+    int i;
+    int j;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = i; j <= 6; j++) {
+            P[i][j][k] = 0.5 * (A[i][j] + A[j][i]);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  len = kfBlock(P, n, k0, Pk)
+ *
+ *  Points Pk at the covariance arrays of the block of instances
+ *  starting at k0 and returns the number of instances in the block.
+ */
+static int kfBlock(double *P[6+1][6+1], int n, int k0, double *Pk[6+1][6+1])
+{
+    int i;
+    int j;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            Pk[i][j] = P[i][j] + k0;
+        }
+    }
+
+    return (n - k0 < KF_LANES) ? n - k0 : KF_LANES;
+}
+
+/*
+ *  kfSandwichLanes(len, A, P)
+ *
+ *  Replaces the covariances P of the len lanes of a block by
+ *  A P A^T.
+ */
+static void kfSandwichLanes(int len, double A[7][7][KF_LANES], double *P[6+1][6+1])
+{
+    double  T[7][7][KF_LANES];
+    double *p;
+    int     i;
+    int     j;
+    int     m;
+    int     l;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                T[i][j][l] = 0.;
+            }
+            for(m = 1; m <= 6; m++) {
+                p = P[m][j];
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    T[i][j][l] += A[i][m][l] * p[l];
+                }
+            }
+        }
+    }
+    for(i = 1; i <= 6; i++) {
+        for(j = i; j <= 6; j++) {
+            p = P[i][j];
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                p[l] = 0.;
+            }
+            for(m = 1; m <= 6; m++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    p[l] += T[i][m][l] * A[j][m][l];
+                }
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ *  kfMaskLanes(len, ok, v)
+ *
+ *  Zeroes v[l] for the lanes of a block with ok[l] = 0, whatever
+ *  v[l] holds.  It is a pass of its own so that the compiler cannot
+ *  sink the computation of v into a branch of the selection.
+ */
+static void kfMaskLanes(int len, double *ok, double *v)
+{
+    int l;
+
+    #pragma omp simd
+    for(l = 0; l < len; l++) {
+        v[l] = (ok[l] != 0.) ? v[l] : 0.;
+    }
+
+    return;
+}
+
+/*
+ *  accepted = kfGateLanes(len, y, S, gate, ok)
+ *
+ *  Replaces the symmetric 3x3 innovation covariances S of the len
+ *  lanes of a block by their inverses, computed by cofactors from
+ *  the upper triangle, and gates the innovations y with them.
+ *  Clears ok[l] for the lanes that fail the gate and returns the
+ *  number of lanes still set.
+ */
+static int kfGateLanes(int len, double y[3+1][KF_LANES], double S[3+1][3+1][KF_LANES], double gate,
+                       double *ok)
+{
+    double a11;
+    double a12;
+    double a13;
+    double a22;
+    double a23;
+    double a33;
+    double det;
+    double d2;
+    double sum;
+    int    l;
+
+    #pragma omp simd private(a11, a12, a13, a22, a23, a33, det)
+    for(l = 0; l < len; l++) {
+        a11 = S[2][2][l] * S[3][3][l] - S[2][3][l] * S[2][3][l];
+        a12 = S[1][3][l] * S[2][3][l] - S[1][2][l] * S[3][3][l];
+        a13 = S[1][2][l] * S[2][3][l] - S[1][3][l] * S[2][2][l];
+        a22 = S[1][1][l] * S[3][3][l] - S[1][3][l] * S[1][3][l];
+        a23 = S[1][2][l] * S[1][3][l] - S[1][1][l] * S[2][3][l];
+        a33 = S[1][1][l] * S[2][2][l] - S[1][2][l] * S[1][2][l];
+        det = S[1][1][l] * a11 + S[1][2][l] * a12 + S[1][3][l] * a13;
+        S[1][1][l] = a11 / det;
+        S[1][2][l] = S[2][1][l] = a12 / det;
+        S[1][3][l] = S[3][1][l] = a13 / det;
+        S[2][2][l] = a22 / det;
+        S[2][3][l] = S[3][2][l] = a23 / det;
+        S[3][3][l] = a33 / det;
+    }
+    if(gate > 0.) {
+        #pragma omp simd private(d2)
+        for(l = 0; l < len; l++) {
+            d2 = y[1][l] * y[1][l] * S[1][1][l] + y[2][l] * y[2][l] * S[2][2][l]
+                 + y[3][l] * y[3][l] * S[3][3][l]
+                 + 2. * (y[1][l] * y[2][l] * S[1][2][l] + y[1][l] * y[3][l] * S[1][3][l]
+                         + y[2][l] * y[3][l] * S[2][3][l]);
+            ok[l] = (d2 <= gate * gate) ? ok[l] : 0.;
+        }
+    }
+    sum = 0.;
+    #pragma omp simd reduction(+:sum)
+    for(l = 0; l < len; l++) {
+        sum += ok[l];
+    }
+
+    return (int)sum;
+}
+
+/*
+ *  kfGainLanes(len, Pxz, Si, y, ok, K, dx)
+ *
+ *  Gains K = Pxz Si of the len lanes of a block and the corrections
+ *  dx = K y, both zero for the lanes with ok[l] = 0.
+ */
+static void kfGainLanes(int len, double Pxz[6+1][3+1][KF_LANES], double Si[3+1][3+1][KF_LANES],
+                        double y[3+1][KF_LANES], double *ok, double K[6+1][3+1][KF_LANES],
+                        double dx[6+1][KF_LANES])
+{
+    int i;
+    int c;
+    int l;
+
+    for(i = 1; i <= 6; i++) {
+        for(c = 1; c <= 3; c++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                K[i][c][l] = Pxz[i][1][l] * Si[1][c][l] + Pxz[i][2][l] * Si[2][c][l]
+                             + Pxz[i][3][l] * Si[3][c][l];
+            }
+            kfMaskLanes(len, ok, K[i][c]);
+        }
+        #pragma omp simd
+        for(l = 0; l < len; l++) {
+            dx[i][l] = K[i][1][l] * y[1][l] + K[i][2][l] * y[2][l] + K[i][3][l] * y[3][l];
+        }
+        kfMaskLanes(len, ok, dx[i]);
+    }
+
+    return;
+}
+
+/*
+ *  accepted = kfUpdateLanes(len, H, y, gate, ok, P, dx)
+ *
+ *  Kalman update of the covariances P of the len lanes of a block
+ *  with three whitened residuals y and partials H per lane, unused
+ *  rows being zero.  Lanes with ok[l] = 0 or that fail the gate get
+ *  a zero gain, so that dx is zero and P is left unchanged, and
+ *  leave with ok[l] = 0.  Returns the corrections dx and the number
+ *  of accepted lanes.
+ */
+static int kfUpdateLanes(int len, double H[3+1][6+1][KF_LANES], double y[3+1][KF_LANES], double gate,
+                         double *ok, double *P[6+1][6+1], double dx[6+1][KF_LANES])
+{
+    double  PHt[6+1][3+1][KF_LANES];
+    double  S[3+1][3+1][KF_LANES];
+    double  K[6+1][3+1][KF_LANES];
+    double  A[7][7][KF_LANES];
+    double *p;
+    int     accepted;
+    int     c;
+    int     d;
+    int     i;
+    int     j;
+    int     l;
+
+    for(i = 1; i <= 6; i++) {
+        for(c = 1; c <= 3; c++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                PHt[i][c][l] = 0.;
+            }
+            for(j = 1; j <= 6; j++) {
+                p = P[i][j];
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    PHt[i][c][l] += p[l] * H[c][j][l];
+                }
+            }
+        }
+    }
+    for(c = 1; c <= 3; c++) {
+        for(d = c; d <= 3; d++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                S[c][d][l] = (c == d) ? 1. : 0.;
+            }
+            for(i = 1; i <= 6; i++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    S[c][d][l] += H[c][i][l] * PHt[i][d][l];
+                }
+            }
+        }
+    }
+    accepted = kfGateLanes(len, y, S, gate, ok);
+    kfGainLanes(len, PHt, S, y, ok, K, dx);
+
+    /* Joseph form (I - K H) P (I - K H)^T + K K^T */
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                A[i][j][l] = K[i][1][l] * H[1][j][l] + K[i][2][l] * H[2][j][l] + K[i][3][l] * H[3][j][l];
+            }
+            kfMaskLanes(len, ok, A[i][j]);
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                A[i][j][l] = ((i == j) ? 1. : 0.) - A[i][j][l];
+            }
+        }
+    }
+    kfSandwichLanes(len, A, P);
+    for(i = 1; i <= 6; i++) {
+        for(j = i; j <= 6; j++) {
+            p = P[i][j];
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                p[l] += K[i][1][l] * K[j][1][l] + K[i][2][l] * K[j][2][l] + K[i][3][l] * K[j][3][l];
+            }
+        }
+    }
+
+    return accepted;
+}
+
+/*
+ *  kfOrbitNoiseLanes(len, q, t, P)
+ *
+ *  Adds the process noise of a white acceleration of spectral
+ *  density q acting over t seconds to the covariances P of the len
+ *  lanes of a block.
+ */
+static void kfOrbitNoiseLanes(int len, double q, double t, double *P[6+1][6+1])
+{
+    double *pp;
+    double *pv;
+    double *vv;
+    int     i;
+    int     l;
+
+    for(i = 1; i <= 3; i++) {
+        pp = P[i][i];
+        pv = P[i][i + 3];
+        vv = P[i + 3][i + 3];
+        #pragma omp simd
+        for(l = 0; l < len; l++) {
+            pp[l] += q * t * t * t / 3.;
+            pv[l] += q * t * t / 2.;
+            vv[l] += q * t;
+        }
+    }
+
+    return;
+}
+
+/*
+ *  m = kfWhiten(obs, x, y, H)
+ *
+ *  Whitened residuals y[1..m] of the observation obs at the state x
+ *  and their partials H[1..m][1..6].
+ */
+static int kfWhiten(odObservation *obs, double *x, double *y, double H[3+1][6+1])
+{
+    double z[2+1];
+    double Hz[2+1][6+1];
+    int    m;
+    int    c;
+    int    j;
+
+    m = odPredict(obs, &x[0], &x[3], z, Hz);
+    for(c = 1; c <= m; c++) {
+        y[c] = (obs->z[c] - z[c]) / obs->sigma;
+        for(j = 1; j <= 6; j++) {
+            H[c][j] = Hz[c][j] / obs->sigma;
+        }
+    }
+    if(obs->type == OD_ANGLES) {
+        y[1] = remainder(obs->z[1] - z[1], 2. * M_PI) * cos(z[2]) / obs->sigma;
+        for(j = 1; j <= 6; j++) {
+            H[1][j] *= cos(z[2]);
+        }
+    }
+
+    return m;
+}
+
+/*
+ *  kfWeights(Wm, Wc, scale)
+ *
+ *  Mean and covariance weights of the sigma points of a 6 state
+ *  unscented transform and the scale of the covariance square root
+ *  that spreads them.
+ */
+static void kfWeights(double *Wm, double *Wc, double *scale)
+{
+    double lambda;
+    int    s;
+
+    lambda = KF_UT_ALPHA * KF_UT_ALPHA * (6. + KF_UT_KAPPA) - 6.;
+    Wm[0]  = lambda / (6. + lambda);
+    Wc[0]  = Wm[0] + 1. - KF_UT_ALPHA * KF_UT_ALPHA + KF_UT_BETA;
+    for(s = 1; s < KF_SIGMA; s++) {
+        Wm[s] = Wc[s] = 0.5 / (6. + lambda);
+    }
+    *scale = sqrt(6. + lambda);
+
+    return;
+}
+
+/*
+ *  kfSigmaLanes(len, x, P, scale, chi, ok)
+ *
+ *  Sigma points chi[0..12][1..6][l] of the means x[1..6][l] and
+ *  covariances P of the len lanes of a block, from the Cholesky
+ *  factors of P.  Clears ok[l] for the lanes whose covariance is
+ *  not positive definite; their sigma points are meaningless.
+ */
+static void kfSigmaLanes(int len, double x[6+1][KF_LANES], double *P[6+1][6+1], double scale,
+                         double chi[KF_SIGMA][6+1][KF_LANES], double *ok)
+{
+    double L[6+1][6+1][KF_LANES];
+    int    i;
+    int    j;
+    int    m;
+    int    l;
+
+    for(j = 1; j <= 6; j++) {
+        for(i = j; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                L[i][j][l] = P[i][j][l];
+            }
+            for(m = 1; m < j; m++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    L[i][j][l] -= L[i][m][l] * L[j][m][l];
+                }
+            }
+        }
+        #pragma omp simd
+        for(l = 0; l < len; l++) {
+            ok[l]      = (L[j][j][l] <= 0.) ? 0. : ok[l];
+            L[j][j][l] = sqrt((L[j][j][l] <= 0.) ? 1. : L[j][j][l]);
+        }
+        for(i = j + 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                L[i][j][l] /= L[j][j][l];
+            }
+        }
+    }
+
+    for(i = 1; i <= 6; i++) {
+        #pragma omp simd
+        for(l = 0; l < len; l++) {
+            chi[0][i][l] = x[i][l];
+        }
+        for(j = 1; j <= i; j++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                chi[j][i][l]     = x[i][l] + scale * L[i][j][l];
+                chi[j + 6][i][l] = x[i][l] - scale * L[i][j][l];
+            }
+        }
+        for(j = i + 1; j <= 6; j++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                chi[j][i][l] = chi[j + 6][i][l] = x[i][l];
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ *  f = kfOrbitCreate(n)
+ *
+ *  Allocates a batch of n orbit filters with zero states and
+ *  covariances, CdAm = 0 and Am = 0.  Returns NULL on failure.
+ */
+kfOrbitBatch *kfOrbitCreate(int n)
+{
+    kfOrbitBatch *f;
+    int           stride;
+    int           i;
+
+    if(n < 0) {
+        printf("ERROR: kfOrbitCreate() received n = %d \n", n);
+        printf("The value of n should be n >= 0. \n");
+        return NULL;
+    }
+    f = (kfOrbitBatch *)malloc(sizeof(kfOrbitBatch));
+    if(f == NULL) {
+        return NULL;
+    }
+    f->mem = kfAlloc(n, 8, f->P, &stride);
+    if(f->mem == NULL) {
+        free(f);
+        return NULL;
+    }
+    f->n = n;
+    for(i = 1; i <= 6; i++) {
+        f->x[i] = f->mem + (size_t)(i - 1) * stride;
+    }
+    f->CdAm = f->mem + (size_t)6 * stride;
+    f->Am   = f->mem + (size_t)7 * stride;
+
+    return f;
+}
+
+/*
+ *  kfOrbitFree(f)
+ *
+ *  Releases a batch created by kfOrbitCreate().
+ */
+void kfOrbitFree(kfOrbitBatch *f)
+{
+    if(f == NULL) {
+        return;
+    }
+    free(f->mem);
+    free(f);
+
+    return;
+}
+
+/*
+ *  kfOrbitSet(f, k, x, P, CdAm, Am)
+ *
+ *  Initializes filter k with the state x[1..6], the covariance P
+ *  and the drag and solar radiation parameters of the object.
+ */
+void kfOrbitSet(kfOrbitBatch *f, int k, double *x, double P[7][7], double CdAm, double Am)
+{
+    int i;
+
+    for(i = 1; i <= 6; i++) {
+        f->x[i][k] = x[i];
+    }
+    kfStoreCov(P, k, f->P);
+    f->CdAm[k] = CdAm;
+    f->Am[k]   = Am;
+
+    return;
+}
+
+/*
+ *  kfOrbitGet(f, k, x, P)
+ *
+ *  Returns the state and covariance of filter k.
+ */
+void kfOrbitGet(kfOrbitBatch *f, int k, double *x, double P[7][7])
+{
+    int i;
+
+    for(i = 1; i <= 6; i++) {
+        x[i] = f->x[i][k];
+    }
+    kfLoadCov(f->P, k, P);
+
+    return;
+}
+
+/*
+ *  kfEKFPredict(f, fm, t, dt, q)
+ *
+ *  Extended Kalman filter time update of all instances over t
+ *  seconds, integrating the state and the state transition matrix
+ *  with RK4 steps of at most dt seconds under the force model fm,
+ *  with process noise of spectral density q.
+ */
+void kfEKFPredict(kfOrbitBatch *f, batchForceModel *fm, double t, double dt, double q)
+{
+    int k0;
+
+    #pragma omp parallel for schedule(static)
+    for(k0 = 0; k0 < f->n; k0 += KF_LANES) {
+        double  Phi[7][7][KF_LANES];
+        double  X[42+1];
+        double *P[6+1][6+1];
+        int     len;
+        int     i;
+        int     j;
+        int     l;
+
+        len = kfBlock(f->P, f->n, k0, P);
+        for(l = 0; l < len; l++) {
+            for(i = 1; i <= 6; i++) {
+                X[i] = f->x[i][k0 + l];
+                for(j = 1; j <= 6; j++) {
+                    X[6 + 6 * (i - 1) + j] = (i == j) ? 1. : 0.;
+                }
+            }
+            odPropagate(fm, f->CdAm[k0 + l], f->Am[k0 + l], X, 1, t, dt);
+            for(i = 1; i <= 6; i++) {
+                f->x[i][k0 + l] = X[i];
+                for(j = 1; j <= 6; j++) {
+                    Phi[i][j][l] = X[6 + 6 * (i - 1) + j];
+                }
+            }
+        }
+        kfSandwichLanes(len, Phi, P);
+        kfOrbitNoiseLanes(len, q, t, P);
+    }
+
+    return;
+}
+
+/*
+ *  accepted = kfEKFUpdate(f, obs, gate)
+ *
+ *  Extended Kalman filter measurement update of every instance k
+ *  with the observation obs[k], skipping instances whose obs[k].type
+ *  is 0.  Returns the number of accepted observations.
+ */
+int kfEKFUpdate(kfOrbitBatch *f, odObservation *obs, double gate)
+{
+    int accepted;
+    int k0;
+
+    accepted = 0;
+    #pragma omp parallel for schedule(static) reduction(+:accepted) if(f->n >= KF_PARALLEL_MIN)
+    for(k0 = 0; k0 < f->n; k0 += KF_LANES) {
+        double  H[3+1][6+1][KF_LANES];
+        double  y[3+1][KF_LANES];
+        double  dx[6+1][KF_LANES];
+        double  ok[KF_LANES];
+        double  x[6+1];
+        double  yk[3+1];
+        double  Hk[3+1][6+1];
+        double *P[6+1][6+1];
+        int     len;
+        int     m;
+        int     c;
+        int     i;
+        int     l;
+
+        len = kfBlock(f->P, f->n, k0, P);
+        for(l = 0; l < len; l++) {
+            m     = 0;
+            ok[l] = (obs[k0 + l].type != 0) ? 1. : 0.;
+            if(obs[k0 + l].type != 0) {
+                for(i = 1; i <= 6; i++) {
+                    x[i] = f->x[i][k0 + l];
+                }
+                m = kfWhiten(&obs[k0 + l], x, yk, Hk);
+            }
+            for(c = 1; c <= 3; c++) {
+                y[c][l] = (c <= m) ? yk[c] : 0.;
+                for(i = 1; i <= 6; i++) {
+                    H[c][i][l] = (c <= m) ? Hk[c][i] : 0.;
+                }
+            }
+        }
+        accepted += kfUpdateLanes(len, H, y, gate, ok, P, dx);
+        for(i = 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                f->x[i][k0 + l] += dx[i][l];
+            }
+        }
+    }
+
+    return accepted;
+}
+
+/*
+ *  failed = kfUKFPredict(f, fm, t, dt, q)
+ *
+ *  Unscented Kalman filter time update of all instances over t
+ *  seconds, integrating the sigma points with RK4 steps of at most
+ *  dt seconds under the force model fm, with process noise of
+ *  spectral density q.  An instance whose covariance is not positive
+ *  definite propagates its state alone and only adds the process
+ *  noise; the number of such instances is returned.
+ */
+int kfUKFPredict(kfOrbitBatch *f, batchForceModel *fm, double t, double dt, double q)
+{
+    double Wm[KF_SIGMA];
+    double Wc[KF_SIGMA];
+    double scale;
+    int    failed;
+    int    k0;
+
+    kfWeights(Wm, Wc, &scale);
+    failed = 0;
+    #pragma omp parallel for schedule(static) reduction(+:failed)
+    for(k0 = 0; k0 < f->n; k0 += KF_LANES) {
+        double  chi[KF_SIGMA][6+1][KF_LANES];
+        double  x[6+1][KF_LANES];
+        double  xm[6+1][KF_LANES];
+        double  Pm[KF_LANES];
+        double  ok[KF_LANES];
+        double  X[6+1];
+        double *P[6+1][6+1];
+        double *p;
+        int     len;
+        int     sp;
+        int     i;
+        int     j;
+        int     l;
+
+        len = kfBlock(f->P, f->n, k0, P);
+        for(i = 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                x[i][l] = f->x[i][k0 + l];
+            }
+        }
+        for(l = 0; l < len; l++) {
+            ok[l] = 1.;
+        }
+        kfSigmaLanes(len, x, P, scale, chi, ok);
+
+        for(l = 0; l < len; l++) {
+            if(ok[l] == 0.) {
+                for(i = 1; i <= 6; i++) {
+                    X[i] = x[i][l];
+                }
+                odPropagate(fm, f->CdAm[k0 + l], f->Am[k0 + l], X, 0, t, dt);
+                for(i = 1; i <= 6; i++) {
+                    x[i][l] = X[i];
+                }
+                failed++;
+                continue;
+            }
+            for(sp = 0; sp < KF_SIGMA; sp++) {
+                for(i = 1; i <= 6; i++) {
+                    X[i] = chi[sp][i][l];
+                }
+                odPropagate(fm, f->CdAm[k0 + l], f->Am[k0 + l], X, 0, t, dt);
+                for(i = 1; i <= 6; i++) {
+                    chi[sp][i][l] = X[i];
+                }
+            }
+        }
+
+        /* weighted mean and covariance of the propagated points */
+        for(i = 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                xm[i][l] = 0.;
+            }
+            for(sp = 0; sp < KF_SIGMA; sp++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    xm[i][l] += Wm[sp] * chi[sp][i][l];
+                }
+            }
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                x[i][l] = (ok[l] != 0.) ? xm[i][l] : x[i][l];
+            }
+        }
+        for(sp = 0; sp < KF_SIGMA; sp++) {
+            for(i = 1; i <= 6; i++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    chi[sp][i][l] -= x[i][l];
+                }
+            }
+        }
+        for(i = 1; i <= 6; i++) {
+            for(j = i; j <= 6; j++) {
+                p = P[i][j];
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    Pm[l] = 0.;
+                }
+                for(sp = 0; sp < KF_SIGMA; sp++) {
+                    #pragma omp simd
+                    for(l = 0; l < len; l++) {
+                        Pm[l] += Wc[sp] * chi[sp][i][l] * chi[sp][j][l];
+                    }
+                }
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    p[l] = (ok[l] != 0.) ? Pm[l] : p[l];
+                }
+            }
+        }
+        kfOrbitNoiseLanes(len, q, t, P);
+        for(i = 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                f->x[i][k0 + l] = x[i][l];
+            }
+        }
+    }
+
+    return failed;
+}
+
+/*
+ *  accepted = kfUKFUpdate(f, obs, gate)
+ *
+ *  Unscented Kalman filter measurement update of every instance k
+ *  with the observation obs[k], skipping instances whose obs[k].type
+ *  is 0 or whose covariance is not positive definite.  Returns the
+ *  number of accepted observations.
+ */
+int kfUKFUpdate(kfOrbitBatch *f, odObservation *obs, double gate)
+{
+    double Wm[KF_SIGMA];
+    double Wc[KF_SIGMA];
+    double scale;
+    int    accepted;
+    int    k0;
+
+    kfWeights(Wm, Wc, &scale);
+    accepted = 0;
+    #pragma omp parallel for schedule(static) reduction(+:accepted) if(f->n >= KF_PARALLEL_MIN)
+    for(k0 = 0; k0 < f->n; k0 += KF_LANES) {
+        double  chi[KF_SIGMA][6+1][KF_LANES];
+        double  Y[KF_SIGMA][3+1][KF_LANES];
+        double  x[6+1][KF_LANES];
+        double  y[3+1][KF_LANES];
+        double  Pxz[6+1][3+1][KF_LANES];
+        double  S[3+1][3+1][KF_LANES];
+        double  K[6+1][3+1][KF_LANES];
+        double  dx[6+1][KF_LANES];
+        double  dP[KF_LANES];
+        double  ok[KF_LANES];
+        double  X[6+1];
+        double  yk[3+1];
+        double  Hk[3+1][6+1];
+        double *P[6+1][6+1];
+        double *p;
+        int     len;
+        int     m;
+        int     sp;
+        int     c;
+        int     d;
+        int     i;
+        int     j;
+        int     l;
+
+        len = kfBlock(f->P, f->n, k0, P);
+        for(i = 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                x[i][l] = f->x[i][k0 + l];
+            }
+        }
+        for(l = 0; l < len; l++) {
+            ok[l] = (obs[k0 + l].type != 0) ? 1. : 0.;
+        }
+        kfSigmaLanes(len, x, P, scale, chi, ok);
+
+        /* whitened residuals of the sigma points, y = -z up to a constant */
+        for(l = 0; l < len; l++) {
+            for(sp = 0; sp < KF_SIGMA; sp++) {
+                m = 0;
+                if(ok[l] != 0.) {
+                    for(i = 1; i <= 6; i++) {
+                        X[i] = chi[sp][i][l];
+                    }
+                    m = kfWhiten(&obs[k0 + l], X, yk, Hk);
+                }
+                for(c = 1; c <= 3; c++) {
+                    Y[sp][c][l] = (c <= m) ? yk[c] : 0.;
+                }
+            }
+        }
+        for(c = 1; c <= 3; c++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                y[c][l] = 0.;
+            }
+            for(sp = 0; sp < KF_SIGMA; sp++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    y[c][l] += Wm[sp] * Y[sp][c][l];
+                }
+            }
+        }
+        for(sp = 0; sp < KF_SIGMA; sp++) {
+            for(c = 1; c <= 3; c++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    Y[sp][c][l] -= y[c][l];
+                }
+            }
+            for(i = 1; i <= 6; i++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    chi[sp][i][l] -= x[i][l];
+                }
+            }
+        }
+        for(c = 1; c <= 3; c++) {
+            for(d = c; d <= 3; d++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    S[c][d][l] = (c == d) ? 1. : 0.;
+                }
+                for(sp = 0; sp < KF_SIGMA; sp++) {
+                    #pragma omp simd
+                    for(l = 0; l < len; l++) {
+                        S[c][d][l] += Wc[sp] * Y[sp][c][l] * Y[sp][d][l];
+                    }
+                }
+            }
+            for(i = 1; i <= 6; i++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    Pxz[i][c][l] = 0.;
+                }
+                for(sp = 0; sp < KF_SIGMA; sp++) {
+                    #pragma omp simd
+                    for(l = 0; l < len; l++) {
+                        Pxz[i][c][l] -= Wc[sp] * chi[sp][i][l] * Y[sp][c][l];
+                    }
+                }
+            }
+        }
+        accepted += kfGateLanes(len, y, S, gate, ok);
+        kfGainLanes(len, Pxz, S, y, ok, K, dx);
+
+        for(i = 1; i <= 6; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                f->x[i][k0 + l] = x[i][l] + dx[i][l];
+            }
+        }
+        for(i = 1; i <= 6; i++) {
+            for(j = i; j <= 6; j++) {
+                p = P[i][j];
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    dP[l] = K[i][1][l] * Pxz[j][1][l] + K[i][2][l] * Pxz[j][2][l]
+                            + K[i][3][l] * Pxz[j][3][l] + K[j][1][l] * Pxz[i][1][l]
+                            + K[j][2][l] * Pxz[i][2][l] + K[j][3][l] * Pxz[i][3][l];
+                }
+                kfMaskLanes(len, ok, dP);
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    p[l] -= 0.5 * dP[l];
+                }
+            }
+        }
+    }
+
+    return accepted;
+}
+
+/*
+ *  f = kfAttitudeCreate(n)
+ *
+ *  Allocates a batch of n attitude filters with identity attitudes,
+ *  zero biases and zero covariances.  Returns NULL on failure.
+ */
+kfAttitudeBatch *kfAttitudeCreate(int n)
+{
+    kfAttitudeBatch *f;
+    int              stride;
+    int              i;
+    int              k;
+
+    if(n < 0) {
+        printf("ERROR: kfAttitudeCreate() received n = %d \n", n);
+        printf("The value of n should be n >= 0. \n");
+        return NULL;
+    }
+    f = (kfAttitudeBatch *)malloc(sizeof(kfAttitudeBatch));
+    if(f == NULL) {
+        return NULL;
+    }
+    f->mem = kfAlloc(n, 7, f->P, &stride);
+    if(f->mem == NULL) {
+        free(f);
+        return NULL;
+    }
+    f->n = n;
+    for(i = 1; i <= 4; i++) {
+        f->q[i] = f->mem + (size_t)(i - 1) * stride;
+    }
+    for(i = 1; i <= 3; i++) {
+        f->b[i] = f->mem + (size_t)(i + 3) * stride;
+    }
+    for(k = 0; k < n; k++) {
+        f->q[1][k] = 1.;
+    }
+
+    return f;
+}
+
+/*
+ *  kfAttitudeFree(f)
+ *
+ *  Releases a batch created by kfAttitudeCreate().
+ */
+void kfAttitudeFree(kfAttitudeBatch *f)
+{
+    if(f == NULL) {
+        return;
+    }
+    free(f->mem);
+    free(f);
+
+    return;
+}
+
+/*
+ *  kfAttitudeSet(f, k, q, b, P)
+ *
+ *  Initializes filter k with the Euler parameters q[1..4], the gyro
+ *  bias b[1..3] and the covariance P of the MRP error and the bias.
+ */
+void kfAttitudeSet(kfAttitudeBatch *f, int k, double *q, double *b, double P[7][7])
+{
+    int i;
+
+    for(i = 1; i <= 4; i++) {
+        f->q[i][k] = q[i];
+    }
+    for(i = 1; i <= 3; i++) {
+        f->b[i][k] = b[i];
+    }
+    kfStoreCov(P, k, f->P);
+
+    return;
+}
+
+/*
+ *  kfAttitudeGet(f, k, q, b, P)
+ *
+ *  Returns the attitude, gyro bias and covariance of filter k.
+ */
+void kfAttitudeGet(kfAttitudeBatch *f, int k, double *q, double *b, double P[7][7])
+{
+    int i;
+
+    for(i = 1; i <= 4; i++) {
+        q[i] = f->q[i][k];
+    }
+    for(i = 1; i <= 3; i++) {
+        b[i] = f->b[i][k];
+    }
+    kfLoadCov(f->P, k, P);
+
+    return;
+}
+
+/*
+ *  kfEPRateLanes(len, q, w, dq)
+ *
+ *  Euler parameter rates dq = 1/2 [B(q)] w of the len lanes of a
+ *  block, as dEP() computes them for a single attitude.
+ */
+static void kfEPRateLanes(int len, double q[4+1][KF_LANES], double w[3+1][KF_LANES],
+                          double dq[4+1][KF_LANES])
+{
+    int l;
+
+    #pragma omp simd
+    for(l = 0; l < len; l++) {
+        dq[1][l] = 0.5 * (-q[2][l] * w[1][l] - q[3][l] * w[2][l] - q[4][l] * w[3][l]);
+        dq[2][l] = 0.5 * (q[1][l] * w[1][l] - q[4][l] * w[2][l] + q[3][l] * w[3][l]);
+        dq[3][l] = 0.5 * (q[4][l] * w[1][l] + q[1][l] * w[2][l] - q[2][l] * w[3][l]);
+        dq[4][l] = 0.5 * (-q[3][l] * w[1][l] + q[2][l] * w[2][l] + q[1][l] * w[3][l]);
+    }
+
+    return;
+}
+
+/*
+ *  kfMEKFPredict(f, omega, dt, sigmaV, sigmaU)
+ *
+ *  Multiplicative EKF time update of all instances over dt seconds
+ *  with the gyro rates omega[1..3][k] (rad/s), held constant over
+ *  the step.  The Euler parameters are integrated with one RK4 step
+ *  of the rates of dEP() at the bias corrected rate.
+ */
+void kfMEKFPredict(kfAttitudeBatch *f, double *omega[3+1], double dt, double sigmaV, double sigmaU)
+{
+    double v2;
+    double u2;
+    int    k0;
+
+    v2 = sigmaV * sigmaV;
+    u2 = sigmaU * sigmaU;
+
+    #pragma omp parallel for schedule(static) if(f->n >= KF_PARALLEL_MIN)
+    for(k0 = 0; k0 < f->n; k0 += KF_LANES) {
+        double  Phi[7][7][KF_LANES];
+        double  w[3+1][KF_LANES];
+        double  q[4+1][KF_LANES];
+        double  qt[4+1][KF_LANES];
+        double  k1[4+1][KF_LANES];
+        double  k2[4+1][KF_LANES];
+        double  k3[4+1][KF_LANES];
+        double  k4[4+1][KF_LANES];
+        double  s;
+        double *P[6+1][6+1];
+        int     len;
+        int     i;
+        int     j;
+        int     l;
+
+        len = kfBlock(f->P, f->n, k0, P);
+        for(i = 1; i <= 3; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                w[i][l] = omega[i][k0 + l] - f->b[i][k0 + l];
+            }
+        }
+        for(i = 1; i <= 4; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                q[i][l] = f->q[i][k0 + l];
+            }
+        }
+        kfEPRateLanes(len, q, w, k1);
+        for(i = 1; i <= 4; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                qt[i][l] = q[i][l] + dt / 2. * k1[i][l];
+            }
+        }
+        kfEPRateLanes(len, qt, w, k2);
+        for(i = 1; i <= 4; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                qt[i][l] = q[i][l] + dt / 2. * k2[i][l];
+            }
+        }
+        kfEPRateLanes(len, qt, w, k3);
+        for(i = 1; i <= 4; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                qt[i][l] = q[i][l] + dt * k3[i][l];
+            }
+        }
+        kfEPRateLanes(len, qt, w, k4);
+        for(i = 1; i <= 4; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                q[i][l] += dt / 6. * (k1[i][l] + 2. * k2[i][l] + 2. * k3[i][l] + k4[i][l]);
+            }
+        }
+        #pragma omp simd private(s)
+        for(l = 0; l < len; l++) {
+            s = sqrt(q[1][l] * q[1][l] + q[2][l] * q[2][l] + q[3][l] * q[3][l] + q[4][l] * q[4][l]);
+            f->q[1][k0 + l] = q[1][l] / s;
+            f->q[2][k0 + l] = q[2][l] / s;
+            f->q[3][k0 + l] = q[3][l] / s;
+            f->q[4][k0 + l] = q[4][l] / s;
+        }
+
+        /* Phi = I + F dt + F^2 dt^2/2 with F = [-[w~] -I/4; 0 0] */
+        for(i = 1; i <= 6; i++) {
+            for(j = 1; j <= 6; j++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    Phi[i][j][l] = (i == j) ? 1. : 0.;
+                }
+            }
+        }
+        #pragma omp simd
+        for(l = 0; l < len; l++) {
+            /* [w~]^2 = w w^T - |w|^2 I */
+            Phi[1][1][l] -= (w[2][l] * w[2][l] + w[3][l] * w[3][l]) * dt * dt / 2.;
+            Phi[2][2][l] -= (w[1][l] * w[1][l] + w[3][l] * w[3][l]) * dt * dt / 2.;
+            Phi[3][3][l] -= (w[1][l] * w[1][l] + w[2][l] * w[2][l]) * dt * dt / 2.;
+            Phi[1][2][l]  = w[3][l] * dt + w[1][l] * w[2][l] * dt * dt / 2.;
+            Phi[1][3][l]  = -w[2][l] * dt + w[1][l] * w[3][l] * dt * dt / 2.;
+            Phi[2][1][l]  = -w[3][l] * dt + w[2][l] * w[1][l] * dt * dt / 2.;
+            Phi[2][3][l]  = w[1][l] * dt + w[2][l] * w[3][l] * dt * dt / 2.;
+            Phi[3][1][l]  = w[2][l] * dt + w[3][l] * w[1][l] * dt * dt / 2.;
+            Phi[3][2][l]  = -w[1][l] * dt + w[3][l] * w[2][l] * dt * dt / 2.;
+            Phi[1][4][l]  = -dt / 4.;
+            Phi[1][5][l]  = -w[3][l] * dt * dt / 8.;
+            Phi[1][6][l]  = w[2][l] * dt * dt / 8.;
+            Phi[2][4][l]  = w[3][l] * dt * dt / 8.;
+            Phi[2][5][l]  = -dt / 4.;
+            Phi[2][6][l]  = -w[1][l] * dt * dt / 8.;
+            Phi[3][4][l]  = -w[2][l] * dt * dt / 8.;
+            Phi[3][5][l]  = w[1][l] * dt * dt / 8.;
+            Phi[3][6][l]  = -dt / 4.;
+        }
+        kfSandwichLanes(len, Phi, P);
+        for(i = 1; i <= 3; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                P[i][i][l]         += (v2 * dt + u2 * dt * dt * dt / 3.) / 16.;
+                P[i][i + 3][l]     -= u2 * dt * dt / 8.;
+                P[i + 3][i + 3][l] += u2 * dt;
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ *  accepted = kfMEKFUpdate(f, bMeas, rN, sigma, gate)
+ *
+ *  Multiplicative EKF measurement update of every instance k with
+ *  the measured body frame unit vector bMeas[1..3][k] of the
+ *  inertial unit vector rN[1..3][k], with noise standard deviation
+ *  sigma on each axis.  Instances with bMeas[1][k] = NAN are
+ *  skipped.  Returns the number of accepted measurements.
+ */
+int kfMEKFUpdate(kfAttitudeBatch *f, double *bMeas[3+1], double *rN[3+1], double sigma, double gate)
+{
+    int accepted;
+    int k0;
+
+    accepted = 0;
+    #pragma omp parallel for schedule(static) reduction(+:accepted) if(f->n >= KF_PARALLEL_MIN)
+    for(k0 = 0; k0 < f->n; k0 += KF_LANES) {
+        double  H[3+1][6+1][KF_LANES];
+        double  y[3+1][KF_LANES];
+        double  dx[6+1][KF_LANES];
+        double  qn[4+1][KF_LANES];
+        double  ok[KF_LANES];
+        double  q1;
+        double  q2;
+        double  q3;
+        double  q4;
+        double  b1;
+        double  b2;
+        double  b3;
+        double  z1;
+        double  z2;
+        double  z3;
+        double  r1;
+        double  r2;
+        double  r3;
+        double  e1;
+        double  e2;
+        double  e3;
+        double  e4;
+        double  s;
+        double *P[6+1][6+1];
+        int     len;
+        int     i;
+        int     j;
+        int     l;
+
+        len = kfBlock(f->P, f->n, k0, P);
+        for(i = 1; i <= 3; i++) {
+            for(j = 1; j <= 6; j++) {
+                #pragma omp simd
+                for(l = 0; l < len; l++) {
+                    H[i][j][l] = 0.;
+                }
+            }
+        }
+        #pragma omp simd private(q1, q2, q3, q4, b1, b2, b3, z1, z2, z3, r1, r2, r3)
+        for(l = 0; l < len; l++) {
+            z1    = bMeas[1][k0 + l];
+            z2    = bMeas[2][k0 + l];
+            z3    = bMeas[3][k0 + l];
+            ok[l] = isnan(z1) ? 0. : 1.;
+            q1    = f->q[1][k0 + l];
+            q2    = f->q[2][k0 + l];
+            q3    = f->q[3][k0 + l];
+            q4    = f->q[4][k0 + l];
+            r1    = rN[1][k0 + l];
+            r2    = rN[2][k0 + l];
+            r3    = rN[3][k0 + l];
+
+            /* bRef = [C(q)] rN with [C(q)] as in EP2C() */
+            b1 = (q1 * q1 + q2 * q2 - q3 * q3 - q4 * q4) * r1 + 2. * (q2 * q3 + q1 * q4) * r2
+                 + 2. * (q2 * q4 - q1 * q3) * r3;
+            b2 = 2. * (q2 * q3 - q1 * q4) * r1 + (q1 * q1 - q2 * q2 + q3 * q3 - q4 * q4) * r2
+                 + 2. * (q3 * q4 + q1 * q2) * r3;
+            b3 = 2. * (q2 * q4 + q1 * q3) * r1 + 2. * (q3 * q4 - q1 * q2) * r2
+                 + (q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4) * r3;
+
+            /* b = [C(dsigma)] bRef = bRef + 4 [bRef~] dsigma */
+            y[1][l]    = (z1 - b1) / sigma;
+            y[2][l]    = (z2 - b2) / sigma;
+            y[3][l]    = (z3 - b3) / sigma;
+            H[1][2][l] = -4. * b3 / sigma;
+            H[1][3][l] = 4. * b2 / sigma;
+            H[2][1][l] = 4. * b3 / sigma;
+            H[2][3][l] = -4. * b1 / sigma;
+            H[3][1][l] = -4. * b2 / sigma;
+            H[3][2][l] = 4. * b1 / sigma;
+        }
+        for(i = 1; i <= 3; i++) {
+            kfMaskLanes(len, ok, y[i]);
+            for(j = 1; j <= 3; j++) {
+                kfMaskLanes(len, ok, H[i][j]);
+            }
+        }
+        accepted += kfUpdateLanes(len, H, y, gate, ok, P, dx);
+
+        /* fold the error into the reference as MRP2EP() and addEP() do */
+        #pragma omp simd private(q1, q2, q3, q4, e1, e2, e3, e4, s)
+        for(l = 0; l < len; l++) {
+            q1 = f->q[1][k0 + l];
+            q2 = f->q[2][k0 + l];
+            q3 = f->q[3][k0 + l];
+            q4 = f->q[4][k0 + l];
+            s  = 1. + dx[1][l] * dx[1][l] + dx[2][l] * dx[2][l] + dx[3][l] * dx[3][l];
+            e1 = (2. - s) / s;
+            e2 = 2. * dx[1][l] / s;
+            e3 = 2. * dx[2][l] / s;
+            e4 = 2. * dx[3][l] / s;
+            qn[1][l] = e1 * q1 - e2 * q2 - e3 * q3 - e4 * q4;
+            qn[2][l] = e2 * q1 + e1 * q2 + e4 * q3 - e3 * q4;
+            qn[3][l] = e3 * q1 - e4 * q2 + e1 * q3 + e2 * q4;
+            qn[4][l] = e4 * q1 + e3 * q2 - e2 * q3 + e1 * q4;
+            s        = sqrt(qn[1][l] * qn[1][l] + qn[2][l] * qn[2][l] + qn[3][l] * qn[3][l]
+                            + qn[4][l] * qn[4][l]);
+            qn[1][l] /= s;
+            qn[2][l] /= s;
+            qn[3][l] /= s;
+            qn[4][l] /= s;
+        }
+        for(i = 1; i <= 4; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                f->q[i][k0 + l] = (ok[l] != 0.) ? qn[i][l] : f->q[i][k0 + l];
+            }
+        }
+        for(i = 1; i <= 3; i++) {
+            #pragma omp simd
+            for(l = 0; l < len; l++) {
+                f->b[i][k0 + l] += dx[i + 3][l];
+            }
+        }
+    }
+
+    return accepted;
+}
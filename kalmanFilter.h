@@ -0,0 +1,73 @@
+/*
+ *  kalmanFilter.h
+ *  OrbitalMotion
+ *
+ *  Sequential filters run as batches of independent instances.  The
+ *  orbit filters estimate the inertial state [r v] from the
+ *  observations of orbitDetermination.h, either as an extended
+ *  Kalman filter propagating the state transition matrix or as an
+ *  unscented Kalman filter propagating 13 sigma points, both with
+ *  the batch force model.  The attitude filter is a multiplicative
+ *  extended Kalman filter with an Euler parameter reference, an MRP
+ *  error state and a gyro bias, driven by rate gyro data and updated
+ *  with unit vector measurements.  States and covariances are kept
+ *  as SoA arrays x[i][k] and P[i][j][k] over the instances k, where
+ *  P[i][j] and P[j][i] share one array.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "orbitDetermination.h"
+#include "RigidBodyKinematics.h"
+
+#ifndef _KALMAN_FILTER_H_
+#define _KALMAN_FILTER_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define KF_PARALLEL_MIN     4096    /* smallest batch updated with several threads */
+
+    typedef struct kfOrbitBatchStruct {
+        int     n;                      /* number of filter instances */
+        double *x[6+1];                 /* x[i][k], state [r v] (km, km/s) */
+        double *P[6+1][6+1];            /* P[i][j][k], state covariance */
+        double *CdAm;                   /* drag parameter of each instance */
+        double *Am;                     /* area to mass ratio of each instance */
+        double *mem;                    /* block holding all the arrays */
+    } kfOrbitBatch;
+
+    typedef struct kfAttitudeBatchStruct {
+        int     n;                      /* number of filter instances */
+        double *q[4+1];                 /* q[i][k], reference Euler parameters of B relative to N */
+        double *b[3+1];                 /* b[i][k], gyro bias (rad/s) */
+        double *P[6+1][6+1];            /* P[i][j][k], covariance of the MRP error and the bias */
+        double *mem;                    /* block holding all the arrays */
+    } kfAttitudeBatch;
+
+    kfOrbitBatch    *kfOrbitCreate(int n);
+    void             kfOrbitFree(kfOrbitBatch *f);
+    void             kfOrbitSet(kfOrbitBatch *f, int k, double *x, double P[7][7], double CdAm, double Am);
+    void             kfOrbitGet(kfOrbitBatch *f, int k, double *x, double P[7][7]);
+    void             kfEKFPredict(kfOrbitBatch *f, batchForceModel *fm, double t, double dt, double q);
+    int              kfEKFUpdate(kfOrbitBatch *f, odObservation *obs, double gate);
+    int              kfUKFPredict(kfOrbitBatch *f, batchForceModel *fm, double t, double dt, double q);
+    int              kfUKFUpdate(kfOrbitBatch *f, odObservation *obs, double gate);
+
+    kfAttitudeBatch *kfAttitudeCreate(int n);
+    void             kfAttitudeFree(kfAttitudeBatch *f);
+    void             kfAttitudeSet(kfAttitudeBatch *f, int k, double *q, double *b, double P[7][7]);
+    void             kfAttitudeGet(kfAttitudeBatch *f, int k, double *q, double *b, double P[7][7]);
+    void             kfMEKFPredict(kfAttitudeBatch *f, double *omega[3+1], double dt, double sigmaV,
+                                   double sigmaU);
+    int              kfMEKFUpdate(kfAttitudeBatch *f, double *bMeas[3+1], double *rN[3+1], double sigma,
+                                  double gate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
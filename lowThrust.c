@@ -0,0 +1,472 @@
+/*
+ *  lowThrust.c
+ *  OrbitalMotion
+ *
+ *  The averaged rates are
+ *
+ *      dx/dt = 1/P Int_0^2pi B(L) u(L) aT dt/dL dL,   dt/dL = p^2 / (q^2 sqrt(mu p))
+ *
+ *  with P the orbit period, B the Gauss matrix of the equinoctial
+ *  elements and u the thrust direction in the radial, transverse
+ *  and normal frame.  The integral uses the trapezoidal rule on
+ *  LT_NODES nodes, which is spectrally accurate for the smooth
+ *  periodic integrand.  With eclipses each cell is weighted by its
+ *  sunlit fraction, located by linear interpolation of a continuous
+ *  shadow function, so the shadow boundaries cost no extra nodes.
+ *
+ *  References:
+ *  T. N. Edelbaum, "Propulsion Requirements for Controllable
+ *  Satellites", ARS Journal 31, 1961, pp. 1079-1089.
+ *  A. E. Petropoulos, "Refinements to the Q-law for Low-Thrust
+ *  Orbit Transfers", AAS 05-162, 2005.
+ *  G. I. Varga and J. M. S. Perez, "Many-Revolution Low-Thrust Orbit
+ *  Transfer Computation Using Equinoctial Q-Law Including J2 and
+ *  Eclipse Effects", AIAA 2016-5334, 2016.
+ */
+
+#include <string.h>
+#include "lowThrust.h"
+
+/*
+ *  elem2MEE(elem, mee)
+ *
+ *  Maps the classical elements into the modified equinoctial
+ *  elements mee = [p f g h k L].
+ */
+void elem2MEE(classicElements *elem, double *mee)
+{
+    double t;
+
+    t      = tan(elem->i / 2.);
+    mee[1] = elem->a * (1. - elem->e * elem->e);
+    mee[2] = elem->e * cos(elem->omega + elem->Omega);
+    mee[3] = elem->e * sin(elem->omega + elem->Omega);
+    mee[4] = t * cos(elem->Omega);
+    mee[5] = t * sin(elem->Omega);
+    mee[6] = elem->Omega + elem->omega + elem->anom;
+
+    return;
+}
+
+/*
+ *  MEE2elem(mee, elem)
+ *
+ *  Maps the modified equinoctial elements mee = [p f g h k L] into
+ *  the classical elements.
+ */
+void MEE2elem(double *mee, classicElements *elem)
+{
+    double e;
+    double w;
+
+    e            = sqrt(mee[2] * mee[2] + mee[3] * mee[3]);
+    w            = atan2(mee[3], mee[2]);
+    elem->a      = mee[1] / (1. - e * e);
+    elem->e      = e;
+    elem->i      = 2. * atan(sqrt(mee[4] * mee[4] + mee[5] * mee[5]));
+    elem->Omega  = atan2(mee[5], mee[4]);
+    elem->omega  = w - elem->Omega;
+    elem->anom   = mee[6] - w;
+
+    return;
+}
+
+/*
+ *  ltSunDirection(t, s)
+ *
+ *  Returns the unit vector s from the Earth to the Sun in the
+ *  equatorial frame at t days past J2000, from the low precision
+ *  solar coordinates of the Astronomical Almanac (0.01 deg).
+ */
+void ltSunDirection(double t, double *s)
+{
+    double L;
+    double g;
+    double lambda;
+    double eps;
+
+    L      = (280.460 + 0.9856474 * t) * M_PI / 180.;
+    g      = (357.528 + 0.9856003 * t) * M_PI / 180.;
+    lambda = L + (1.915 * sin(g) + 0.020 * sin(2. * g)) * M_PI / 180.;
+    eps    = (23.439 - 0.0000004 * t) * M_PI / 180.;
+    set3(cos(lambda), cos(eps) * sin(lambda), sin(eps) * sin(lambda), s);
+
+    return;
+}
+
+/*
+ *  ltEdelbaum(param, x, beta, dv)
+ *
+ *  Returns the Edelbaum yaw angle beta for the remaining transfer
+ *  from the circular orbit of radius p and inclination i to the
+ *  target, and the remaining delta-v dv (km/s).
+ */
+static void ltEdelbaum(ltParam *param, double *x, double *beta, double *dv)
+{
+    double v0;
+    double v1;
+    double di;
+    double c;
+
+    v0 = sqrt(param->mu / x[1]);
+    v1 = sqrt(param->mu / param->target[1]);
+    di = 2. * atan(sqrt(param->target[4] * param->target[4] + param->target[5] * param->target[5]))
+         - 2. * atan(sqrt(x[4] * x[4] + x[5] * x[5]));
+    c  = cos(M_PI / 2. * di);
+    *dv   = sqrt(fmax(0., v0 * v0 - 2. * v0 * v1 * c + v1 * v1));
+    *beta = atan2(sin(M_PI / 2. * fabs(di)), v0 / v1 - c);
+    if(di < 0.) {
+        *beta = -*beta;
+    }
+
+    return;
+}
+
+/*
+ *  ltQMaxRates(param, x, d)
+ *
+ *  Returns the approximate maximum rates d[1..5] of the equinoctial
+ *  elements over the thrust direction and the true longitude, per
+ *  unit thrust acceleration.
+ */
+static void ltQMaxRates(ltParam *param, double *x, double *d)
+{
+    double w;
+    double e;
+    double s2;
+
+    w  = sqrt(x[1] / param->mu);
+    e  = sqrt(x[2] * x[2] + x[3] * x[3]);
+    s2 = 1. + x[4] * x[4] + x[5] * x[5];
+    d[1] = 2. * x[1] * w / (1. - e);
+    d[2] = 2. * w;
+    d[3] = 2. * w;
+    d[4] = 0.5 * w * s2 / (sqrt(1. - x[3] * x[3]) + x[2]);
+    d[5] = 0.5 * w * s2 / (sqrt(1. - x[2] * x[2]) + x[3]);
+
+    return;
+}
+
+/*
+ *  Q = ltRemaining(param, x)
+ *
+ *  Returns the distance to the target: the Q-law proximity quotient
+ *  Q, or the remaining Edelbaum delta-v (km/s).
+ */
+double ltRemaining(ltParam *param, double *x)
+{
+    double d[5+1];
+    double Q;
+    double beta;
+    int    i;
+
+    if(param->law == LT_EDELBAUM) {
+        ltEdelbaum(param, x, &beta, &Q);
+        return Q;
+    }
+    ltQMaxRates(param, x, d);
+    Q = 0.;
+    for(i = 1; i <= 5; i++) {
+        Q += param->weight[i] * (x[i] - param->target[i]) * (x[i] - param->target[i]) / (d[i] * d[i]);
+    }
+
+    return Q;
+}
+
+/*
+ *  ltAveragedRates(param, t, x, dx)
+ *
+ *  Returns the orbit-averaged rates dx of the state x = [p f g h k m]
+ *  at the time t (sec past param->t0).
+ */
+void ltAveragedRates(ltParam *param, double t, double *x, double *dx)
+{
+    double Bm[LT_NODES][5+1][3+1];
+    double u[LT_NODES][3+1];
+    double tau[LT_NODES];
+    double sh[LT_NODES];
+    double on[LT_NODES];
+    double D[LT_NODES];
+    double dQ[5+1];
+    double dmax[5+1];
+    double sun[3+1];
+    double I[6+1];
+    double mu;
+    double p;
+    double a;
+    double e2;
+    double w;
+    double s2;
+    double alpha2;
+    double P;
+    double aT;
+    double beta;
+    double dv;
+    double Dmin;
+    double Dmax;
+    double Om;
+    double n;
+    double ci;
+    double dOm;
+    double dw;
+    double frac;
+    double dL;
+    int    i;
+    int    j;
+    int    c;
+
+    mu     = param->mu;
+    p      = x[1];
+    e2     = x[2] * x[2] + x[3] * x[3];
+    a      = p / (1. - e2);
+    w      = sqrt(p / mu);
+    s2     = 1. + x[4] * x[4] + x[5] * x[5];
+    alpha2 = x[4] * x[4] - x[5] * x[5];
+    P      = 2. * M_PI * sqrt(a * a * a / mu);
+    aT     = param->thrust / x[6] / 1000.;
+    dL     = 2. * M_PI / LT_NODES;
+    Om     = atan2(x[5], x[4]);
+    beta   = 0.;
+    if(param->law == LT_EDELBAUM) {
+        ltEdelbaum(param, x, &beta, &dv);
+    } else {
+        ltQMaxRates(param, x, dmax);
+        for(i = 1; i <= 5; i++) {
+            dQ[i] = 2. * param->weight[i] * (x[i] - param->target[i]) / (dmax[i] * dmax[i]);
+        }
+    }
+    if(param->eclipse) {
+        ltSunDirection(param->t0 + t / 86400., sun);
+    }
+
+    Dmin = Dmax = 0.;
+    for(j = 0; j < LT_NODES; j++) {
+        double L;
+        double cL;
+        double sL;
+        double q;
+        double r;
+        double z;
+        double rv[3+1];
+        double rs;
+        double rp;
+
+        L  = j * dL;
+        cL = cos(L);
+        sL = sin(L);
+        q  = 1. + x[2] * cL + x[3] * sL;
+        r  = p / q;
+        z  = x[4] * sL - x[5] * cL;
+        tau[j] = p * p / (q * q * sqrt(mu * p));
+
+        memset(Bm[j], 0, sizeof(Bm[j]));
+        Bm[j][1][2] = 2. * p * w / q;
+        Bm[j][2][1] = w * sL;
+        Bm[j][2][2] = w * ((q + 1.) * cL + x[2]) / q;
+        Bm[j][2][3] = -w * z * x[3] / q;
+        Bm[j][3][1] = -w * cL;
+        Bm[j][3][2] = w * ((q + 1.) * sL + x[3]) / q;
+        Bm[j][3][3] = w * z * x[2] / q;
+        Bm[j][4][3] = w * s2 * cL / (2. * q);
+        Bm[j][5][3] = w * s2 * sL / (2. * q);
+
+        if(param->law == LT_EDELBAUM) {
+            /* the argument of latitude is L - Omega */
+            set3(0., cos(beta), (cos(L - Om) >= 0. ? 1. : -1.) * sin(beta), u[j]);
+            D[j] = 1.;
+        } else {
+            for(c = 1; c <= 3; c++) {
+                u[j][c] = 0.;
+                for(i = 1; i <= 5; i++) {
+                    u[j][c] -= dQ[i] * Bm[j][i][c];
+                }
+            }
+            D[j] = norm(u[j]);
+            if(D[j] > 0.) {
+                mult(1. / D[j], u[j], u[j]);
+            }
+            if((j == 0) || (D[j] < Dmin)) {
+                Dmin = D[j];
+            }
+            if((j == 0) || (D[j] > Dmax)) {
+                Dmax = D[j];
+            }
+        }
+
+        sh[j] = 1.;
+        if(param->eclipse) {
+            rv[1] = r / s2 * (cL + alpha2 * cL + 2. * x[4] * x[5] * sL);
+            rv[2] = r / s2 * (sL - alpha2 * sL + 2. * x[4] * x[5] * cL);
+            rv[3] = 2. * r / s2 * z;
+            rs    = dot(rv, sun);
+            rp    = sqrt(fmax(0., r * r - rs * rs));
+            sh[j] = fmax(rs, rp - param->req) / param->req;
+        }
+    }
+
+    /* Q-law coasting on the least effective part of the orbit */
+    for(j = 0; j < LT_NODES; j++) {
+        on[j] = 1.;
+        if((param->law == LT_QLAW) && (Dmax > Dmin)
+           && ((D[j] - Dmin) / (Dmax - Dmin) < param->etaCut)) {
+            on[j] = 0.;
+        }
+    }
+
+    for(i = 1; i <= 6; i++) {
+        I[i] = 0.;
+    }
+    for(c = 0; c < LT_NODES; c++) {
+        int    k;
+        double s0;
+        double s1;
+
+        k  = (c + 1) % LT_NODES;
+        s0 = sh[c];
+        s1 = sh[k];
+        if((s0 > 0.) && (s1 > 0.)) {
+            frac = 1.;
+        } else if((s0 <= 0.) && (s1 <= 0.)) {
+            frac = 0.;
+        } else if(s0 > 0.) {
+            frac = s0 / (s0 - s1);
+        } else {
+            frac = s1 / (s1 - s0);
+        }
+        if(frac == 0.) {
+            continue;
+        }
+        for(i = 1; i <= 5; i++) {
+            I[i] += frac * dL / 2. * (on[c] * tau[c] * dot(Bm[c][i], u[c]) + on[k] * tau[k] * dot(Bm[k][i], u[k]));
+        }
+        I[6] += frac * dL / 2. * (on[c] * tau[c] + on[k] * tau[k]);
+    }
+    for(i = 1; i <= 5; i++) {
+        dx[i] = aT * I[i] / P;
+    }
+    dx[6] = -param->thrust / (param->Isp * LT_G0) * I[6] / P;
+
+    /* secular J2 drift of the node and the longitude of periapsis */
+    if(param->J2 != 0.) {
+        n   = sqrt(mu / (a * a * a));
+        ci  = (2. - s2) / s2;
+        dOm = -1.5 * n * param->J2 * param->req * param->req / (p * p) * ci;
+        dw  = 0.75 * n * param->J2 * param->req * param->req / (p * p) * (5. * ci * ci - 1.);
+        dx[2] -= x[3] * (dOm + dw);
+        dx[3] += x[2] * (dOm + dw);
+        dx[4] -= x[5] * dOm;
+        dx[5] += x[4] * dOm;
+    }
+
+    return;
+}
+
+/*
+ *  steps = ltPropagate(param, x0, tf, revs, xf, t)
+ *
+ *  Propagates the averaged state x0 with fourth order Runge-Kutta
+ *  steps of revs orbit periods for at most tf seconds, stopping
+ *  early once ltRemaining() falls below param->tol or the mass
+ *  reaches param->mDry.  Edelbaum steps are shortened to the time
+ *  needed for the remaining delta-v.  Returns the
+ *  number of steps, the final state xf and its time t.  xf may
+ *  alias x0.  Returns -1 with xf and t set to NAN if param->tol is
+ *  not positive.
+ */
+int ltPropagate(ltParam *param, double *x0, double tf, double revs, double *xf, double *t)
+{
+    double x[6+1];
+    double y[6+1];
+    double k1[6+1];
+    double k2[6+1];
+    double k3[6+1];
+    double k4[6+1];
+    double a;
+    double h;
+    double Q;
+    double tt;
+    int    steps;
+    int    i;
+
+    if(param->tol <= 0.) {
+        printf("ERROR: ltPropagate() received tol = %g \n", param->tol);
+        printf("The value of tol should be tol > 0. \n");
+        for(i = 1; i <= 6; i++) {
+            xf[i] = NAN;
+        }
+        *t = NAN;
+        return -1;
+    }
+    for(i = 1; i <= 6; i++) {
+        x[i] = x0[i];
+    }
+    tt = 0.;
+    for(steps = 0; steps < LT_MAX_STEPS; steps++) {
+        Q = ltRemaining(param, x);
+        if((tt >= tf) || (Q < param->tol) || (x[6] - param->mDry < 1e-9 * x0[6])) {
+            break;
+        }
+        a = x[1] / (1. - x[2] * x[2] - x[3] * x[3]);
+        h = fmin(revs * 2. * M_PI * sqrt(a * a * a / param->mu), tf - tt);
+        h = fmin(h, (x[6] - param->mDry) * param->Isp * LT_G0 / param->thrust);
+        if(param->law == LT_EDELBAUM) {
+            /* do not overshoot the remaining delta-v */
+            h = fmin(h, Q * x[6] * 1000. / param->thrust);
+        }
+
+        ltAveragedRates(param, tt, x, k1);
+        for(i = 1; i <= 6; i++) {
+            y[i] = x[i] + h / 2. * k1[i];
+        }
+        ltAveragedRates(param, tt + h / 2., y, k2);
+        for(i = 1; i <= 6; i++) {
+            y[i] = x[i] + h / 2. * k2[i];
+        }
+        ltAveragedRates(param, tt + h / 2., y, k3);
+        for(i = 1; i <= 6; i++) {
+            y[i] = x[i] + h * k3[i];
+        }
+        ltAveragedRates(param, tt + h, y, k4);
+        for(i = 1; i <= 6; i++) {
+            x[i] += h / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+        }
+        tt += h;
+    }
+
+    for(i = 1; i <= 6; i++) {
+        xf[i] = x[i];
+    }
+    *t = tt;
+
+    return steps;
+}
+
+/*
+ *  batchLowThrust(param, n, x0, tf, revs, xf, t)
+ *
+ *  Propagates the n states x0[1..6][k] with the parameters param[k]
+ *  as in ltPropagate(), returning xf[1..6][k] and the final times
+ *  t[k].  The transfers run in parallel with dynamic scheduling
+ *  since their durations differ.  xf may alias x0.
+ */
+void batchLowThrust(ltParam *param, int n, double *x0[6+1], double tf, double revs,
+                    double *xf[6+1], double *t)
+{
+    int k;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(k = 0; k < n; k++) {
+        double x[6+1];
+        int    i;
+
+        for(i = 1; i <= 6; i++) {
+            x[i] = x0[i][k];
+        }
+        ltPropagate(&param[k], x, tf, revs, x, &t[k]);
+        for(i = 1; i <= 6; i++) {
+            xf[i][k] = x[i];
+        }
+    }
+
+    return;
+}
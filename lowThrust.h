@@ -0,0 +1,70 @@
+/*
+ *  lowThrust.h
+ *  OrbitalMotion
+ *
+ *  Orbit-averaged low-thrust transfer propagation in modified
+ *  equinoctial elements.  The Gauss variational equations are
+ *  averaged over one revolution by quadrature in true longitude, so
+ *  the propagator takes steps of whole revolutions.  Thrust follows
+ *  a closed loop Edelbaum steering law (near circular transfers with
+ *  plane change) or the Q-law, is cut off in the cylindrical shadow
+ *  of the central body, and the secular J2 drift of the node and
+ *  periapsis is added.  The averaged state is
+ *
+ *      x = [p f g h k m]
+ *
+ *  with the semi-latus rectum p (km) and the mass m (kg).  The batch
+ *  routine propagates SoA states x[1..6][k], each with its own
+ *  parameter set, for design sweeps.
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "orbitalMotion.h"
+
+#ifndef _LOW_THRUST_H_
+#define _LOW_THRUST_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define LT_EDELBAUM         1       /* tangential thrust with Edelbaum yaw, switched at the nodes */
+    #define LT_QLAW             2       /* Petropoulos Q-law in equinoctial elements */
+
+    #define LT_NODES            64      /* quadrature nodes per revolution */
+    #define LT_G0               9.80665 /* standard gravity (m/s^2) */
+    #define LT_MAX_STEPS        1000000
+
+    typedef struct ltParamStruct {
+        double mu;                      /* gravitational constant (km^3/s^2) */
+        double req;                     /* body radius (km) for J2 and the shadow */
+        double J2;                      /* 0 to neglect J2 */
+        double thrust;                  /* thrust (N) */
+        double Isp;                     /* specific impulse (s) */
+        double mDry;                    /* mass (kg) at which the propellant is exhausted */
+        int    law;                     /* LT_EDELBAUM or LT_QLAW */
+        double target[5+1];             /* target p, f, g, h, k */
+        double weight[5+1];             /* Q-law weights, 0 for free elements */
+        double etaCut;                  /* Q-law relative effectiveness below which to coast */
+        double tol;                     /* stop once ltRemaining() < tol */
+        int    eclipse;                 /* cut the thrust in the shadow */
+        double t0;                      /* epoch (days past J2000) of the Earth-Sun direction */
+    } ltParam;
+
+    void    elem2MEE(classicElements *elem, double *mee);
+    void    MEE2elem(double *mee, classicElements *elem);
+    void    ltSunDirection(double t, double *s);
+    double  ltRemaining(ltParam *param, double *x);
+    void    ltAveragedRates(ltParam *param, double t, double *x, double *dx);
+    int     ltPropagate(ltParam *param, double *x0, double tf, double revs, double *xf, double *t);
+
+    void    batchLowThrust(ltParam *param, int n, double *x0[6+1], double tf, double revs,
+                           double *xf[6+1], double *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ *  memArena.c
+ *  OrbitalMotion
+ *
+ *  Bump-pointer arena allocator with per-thread arena sets and a
+ *  fixed-size object pool on top.  Allocations are only returned
+ *  to the arena in bulk, by memArenaReset(), which rewinds all
+ *  blocks but keeps them (and their NUMA page placement) for the
+ *  next run, or by memArenaFree(), which returns them to the
+ *  system.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <string.h>
+#include "memArena.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static size_t memArenaRound(size_t bytes)
+{
+    return (bytes + MEM_ARENA_ALIGN - 1) & ~(size_t)(MEM_ARENA_ALIGN - 1);
+}
+
+/*
+ *  memArenaInit(arena, blockSize)
+ *
+ *  Sets up an empty arena that obtains memory from the system in
+ *  blocks of blockSize bytes (MEM_ARENA_BLOCK_SIZE if 0).  No
+ *  memory is reserved until the first allocation.
+ */
+void memArenaInit(memArena *arena, size_t blockSize)
+{
+    memset(arena, 0, sizeof(memArena));
+    arena->blockSize = blockSize > 0 ? memArenaRound(blockSize) : MEM_ARENA_BLOCK_SIZE;
+
+    return;
+}
+
+/*
+ *  ptr = memArenaAlloc(arena, bytes)
+ *
+ *  Returns MEM_ARENA_ALIGN aligned memory for bytes bytes, or NULL
+ *  if no more memory could be obtained.  The memory is not zeroed.
+ */
+void *memArenaAlloc(memArena *arena, size_t bytes)
+{
+    memArenaBlock *block;
+    memArenaBlock *last;
+    size_t         size;
+    void          *mem;
+    char          *ptr;
+
+    bytes = memArenaRound(bytes > 0 ? bytes : 1);
+
+    /* use the current block, or any rewound block following it */
+    block = arena->cur;
+    while((block != NULL) && (block->size - block->used < bytes)) {
+        block = block->next;
+    }
+
+    if(block == NULL) {
+        size = bytes > arena->blockSize ? bytes : arena->blockSize;
+        mem  = NULL;
+        if(posix_memalign(&mem, MEM_ARENA_ALIGN, sizeof(memArenaBlock) + size) != 0) {
+            printf("ERROR: memArenaAlloc() could not reserve %lu bytes \n", (unsigned long)size);
+            return NULL;
+        }
+        block       = (memArenaBlock *)mem;
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+
+        /* append to the end of the block list */
+        if(arena->head == NULL) {
+            arena->head = block;
+        } else {
+            last = arena->cur != NULL ? arena->cur : arena->head;
+            while(last->next != NULL) {
+                last = last->next;
+            }
+            last->next = block;
+        }
+        arena->stats.bytesReserved += size;
+        arena->stats.numBlocks++;
+    }
+
+    arena->cur   = block;
+    ptr          = (char *)(block + 1) + block->used;
+    block->used += bytes;
+
+    arena->stats.numAllocs++;
+    arena->stats.bytesUsed += bytes;
+    if(arena->stats.bytesUsed > arena->stats.peakUsed) {
+        arena->stats.peakUsed = arena->stats.bytesUsed;
+    }
+
+    return ptr;
+}
+
+/*
+ *  memArenaReset(arena)
+ *
+ *  Releases all allocations of the arena at once.  The blocks are
+ *  kept and reused by the following allocations.
+ */
+void memArenaReset(memArena *arena)
+{
+    memArenaBlock *block;
+
+    for(block = arena->head; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+    arena->cur             = arena->head;
+    arena->stats.numAllocs = 0;
+    arena->stats.bytesUsed = 0;
+    arena->stats.numResets++;
+
+    return;
+}
+
+/*
+ *  memArenaFree(arena)
+ *
+ *  Returns all blocks of the arena to the system.  The arena can
+ *  be used again afterwards.
+ */
+void memArenaFree(memArena *arena)
+{
+    memArenaBlock *block;
+    memArenaBlock *next;
+
+    for(block = arena->head; block != NULL; block = next) {
+        next = block->next;
+        free(block);
+    }
+    memArenaInit(arena, arena->blockSize);
+
+    return;
+}
+
+/*
+ *  memArenaGetStats(arena, stats)
+ *
+ *  Returns the allocation statistics of an arena.
+ */
+void memArenaGetStats(memArena *arena, memArenaStatistics *stats)
+{
+    *stats = arena->stats;
+
+    return;
+}
+
+void memArenaPrintStats(const char *str, memArenaStatistics *stats)
+{
+    printf("%s: %lu allocs, %lu bytes used (peak %lu), %lu bytes in %lu blocks, %lu resets\n", str,
+           (unsigned long)stats->numAllocs, (unsigned long)stats->bytesUsed,
+           (unsigned long)stats->peakUsed, (unsigned long)stats->bytesReserved,
+           (unsigned long)stats->numBlocks, (unsigned long)stats->numResets);
+
+    return;
+}
+
+/*
+ *  memPoolInit(pool, arena, objSize)
+ *
+ *  Sets up a pool of fixed-size objects of objSize bytes carved
+ *  from arena.  Released objects are recycled by later
+ *  memPoolAlloc() calls; all objects go away with the arena.
+ */
+void memPoolInit(memPool *pool, memArena *arena, size_t objSize)
+{
+    pool->arena    = arena;
+    pool->objSize  = objSize < sizeof(void *) ? sizeof(void *) : objSize;
+    pool->freeList = NULL;
+    pool->numLive  = 0;
+
+    return;
+}
+
+void *memPoolAlloc(memPool *pool)
+{
+    void *obj;
+
+    if(pool->freeList != NULL) {
+        obj = pool->freeList;
+        pool->freeList = *(void **)obj;
+    } else {
+        obj = memArenaAlloc(pool->arena, pool->objSize);
+        if(obj == NULL) {
+            return NULL;
+        }
+    }
+    pool->numLive++;
+
+    return obj;
+}
+
+void memPoolRelease(memPool *pool, void *obj)
+{
+    if(obj == NULL) {
+        return;
+    }
+    *(void **)obj  = pool->freeList;
+    pool->freeList = obj;
+    pool->numLive--;
+
+    return;
+}
+
+/*
+ *  set = memArenaSetCreate(num, blockSize)
+ *
+ *  Creates num independent arenas, one per worker thread.  If
+ *  num <= 0 one arena per OpenMP thread is created.
+ */
+memArenaSet *memArenaSetCreate(int num, size_t blockSize)
+{
+    memArenaSet *set;
+    void        *mem;
+    int          i;
+
+    if(num <= 0) {
+#ifdef _OPENMP
+        num = omp_get_max_threads();
+#else
+        num = 1;
+#endif
+    }
+
+    set = (memArenaSet *)malloc(sizeof(memArenaSet));
+    mem = NULL;
+    if((set == NULL) || (posix_memalign(&mem, MEM_ARENA_ALIGN, num * sizeof(memArena)) != 0)) {
+        free(set);
+        return NULL;
+    }
+    set->num   = num;
+    set->arena = (memArena *)mem;
+    for(i = 0; i < num; i++) {
+        memArenaInit(&set->arena[i], blockSize);
+    }
+
+    return set;
+}
+
+/*
+ *  arena = memArenaLocal(set)
+ *
+ *  Returns the arena of the calling OpenMP thread.
+ */
+memArena *memArenaLocal(memArenaSet *set)
+{
+#ifdef _OPENMP
+    return &set->arena[omp_get_thread_num() % set->num];
+#else
+    return &set->arena[0];
+#endif
+}
+
+void memArenaSetReset(memArenaSet *set)
+{
+    int i;
+
+    for(i = 0; i < set->num; i++) {
+        memArenaReset(&set->arena[i]);
+    }
+
+    return;
+}
+
+void memArenaSetFree(memArenaSet *set)
+{
+    int i;
+
+    if(set == NULL) {
+        return;
+    }
+    for(i = 0; i < set->num; i++) {
+        memArenaFree(&set->arena[i]);
+    }
+    free(set->arena);
+    free(set);
+
+    return;
+}
+
+/*
+ *  memArenaSetGetStats(set, stats)
+ *
+ *  Returns the allocation statistics summed over all arenas of
+ *  a set.  The peak is the sum of the per-thread peaks.
+ */
+void memArenaSetGetStats(memArenaSet *set, memArenaStatistics *stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(memArenaStatistics));
+    for(i = 0; i < set->num; i++) {
+        stats->numAllocs     += set->arena[i].stats.numAllocs;
+        stats->bytesUsed     += set->arena[i].stats.bytesUsed;
+        stats->peakUsed      += set->arena[i].stats.peakUsed;
+        stats->bytesReserved += set->arena[i].stats.bytesReserved;
+        stats->numBlocks     += set->arena[i].stats.numBlocks;
+        if(set->arena[i].stats.numResets > stats->numResets) {
+            stats->numResets = set->arena[i].stats.numResets;
+        }
+    }
+
+    return;
+}
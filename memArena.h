@@ -0,0 +1,83 @@
+/*
+ *  memArena.h
+ *  OrbitalMotion
+ *
+ *  Arena and fixed-size pool allocators for simulation state,
+ *  step histories and output buffers.  Memory is carved out of
+ *  large blocks and released in bulk once per run.  An arena is
+ *  not thread safe; threaded code uses one arena per thread via
+ *  a memArenaSet.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _MEM_ARENA_H_
+#define _MEM_ARENA_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define MEM_ARENA_ALIGN         64
+    #define MEM_ARENA_BLOCK_SIZE    (4 << 20)
+
+    typedef struct memArenaBlockStruct {
+        struct memArenaBlockStruct *next;
+        size_t                      size;   /* usable bytes following the header */
+        size_t                      used;
+        double                      align[(MEM_ARENA_ALIGN - 2 * sizeof(size_t) - sizeof(void *)) / sizeof(double)];
+    } memArenaBlock;
+
+    typedef struct memArenaStats {
+        size_t numAllocs;       /* allocations since the last reset */
+        size_t bytesUsed;       /* bytes handed out since the last reset */
+        size_t peakUsed;        /* largest bytesUsed of any run */
+        size_t bytesReserved;   /* bytes obtained from the system */
+        size_t numBlocks;       /* blocks obtained from the system */
+        size_t numResets;
+    } memArenaStatistics;
+
+    typedef struct memArenaStruct {
+        memArenaBlock      *head;
+        memArenaBlock      *cur;
+        size_t              blockSize;
+        memArenaStatistics  stats;
+        char                pad[MEM_ARENA_ALIGN];  /* keeps per-thread arenas on separate cache lines */
+    } memArena;
+
+    typedef struct memPoolStruct {
+        memArena *arena;
+        size_t    objSize;
+        void     *freeList;
+        size_t    numLive;      /* objects currently handed out */
+    } memPool;
+
+    typedef struct memArenaSetStruct {
+        int       num;
+        memArena *arena;
+    } memArenaSet;
+
+    void         memArenaInit(memArena *arena, size_t blockSize);
+    void        *memArenaAlloc(memArena *arena, size_t bytes);
+    void         memArenaReset(memArena *arena);
+    void         memArenaFree(memArena *arena);
+    void         memArenaGetStats(memArena *arena, memArenaStatistics *stats);
+    void         memArenaPrintStats(const char *str, memArenaStatistics *stats);
+
+    void         memPoolInit(memPool *pool, memArena *arena, size_t objSize);
+    void        *memPoolAlloc(memPool *pool);
+    void         memPoolRelease(memPool *pool, void *obj);
+
+    memArenaSet *memArenaSetCreate(int num, size_t blockSize);
+    memArena    *memArenaLocal(memArenaSet *set);
+    void         memArenaSetReset(memArenaSet *set);
+    void         memArenaSetFree(memArenaSet *set);
+    void         memArenaSetGetStats(memArenaSet *set, memArenaStatistics *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
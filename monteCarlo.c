@@ -0,0 +1,538 @@
+/*
+ *  monteCarlo.c
+ *  OrbitalMotion
+ *
+ *  Philox4x32-10 counter-based random numbers, declarative sample
+ *  generation, chunked batch propagation and streaming statistics
+ *  (Welford mean/covariance and P-square percentile estimates).
+ *
+ *  Reproducibility: the draws of a sample only depend on the seed,
+ *  the sample index, the dispersed parameter and the index of the
+ *  dispersion, so that several dispersions of one parameter are
+ *  independent.  Every sample is propagated independently, and the
+ *  final states are reduced into the statistics in sample order.
+ *  The results are therefore the same for any number of threads,
+ *  partitions or chunk size.
+ *
+ *  References:
+ *  J. K. Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3",
+ *  SC11, 2011.
+ *  R. Jain and I. Chlamtac, "The P2 Algorithm for Dynamic Calculation
+ *  of Quantiles and Histograms without Storing Observations",
+ *  Comm. ACM 28(10), 1985.
+ */
+
+#include <string.h>
+#include "monteCarlo.h"
+
+#define PHILOX_M0   0xD2511F53u
+#define PHILOX_M1   0xCD9E8D57u
+#define PHILOX_W0   0x9E3779B9u
+#define PHILOX_W1   0xBB67AE85u
+
+/*
+ *  philox4x32(ctr, key, out)
+ *
+ *  Philox4x32-10 block function.  Maps the 128 bit counter
+ *  ctr[0..3] under the 64 bit key key[0..1] into 128 random bits
+ *  out[0..3].
+ */
+void philox4x32(uint32_t *ctr, uint32_t *key, uint32_t *out)
+{
+    uint32_t c[4];
+    uint32_t k[2];
+    uint64_t p0;
+    uint64_t p1;
+    int      i;
+
+    memcpy(c, ctr, sizeof(c));
+    k[0] = key[0];
+    k[1] = key[1];
+    for(i = 0; i < 10; i++) {
+        p0 = (uint64_t)PHILOX_M0 * c[0];
+        p1 = (uint64_t)PHILOX_M1 * c[2];
+        c[0] = (uint32_t)(p1 >> 32) ^ c[1] ^ k[0];
+        c[1] = (uint32_t)p1;
+        c[2] = (uint32_t)(p0 >> 32) ^ c[3] ^ k[1];
+        c[3] = (uint32_t)p0;
+        k[0] += PHILOX_W0;
+        k[1] += PHILOX_W1;
+    }
+    memcpy(out, c, sizeof(c));
+
+    return;
+}
+
+/*
+ *  mcUniform2(seed, sample, param, index, *u1, *u2)
+ *
+ *  Returns two independent uniform random numbers on the open
+ *  interval (0,1), each with 53 random bits, for the dispersion
+ *  disp[index] of the parameter param of the given sample.
+ */
+void mcUniform2(uint64_t seed, long sample, int param, int index, double *u1, double *u2)
+{
+    uint32_t ctr[4];
+    uint32_t key[2];
+    uint32_t out[4];
+
+    ctr[0] = (uint32_t)((uint64_t)sample);
+    ctr[1] = (uint32_t)((uint64_t)sample >> 32);
+    ctr[2] = (uint32_t)param;
+    ctr[3] = (uint32_t)index;
+    key[0] = (uint32_t)seed;
+    key[1] = (uint32_t)(seed >> 32);
+    philox4x32(ctr, key, out);
+
+    *u1 = ((out[0] >> 5) * 67108864. + (out[1] >> 6) + 0.5) / 9007199254740992.;
+    *u2 = ((out[2] >> 5) * 67108864. + (out[3] >> 6) + 0.5) / 9007199254740992.;
+
+    return;
+}
+
+/*
+ *  x = mcNormal(seed, sample, param, index)
+ *
+ *  Returns a standard normal random number (Box-Muller) for the
+ *  dispersion disp[index] of the parameter param of the given sample.
+ */
+double mcNormal(uint64_t seed, long sample, int param, int index)
+{
+    double u1;
+    double u2;
+
+    mcUniform2(seed, sample, param, index, &u1, &u2);
+
+    return sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+}
+
+/*
+ *  status = mcSample(nom, disp, numDisp, seed, sample, elem, CdAm, Am, sigma, omega)
+ *
+ *  Generates the initial conditions of one Monte Carlo sample by
+ *  applying the dispersions disp[0..numDisp-1] to the nominal
+ *  values.  The MC_SIGMA1..3 dispersions define a small attitude
+ *  error MRP that is added to the nominal attitude with addMRP().
+ *  Returns -1 if a dispersion has an unknown param or dist, which
+ *  is then skipped.  Nothing is printed, so that mcSample() can run
+ *  inside parallel loops; the caller reports the failure.
+ */
+int mcSample(mcNominal *nom, mcDispersion *disp, int numDisp, uint64_t seed, long sample,
+              classicElements *elem, double *CdAm, double *Am, double *sigma, double *omega)
+{
+    double  dsigma[3+1];
+    double *val;
+    double  u1;
+    double  u2;
+    double  x;
+    int     status;
+    int     i;
+
+    status = 0;
+    *elem  = nom->elem;
+    *CdAm = nom->CdAm;
+    *Am   = nom->Am;
+    setZero(dsigma);
+    equal(nom->omega, omega);
+
+    for(i = 0; i < numDisp; i++) {
+        switch(disp[i].param) {
+            case MC_SMA:    val = &elem->a;     break;
+            case MC_ECC:    val = &elem->e;     break;
+            case MC_INC:    val = &elem->i;     break;
+            case MC_RAAN:   val = &elem->Omega; break;
+            case MC_AOP:    val = &elem->omega; break;
+            case MC_ANOM:   val = &elem->anom;  break;
+            case MC_CDAM:   val = CdAm;         break;
+            case MC_AM:     val = Am;           break;
+            case MC_SIGMA1: val = &dsigma[1];   break;
+            case MC_SIGMA2: val = &dsigma[2];   break;
+            case MC_SIGMA3: val = &dsigma[3];   break;
+            case MC_OMEGA1: val = &omega[1];    break;
+            case MC_OMEGA2: val = &omega[2];    break;
+            case MC_OMEGA3: val = &omega[3];    break;
+            default:
+                status = -1;
+                continue;
+        }
+
+        mcUniform2(seed, sample, disp[i].param, i, &u1, &u2);
+        x = sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+        switch(disp[i].dist) {
+            case MC_NORMAL:
+                *val += disp[i].a * x;
+                break;
+            case MC_UNIFORM:
+                *val += disp[i].a + (disp[i].b - disp[i].a) * u1;
+                break;
+            case MC_NORMAL_REL:
+                *val *= 1. + disp[i].a * x;
+                break;
+            default:
+                status = -1;
+                break;
+        }
+    }
+
+    addMRP(nom->sigma, dsigma, sigma);
+    MRPswitch(sigma, 1., sigma);
+
+    return status;
+}
+
+/*
+ *  mcAttitudeStep(sigma, omega, dt)
+ *
+ *  Advances the MRP attitude sigma by one RK4 step of the
+ *  kinematic differential equation dMRP() for constant body
+ *  angular rates omega (torque free, no rate dynamics), switching
+ *  to the shadow set if |sigma| > 1.
+ */
+void mcAttitudeStep(double *sigma, double *omega, double dt)
+{
+    double k1[3+1];
+    double k2[3+1];
+    double k3[3+1];
+    double k4[3+1];
+    double s[3+1];
+    int    i;
+
+    dMRP(sigma, omega, k1);
+    for(i = 1; i <= 3; i++) {
+        s[i] = sigma[i] + dt / 2. * k1[i];
+    }
+    dMRP(s, omega, k2);
+    for(i = 1; i <= 3; i++) {
+        s[i] = sigma[i] + dt / 2. * k2[i];
+    }
+    dMRP(s, omega, k3);
+    for(i = 1; i <= 3; i++) {
+        s[i] = sigma[i] + dt * k3[i];
+    }
+    dMRP(s, omega, k4);
+    for(i = 1; i <= 3; i++) {
+        sigma[i] += dt / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+    }
+    MRPswitch(sigma, 1., sigma);
+
+    return;
+}
+
+/*
+ *  mcStatsInit(stats, numQuant, prob)
+ *
+ *  Clears the statistics and sets up the P-square estimators of
+ *  the numQuant (<= MC_MAX_QUANT) percentiles prob[0..numQuant-1],
+ *  given as fractions 0 < p < 1.
+ */
+void mcStatsInit(mcStatistics *stats, int numQuant, double *prob)
+{
+    int i;
+
+    memset(stats, 0, sizeof(mcStatistics));
+    if((numQuant < 0) || (numQuant > MC_MAX_QUANT)) {
+        printf("ERROR: mcStatsInit() received numQuant = %d \n", numQuant);
+        printf("The value of numQuant should be 0 <= numQuant <= %d. \n", MC_MAX_QUANT);
+        numQuant = 0;
+    }
+    stats->numQuant = numQuant;
+    for(i = 0; i < numQuant; i++) {
+        stats->prob[i] = prob[i];
+    }
+
+    return;
+}
+
+/*
+ *  mcP2Add(p2, p, x)
+ *
+ *  Adds the observation x to the P-square estimator of the
+ *  p-quantile.
+ */
+static void mcP2Add(mcP2 *p2, double p, double x)
+{
+    double d;
+    double qp;
+    double t;
+    int    i;
+    int    j;
+    int    k;
+
+    if(p2->count < 5) {
+        p2->q[++p2->count] = x;
+        if(p2->count == 5) {
+            for(i = 2; i <= 5; i++) {
+                t = p2->q[i];
+                for(j = i - 1; (j >= 1) && (p2->q[j] > t); j--) {
+                    p2->q[j + 1] = p2->q[j];
+                }
+                p2->q[j + 1] = t;
+            }
+            for(i = 1; i <= 5; i++) {
+                p2->n[i] = i;
+            }
+            p2->np[1] = 1.;
+            p2->np[2] = 1. + 2. * p;
+            p2->np[3] = 1. + 4. * p;
+            p2->np[4] = 3. + 2. * p;
+            p2->np[5] = 5.;
+            p2->dn[1] = 0.;
+            p2->dn[2] = p / 2.;
+            p2->dn[3] = p;
+            p2->dn[4] = (1. + p) / 2.;
+            p2->dn[5] = 1.;
+        }
+        return;
+    }
+    p2->count++;
+
+    /* find the cell of x and adjust the extreme markers */
+    if(x < p2->q[1]) {
+        p2->q[1] = x;
+        k = 1;
+    } else if(x >= p2->q[5]) {
+        p2->q[5] = x;
+        k = 4;
+    } else {
+        for(k = 1; k < 4; k++) {
+            if(x < p2->q[k + 1]) {
+                break;
+            }
+        }
+    }
+    for(i = k + 1; i <= 5; i++) {
+        p2->n[i] += 1.;
+    }
+    for(i = 1; i <= 5; i++) {
+        p2->np[i] += p2->dn[i];
+    }
+
+    /* adjust the heights of the middle markers */
+    for(i = 2; i <= 4; i++) {
+        d = p2->np[i] - p2->n[i];
+        if(((d >= 1.) && (p2->n[i + 1] - p2->n[i] > 1.)) || ((d <= -1.) && (p2->n[i - 1] - p2->n[i] < -1.))) {
+            d  = d > 0. ? 1. : -1.;
+            qp = p2->q[i] + d / (p2->n[i + 1] - p2->n[i - 1])
+                 * ((p2->n[i] - p2->n[i - 1] + d) * (p2->q[i + 1] - p2->q[i]) / (p2->n[i + 1] - p2->n[i])
+                    + (p2->n[i + 1] - p2->n[i] - d) * (p2->q[i] - p2->q[i - 1]) / (p2->n[i] - p2->n[i - 1]));
+            if((p2->q[i - 1] < qp) && (qp < p2->q[i + 1])) {
+                p2->q[i] = qp;
+            } else {
+                j = i + (int)d;
+                p2->q[i] += d * (p2->q[j] - p2->q[i]) / (p2->n[j] - p2->n[i]);
+            }
+            p2->n[i] += d;
+        }
+    }
+
+    return;
+}
+
+/*
+ *  mcStatsAdd(stats, x)
+ *
+ *  Adds one sample outcome x[1..MC_NUM_OUT] to the running mean,
+ *  covariance (Welford) and percentile estimates.
+ */
+void mcStatsAdd(mcStatistics *stats, double *x)
+{
+    double d[MC_NUM_OUT+1];
+    int    i;
+    int    j;
+
+    stats->count++;
+    for(i = 1; i <= MC_NUM_OUT; i++) {
+        d[i] = x[i] - stats->mean[i];
+        stats->mean[i] += d[i] / stats->count;
+    }
+    for(i = 1; i <= MC_NUM_OUT; i++) {
+        for(j = 1; j <= MC_NUM_OUT; j++) {
+            stats->M2[i][j] += d[i] * (x[j] - stats->mean[j]);
+        }
+    }
+    for(i = 1; i <= MC_NUM_OUT; i++) {
+        for(j = 0; j < stats->numQuant; j++) {
+            mcP2Add(&stats->p2[i][j], stats->prob[j], x[i]);
+        }
+    }
+
+    return;
+}
+
+/*
+ *  mcStatsCovariance(stats, cov)
+ *
+ *  Returns the unbiased sample covariance of the outcomes.
+ */
+void mcStatsCovariance(mcStatistics *stats, double cov[MC_NUM_OUT+1][MC_NUM_OUT+1])
+{
+    int i;
+    int j;
+
+    for(i = 1; i <= MC_NUM_OUT; i++) {
+        for(j = 1; j <= MC_NUM_OUT; j++) {
+            cov[i][j] = stats->count > 1 ? stats->M2[i][j] / (stats->count - 1) : 0.;
+        }
+    }
+
+    return;
+}
+
+/*
+ *  q = mcStatsQuantile(stats, var, iq)
+ *
+ *  Returns the estimate of the percentile stats->prob[iq] of the
+ *  outcome variable var (1..MC_NUM_OUT).  With fewer than 5
+ *  samples the nearest-rank value of the stored samples is used.
+ */
+double mcStatsQuantile(mcStatistics *stats, int var, int iq)
+{
+    mcP2  *p2;
+    double q[5+1];
+    double t;
+    int    i;
+    int    j;
+
+    if((var < 1) || (var > MC_NUM_OUT) || (iq < 0) || (iq >= stats->numQuant) || (stats->count == 0)) {
+        printf("ERROR: mcStatsQuantile() received var = %d, iq = %d \n", var, iq);
+        printf("var should be 1..%d and iq 0..%d, with at least one sample. \n", MC_NUM_OUT, stats->numQuant - 1);
+        return NAN;
+    }
+    p2 = &stats->p2[var][iq];
+    if(p2->count >= 5) {
+        return p2->q[3];
+    }
+
+    for(i = 1; i <= p2->count; i++) {
+        t = p2->q[i];
+        for(j = i - 1; (j >= 1) && (q[j] > t); j--) {
+            q[j + 1] = q[j];
+        }
+        q[j + 1] = t;
+    }
+    i = (int)ceil(stats->prob[iq] * p2->count);
+
+    return q[i < 1 ? 1 : i];
+}
+
+/*
+ *  status = mcRun(nom, disp, numDisp, seed, numSamples, fm, dt, numSteps, chunk, numParts, stats)
+ *
+ *  Runs a Monte Carlo dispersion analysis.
+ *
+ *  Input is
+ *      nom        - nominal initial conditions
+ *      disp       - dispersion specifications disp[0..numDisp-1]
+ *      seed       - 64 bit seed of the Philox streams
+ *      numSamples - number of samples
+ *      fm         - orbit force model of the batch engine
+ *      dt         - fixed integration step (sec)
+ *      numSteps   - number of steps
+ *      chunk      - samples propagated per batch (MC_CHUNK if <= 0)
+ *      numParts   - batch engine partitions (see batchCreate())
+ *      stats      - statistics set up with mcStatsInit()
+ *
+ *  Output is
+ *      stats      - statistics of the final states
+ *                   [x y z vx vy vz sigma1 sigma2 sigma3]
+ *
+ *  The attitude is propagated kinematically with mcAttitudeStep().
+ *  Returns 0 on success and -1 if a dispersion is invalid or memory
+ *  could not be allocated.
+ */
+int mcRun(mcNominal *nom, mcDispersion *disp, int numDisp, uint64_t seed, long numSamples,
+          batchForceModel *fm, double dt, int numSteps, int chunk, int numParts,
+          mcStatistics *stats)
+{
+    batchState *state;
+    double     *mem;
+    double     *R[3+1];
+    double     *V[3+1];
+    double     *att;
+    double      x[MC_NUM_OUT+1];
+    long        first;
+    int         failed;
+    int         m;
+    int         k;
+    int         i;
+
+    if(chunk <= 0) {
+        chunk = MC_CHUNK;
+    }
+    if(numSamples < chunk) {
+        chunk = (int)numSamples;
+    }
+    mem = (double *)malloc((9 * (size_t)chunk + 1) * sizeof(double));
+    if(mem == NULL) {
+        return -1;
+    }
+    for(i = 1; i <= 3; i++) {
+        R[i] = mem + (i - 1) * (size_t)chunk;
+        V[i] = mem + (i + 2) * (size_t)chunk;
+    }
+    att   = mem + 6 * (size_t)chunk;
+    state = NULL;
+
+    for(first = 0; first < numSamples; first += chunk) {
+        m = numSamples - first < chunk ? (int)(numSamples - first) : chunk;
+        if((state == NULL) || (state->n != m)) {
+            batchFree(state);
+            state = batchCreate(m, numParts);
+            if(state == NULL) {
+                free(mem);
+                return -1;
+            }
+        }
+        state->t = 0.;
+
+        /* generate and propagate the samples of this chunk */
+        failed = 0;
+        #pragma omp parallel for schedule(static) reduction(+:failed)
+        for(k = 0; k < m; k++) {
+            classicElements elem;
+            double          rVec[3+1];
+            double          vVec[3+1];
+            double          sigma[3+1];
+            double          omega[3+1];
+            double          CdAm;
+            double          Am;
+            int             j;
+
+            if(mcSample(nom, disp, numDisp, seed, first + k, &elem, &CdAm, &Am, sigma, omega) != 0) {
+                failed++;
+            }
+            elem2rv(nom->mu, &elem, rVec, vVec);
+            batchSet(state, k, rVec, vVec, CdAm, Am);
+            for(j = 0; j < numSteps; j++) {
+                mcAttitudeStep(sigma, omega, dt);
+            }
+            att[3 * k]     = sigma[1];
+            att[3 * k + 1] = sigma[2];
+            att[3 * k + 2] = sigma[3];
+        }
+        if(failed) {
+            printf("ERROR: mcRun() received an invalid dispersion \n");
+            printf("The param should be MC_SMA ... MC_OMEGA3 and dist MC_NORMAL, MC_UNIFORM or MC_NORMAL_REL. \n");
+            batchFree(state);
+            free(mem);
+            return -1;
+        }
+        batchPropagate(state, fm, dt, numSteps);
+        batchGather(state, R, V);
+
+        /* reduce in sample order */
+        for(k = 0; k < m; k++) {
+            for(i = 1; i <= 3; i++) {
+                x[i]     = R[i][k];
+                x[i + 3] = V[i][k];
+                x[i + 6] = att[3 * k + i - 1];
+            }
+            mcStatsAdd(stats, x);
+        }
+    }
+
+    batchFree(state);
+    free(mem);
+
+    return 0;
+}
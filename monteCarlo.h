@@ -0,0 +1,109 @@
+/*
+ *  monteCarlo.h
+ *  OrbitalMotion
+ *
+ *  Monte Carlo dispersion engine.  Samples are generated from a
+ *  nominal orbit, drag/SRP parameters and attitude state through
+ *  a declarative list of dispersions, with every random draw taken
+ *  from a Philox4x32-10 counter-based stream keyed by the seed and
+ *  indexed by (sample, parameter, dispersion).  The samples are
+ *  propagated in chunks with the batch engine and reduced into
+ *  streaming statistics, so results are reproducible for any thread
+ *  count and no trajectories are stored.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "orbitalMotion.h"
+#include "RigidBodyKinematics.h"
+#include "batchPropagation.h"
+
+#ifndef _MONTE_CARLO_H_
+#define _MONTE_CARLO_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    /* dispersed parameters */
+    #define MC_SMA          1       /* semi-major axis (km) */
+    #define MC_ECC          2       /* eccentricity */
+    #define MC_INC          3       /* inclination (rad) */
+    #define MC_RAAN         4       /* ascending node (rad) */
+    #define MC_AOP          5       /* argument of periapses (rad) */
+    #define MC_ANOM         6       /* true anomaly (rad) */
+    #define MC_CDAM         7       /* drag ballistic factor Cd*A/m (m^2/kg) */
+    #define MC_AM           8       /* solar radiation A/m (m^2/kg) */
+    #define MC_SIGMA1       9       /* attitude error MRP components */
+    #define MC_SIGMA2      10
+    #define MC_SIGMA3      11
+    #define MC_OMEGA1      12       /* body angular rate components (rad/s) */
+    #define MC_OMEGA2      13
+    #define MC_OMEGA3      14
+
+    /* dispersion distributions */
+    #define MC_NORMAL       1       /* nominal + a * N(0,1) */
+    #define MC_UNIFORM      2       /* nominal + U(a, b) */
+    #define MC_NORMAL_REL   3       /* nominal * (1 + a * N(0,1)) */
+
+    #define MC_NUM_OUT      9       /* x, y, z, vx, vy, vz, sigma1, sigma2, sigma3 */
+    #define MC_MAX_QUANT    8
+    #define MC_CHUNK        4096
+
+    typedef struct mcDisp {
+        int    param;               /* MC_SMA ... MC_OMEGA3 */
+        int    dist;                /* MC_NORMAL, MC_UNIFORM or MC_NORMAL_REL */
+        double a;
+        double b;
+    } mcDispersion;
+
+    typedef struct mcNom {
+        double          mu;         /* gravitational constant (km^3/s^2) */
+        classicElements elem;       /* nominal orbit elements */
+        double          CdAm;       /* nominal Cd*A/m (m^2/kg) */
+        double          Am;         /* nominal A/m (m^2/kg) */
+        double          sigma[3+1]; /* nominal attitude MRP */
+        double          omega[3+1]; /* nominal body angular rates (rad/s) */
+    } mcNominal;
+
+    typedef struct mcP2Struct {
+        int    count;
+        double q[5+1];              /* marker heights */
+        double n[5+1];              /* marker positions */
+        double np[5+1];             /* desired marker positions */
+        double dn[5+1];             /* desired position increments */
+    } mcP2;
+
+    typedef struct mcStats {
+        long   count;
+        double mean[MC_NUM_OUT+1];
+        double M2[MC_NUM_OUT+1][MC_NUM_OUT+1];
+        int    numQuant;
+        double prob[MC_MAX_QUANT];
+        mcP2   p2[MC_NUM_OUT+1][MC_MAX_QUANT];
+    } mcStatistics;
+
+    void   philox4x32(uint32_t *ctr, uint32_t *key, uint32_t *out);
+    void   mcUniform2(uint64_t seed, long sample, int param, int index, double *u1, double *u2);
+    double mcNormal(uint64_t seed, long sample, int param, int index);
+    int    mcSample(mcNominal *nom, mcDispersion *disp, int numDisp, uint64_t seed, long sample,
+                    classicElements *elem, double *CdAm, double *Am, double *sigma, double *omega);
+    void   mcAttitudeStep(double *sigma, double *omega, double dt);
+
+    void   mcStatsInit(mcStatistics *stats, int numQuant, double *prob);
+    void   mcStatsAdd(mcStatistics *stats, double *x);
+    void   mcStatsCovariance(mcStatistics *stats, double cov[MC_NUM_OUT+1][MC_NUM_OUT+1]);
+    double mcStatsQuantile(mcStatistics *stats, int var, int iq);
+
+    int    mcRun(mcNominal *nom, mcDispersion *disp, int numDisp, uint64_t seed, long numSamples,
+                 batchForceModel *fm, double dt, int numSteps, int chunk, int numParts,
+                 mcStatistics *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
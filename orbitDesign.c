@@ -0,0 +1,385 @@
+/*
+ *  orbitDesign.c
+ *  OrbitalMotion
+ *
+ *  Binary grid file layout (native byte order):
+ *
+ *      header (32 bytes)
+ *           0  char[8]  magic "OMDSGN01"
+ *           8  int32    number of semi-major axes numA
+ *          12  int32    number of eccentricities numE
+ *          16  int32    doubles per record (OD_NUM_FIELDS)
+ *          20  zero padding
+ *      records
+ *          numA x numE orbitDesign records of OD_NUM_FIELDS doubles,
+ *          eccentricity running fastest
+ *
+ *  References:
+ *  D. A. Vallado, "Fundamentals of Astrodynamics and Applications",
+ *  3rd ed., 2007, sections 9.6 and 11.4.
+ *  J. R. Wertz, "Mission Geometry; Orbit and Constellation Design
+ *  and Management", 2001, chapter 3.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "orbitDesign.h"
+
+#define OD_MAGIC            "OMDSGN01"
+#define OD_HEADER           32
+
+/*
+ *  J2SecularRates(a, e, i, dOmega, domega, dM)
+ *
+ *  Returns the secular rates (rad/s) of the ascending node, the
+ *  argument of perigee and the mean anomaly (including the mean
+ *  motion) of an Earth orbit due to J2.
+ */
+void J2SecularRates(double a, double e, double i, double *dOmega, double *domega, double *dM)
+{
+    double n;
+    double p;
+    double k;
+    double c;
+
+    n = sqrt(MU_EARTH / (a * a * a));
+    p = a * (1. - e * e);
+    k = 0.75 * n * J2_EARTH * REQ_EARTH * REQ_EARTH / (p * p);
+    c = cos(i);
+    *dOmega = -2. * k * c;
+    *domega = k * (5. * c * c - 1.);
+    *dM     = n + k * sqrt(1. - e * e) * (3. * c * c - 1.);
+
+    return;
+}
+
+/*
+ *  i = odSunSync(a, e)
+ *
+ *  Sun-synchronous inclination, NAN if there is none.
+ */
+static double odSunSync(double a, double e)
+{
+    double p;
+    double c;
+
+    p = a * (1. - e * e);
+    c = -2. * OD_SUN_RATE * p * p / (3. * sqrt(MU_EARTH / (a * a * a)) * J2_EARTH * REQ_EARTH * REQ_EARTH);
+    if(fabs(c) > 1.) {
+        return NAN;
+    }
+
+    return acos(c);
+}
+
+/*
+ *  i = sunSyncInclination(a, e)
+ *
+ *  Returns the inclination (rad) for which the J2 nodal regression
+ *  of the orbit with semi-major axis a (km) and eccentricity e
+ *  matches the mean motion of the Sun.
+ */
+double sunSyncInclination(double a, double e)
+{
+    double i;
+
+    i = odSunSync(a, e);
+    if(isnan(i)) {
+        printf("ERROR: sunSyncInclination() received a = %g \n", a);
+        printf("No sun-synchronous orbit exists above about 12350 km. \n");
+    }
+
+    return i;
+}
+
+/*
+ *  frozenOrbit(a, i, e, omega)
+ *
+ *  Returns the eccentricity e and argument of perigee omega (rad)
+ *  for which the J2 and J3 long-period variations of e and omega
+ *  vanish,
+ *
+ *      e = -J3 Req sin(i) / (2 J2 p),  omega = 90 deg
+ *
+ *  iterated on p = a (1 - e^2).
+ */
+void frozenOrbit(double a, double i, double *e, double *omega)
+{
+    double ef;
+    int    k;
+
+    ef = 0.;
+    for(k = 0; k < 3; k++) {
+        ef = -J3_EARTH * REQ_EARTH * sin(i) / (2. * J2_EARTH * a * (1. - ef * ef));
+    }
+    *omega = M_PI / 2.;
+    if(ef < 0.) {
+        ef     = -ef;
+        *omega = 1.5 * M_PI;
+    }
+    *e = ef;
+
+    return;
+}
+
+/*
+ *  F = odRepeatError(a, e, i, sso, revs, days)
+ *
+ *  Mismatch (rad/s) of the repeat condition
+ *  days (dM + domega) = revs (wEarth - dOmega).
+ */
+static double odRepeatError(double a, double e, double *i, int sso, int revs, int days)
+{
+    double dOmega;
+    double domega;
+    double dM;
+
+    if(sso) {
+        *i = odSunSync(a, e);
+    }
+    J2SecularRates(a, e, *i, &dOmega, &domega, &dM);
+
+    return days * (dM + domega) - revs * (OMEGA_EARTH - dOmega);
+}
+
+/*
+ *  a = odRepeat(revs, days, e, i, sso)
+ *
+ *  Newton solution of the repeat ground track condition, NAN if it
+ *  fails.
+ */
+static double odRepeat(int revs, int days, double e, double *i, int sso)
+{
+    double a;
+    double n;
+    double F;
+    double dF;
+    double da;
+    double ii;
+    int    k;
+
+    n = (double)revs / days * OMEGA_EARTH;
+    a = pow(MU_EARTH / (n * n), 1. / 3.);
+    for(k = 0; k < OD_MAX_ITER; k++) {
+        ii = *i;
+        F  = odRepeatError(a, e, &ii, sso, revs, days);
+        dF = (odRepeatError(a * (1. + 1e-7), e, &ii, sso, revs, days) - F) / (a * 1e-7);
+        if(isnan(F) || isnan(dF) || (dF == 0.)) {
+            return NAN;
+        }
+        da = -F / dF;
+        a += da;
+        if(fabs(da) < 1e-9 * a) {
+            odRepeatError(a, e, i, sso, revs, days);
+            return a;
+        }
+    }
+
+    return NAN;
+}
+
+/*
+ *  a = repeatGroundTrackSMA(revs, days, e, i, sso)
+ *
+ *  Returns the semi-major axis (km) whose ground track repeats after
+ *  revs nodal revolutions in days nodal days under J2.  If sso is
+ *  non-zero the orbit is also sun-synchronous and its inclination
+ *  is returned in i, otherwise i is the given inclination.  Returns
+ *  NAN if there is no solution.
+ */
+double repeatGroundTrackSMA(int revs, int days, double e, double *i, int sso)
+{
+    double a;
+
+    if((revs < 1) || (days < 1)) {
+        printf("ERROR: repeatGroundTrackSMA() received revs = %d, days = %d \n", revs, days);
+        printf("The repeat cycle should have revs >= 1 and days >= 1. \n");
+        return NAN;
+    }
+    a = odRepeat(revs, days, e, i, sso);
+    if(isnan(a)) {
+        printf("ERROR: repeatGroundTrackSMA() found no orbit for %d revolutions in %d days \n", revs, days);
+        printf("A sun-synchronous repeat orbit should lie below about 12350 km. \n");
+    }
+
+    return a;
+}
+
+/*
+ *  odEvaluate(a, e, i, rec)
+ *
+ *  Fills the design record of the orbit a, e, i.
+ */
+static void odEvaluate(double a, double e, double i, orbitDesign *rec)
+{
+    double dOmega;
+    double domega;
+    double dM;
+
+    rec->a = a;
+    rec->e = e;
+    rec->i = i;
+    if(isnan(i)) {
+        rec->eFrozen = rec->omegaFrozen = rec->Tnodal = rec->revsPerDay = NAN;
+        return;
+    }
+    frozenOrbit(a, i, &rec->eFrozen, &rec->omegaFrozen);
+    J2SecularRates(a, e, i, &dOmega, &domega, &dM);
+    rec->Tnodal     = 2. * M_PI / (dM + domega);
+    rec->revsPerDay = (dM + domega) / (OMEGA_EARTH - dOmega);
+
+    return;
+}
+
+/*
+ *  orbitDesignSweep(aMin, aMax, numA, eMin, eMax, numE, grid)
+ *
+ *  Evaluates the sun-synchronous inclination, the frozen orbit, the
+ *  nodal period and the revolutions per nodal day on the uniform
+ *  numA x numE grid of semi-major axis and eccentricity.  grid[iA *
+ *  numE + iE] holds the grid point (aMin + iA da, eMin + iE de).
+ *  Points without a sun-synchronous orbit return NAN fields.
+ */
+void orbitDesignSweep(double aMin, double aMax, int numA, double eMin, double eMax, int numE,
+                      orbitDesign *grid)
+{
+    double da;
+    double de;
+    long   k;
+
+    da = (numA > 1) ? (aMax - aMin) / (numA - 1) : 0.;
+    de = (numE > 1) ? (eMax - eMin) / (numE - 1) : 0.;
+
+    #pragma omp parallel for schedule(static)
+    for(k = 0; k < (long)numA * numE; k++) {
+        double a;
+        double e;
+
+        a = aMin + (k / numE) * da;
+        e = eMin + (k % numE) * de;
+        odEvaluate(a, e, odSunSync(a, e), &grid[k]);
+        grid[k].revs = grid[k].days = 0.;
+    }
+
+    return;
+}
+
+/*
+ *  count = repeatGroundTrackSearch(maxDays, aMin, aMax, e, i, sso, out, maxOut)
+ *
+ *  Finds all repeat ground track orbits with eccentricity e and
+ *  coprime cycles of up to maxDays nodal days whose semi-major axis
+ *  lies in [aMin, aMax].  If sso is non-zero the orbits are
+ *  sun-synchronous, otherwise they have inclination i.  The orbits
+ *  are solved in parallel and stored in out[0..count-1], ordered by
+ *  days and then by revolutions; at most maxOut cycles are
+ *  examined.
+ */
+int repeatGroundTrackSearch(int maxDays, double aMin, double aMax, double e, double i, int sso,
+                            orbitDesign *out, int maxOut)
+{
+    orbitDesign lo;
+    orbitDesign hi;
+    int         num;
+    int         count;
+    int         days;
+    int         revs;
+    int         g;
+    int         r;
+    int         d;
+    int         k;
+
+    odEvaluate(aMin, e, sso ? odSunSync(aMin, e) : i, &hi);
+    odEvaluate(aMax, e, sso ? odSunSync(aMax, e) : i, &lo);
+    if(isnan(hi.revsPerDay) || isnan(lo.revsPerDay)) {
+        printf("ERROR: repeatGroundTrackSearch() received aMin = %g, aMax = %g \n", aMin, aMax);
+        printf("The range should admit sun-synchronous orbits. \n");
+        return -1;
+    }
+
+    /* candidate cycles, the revolutions per day decrease with a */
+    num = 0;
+    for(days = 1; (days <= maxDays) && (num < maxOut); days++) {
+        for(revs = (int)ceil(lo.revsPerDay * days); revs <= (int)floor(hi.revsPerDay * days); revs++) {
+            r = revs;
+            d = days;
+            while(d != 0) {
+                g = r % d;
+                r = d;
+                d = g;
+            }
+            if(r != 1) {
+                continue;
+            }
+            if(num == maxOut) {
+                break;
+            }
+            out[num].revs = revs;
+            out[num].days = days;
+            num++;
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(k = 0; k < num; k++) {
+        double ik;
+        double a;
+
+        ik = i;
+        a  = odRepeat((int)out[k].revs, (int)out[k].days, e, &ik, sso);
+        odEvaluate(a, e, ik, &out[k]);
+    }
+
+    count = 0;
+    for(k = 0; k < num; k++) {
+        if(!isnan(out[k].a) && (out[k].a >= aMin) && (out[k].a <= aMax)) {
+            out[count++] = out[k];
+        }
+    }
+
+    return count;
+}
+
+/*
+ *  status = orbitDesignWrite(fileName, grid, numA, numE)
+ *
+ *  Writes the numA x numE design grid to the binary file fileName.
+ *  Returns -1 if the file could not be written.
+ */
+int orbitDesignWrite(const char *fileName, orbitDesign *grid, int numA, int numE)
+{
+    unsigned char head[OD_HEADER];
+    FILE         *fp;
+    int32_t       u;
+    size_t        num;
+    int           status;
+
+    fp = fopen(fileName, "wb");
+    if(fp == NULL) {
+        printf("ERROR: orbitDesignWrite() could not open %s \n", fileName);
+        return -1;
+    }
+    memset(head, 0, OD_HEADER);
+    memcpy(head, OD_MAGIC, 8);
+    u = numA;
+    memcpy(head + 8, &u, sizeof(u));
+    u = numE;
+    memcpy(head + 12, &u, sizeof(u));
+    u = OD_NUM_FIELDS;
+    memcpy(head + 16, &u, sizeof(u));
+
+    num    = (size_t)numA * numE;
+    status = 0;
+    if((fwrite(head, 1, OD_HEADER, fp) != OD_HEADER)
+       || (fwrite(grid, sizeof(orbitDesign), num, fp) != num)) {
+        status = -1;
+    }
+    if(fclose(fp) != 0) {
+        status = -1;
+    }
+    if(status != 0) {
+        printf("ERROR: orbitDesignWrite() could not write %s \n", fileName);
+    }
+
+    return status;
+}
@@ -0,0 +1,59 @@
+/*
+ *  orbitDesign.h
+ *  OrbitalMotion
+ *
+ *  Earth orbit design conditions under the J2 (and J3) secular and
+ *  long-period drift: sun-synchronous inclination, frozen
+ *  eccentricity and argument of perigee, and repeat ground track
+ *  semi-major axis, optionally combined with sun-synchronism.  The
+ *  sweep routines evaluate these conditions over a grid of
+ *  semi-major axis and eccentricity, or over all repeat cycles up to
+ *  a number of days, in parallel, and the grid can be written to a
+ *  binary file.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "astroConstants.h"
+
+#ifndef _ORBIT_DESIGN_H_
+#define _ORBIT_DESIGN_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define OD_SUN_RATE         (2. * M_PI / (365.2421897 * 86400.))   /* mean motion of the Sun (rad/s) */
+    #define OD_MAX_ITER         50
+    #define OD_NUM_FIELDS       9       /* doubles per orbitDesign record */
+
+    typedef struct orbitDesignStruct {
+        double a;                       /* semi-major axis (km) */
+        double e;                       /* eccentricity */
+        double i;                       /* inclination (rad), sun-synchronous in the sweeps */
+        double eFrozen;                 /* frozen eccentricity at a, i */
+        double omegaFrozen;             /* frozen argument of perigee (rad) */
+        double Tnodal;                  /* nodal period (s) */
+        double revsPerDay;              /* nodal revolutions per nodal day */
+        double revs;                    /* repeat cycle revolutions, 0 outside repeat searches */
+        double days;                    /* repeat cycle nodal days */
+    } orbitDesign;
+
+    void   J2SecularRates(double a, double e, double i, double *dOmega, double *domega, double *dM);
+    double sunSyncInclination(double a, double e);
+    void   frozenOrbit(double a, double i, double *e, double *omega);
+    double repeatGroundTrackSMA(int revs, int days, double e, double *i, int sso);
+
+    void   orbitDesignSweep(double aMin, double aMax, int numA, double eMin, double eMax, int numE,
+                            orbitDesign *grid);
+    int    repeatGroundTrackSearch(int maxDays, double aMin, double aMax, double e, double i, int sso,
+                                   orbitDesign *out, int maxOut);
+    int    orbitDesignWrite(const char *fileName, orbitDesign *grid, int numA, int numE);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
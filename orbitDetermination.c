@@ -0,0 +1,524 @@
+/*
+ *  orbitDetermination.c
+ *  OrbitalMotion
+ *
+ *  The state and the state transition matrix Phi(t, 0) are
+ *  propagated together with fixed RK4 steps, landing exactly on
+ *  every observation time, and stored there.  The variational
+ *  equations use the exact partials of the full force model with
+ *  respect to [r v], evaluated with the dual numbers of
+ *  dualAccel().  Light time and aberration are neglected.
+ *
+ *  The normal equations of every chunk of OD_CHUNK observations are
+ *  accumulated separately and then summed in chunk order, so the
+ *  solution does not depend on the number of threads.
+ *
+ *  References:
+ *  B. D. Tapley, B. E. Schutz and G. H. Born, "Statistical Orbit
+ *  Determination", Elsevier, 2004, chapter 4.
+ */
+
+#include <string.h>
+#include "orbitDetermination.h"
+#include "dualNumbers.h"
+
+#define OD_NX       42      /* state and state transition matrix */
+
+/*
+ *  odInitSettings(set)
+ *
+ *  Default settings: point mass Earth gravity, 60 s steps, 20
+ *  iterations, 1e-4 RMS convergence and 3 sigma editing.
+ */
+void odInitSettings(odSettings *set)
+{
+    batchInitForceModel(&set->fm);
+    set->dt        = 60.;
+    set->maxIter   = 20;
+    set->tol       = 1e-4;
+    set->editSigma = 3.;
+
+    return;
+}
+
+/*
+ *  status = odCholesky(n, A)
+ *
+ *  Replaces the lower triangle of the symmetric positive definite
+ *  matrix A[1..n][1..n] by its Cholesky factor L, A = L L^T.
+ *  Returns -1 if A is not positive definite.
+ */
+int odCholesky(int n, double A[7][7])
+{
+    double s;
+    int    i;
+    int    j;
+    int    k;
+
+    for(j = 1; j <= n; j++) {
+        s = A[j][j];
+        for(k = 1; k < j; k++) {
+            s -= A[j][k] * A[j][k];
+        }
+        if(s <= 0.) {
+            return -1;
+        }
+        A[j][j] = sqrt(s);
+        for(i = j + 1; i <= n; i++) {
+            s = A[i][j];
+            for(k = 1; k < j; k++) {
+                s -= A[i][k] * A[j][k];
+            }
+            A[i][j] = s / A[j][j];
+        }
+    }
+
+    return 0;
+}
+
+/*
+ *  odCholeskySolve(n, L, b, x)
+ *
+ *  Solves L L^T x = b with the factor L of odCholesky().  x may
+ *  alias b.
+ */
+void odCholeskySolve(int n, double L[7][7], double *b, double *x)
+{
+    double s;
+    int    i;
+    int    k;
+
+    for(i = 1; i <= n; i++) {
+        s = b[i];
+        for(k = 1; k < i; k++) {
+            s -= L[i][k] * x[k];
+        }
+        x[i] = s / L[i][i];
+    }
+    for(i = n; i >= 1; i--) {
+        s = x[i];
+        for(k = i + 1; k <= n; k++) {
+            s -= L[k][i] * x[k];
+        }
+        x[i] = s / L[i][i];
+    }
+
+    return;
+}
+
+/*
+ *  m = odPredict(obs, r, v, z, H)
+ *
+ *  Returns the computed measurement z[1..m] of the observation obs
+ *  for the inertial state r, v and its partials H[1..m][1..6] with
+ *  respect to [r v].  m is 1 for range and range-rate and 2 for
+ *  angles.
+ */
+int odPredict(odObservation *obs, double *r, double *v, double *z, double H[2+1][6+1])
+{
+    double rho[3+1];
+    double rhoDot[3+1];
+    double R;
+    double q2;
+    double q;
+    int    i;
+
+    sub(r, obs->rSite, rho);
+    sub(v, obs->vSite, rhoDot);
+    R = norm(rho);
+    memset(H, 0, sizeof(double) * (2 + 1) * (6 + 1));
+
+    switch(obs->type) {
+        case OD_RANGE:
+            z[1] = R;
+            for(i = 1; i <= 3; i++) {
+                H[1][i] = rho[i] / R;
+            }
+            return 1;
+
+        case OD_RANGE_RATE:
+            z[1] = dot(rho, rhoDot) / R;
+            for(i = 1; i <= 3; i++) {
+                H[1][i]     = (rhoDot[i] - z[1] * rho[i] / R) / R;
+                H[1][i + 3] = rho[i] / R;
+            }
+            return 1;
+
+        default:
+            q2   = rho[1] * rho[1] + rho[2] * rho[2];
+            q    = sqrt(q2);
+            z[1] = atan2(rho[2], rho[1]);
+            z[2] = asin(rho[3] / R);
+            H[1][1] = -rho[2] / q2;
+            H[1][2] = rho[1] / q2;
+            H[2][1] = -rho[1] * rho[3] / (R * R * q);
+            H[2][2] = -rho[2] * rho[3] / (R * R * q);
+            H[2][3] = q / (R * R);
+            return 2;
+    }
+}
+
+/*
+ *  odDerivs(fm, CdAm, Am, X, withSTM, dX)
+ *
+ *  Rates of the state X[1..6] and, if withSTM is non-zero, of the
+ *  state transition matrix X[7..42], stored by rows.
+ */
+static void odDerivs(batchForceModel *fm, double CdAm, double Am, double *X, int withSTM, double *dX)
+{
+    double A[3+1][6+1];
+    double a[3+1];
+    double *rp[3+1];
+    double *vp[3+1];
+    double *acc[3+1];
+    int    i;
+    int    j;
+    int    k;
+
+    if(!withSTM) {
+        for(i = 1; i <= 3; i++) {
+            rp[i]  = &X[i];
+            vp[i]  = &X[i + 3];
+            acc[i] = &a[i];
+        }
+        batchAccel(fm, 1, rp, vp, &CdAm, &Am, acc);
+    } else {
+        dualAccel(fm, CdAm, Am, &X[0], &X[3], a, A);
+    }
+    for(i = 1; i <= 3; i++) {
+        dX[i]     = X[i + 3];
+        dX[i + 3] = a[i];
+    }
+    if(!withSTM) {
+        return;
+    }
+
+    /* dPhi/dt = [0 I; A] Phi */
+    for(j = 1; j <= 6; j++) {
+        for(i = 1; i <= 3; i++) {
+            dX[6 + 6 * (i - 1) + j] = X[6 + 6 * (i + 2) + j];
+            dX[6 + 6 * (i + 2) + j] = 0.;
+            for(k = 1; k <= 6; k++) {
+                dX[6 + 6 * (i + 2) + j] += A[i][k] * X[6 + 6 * (k - 1) + j];
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ *  odStep(fm, CdAm, Am, X, withSTM, h)
+ *
+ *  Advances X by one RK4 step of h seconds.
+ */
+static void odStep(batchForceModel *fm, double CdAm, double Am, double *X, int withSTM, double h)
+{
+    double k1[OD_NX+1];
+    double k2[OD_NX+1];
+    double k3[OD_NX+1];
+    double k4[OD_NX+1];
+    double Y[OD_NX+1];
+    int    nx;
+    int    i;
+
+    nx = withSTM ? OD_NX : 6;
+    odDerivs(fm, CdAm, Am, X, withSTM, k1);
+    for(i = 1; i <= nx; i++) {
+        Y[i] = X[i] + h / 2. * k1[i];
+    }
+    odDerivs(fm, CdAm, Am, Y, withSTM, k2);
+    for(i = 1; i <= nx; i++) {
+        Y[i] = X[i] + h / 2. * k2[i];
+    }
+    odDerivs(fm, CdAm, Am, Y, withSTM, k3);
+    for(i = 1; i <= nx; i++) {
+        Y[i] = X[i] + h * k3[i];
+    }
+    odDerivs(fm, CdAm, Am, Y, withSTM, k4);
+    for(i = 1; i <= nx; i++) {
+        X[i] += h / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+    }
+
+    return;
+}
+
+/*
+ *  odPropagate(fm, CdAm, Am, X, withSTM, t, dt)
+ *
+ *  Propagates the state X[1..6] and, if withSTM is non-zero, the
+ *  state transition matrix X[7..42] (stored by rows) by t seconds
+ *  with RK4 steps of at most dt seconds.
+ */
+void odPropagate(batchForceModel *fm, double CdAm, double Am, double *X, int withSTM, double t, double dt)
+{
+    double s;
+    double h;
+
+    s = 0.;
+    while(s < t) {
+        h = fmin(dt, t - s);
+        odStep(fm, CdAm, Am, X, withSTM, h);
+        s = (h == dt) ? s + h : t;
+    }
+
+    return;
+}
+
+/*
+ *  odAccumulate(obs, X, limit, L, N, ss, m)
+ *
+ *  Adds the observation obs, with the propagated state and state
+ *  transition matrix X, to the normal matrix L and vector N, and its
+ *  squared normalized residuals to ss and their number to m, unless
+ *  a residual exceeds limit.
+ */
+static void odAccumulate(odObservation *obs, double *X, double limit, double L[7][7], double *N,
+                         double *ss, int *m)
+{
+    double z[2+1];
+    double Hl[2+1][6+1];
+    double Hx[2+1][6+1];
+    double y[2+1];
+    int    num;
+    int    c;
+    int    i;
+    int    j;
+    int    k;
+
+    num = odPredict(obs, &X[0], &X[3], z, Hl);
+    for(c = 1; c <= num; c++) {
+        y[c] = (obs->z[c] - z[c]) / obs->sigma;
+    }
+    if(obs->type == OD_ANGLES) {
+        y[1] = remainder(obs->z[1] - z[1], 2. * M_PI) * cos(z[2]) / obs->sigma;
+        for(j = 1; j <= 6; j++) {
+            Hl[1][j] *= cos(z[2]);
+        }
+    }
+    for(c = 1; c <= num; c++) {
+        if(fabs(y[c]) > limit) {
+            return;
+        }
+    }
+
+    for(c = 1; c <= num; c++) {
+        for(j = 1; j <= 6; j++) {
+            Hx[c][j] = 0.;
+            for(k = 1; k <= 6; k++) {
+                Hx[c][j] += Hl[c][k] * X[6 + 6 * (k - 1) + j];
+            }
+            Hx[c][j] /= obs->sigma;
+        }
+        for(i = 1; i <= 6; i++) {
+            for(j = 1; j <= 6; j++) {
+                L[i][j] += Hx[c][i] * Hx[c][j];
+            }
+            N[i] += Hx[c][i] * y[c];
+        }
+        *ss += y[c] * y[c];
+        (*m)++;
+    }
+
+    return;
+}
+
+/*
+ *  iter = odFit(set, x0, CdAm, Am, obs, numObs, P0inv, res)
+ *
+ *  Estimates the epoch state from the numObs observations obs,
+ *  sorted by increasing time t >= 0, starting from the a priori
+ *  state x0 with information matrix P0inv (NULL for none).  CdAm and
+ *  Am are the drag and solar radiation parameters of the force
+ *  model.  Angle residuals are weighted along the sky, i.e. the
+ *  right ascension residual is scaled by cos(declination).  Returns
+ *  the number of iterations and the result in res, or -1 if there
+ *  are no observations, they are out of order or the normal
+ *  equations are singular.
+ */
+int odFit(odSettings *set, double *x0, double CdAm, double Am, odObservation *obs, int numObs,
+          double P0inv[7][7], odResult *res)
+{
+    double *Xs;
+    double  X[OD_NX+1];
+    double  x[6+1];
+    double  L[7][7];
+    double  N[6+1];
+    double  dx[6+1];
+    double  e[6+1];
+    double  t;
+    double  ss;
+    double  rms;
+    double  rmsPrev;
+    double  limit;
+    int     numChunks;
+    int     m;
+    int     iter;
+    int     i;
+    int     j;
+    int     k;
+
+    if(numObs < 1) {
+        printf("ERROR: odFit() received numObs = %d \n", numObs);
+        printf("The value of numObs should be numObs >= 1. \n");
+        return -1;
+    }
+    if(obs[0].t < 0.) {
+        printf("ERROR: odFit() received observation 0 at t = %g \n", obs[0].t);
+        printf("The observations should be sorted by time t >= 0. \n");
+        return -1;
+    }
+    for(k = 1; k < numObs; k++) {
+        if(obs[k].t < obs[k - 1].t) {
+            printf("ERROR: odFit() received observation %d at t = %g \n", k, obs[k].t);
+            printf("The observations should be sorted by time t >= 0. \n");
+            return -1;
+        }
+    }
+    Xs = (double *)malloc(sizeof(double) * (OD_NX + 1) * numObs);
+    if(Xs == NULL) {
+        return -1;
+    }
+
+    memcpy(x, x0, sizeof(x));
+    memset(res, 0, sizeof(odResult));
+    numChunks = (numObs + OD_CHUNK - 1) / OD_CHUNK;
+    rmsPrev   = INFINITY;
+    for(iter = 1; iter <= set->maxIter; iter++) {
+        /* state and state transition matrix at every observation */
+        memset(X, 0, sizeof(X));
+        memcpy(X, x, sizeof(x));
+        for(i = 1; i <= 6; i++) {
+            X[6 + 6 * (i - 1) + i] = 1.;
+        }
+        t = 0.;
+        for(k = 0; k < numObs; k++) {
+            odPropagate(&set->fm, CdAm, Am, X, 1, obs[k].t - t, set->dt);
+            t = obs[k].t;
+            memcpy(&Xs[(OD_NX + 1) * k], X, sizeof(X));
+        }
+
+        /* normal equations, accumulated by chunks */
+        memset(L, 0, sizeof(L));
+        memset(N, 0, sizeof(N));
+        ss    = 0.;
+        m     = 0;
+        limit = ((set->editSigma > 0.) && (iter > 1)) ? set->editSigma * rmsPrev : INFINITY;
+        if(P0inv != NULL) {
+            for(i = 1; i <= 6; i++) {
+                for(j = 1; j <= 6; j++) {
+                    L[i][j] += P0inv[i][j];
+                    N[i]    += P0inv[i][j] * (x0[j] - x[j]);
+                }
+            }
+        }
+        {
+            double (*Lc)[7][7];
+            double (*Nc)[6+1];
+            double  *ssc;
+            int     *mc;
+            int      c;
+
+            Lc  = calloc(numChunks, sizeof(*Lc));
+            Nc  = calloc(numChunks, sizeof(*Nc));
+            ssc = calloc(numChunks, sizeof(double));
+            mc  = calloc(numChunks, sizeof(int));
+            if((Lc == NULL) || (Nc == NULL) || (ssc == NULL) || (mc == NULL)) {
+                free(Lc);
+                free(Nc);
+                free(ssc);
+                free(mc);
+                free(Xs);
+                return -1;
+            }
+
+            #pragma omp parallel for schedule(static) if(numObs >= OD_PARALLEL_MIN)
+            for(c = 0; c < numChunks; c++) {
+                int kk;
+
+                for(kk = c * OD_CHUNK; (kk < (c + 1) * OD_CHUNK) && (kk < numObs); kk++) {
+                    odAccumulate(&obs[kk], &Xs[(OD_NX + 1) * kk], limit, Lc[c], Nc[c], &ssc[c], &mc[c]);
+                }
+            }
+
+            for(c = 0; c < numChunks; c++) {
+                for(i = 1; i <= 6; i++) {
+                    for(j = 1; j <= 6; j++) {
+                        L[i][j] += Lc[c][i][j];
+                    }
+                    N[i] += Nc[c][i];
+                }
+                ss += ssc[c];
+                m  += mc[c];
+            }
+            free(Lc);
+            free(Nc);
+            free(ssc);
+            free(mc);
+        }
+
+        rms          = (m > 0) ? sqrt(ss / m) : 0.;
+        res->rms     = rms;
+        res->numUsed = m;
+        res->numIter = iter;
+        if(odCholesky(6, L) != 0) {
+            free(Xs);
+            printf("ERROR: odFit() found singular normal equations with %d residuals \n", m);
+            printf("The observations should determine all six state components. \n");
+            return -1;
+        }
+        odCholeskySolve(6, L, N, dx);
+        for(i = 1; i <= 6; i++) {
+            x[i] += dx[i];
+        }
+        if(fabs(rms - rmsPrev) <= set->tol * rms) {
+            res->converged = 1;
+            break;
+        }
+        rmsPrev = rms;
+    }
+
+    /* formal covariance (L L^T)^-1 */
+    for(j = 1; j <= 6; j++) {
+        memset(e, 0, sizeof(e));
+        e[j] = 1.;
+        odCholeskySolve(6, L, e, e);
+        for(i = 1; i <= 6; i++) {
+            res->P[i][j] = e[i];
+        }
+    }
+    memcpy(res->x0, x, sizeof(x));
+    free(Xs);
+
+    return res->numIter;
+}
+
+/*
+ *  odBatchFit(set, n, x0, CdAm, Am, obs, numObs, res)
+ *
+ *  Fits the n objects with a priori states x0[1..6][k], parameters
+ *  CdAm[k], Am[k] (either may be NULL for zeros) and observations
+ *  obs[k][0..numObs[k]-1] in parallel, one object per thread,
+ *  returning res[k].  Failed fits return numIter = -1.
+ */
+void odBatchFit(odSettings *set, int n, double *x0[6+1], double *CdAm, double *Am,
+                odObservation **obs, int *numObs, odResult *res)
+{
+    int k;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(k = 0; k < n; k++) {
+        double x[6+1];
+        int    i;
+
+        for(i = 1; i <= 6; i++) {
+            x[i] = x0[i][k];
+        }
+        if(odFit(set, x, (CdAm != NULL) ? CdAm[k] : 0., (Am != NULL) ? Am[k] : 0.,
+                 obs[k], numObs[k], NULL, &res[k]) < 0) {
+            res[k].numIter = -1;
+        }
+    }
+
+    return;
+}
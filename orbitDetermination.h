@@ -0,0 +1,78 @@
+/*
+ *  orbitDetermination.h
+ *  OrbitalMotion
+ *
+ *  Batch weighted least-squares orbit determination.  The epoch
+ *  state x0 = [r v] is corrected iteratively from range, range-rate
+ *  and right ascension/declination measurements taken from stations
+ *  with known inertial states.  Each iteration propagates the state
+ *  and its state transition matrix with the batch force model,
+ *  accumulates the normal equations over chunks of observations in
+ *  parallel, and solves them with a 6x6 Cholesky factorization.
+ *  Residuals beyond a multiple of the previous weighted RMS are
+ *  edited out.  Many objects are fitted in parallel with
+ *  odBatchFit().
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "batchPropagation.h"
+
+#ifndef _ORBIT_DETERMINATION_H_
+#define _ORBIT_DETERMINATION_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define OD_RANGE            1       /* range (km) */
+    #define OD_RANGE_RATE       2       /* range-rate (km/s) */
+    #define OD_ANGLES           3       /* right ascension and declination (rad) */
+
+    #define OD_CHUNK            256     /* observations per accumulation chunk */
+    #define OD_PARALLEL_MIN     4096    /* fewest observations accumulated with several threads */
+
+    typedef struct odObsStruct {
+        double t;                       /* time past the estimation epoch (sec) */
+        int    type;                    /* OD_RANGE, OD_RANGE_RATE or OD_ANGLES */
+        double rSite[3+1];              /* inertial station position (km) */
+        double vSite[3+1];              /* inertial station velocity (km/s) */
+        double z[2+1];                  /* measured value(s) */
+        double sigma;                   /* measurement noise standard deviation */
+    } odObservation;
+
+    typedef struct odSettingsStruct {
+        batchForceModel fm;             /* force model of the state propagation */
+        double dt;                      /* largest integration step (sec) */
+        int    maxIter;                 /* iteration limit */
+        double tol;                     /* relative change of the RMS at convergence */
+        double editSigma;               /* residuals above editSigma * RMS are edited, 0 for none */
+    } odSettings;
+
+    typedef struct odResultStruct {
+        double x0[6+1];                 /* estimated epoch state */
+        double P[7][7];                 /* formal covariance of x0 */
+        double rms;                     /* weighted RMS of the used residuals */
+        int    numUsed;                 /* residuals used in the last iteration */
+        int    numIter;                 /* iterations performed */
+        int    converged;               /* non-zero if the RMS converged */
+    } odResult;
+
+    void   odInitSettings(odSettings *set);
+    int    odCholesky(int n, double A[7][7]);
+    void   odCholeskySolve(int n, double L[7][7], double *b, double *x);
+    int    odPredict(odObservation *obs, double *r, double *v, double *z, double H[2+1][6+1]);
+    void   odPropagate(batchForceModel *fm, double CdAm, double Am, double *X, int withSTM,
+                       double t, double dt);
+    int    odFit(odSettings *set, double *x0, double CdAm, double Am, odObservation *obs, int numObs,
+                 double P0inv[7][7], odResult *res);
+    void   odBatchFit(odSettings *set, int n, double *x0[6+1], double *CdAm, double *Am,
+                      odObservation **obs, int *numObs, odResult *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
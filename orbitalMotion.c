@@ -643,6 +643,154 @@ void AtmosphericDrag(double Cd, double A, double m, double *rvec, double *vvec,
     return;
 }
 
+/*
+ *  Zonal perturbation polynomials in s = z/r of JPerturb(), scaled by
+ *  the constants JP_C2..JP_C6 of orbitalMotion.h.  The degree n term
+ *  of the acceleration is r^-(n+2) [X_n x/r, X_n y/r, Z_n].
+ */
+#define JP_X2(s, s2)    (JP_C2 * (1. - 5. * (s2)))
+#define JP_Z2(s, s2)    (JP_C2 * (3. - 5. * (s2)) * (s))
+#define JP_X3(s, s2)    (JP_C3 * (-15. + 35. * (s2)) * (s))
+#define JP_Z3(s, s2)    (JP_C3 * (3. + (s2) * (-30. + 35. * (s2))))
+#define JP_X4(s, s2)    (JP_C4 * (3. + (s2) * (-42. + 63. * (s2))))
+#define JP_Z4(s, s2)    (JP_C4 * (15. + (s2) * (-70. + 63. * (s2))) * (s))
+#define JP_X5(s, s2)    (JP_C5 * (105. + (s2) * (-630. + 693. * (s2))) * (s))
+#define JP_Z5(s, s2)    (JP_C5 * (-15. + (s2) * (315. + (s2) * (-945. + 693. * (s2)))))
+#define JP_X6(s, s2)    (JP_C6 * (35. + (s2) * (-945. + (s2) * (3465. - 3003. * (s2)))))
+#define JP_Z6(s, s2)    (JP_C6 * (245. + (s2) * (-2205. + (s2) * (4851. - 3003. * (s2)))) * (s))
+
+/*
+ *  JPerturbScale(rvec, ri, px, pz, ajtot)
+ *
+ *  Forms the acceleration from the sums px = sum X_n r^-(n-2) and
+ *  pz = sum Z_n r^-(n-2) and ri = 1/r.
+ */
+static void JPerturbScale(double *rvec, double ri, double px, double pz, double *ajtot)
+{
+    double f;
+
+    f = ri * ri * ri * ri;
+    ajtot[1] = f * px * rvec[1] * ri;
+    ajtot[2] = f * px * rvec[2] * ri;
+    ajtot[3] = f * pz;
+
+    return;
+}
+
+/*
+ *  JPerturb2(rvec,ajtot) ... JPerturb6(rvec,ajtot)
+ *
+ *  Purpose:  Computes the J2_EARTH-JN_EARTH zonal gravitational
+ *            perturbation accelerations with the degree fixed, the
+ *            same as JPerturb(rvec,N,ajtot) without the degree
+ *            checks.  The degrees are summed with Horner's rule in
+ *            1/r.
+ */
+void JPerturb2(double *rvec, double *ajtot)
+{
+    double ri;
+    double s;
+    double s2;
+
+    ri = 1. / norm(rvec);
+    s  = rvec[3] * ri;
+    s2 = s * s;
+    JPerturbScale(rvec, ri, JP_X2(s, s2), JP_Z2(s, s2), ajtot);
+
+    return;
+}
+
+void JPerturb3(double *rvec, double *ajtot)
+{
+    double ri;
+    double s;
+    double s2;
+    double px;
+    double pz;
+
+    ri = 1. / norm(rvec);
+    s  = rvec[3] * ri;
+    s2 = s * s;
+    px = JP_X2(s, s2) + ri * JP_X3(s, s2);
+    pz = JP_Z2(s, s2) + ri * JP_Z3(s, s2);
+    JPerturbScale(rvec, ri, px, pz, ajtot);
+
+    return;
+}
+
+void JPerturb4(double *rvec, double *ajtot)
+{
+    double ri;
+    double s;
+    double s2;
+    double px;
+    double pz;
+
+    ri = 1. / norm(rvec);
+    s  = rvec[3] * ri;
+    s2 = s * s;
+    px = JP_X2(s, s2) + ri * (JP_X3(s, s2) + ri * JP_X4(s, s2));
+    pz = JP_Z2(s, s2) + ri * (JP_Z3(s, s2) + ri * JP_Z4(s, s2));
+    JPerturbScale(rvec, ri, px, pz, ajtot);
+
+    return;
+}
+
+void JPerturb5(double *rvec, double *ajtot)
+{
+    double ri;
+    double s;
+    double s2;
+    double px;
+    double pz;
+
+    ri = 1. / norm(rvec);
+    s  = rvec[3] * ri;
+    s2 = s * s;
+    px = JP_X2(s, s2) + ri * (JP_X3(s, s2) + ri * (JP_X4(s, s2) + ri * JP_X5(s, s2)));
+    pz = JP_Z2(s, s2) + ri * (JP_Z3(s, s2) + ri * (JP_Z4(s, s2) + ri * JP_Z5(s, s2)));
+    JPerturbScale(rvec, ri, px, pz, ajtot);
+
+    return;
+}
+
+void JPerturb6(double *rvec, double *ajtot)
+{
+    double ri;
+    double s;
+    double s2;
+    double px;
+    double pz;
+
+    ri = 1. / norm(rvec);
+    s  = rvec[3] * ri;
+    s2 = s * s;
+    px = JP_X2(s, s2) + ri * (JP_X3(s, s2) + ri * (JP_X4(s, s2) + ri * (JP_X5(s, s2) + ri * JP_X6(s, s2))));
+    pz = JP_Z2(s, s2) + ri * (JP_Z3(s, s2) + ri * (JP_Z4(s, s2) + ri * (JP_Z5(s, s2) + ri * JP_Z6(s, s2))));
+    JPerturbScale(rvec, ri, px, pz, ajtot);
+
+    return;
+}
+
+/*
+ *  fcn = JPerturbSelect(num)
+ *
+ *  Purpose:  Returns the zonal perturbation function JPerturb2() to
+ *            JPerturb6() for the degree num, so that callers which fix
+ *            the degree once can skip the per call dispatch of
+ *            JPerturb().  Returns NULL if num is not between 2 and 6.
+ */
+JPerturbFcn JPerturbSelect(int num)
+{
+    static const JPerturbFcn fcn[6+1] = {NULL, NULL, JPerturb2, JPerturb3, JPerturb4, JPerturb5, JPerturb6};
+
+    if((num < 2) || (num > 6)) {
+        return NULL;
+    }
+
+    return fcn[num];
+}
+
 /*
  *  JPerturb(rvec,num,ajtot)
  *
@@ -663,18 +811,6 @@ void AtmosphericDrag(double Cd, double A, double m, double *rvec, double *vvec,
  */
 void JPerturb(double *rvec, int num, double *ajtot)
 {
-    double mu, req, x, y, z, r, temp[4], temp2[4];
-
-    /* Constants for Earth */
-    mu  = MU_EARTH;
-    req = REQ_EARTH;
-
-    /* Calculate the J perturbations */
-    x = rvec[1];
-    y = rvec[2];
-    z = rvec[3];
-    r = norm(rvec);
-
     /* Error Checking */
     if((num < 2) || (num > 6)) {
         printf("ERROR: jPerturb() received num = %d \n", num);
@@ -683,31 +819,7 @@ void JPerturb(double *rvec, int num, double *ajtot)
         return;
     }
 
-    /* Calculating the total acceleration based on user input */
-    if(num >= 2) {
-        set3((1 - 5 * pow(z / r, 2))*(x / r), (1 - 5 * pow(z / r, 2))*(y / r), (3 - 5 * pow(z / r, 2))*(z / r), ajtot);
-        mult(-3. / 2.*J2_EARTH*(mu / pow(r, 2))*pow(req / r, 2), ajtot, ajtot);
-    }
-    if(num >= 3) {
-        set3(5 *(7 * pow(z / r, 3) - 3 *(z / r))*(x / r), 5 *(7 * pow(z / r, 3) - 3 *(z / r))*(y / r), -3 *(10 * pow(z / r, 2) - (35. / 3.)*pow(z / r, 4) - 1), temp);
-        mult(1. / 2.*J3_EARTH*(mu / pow(r, 2))*pow(req / r, 3), temp, temp2);
-        add(ajtot, temp2, ajtot);
-    }
-    if(num >= 4) {
-        set3((3 - 42 * pow(z / r, 2) + 63 * pow(z / r, 4))*(x / r), (3 - 42 * pow(z / r, 2) + 63 * pow(z / r, 4))*(y / r), (15 - 70 * pow(z / r, 2) + 63 * pow(z / r, 4))*(z / r), temp);
-        mult(5. / 8.*J4_EARTH*(mu / pow(r, 2))*pow(req / r, 4), temp, temp2);
-        add(ajtot, temp2, ajtot);
-    }
-    if(num >= 5) {
-        set3(3 *(35 *(z / r) - 210 * pow(z / r, 3) + 231 * pow(z / r, 5))*(x / r), 3 *(35 *(z / r) - 210 * pow(z / r, 3) + 231 * pow(z / r, 5))*(y / r), -(15 - 315 * pow(z / r, 2) + 945 * pow(z / r, 4) - 693 * pow(z / r, 6)), temp);
-        mult(1. / 8.*J5_EARTH*(mu / pow(r, 2))*pow(req / r, 5), temp, temp2);
-        add(ajtot, temp2, ajtot);
-    }
-    if(num >= 6) {
-        set3((35 - 945 * pow(z / r, 2) + 3465 * pow(z / r, 4) - 3003 * pow(z / r, 6))*(x / r), (35 - 945 * pow(z / r, 2) + 3465 * pow(z / r, 4) - 3003 * pow(z / r, 6))*(y / r), -(3003 * pow(z / r, 6) - 4851 * pow(z / r, 4) + 2205 * pow(z / r, 2) - 245)*(z / r), temp);
-        mult(-1. / 16.*J6_EARTH*(mu / pow(r, 2))*pow(req / r, 6), temp, temp2);
-        add(ajtot, temp2, ajtot);
-    }
+    JPerturbSelect(num)(rvec, ajtot);
 
     return;
 }
@@ -23,6 +23,15 @@ extern "C"  {
 
     #define N_DEBYE_PARAMETERS 37
 
+    /* zonal constants c_n J_n mu req^n of JPerturb(), folded at compile time */
+    #define JP_C2   (-3. / 2. * J2_EARTH * MU_EARTH * REQ_EARTH * REQ_EARTH)
+    #define JP_C3   (1. / 2. * J3_EARTH * MU_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH)
+    #define JP_C4   (5. / 8. * J4_EARTH * MU_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH)
+    #define JP_C5   (1. / 8. * J5_EARTH * MU_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH \
+                     * REQ_EARTH)
+    #define JP_C6   (-1. / 16. * J6_EARTH * MU_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH * REQ_EARTH \
+                     * REQ_EARTH * REQ_EARTH)
+
     typedef struct classicElem {
         double a;
         double e;
@@ -32,6 +41,8 @@ extern "C"  {
         double anom;
     } classicElements;
 
+    typedef void (*JPerturbFcn)(double *rvec, double *ajtot);
+
     double  E2f(double E, double e);
     double  E2M(double E, double e);
     double  f2E(double f, double e);
@@ -47,6 +58,12 @@ extern "C"  {
     double  Debye(double alt);
     void    AtmosphericDrag(double Cd, double A, double m, double *rvec, double *vvec, double *advec);
     void    JPerturb(double *rvec, int num, double *ajtot);
+    void    JPerturb2(double *rvec, double *ajtot);
+    void    JPerturb3(double *rvec, double *ajtot);
+    void    JPerturb4(double *rvec, double *ajtot);
+    void    JPerturb5(double *rvec, double *ajtot);
+    void    JPerturb6(double *rvec, double *ajtot);
+    JPerturbFcn JPerturbSelect(int num);
     void    SolarRad(double A, double m, double *sunvec, double *arvec);
 
 #ifdef __cplusplus
@@ -0,0 +1,463 @@
+/*
+ *  parareal.c
+ *  OrbitalMotion
+ *
+ *  With the slice boundaries T_k = t0 + k dt, the coarse propagator G
+ *  and the fine propagator F over one slice, the states U_k of the
+ *  boundaries are iterated as
+ *
+ *      U_(k+1) <- G(U_k new) + F(U_k old) - G(U_k old)
+ *
+ *  starting from the coarse sweep U_(k+1) = G(U_k).  For bound orbits
+ *  the update is formed in equinoctial elements, in which a phase
+ *  error is a difference of the mean longitude only; Cartesian
+ *  updates turn it into radial errors that the Kepler flow amplifies
+ *  and fail to converge once the arc spans many revolutions.  The fine
+ *  solutions of all slices are independent and computed in parallel;
+ *  the coarse correction sweep is sequential but cheap.  Slices
+ *  whose initial state is already exact are not integrated again.
+ *
+ *  The J2 coarse propagator converts the state to equinoctial
+ *  elements, advances the node, the argument of perigee and the mean
+ *  anomaly with the secular J2 rates and converts back.  The rates
+ *  use the mean semi-major axis, the osculating one less its first
+ *  order short period J2 variation
+ *
+ *      da = J2 Req^2 / a [(1 - 3/2 sin^2 i) ((a/r)^3 - (1-e^2)^-3/2)
+ *                          + 3/2 sin^2 i (a/r)^3 cos 2(omega + f)]
+ *
+ *  since an error of the mean motion accumulates along the arc and
+ *  slows the convergence of the iteration.  The other short period
+ *  terms are left to the difference F - G.
+ *
+ *  References:
+ *  J.-L. Lions, Y. Maday and G. Turinici, "A parareal in time
+ *  discretization of PDEs", C. R. Acad. Sci. Paris, 332, 2001.
+ */
+
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "parareal.h"
+#include "symplectic.h"
+#include "orbitDesign.h"
+
+/*
+ *  prInitSettings(set, fm, CdAm, Am, h)
+ *
+ *  Default settings for the fine force model fm, the object
+ *  parameters CdAm and Am and the fine step h: J2 coarse propagation,
+ *  one slice per thread and a tolerance of 1e-10.
+ */
+void prInitSettings(prSettings *set, batchForceModel *fm, double CdAm, double Am, double h)
+{
+    set->fm      = *fm;
+    set->CdAm    = CdAm;
+    set->Am      = Am;
+    set->coarse  = PR_J2;
+    set->h       = h;
+#ifdef _OPENMP
+    set->numSlices = omp_get_max_threads();
+#else
+    set->numSlices = 1;
+#endif
+    set->tol     = 1e-10;
+    set->maxIter = 0;
+
+    return;
+}
+
+/*
+ *  prEquinoctial(mu, r, v, x)
+ *
+ *  Equinoctial elements x = [a ex ey p q lambda] of a bound orbit,
+ *  with p = tan(i/2) sin(Omega), q = tan(i/2) cos(Omega), the
+ *  eccentricity vector components ex, ey along the equinoctial axes
+ *  and the mean longitude lambda.  Singular for i = 180 deg only.
+ */
+static void prEquinoctial(double mu, double *r, double *v, double *x)
+{
+    double h[3+1];
+    double e[3+1];
+    double f[3+1];
+    double g[3+1];
+    double rm;
+    double s;
+    double b;
+    double X;
+    double Y;
+    double cF;
+    double sF;
+
+    rm = norm(r);
+    cross(r, v, h);
+    s = norm(h);
+    x[4] = h[1] / (s + h[3]);
+    x[5] = -h[2] / (s + h[3]);
+    x[1] = 1. / (2. / rm - dot(v, v) / mu);
+
+    s = 1. + x[4] * x[4] + x[5] * x[5];
+    set3((1. - x[4] * x[4] + x[5] * x[5]) / s, 2. * x[4] * x[5] / s, -2. * x[4] / s, f);
+    set3(2. * x[4] * x[5] / s, (1. + x[4] * x[4] - x[5] * x[5]) / s, 2. * x[5] / s, g);
+
+    cross(v, h, e);
+    mult(1. / mu, e, e);
+    e[1] -= r[1] / rm;
+    e[2] -= r[2] / rm;
+    e[3] -= r[3] / rm;
+    x[2] = dot(e, f);
+    x[3] = dot(e, g);
+
+    X  = dot(r, f);
+    Y  = dot(r, g);
+    s  = sqrt(1. - x[2] * x[2] - x[3] * x[3]);
+    b  = 1. / (1. + s);
+    cF = x[2] + ((1. - x[2] * x[2] * b) * X - x[2] * x[3] * b * Y) / (x[1] * s);
+    sF = x[3] + ((1. - x[3] * x[3] * b) * Y - x[2] * x[3] * b * X) / (x[1] * s);
+    x[6] = atan2(sF, cF) - x[2] * sF + x[3] * cF;
+
+    return;
+}
+
+/*
+ *  prCartesian(mu, x, r, v)
+ *
+ *  Inverse of prEquinoctial().
+ */
+static void prCartesian(double mu, double *x, double *r, double *v)
+{
+    double f[3+1];
+    double g[3+1];
+    double s;
+    double b;
+    double F;
+    double dF;
+    double cF;
+    double sF;
+    double rm;
+    double n;
+    double X;
+    double Y;
+    double Xd;
+    double Yd;
+    int    i;
+
+    F = x[6];
+    for(i = 0; i < SYM_MAX_ITER; i++) {
+        dF = (F - x[2] * sin(F) + x[3] * cos(F) - x[6]) / (1. - x[2] * cos(F) - x[3] * sin(F));
+        F -= dF;
+        if(fabs(dF) < 1e-15) {
+            break;
+        }
+    }
+    cF = cos(F);
+    sF = sin(F);
+    s  = sqrt(1. - x[2] * x[2] - x[3] * x[3]);
+    b  = 1. / (1. + s);
+    rm = x[1] * (1. - x[2] * cF - x[3] * sF);
+    n  = sqrt(mu / (x[1] * x[1] * x[1]));
+    X  = x[1] * ((1. - x[3] * x[3] * b) * cF + x[2] * x[3] * b * sF - x[2]);
+    Y  = x[1] * ((1. - x[2] * x[2] * b) * sF + x[2] * x[3] * b * cF - x[3]);
+    Xd = x[1] * x[1] * n / rm * (x[2] * x[3] * b * cF - (1. - x[3] * x[3] * b) * sF);
+    Yd = x[1] * x[1] * n / rm * ((1. - x[2] * x[2] * b) * cF - x[2] * x[3] * b * sF);
+
+    s = 1. + x[4] * x[4] + x[5] * x[5];
+    set3((1. - x[4] * x[4] + x[5] * x[5]) / s, 2. * x[4] * x[5] / s, -2. * x[4] / s, f);
+    set3(2. * x[4] * x[5] / s, (1. + x[4] * x[4] - x[5] * x[5]) / s, 2. * x[5] / s, g);
+    for(i = 1; i <= 3; i++) {
+        r[i] = X * f[i] + Y * g[i];
+        v[i] = Xd * f[i] + Yd * g[i];
+    }
+
+    return;
+}
+
+/*
+ *  da = prShortPeriodA(r, v, a, e)
+ *
+ *  First order short period J2 variation of the semi-major axis of
+ *  the orbit r, v with the semi-major axis a and eccentricity e.
+ */
+static double prShortPeriodA(double *r, double *v, double a, double e)
+{
+    double h[3+1];
+    double n[3+1];
+    double s2;
+    double c2u;
+    double ar3;
+    double rm;
+
+    rm = norm(r);
+    cross(r, v, h);
+    set3(-h[2], h[1], 0., n);
+    s2  = dot(n, n) / dot(h, h);
+    c2u = 0.;
+    if(s2 > 0.) {
+        c2u = dot(n, r) / (norm(n) * rm);
+        c2u = 2. * c2u * c2u - 1.;
+    }
+    ar3 = (a / rm) * (a / rm) * (a / rm);
+
+    return J2_EARTH * REQ_EARTH * REQ_EARTH / a
+           * ((1. - 1.5 * s2) * (ar3 - pow(1. - e * e, -1.5)) + 1.5 * s2 * ar3 * c2u);
+}
+
+/*
+ *  prCoarse(set, dt, r, v)
+ *
+ *  Advances the state r, v by dt seconds with the coarse propagator.
+ *  Unbound orbits and force models without zonals use the Kepler
+ *  solution only.
+ */
+void prCoarse(prSettings *set, double dt, double *r, double *v)
+{
+    double x[6+1];
+    double dOmega;
+    double domega;
+    double dM;
+    double am;
+    double e;
+    double c;
+    double s;
+    double t;
+
+    if(set->coarse != PR_J2 || set->fm.jnum < 2 || 2. / norm(r) <= dot(v, v) / set->fm.mu) {
+        symKeplerDrift(set->fm.mu, r, v, dt);
+        return;
+    }
+    prEquinoctial(set->fm.mu, r, v, x);
+    e  = sqrt(x[2] * x[2] + x[3] * x[3]);
+    am = x[1] - prShortPeriodA(r, v, x[1], e);
+    J2SecularRates(am, e, 2. * atan(sqrt(x[4] * x[4] + x[5] * x[5])), &dOmega, &domega, &dM);
+
+    /* the eccentricity vector turns with the perigee longitude, (p, q) with the node */
+    c = cos((dOmega + domega) * dt);
+    s = sin((dOmega + domega) * dt);
+    t    = x[2] * c - x[3] * s;
+    x[3] = x[2] * s + x[3] * c;
+    x[2] = t;
+    c = cos(dOmega * dt);
+    s = sin(dOmega * dt);
+    t    = x[4] * c + x[5] * s;
+    x[5] = x[5] * c - x[4] * s;
+    x[4] = t;
+    x[6] = fmod(x[6] + (dM + domega + dOmega) * dt, 2. * M_PI);
+
+    x[1] = am;
+    prCartesian(set->fm.mu, x, r, v);
+    x[1] = am + prShortPeriodA(r, v, am, e);
+    prCartesian(set->fm.mu, x, r, v);
+
+    return;
+}
+
+/*
+ *  status = prFine(set, t0, dt, r, v)
+ *
+ *  Advances the state r, v at time t0 by dt > 0 seconds with the
+ *  Gauss-Jackson integration of the full force model.  Returns -1 if
+ *  the step is invalid or its startup did not converge.
+ */
+int prFine(prSettings *set, double t0, double dt, double *r, double *v)
+{
+    gjState gj;
+    int     status;
+
+    if(gjInit(&gj, &set->fm, set->CdAm, set->Am, GJ_TIME, set->h) != 0) {
+        return -1;
+    }
+    status = gjStart(&gj, t0, r, v);
+    if(gjPropagate(&gj, t0 + dt, r, v) != 0) {
+        status = -1;
+    }
+
+    return status;
+}
+
+/*
+ *  prCorrect(mu, rg, vg, F, G, u)
+ *
+ *  Parareal update u = G(U new) + F(U old) - G(U old), where rg, vg
+ *  is the new coarse solution and F, G are the old fine and coarse
+ *  slice results [r v].  The update is formed in equinoctial
+ *  elements when all three orbits are bound and in Cartesian
+ *  coordinates otherwise.
+ */
+static void prCorrect(double mu, double *rg, double *vg, double *F, double *G, double *u)
+{
+    double rf[3+1];
+    double vf[3+1];
+    double ro[3+1];
+    double vo[3+1];
+    double r[3+1];
+    double v[3+1];
+    double xg[6+1];
+    double xf[6+1];
+    double xo[6+1];
+    double d;
+    int    c;
+
+    set3(F[0], F[1], F[2], rf);
+    set3(F[3], F[4], F[5], vf);
+    set3(G[0], G[1], G[2], ro);
+    set3(G[3], G[4], G[5], vo);
+    if(2. / norm(rg) > dot(vg, vg) / mu && 2. / norm(rf) > dot(vf, vf) / mu
+       && 2. / norm(ro) > dot(vo, vo) / mu) {
+        prEquinoctial(mu, rg, vg, xg);
+        prEquinoctial(mu, rf, vf, xf);
+        prEquinoctial(mu, ro, vo, xo);
+        for(c = 1; c <= 5; c++) {
+            xg[c] += xf[c] - xo[c];
+        }
+        d = fmod(xf[6] - xo[6], 2. * M_PI);
+        if(d > M_PI) {
+            d -= 2. * M_PI;
+        } else if(d < -M_PI) {
+            d += 2. * M_PI;
+        }
+        xg[6] += d;
+        prCartesian(mu, xg, r, v);
+    } else {
+        for(c = 1; c <= 3; c++) {
+            r[c] = rg[c] + rf[c] - ro[c];
+            v[c] = vg[c] + vf[c] - vo[c];
+        }
+    }
+    for(c = 0; c < 3; c++) {
+        u[c]     = r[c + 1];
+        u[c + 3] = v[c + 1];
+    }
+
+    return;
+}
+
+/*
+ *  iter = pararealPropagate(set, t0, t, r, v, X)
+ *
+ *  Propagates the state r, v from t0 to t > t0 with numSlices equal
+ *  slices.  If X is not NULL it receives the numSlices+1 boundary
+ *  states as X[6*k + c], c = 0..5 being the components of [r v] at
+ *  t0 + k (t - t0) / numSlices.  Returns the number of iterations,
+ *  or -1 if the slice states did not settle within maxIter
+ *  iterations (the last iterate is returned) or on failure.
+ */
+int pararealPropagate(prSettings *set, double t0, double t, double *r, double *v, double *X)
+{
+    double *U;
+    double *F;
+    double *G;
+    double  rk[3+1];
+    double  vk[3+1];
+    double  u[6];
+    double  dt;
+    double  d;
+    double  change;
+    int     S;
+    int     maxIter;
+    int     converged;
+    int     it;
+    int     k;
+    int     c;
+
+    S = set->numSlices;
+    if(S < 1) {
+        printf("ERROR: pararealPropagate() received numSlices = %d \n", S);
+        printf("The value of numSlices should be numSlices >= 1. \n");
+        return -1;
+    }
+    if(t <= t0) {
+        printf("ERROR: pararealPropagate() received t = %g \n", t);
+        printf("The value of t should be t > t0 = %g. \n", t0);
+        return -1;
+    }
+    if(set->h <= 0.) {
+        printf("ERROR: pararealPropagate() received h = %g \n", set->h);
+        printf("The value of h should be h > 0. \n");
+        return -1;
+    }
+    U = (double *)malloc(sizeof(double) * 6 * (S + 1));
+    F = (double *)malloc(sizeof(double) * 6 * S);
+    G = (double *)malloc(sizeof(double) * 6 * S);
+    if(U == NULL || F == NULL || G == NULL) {
+        free(U);
+        free(F);
+        free(G);
+        return -1;
+    }
+    dt      = (t - t0) / S;
+    maxIter = (set->maxIter > 0) ? set->maxIter : S;
+
+    /* initial coarse sweep */
+    for(c = 0; c < 3; c++) {
+        U[c]     = r[c + 1];
+        U[c + 3] = v[c + 1];
+    }
+    for(k = 0; k < S; k++) {
+        set3(U[6 * k], U[6 * k + 1], U[6 * k + 2], rk);
+        set3(U[6 * k + 3], U[6 * k + 4], U[6 * k + 5], vk);
+        prCoarse(set, dt, rk, vk);
+        for(c = 0; c < 3; c++) {
+            G[6 * k + c]           = rk[c + 1];
+            G[6 * k + c + 3]       = vk[c + 1];
+            U[6 * (k + 1) + c]     = rk[c + 1];
+            U[6 * (k + 1) + c + 3] = vk[c + 1];
+        }
+    }
+
+    converged = 0;
+    for(it = 1; it <= maxIter; it++) {
+        /* fine solutions of the slices that are not exact yet */
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(k = it - 1; k < S; k++) {
+            double rf[3+1];
+            double vf[3+1];
+            int    i;
+
+            set3(U[6 * k], U[6 * k + 1], U[6 * k + 2], rf);
+            set3(U[6 * k + 3], U[6 * k + 4], U[6 * k + 5], vf);
+            prFine(set, t0 + k * dt, dt, rf, vf);
+            for(i = 0; i < 3; i++) {
+                F[6 * k + i]     = rf[i + 1];
+                F[6 * k + i + 3] = vf[i + 1];
+            }
+        }
+
+        /* sequential coarse correction */
+        change = 0.;
+        for(k = it - 1; k < S; k++) {
+            set3(U[6 * k], U[6 * k + 1], U[6 * k + 2], rk);
+            set3(U[6 * k + 3], U[6 * k + 4], U[6 * k + 5], vk);
+            prCoarse(set, dt, rk, vk);
+            prCorrect(set->fm.mu, rk, vk, &F[6 * k], &G[6 * k], u);
+            d = 0.;
+            for(c = 0; c < 3; c++) {
+                d += (u[c] - U[6 * (k + 1) + c]) * (u[c] - U[6 * (k + 1) + c]);
+                G[6 * k + c]     = rk[c + 1];
+                G[6 * k + c + 3] = vk[c + 1];
+            }
+            memcpy(&U[6 * (k + 1)], u, sizeof(u));
+            d = sqrt(d) / norm(rk);
+            if(d > change) {
+                change = d;
+            }
+        }
+        if(change <= set->tol || it >= S) {
+            converged = 1;
+            break;
+        }
+    }
+
+    for(c = 0; c < 3; c++) {
+        r[c + 1] = U[6 * S + c];
+        v[c + 1] = U[6 * S + c + 3];
+    }
+    if(X != NULL) {
+        memcpy(X, U, sizeof(double) * 6 * (S + 1));
+    }
+    free(U);
+    free(F);
+    free(G);
+
+    return converged ? it : -1;
+}
@@ -0,0 +1,54 @@
+/*
+ *  parareal.h
+ *  OrbitalMotion
+ *
+ *  Parareal parallel-in-time propagation of a single long arc.  The
+ *  arc is cut into time slices.  A cheap coarse propagator, either
+ *  the Kepler solution or the Kepler solution with the J2 secular
+ *  drift of the node, perigee and mean anomaly, sweeps the slices
+ *  sequentially, while the expensive fine propagator, Gauss-Jackson
+ *  with the full batch force model, integrates all slices at once on
+ *  the threads.  The slice states are corrected with the difference
+ *  between the fine and coarse results, taken in equinoctial elements
+ *  for bound orbits, until they settle.  After iteration k the first
+ *  k slices are exact, so the scheme never needs more iterations than
+ *  there are slices.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "gaussJackson.h"
+
+#ifndef _PARAREAL_H_
+#define _PARAREAL_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define PR_KEPLER           1       /* coarse propagation with the Kepler solution */
+    #define PR_J2               2       /* Kepler solution with the J2 secular rates */
+
+    typedef struct prSettingsStruct {
+        batchForceModel fm;             /* force model of the fine propagator */
+        double CdAm;                    /* drag ballistic factor Cd*A/m (m^2/kg) */
+        double Am;                      /* area to mass ratio A/m (m^2/kg) */
+        int    coarse;                  /* PR_KEPLER or PR_J2 */
+        double h;                       /* Gauss-Jackson step of the fine propagator (sec) */
+        int    numSlices;               /* time slices, by default one per thread */
+        double tol;                     /* slice state change relative to |r| that ends the iteration */
+        int    maxIter;                 /* iteration limit, 0 for numSlices */
+    } prSettings;
+
+    void prInitSettings(prSettings *set, batchForceModel *fm, double CdAm, double Am, double h);
+    void prCoarse(prSettings *set, double dt, double *r, double *v);
+    int  prFine(prSettings *set, double t0, double dt, double *r, double *v);
+    int  pararealPropagate(prSettings *set, double t0, double t, double *r, double *v, double *X);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,438 @@
+/*
+ *  relativeMotion.c
+ *  OrbitalMotion
+ *
+ *  LVLH conversions and closed form relative motion state
+ *  transition matrices.
+ *
+ *  The Yamanaka-Ankersen solution is written in its own LVLH
+ *  convention (x along-track, y anti-normal, z anti-radial) and in
+ *  the scaled variables x~ = (1 + e cos f) x with true anomaly
+ *  derivatives; YASTM() wraps it so that it maps Hill frame states
+ *  like CWSTM().
+ *
+ *  References:
+ *  H. Schaub and J. L. Junkins, "Analytical Mechanics of Space
+ *  Systems", 2nd ed., AIAA, 2009, chapter 14.
+ *  K. Yamanaka and F. Ankersen, "New State Transition Matrix for
+ *  Relative Motion on an Arbitrary Elliptical Orbit", Journal of
+ *  Guidance, Control, and Dynamics 25(1), 2002, pp. 60-66.
+ */
+
+#include "relativeMotion.h"
+#include "vector3D.h"
+
+/*
+ *  relMatMult(A, B, C)
+ *
+ *  Returns the 6x6 matrix product C = A B.
+ */
+static void relMatMult(double A[7][7], double B[7][7], double C[7][7])
+{
+    int i;
+    int j;
+    int k;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            C[i][j] = 0.;
+            for(k = 1; k <= 6; k++) {
+                C[i][j] += A[i][k] * B[k][j];
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ *  LVLHMatrix(rc, vc, HN)
+ *
+ *  Returns the rotation matrix HN from inertial to the LVLH frame
+ *  of the chief with the inertial position rc and velocity vc.
+ */
+void LVLHMatrix(double *rc, double *vc, double HN[4][4])
+{
+    double ir[3+1];
+    double ih[3+1];
+    double it[3+1];
+    double h[3+1];
+
+    mult(1. / norm(rc), rc, ir);
+    cross(rc, vc, h);
+    mult(1. / norm(h), h, ih);
+    cross(ih, ir, it);
+    setMatrix(ir[1], ir[2], ir[3], it[1], it[2], it[3], ih[1], ih[2], ih[3], HN);
+
+    return;
+}
+
+/*
+ *  rv2LVLH(rc, vc, rd, vd, rho, rhoDot)
+ *
+ *  Returns the relative position rho and the relative velocity
+ *  rhoDot, as seen by the rotating LVLH frame, of the deputy with
+ *  the inertial state rd, vd about the chief with the inertial
+ *  state rc, vc.  All vectors of rho, rhoDot are in LVLH components.
+ */
+void rv2LVLH(double *rc, double *vc, double *rd, double *vd, double *rho, double *rhoDot)
+{
+    double HN[4][4];
+    double w[3+1];
+    double dr[3+1];
+    double dv[3+1];
+    double wxr[3+1];
+
+    LVLHMatrix(rc, vc, HN);
+    cross(rc, vc, w);
+    mult(1. / dot(rc, rc), w, w);
+    sub(rd, rc, dr);
+    sub(vd, vc, dv);
+    cross(w, dr, wxr);
+    sub(dv, wxr, dv);
+    Mdot(HN, dr, rho);
+    Mdot(HN, dv, rhoDot);
+
+    return;
+}
+
+/*
+ *  LVLH2rv(rc, vc, rho, rhoDot, rd, vd)
+ *
+ *  Inverse of rv2LVLH().
+ */
+void LVLH2rv(double *rc, double *vc, double *rho, double *rhoDot, double *rd, double *vd)
+{
+    double HN[4][4];
+    double NH[4][4];
+    double w[3+1];
+    double dr[3+1];
+    double dv[3+1];
+    double wxr[3+1];
+
+    LVLHMatrix(rc, vc, HN);
+    transpose(HN, NH);
+    cross(rc, vc, w);
+    mult(1. / dot(rc, rc), w, w);
+    Mdot(NH, rho, dr);
+    Mdot(NH, rhoDot, dv);
+    cross(w, dr, wxr);
+    add(dv, wxr, dv);
+    add(rc, dr, rd);
+    add(vc, dv, vd);
+
+    return;
+}
+
+/*
+ *  CWSTM(n, t, Phi)
+ *
+ *  Returns the 6x6 Clohessy-Wiltshire state transition matrix
+ *  Phi[1..6][1..6] that maps the LVLH relative state about a
+ *  circular chief orbit with the mean motion n over t seconds.
+ */
+void CWSTM(double n, double t, double Phi[7][7])
+{
+    double s;
+    double c;
+    int    i;
+    int    j;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            Phi[i][j] = 0.;
+        }
+    }
+    s = sin(n * t);
+    c = cos(n * t);
+
+    Phi[1][1] = 4. - 3. * c;
+    Phi[1][4] = s / n;
+    Phi[1][5] = 2. / n * (1. - c);
+    Phi[2][1] = 6. * (s - n * t);
+    Phi[2][2] = 1.;
+    Phi[2][4] = -2. / n * (1. - c);
+    Phi[2][5] = (4. * s - 3. * n * t) / n;
+    Phi[3][3] = c;
+    Phi[3][6] = s / n;
+    Phi[4][1] = 3. * n * s;
+    Phi[4][4] = c;
+    Phi[4][5] = 2. * s;
+    Phi[5][1] = -6. * n * (1. - c);
+    Phi[5][4] = -2. * s;
+    Phi[5][5] = 4. * c - 3.;
+    Phi[6][3] = -n * s;
+    Phi[6][6] = c;
+
+    return;
+}
+
+/*
+ *  YASTM(mu, a, e, f0, t, Phi)
+ *
+ *  Returns the 6x6 Yamanaka-Ankersen state transition matrix
+ *  Phi[1..6][1..6] that maps the LVLH relative state about a chief
+ *  orbit with the semi-major axis a, eccentricity 0 <= e < 1 and
+ *  the initial true anomaly f0 over t seconds.
+ */
+void YASTM(double mu, double a, double e, double f0, double t, double Phi[7][7])
+{
+    double T0[7][7];
+    double Psi[7][7];
+    double T1[7][7];
+    double M[7][7];
+    double p;
+    double k2;
+    double n;
+    double f;
+    double J;
+    double rho;
+    double s;
+    double c;
+    double sd;
+    double cd;
+    double ip[4+1][4+1];
+    double iv[4+1][4+1];
+    int    idx[4+1];
+    int    i;
+    int    j;
+    int    k;
+
+    if((e < 0) || (e >= 1)) {
+        printf("ERROR: YASTM() received e = %g \n", e);
+        printf("The value of e should be 0 <= e < 1. \n");
+        for(i = 1; i <= 6; i++) {
+            for(j = 1; j <= 6; j++) {
+                Phi[i][j] = NAN;
+            }
+        }
+        return;
+    }
+    p  = a * (1. - e * e);
+    k2 = sqrt(mu / (p * p * p));
+    n  = sqrt(mu / (a * a * a));
+    f  = E2f(M2E(E2M(f2E(f0, e), e) + n * t, e), e);
+    J  = k2 * t;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            T0[i][j]  = 0.;
+            Psi[i][j] = 0.;
+            T1[i][j]  = 0.;
+        }
+    }
+
+    /* Hill state at f0 to the scaled Yamanaka-Ankersen variables
+       u = [x~ y~ z~ x~' y~' z~'] with x = y_H, y = -z_H, z = -x_H */
+    rho = 1. + e * cos(f0);
+    T0[1][2] = rho;
+    T0[4][2] = -e * sin(f0);
+    T0[4][5] = 1. / (k2 * rho);
+    T0[2][3] = -rho;
+    T0[5][3] = e * sin(f0);
+    T0[5][6] = -1. / (k2 * rho);
+    T0[3][1] = -rho;
+    T0[6][1] = e * sin(f0);
+    T0[6][4] = -1. / (k2 * rho);
+
+    /* in-plane pseudo initial values */
+    s = rho * sin(f0);
+    c = rho * cos(f0);
+    iv[1][1] = 1. - e * e;
+    iv[1][2] = 3. * e * s * (1. / rho + 1. / (rho * rho));
+    iv[1][3] = -e * s * (1. + 1. / rho);
+    iv[1][4] = -e * c + 2.;
+    iv[2][1] = 0.;
+    iv[2][2] = -3. * s * (1. / rho + e * e / (rho * rho));
+    iv[2][3] = s * (1. + 1. / rho);
+    iv[2][4] = c - 2. * e;
+    iv[3][1] = 0.;
+    iv[3][2] = -3. * (c / rho + e);
+    iv[3][3] = c * (1. + 1. / rho) + e;
+    iv[3][4] = -s;
+    iv[4][1] = 0.;
+    iv[4][2] = 3. * rho + e * e - 1.;
+    iv[4][3] = -rho * rho;
+    iv[4][4] = e * s;
+
+    /* in-plane transition at f */
+    rho = 1. + e * cos(f);
+    s   = rho * sin(f);
+    c   = rho * cos(f);
+    sd  = cos(f) + e * cos(2. * f);
+    cd  = -(sin(f) + e * sin(2. * f));
+    ip[1][1] = 1.;
+    ip[1][2] = -c * (1. + 1. / rho);
+    ip[1][3] = s * (1. + 1. / rho);
+    ip[1][4] = 3. * rho * rho * J;
+    ip[2][1] = 0.;
+    ip[2][2] = s;
+    ip[2][3] = c;
+    ip[2][4] = 2. - 3. * e * s * J;
+    ip[3][1] = 0.;
+    ip[3][2] = 2. * s;
+    ip[3][3] = 2. * c - e;
+    ip[3][4] = 3. * (1. - 2. * e * s * J);
+    ip[4][1] = 0.;
+    ip[4][2] = sd;
+    ip[4][3] = cd;
+    ip[4][4] = -3. * e * (sd * J + s / (rho * rho));
+
+    /* [x~ z~ x~' z~'] occupy u[1], u[3], u[4], u[6] */
+    idx[1] = 1;
+    idx[2] = 3;
+    idx[3] = 4;
+    idx[4] = 6;
+    for(i = 1; i <= 4; i++) {
+        for(j = 1; j <= 4; j++) {
+            Psi[idx[i]][idx[j]] = 0.;
+            for(k = 1; k <= 4; k++) {
+                Psi[idx[i]][idx[j]] += ip[i][k] * iv[k][j] / (1. - e * e);
+            }
+        }
+    }
+    Psi[2][2] = cos(f - f0);
+    Psi[2][5] = sin(f - f0);
+    Psi[5][2] = -sin(f - f0);
+    Psi[5][5] = cos(f - f0);
+
+    /* scaled variables at f back to the Hill state */
+    T1[2][1] = 1. / rho;
+    T1[5][1] = k2 * e * sin(f);
+    T1[5][4] = k2 * rho;
+    T1[3][2] = -1. / rho;
+    T1[6][2] = -k2 * e * sin(f);
+    T1[6][5] = -k2 * rho;
+    T1[1][3] = -1. / rho;
+    T1[4][3] = -k2 * e * sin(f);
+    T1[4][6] = -k2 * rho;
+
+    relMatMult(Psi, T0, M);
+    relMatMult(T1, M, Phi);
+
+    return;
+}
+
+/*
+ *  relSTMdot(Phi, x, xOut)
+ *
+ *  Returns the 6x1 state xOut = Phi x.  xOut may alias x.
+ */
+void relSTMdot(double Phi[7][7], double *x, double *xOut)
+{
+    double y[6+1];
+    int    i;
+    int    j;
+
+    for(i = 1; i <= 6; i++) {
+        y[i] = 0.;
+        for(j = 1; j <= 6; j++) {
+            y[i] += Phi[i][j] * x[j];
+        }
+    }
+    for(i = 1; i <= 6; i++) {
+        xOut[i] = y[i];
+    }
+
+    return;
+}
+
+/*
+ *  batchRV2LVLH(rc, vc, n, r, v, x)
+ *
+ *  SoA version of rv2LVLH() for the n deputies r[1..3][k],
+ *  v[1..3][k], returning x[1..6][k] = [rho; rhoDot].
+ */
+void batchRV2LVLH(double *rc, double *vc, int n, double *r[3+1], double *v[3+1], double *x[6+1])
+{
+    double HN[4][4];
+    double w[3+1];
+    int    k;
+
+    LVLHMatrix(rc, vc, HN);
+    cross(rc, vc, w);
+    mult(1. / dot(rc, rc), w, w);
+
+    #pragma omp parallel for schedule(static) if(n >= REL_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double dr[3+1];
+        double dv[3+1];
+        int    i;
+
+        for(i = 1; i <= 3; i++) {
+            dr[i] = r[i][k] - rc[i];
+        }
+        dv[1] = v[1][k] - vc[1] - (w[2] * dr[3] - w[3] * dr[2]);
+        dv[2] = v[2][k] - vc[2] - (w[3] * dr[1] - w[1] * dr[3]);
+        dv[3] = v[3][k] - vc[3] - (w[1] * dr[2] - w[2] * dr[1]);
+        for(i = 1; i <= 3; i++) {
+            x[i][k]     = HN[i][1] * dr[1] + HN[i][2] * dr[2] + HN[i][3] * dr[3];
+            x[i + 3][k] = HN[i][1] * dv[1] + HN[i][2] * dv[2] + HN[i][3] * dv[3];
+        }
+    }
+
+    return;
+}
+
+/*
+ *  batchLVLH2RV(rc, vc, n, x, r, v)
+ *
+ *  SoA version of LVLH2rv().
+ */
+void batchLVLH2RV(double *rc, double *vc, int n, double *x[6+1], double *r[3+1], double *v[3+1])
+{
+    double HN[4][4];
+    double w[3+1];
+    int    k;
+
+    LVLHMatrix(rc, vc, HN);
+    cross(rc, vc, w);
+    mult(1. / dot(rc, rc), w, w);
+
+    #pragma omp parallel for schedule(static) if(n >= REL_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double dr[3+1];
+        double dv[3+1];
+        int    i;
+
+        for(i = 1; i <= 3; i++) {
+            dr[i] = HN[1][i] * x[1][k] + HN[2][i] * x[2][k] + HN[3][i] * x[3][k];
+            dv[i] = HN[1][i] * x[4][k] + HN[2][i] * x[5][k] + HN[3][i] * x[6][k];
+        }
+        r[1][k] = rc[1] + dr[1];
+        r[2][k] = rc[2] + dr[2];
+        r[3][k] = rc[3] + dr[3];
+        v[1][k] = vc[1] + dv[1] + (w[2] * dr[3] - w[3] * dr[2]);
+        v[2][k] = vc[2] + dv[2] + (w[3] * dr[1] - w[1] * dr[3]);
+        v[3][k] = vc[3] + dv[3] + (w[1] * dr[2] - w[2] * dr[1]);
+    }
+
+    return;
+}
+
+/*
+ *  batchRelSTM(Phi, n, x, xOut)
+ *
+ *  Maps the n relative states x[1..6][k] with the state transition
+ *  matrix Phi, xOut[.][k] = Phi x[.][k].  xOut may alias x.
+ */
+void batchRelSTM(double Phi[7][7], int n, double *x[6+1], double *xOut[6+1])
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= REL_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double y[6+1];
+        int    i;
+
+        for(i = 1; i <= 6; i++) {
+            y[i] = Phi[i][1] * x[1][k] + Phi[i][2] * x[2][k] + Phi[i][3] * x[3][k]
+                   + Phi[i][4] * x[4][k] + Phi[i][5] * x[5][k] + Phi[i][6] * x[6][k];
+        }
+        for(i = 1; i <= 6; i++) {
+            xOut[i][k] = y[i];
+        }
+    }
+
+    return;
+}
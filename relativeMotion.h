@@ -0,0 +1,43 @@
+/*
+ *  relativeMotion.h
+ *  OrbitalMotion
+ *
+ *  Linearized relative motion of deputy spacecraft about a chief
+ *  orbit.  The relative states x = [rho; rhoDot] are expressed in
+ *  the chief LVLH (Hill) frame with the axes o_r (radial), o_theta
+ *  (along-track) and o_h (orbit normal), and are propagated with
+ *  the closed form Clohessy-Wiltshire (circular chief) or
+ *  Yamanaka-Ankersen (eccentric chief) state transition matrices.
+ *  The batch routines operate on SoA deputy arrays x[1..6][k].
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "orbitalMotion.h"
+
+#ifndef _RELATIVE_MOTION_H_
+#define _RELATIVE_MOTION_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define REL_PARALLEL_MIN    4096    /* smallest batch processed with several threads */
+
+    void    LVLHMatrix(double *rc, double *vc, double HN[4][4]);
+    void    rv2LVLH(double *rc, double *vc, double *rd, double *vd, double *rho, double *rhoDot);
+    void    LVLH2rv(double *rc, double *vc, double *rho, double *rhoDot, double *rd, double *vd);
+    void    CWSTM(double n, double t, double Phi[7][7]);
+    void    YASTM(double mu, double a, double e, double f0, double t, double Phi[7][7]);
+    void    relSTMdot(double Phi[7][7], double *x, double *xOut);
+
+    void    batchRV2LVLH(double *rc, double *vc, int n, double *r[3+1], double *v[3+1], double *x[6+1]);
+    void    batchLVLH2RV(double *rc, double *vc, int n, double *x[6+1], double *r[3+1], double *v[3+1]);
+    void    batchRelSTM(double Phi[7][7], int n, double *x[6+1], double *xOut[6+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ *  relativeOrbitElements.c
+ *  OrbitalMotion
+ *
+ *  Quasi-nonsingular relative orbit elements
+ *
+ *      da      = (a_d - a_c) / a_c
+ *      dlambda = (u_d - u_c) + (Omega_d - Omega_c) cos(i_c)
+ *      dex     = e_d cos(omega_d) - e_c cos(omega_c)
+ *      dey     = e_d sin(omega_d) - e_c sin(omega_c)
+ *      dix     = i_d - i_c
+ *      diy     = (Omega_d - Omega_c) sin(i_c)
+ *
+ *  with the mean argument of latitude u = omega + M.  The ROE to
+ *  LVLH map is the first order solution for near-circular chiefs,
+ *  whose inverse is closed form.
+ *
+ *  References:
+ *  S. D'Amico, "Autonomous Formation Flying in Low Earth Orbit",
+ *  PhD thesis, TU Delft, 2010.
+ *  A. W. Koenig, T. Guffanti and S. D'Amico, "New State Transition
+ *  Matrices for Spacecraft Relative Motion in Perturbed Orbits",
+ *  Journal of Guidance, Control, and Dynamics 40(7), 2017.
+ */
+
+#include "relativeOrbitElements.h"
+#include "relativeMotion.h"
+
+/*
+ *  roeWrap(x)
+ *
+ *  Wraps the angle x into [-pi, pi).
+ */
+static double roeWrap(double x)
+{
+    x = fmod(x + M_PI, 2. * M_PI);
+    if(x < 0.) {
+        x += 2. * M_PI;
+    }
+
+    return x - M_PI;
+}
+
+/*
+ *  roeMeanArgLat(elem)
+ *
+ *  Returns the mean argument of latitude omega + M.
+ */
+static double roeMeanArgLat(classicElements *elem)
+{
+    return elem->omega + E2M(f2E(elem->anom, elem->e), elem->e);
+}
+
+/*
+ *  elem2ROE(chief, deputy, roe)
+ *
+ *  Returns the relative orbit elements roe[1..6] of the deputy
+ *  with respect to the chief orbit elements.
+ */
+void elem2ROE(classicElements *chief, classicElements *deputy, double *roe)
+{
+    double dOmega;
+
+    dOmega = roeWrap(deputy->Omega - chief->Omega);
+    roe[1] = (deputy->a - chief->a) / chief->a;
+    roe[2] = roeWrap(roeMeanArgLat(deputy) - roeMeanArgLat(chief)) + dOmega * cos(chief->i);
+    roe[3] = deputy->e * cos(deputy->omega) - chief->e * cos(chief->omega);
+    roe[4] = deputy->e * sin(deputy->omega) - chief->e * sin(chief->omega);
+    roe[5] = deputy->i - chief->i;
+    roe[6] = dOmega * sin(chief->i);
+
+    return;
+}
+
+/*
+ *  ROE2elem(chief, roe, deputy)
+ *
+ *  Inverse of elem2ROE().  The chief must not be equatorial; for an
+ *  equatorial chief the deputy elements are set to NAN.
+ */
+void ROE2elem(classicElements *chief, double *roe, classicElements *deputy)
+{
+    double ex;
+    double ey;
+    double dOmega;
+    double u;
+    double M;
+
+    if(fabs(sin(chief->i)) < 1e-12) {
+        deputy->a     = NAN;
+        deputy->e     = NAN;
+        deputy->i     = NAN;
+        deputy->Omega = NAN;
+        deputy->omega = NAN;
+        deputy->anom  = NAN;
+        printf("ERROR: ROE2elem() received i = %g \n", chief->i);
+        printf("The chief orbit should not be equatorial. \n");
+        return;
+    }
+    ex     = chief->e * cos(chief->omega) + roe[3];
+    ey     = chief->e * sin(chief->omega) + roe[4];
+    dOmega = roe[6] / sin(chief->i);
+    u      = roeMeanArgLat(chief) + roe[2] - dOmega * cos(chief->i);
+
+    deputy->a     = chief->a * (1. + roe[1]);
+    deputy->e     = sqrt(ex * ex + ey * ey);
+    deputy->i     = chief->i + roe[5];
+    deputy->Omega = chief->Omega + dOmega;
+    deputy->omega = atan2(ey, ex);
+    M             = u - deputy->omega;
+    deputy->anom  = E2f(M2E(roeWrap(M), deputy->e), deputy->e);
+
+    return;
+}
+
+/*
+ *  ROE2RTNMatrix(mu, chief, T)
+ *
+ *  Returns the 6x6 matrix T that maps the ROE into the LVLH
+ *  (radial, along-track, normal) relative position and velocity
+ *  of the deputy, to first order in the separation and the chief
+ *  eccentricity.
+ */
+void ROE2RTNMatrix(double mu, classicElements *chief, double T[7][7])
+{
+    double a;
+    double n;
+    double s;
+    double c;
+    int    i;
+    int    j;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            T[i][j] = 0.;
+        }
+    }
+    a = chief->a;
+    n = sqrt(mu / (a * a * a));
+    s = sin(roeMeanArgLat(chief));
+    c = cos(roeMeanArgLat(chief));
+
+    T[1][1] = a;
+    T[1][3] = -a * c;
+    T[1][4] = -a * s;
+    T[2][2] = a;
+    T[2][3] = 2. * a * s;
+    T[2][4] = -2. * a * c;
+    T[3][5] = a * s;
+    T[3][6] = -a * c;
+    T[4][3] = a * n * s;
+    T[4][4] = -a * n * c;
+    T[5][1] = -1.5 * a * n;
+    T[5][3] = 2. * a * n * c;
+    T[5][4] = 2. * a * n * s;
+    T[6][5] = a * n * c;
+    T[6][6] = a * n * s;
+
+    return;
+}
+
+/*
+ *  RTN2ROEMatrix(mu, chief, T)
+ *
+ *  Returns the inverse of ROE2RTNMatrix().
+ */
+void RTN2ROEMatrix(double mu, classicElements *chief, double T[7][7])
+{
+    double a;
+    double n;
+    double s;
+    double c;
+    int    i;
+    int    j;
+
+    for(i = 1; i <= 6; i++) {
+        for(j = 1; j <= 6; j++) {
+            T[i][j] = 0.;
+        }
+    }
+    a = chief->a;
+    n = sqrt(mu / (a * a * a));
+    s = sin(roeMeanArgLat(chief));
+    c = cos(roeMeanArgLat(chief));
+
+    T[1][1] = 4. / a;
+    T[1][5] = 2. / (a * n);
+    T[2][2] = 1. / a;
+    T[2][4] = -2. / (a * n);
+    T[3][1] = 3. * c / a;
+    T[3][4] = s / (a * n);
+    T[3][5] = 2. * c / (a * n);
+    T[4][1] = 3. * s / a;
+    T[4][4] = -c / (a * n);
+    T[4][5] = 2. * s / (a * n);
+    T[5][3] = s / a;
+    T[5][6] = c / (a * n);
+    T[6][3] = -c / a;
+    T[6][6] = s / (a * n);
+
+    return;
+}
+
+/*
+ *  J2SecularElements(mu, elem, t, out)
+ *
+ *  Advances the mean orbit elements by t seconds with the secular
+ *  Earth J2 rates of the ascending node, argument of periapses and
+ *  mean anomaly.
+ */
+void J2SecularElements(double mu, classicElements *elem, double t, classicElements *out)
+{
+    double n;
+    double p;
+    double eta;
+    double k;
+    double ci;
+    double M;
+
+    n   = sqrt(mu / (elem->a * elem->a * elem->a));
+    p   = elem->a * (1. - elem->e * elem->e);
+    eta = sqrt(1. - elem->e * elem->e);
+    k   = 0.75 * n * J2_EARTH * (REQ_EARTH / p) * (REQ_EARTH / p);
+    ci  = cos(elem->i);
+    M   = E2M(f2E(elem->anom, elem->e), elem->e);
+
+    *out        = *elem;
+    out->Omega  = elem->Omega - 2. * k * ci * t;
+    out->omega  = elem->omega + k * (5. * ci * ci - 1.) * t;
+    M          += (n + k * eta * (3. * ci * ci - 1.)) * t;
+    out->anom   = E2f(M2E(roeWrap(M), elem->e), elem->e);
+
+    return;
+}
+
+/*
+ *  ROESTM(mu, chief, t, Phi)
+ *
+ *  Returns the 7x7 state transition matrix Phi[1..7][1..7] of the
+ *  ROE augmented with the relative decay rate dadot under the
+ *  secular Earth J2 and a constant differential drag over t
+ *  seconds, for the chief mean orbit elements at the initial time.
+ */
+void ROESTM(double mu, classicElements *chief, double t, double Phi[ROE_NUM+1][ROE_NUM+1])
+{
+    double a;
+    double n;
+    double eta;
+    double kappa;
+    double E;
+    double F;
+    double G;
+    double P;
+    double Q;
+    double S;
+    double T;
+    double w;
+    double exi;
+    double eyi;
+    double exf;
+    double eyf;
+    double cw;
+    double sw;
+    int    i;
+    int    j;
+
+    a     = chief->a;
+    n     = sqrt(mu / (a * a * a));
+    eta   = sqrt(1. - chief->e * chief->e);
+    kappa = 0.75 * J2_EARTH * REQ_EARTH * REQ_EARTH * sqrt(mu) / (pow(a, 3.5) * pow(eta, 4));
+    E     = 1. + eta;
+    F     = 4. + 3. * eta;
+    G     = 1. / (eta * eta);
+    P     = 3. * cos(chief->i) * cos(chief->i) - 1.;
+    Q     = 5. * cos(chief->i) * cos(chief->i) - 1.;
+    S     = sin(2. * chief->i);
+    T     = sin(chief->i) * sin(chief->i);
+    w     = kappa * Q;
+    cw    = cos(w * t);
+    sw    = sin(w * t);
+    exi   = chief->e * cos(chief->omega);
+    eyi   = chief->e * sin(chief->omega);
+    exf   = chief->e * cos(chief->omega + w * t);
+    eyf   = chief->e * sin(chief->omega + w * t);
+
+    for(i = 1; i <= ROE_NUM; i++) {
+        for(j = 1; j <= ROE_NUM; j++) {
+            Phi[i][j] = (i == j) ? 1. : 0.;
+        }
+    }
+
+    Phi[2][1] = -(1.5 * n + 3.5 * kappa * E * P) * t;
+    Phi[2][3] = kappa * exi * F * G * P * t;
+    Phi[2][4] = kappa * eyi * F * G * P * t;
+    Phi[2][5] = -kappa * F * S * t;
+
+    Phi[3][1] = 3.5 * kappa * eyf * Q * t;
+    Phi[3][3] = cw - 4. * kappa * exi * eyf * G * Q * t;
+    Phi[3][4] = -sw - 4. * kappa * eyi * eyf * G * Q * t;
+    Phi[3][5] = 5. * kappa * eyf * S * t;
+
+    Phi[4][1] = -3.5 * kappa * exf * Q * t;
+    Phi[4][3] = sw + 4. * kappa * exi * exf * G * Q * t;
+    Phi[4][4] = cw + 4. * kappa * eyi * exf * G * Q * t;
+    Phi[4][5] = -5. * kappa * exf * S * t;
+
+    Phi[6][1] = 3.5 * kappa * S * t;
+    Phi[6][3] = -4. * kappa * exi * G * S * t;
+    Phi[6][4] = -4. * kappa * eyi * G * S * t;
+    Phi[6][5] = 2. * kappa * T * t;
+
+    /* constant relative decay rate, integrated through the da column */
+    Phi[1][7] = t;
+    Phi[2][7] = Phi[2][1] * t / 2.;
+    Phi[3][7] = Phi[3][1] * t / 2.;
+    Phi[4][7] = Phi[4][1] * t / 2.;
+    Phi[6][7] = Phi[6][1] * t / 2.;
+
+    return;
+}
+
+/*
+ *  batchROE2RTN(mu, chief, n, roe, x)
+ *
+ *  Maps the n ROE vectors roe[1..6][k] into the LVLH relative
+ *  states x[1..6][k] with ROE2RTNMatrix().
+ */
+void batchROE2RTN(double mu, classicElements *chief, int n, double *roe[ROE_NUM+1], double *x[6+1])
+{
+    double T[7][7];
+
+    ROE2RTNMatrix(mu, chief, T);
+    batchRelSTM(T, n, roe, x);
+
+    return;
+}
+
+/*
+ *  batchRTN2ROE(mu, chief, n, x, roe)
+ *
+ *  Inverse of batchROE2RTN().  roe[7][k] is not changed.
+ */
+void batchRTN2ROE(double mu, classicElements *chief, int n, double *x[6+1], double *roe[ROE_NUM+1])
+{
+    double T[7][7];
+
+    RTN2ROEMatrix(mu, chief, T);
+    batchRelSTM(T, n, x, roe);
+
+    return;
+}
+
+/*
+ *  batchROESTM(Phi, n, roe, roeOut)
+ *
+ *  Maps the n augmented ROE states roe[1..7][k] with the state
+ *  transition matrix Phi of ROESTM().  roeOut may alias roe.
+ */
+void batchROESTM(double Phi[ROE_NUM+1][ROE_NUM+1], int n, double *roe[ROE_NUM+1],
+                 double *roeOut[ROE_NUM+1])
+{
+    int k;
+
+    #pragma omp parallel for schedule(static) if(n >= ROE_PARALLEL_MIN)
+    for(k = 0; k < n; k++) {
+        double y[ROE_NUM+1];
+        int    i;
+        int    j;
+
+        for(i = 1; i <= ROE_NUM; i++) {
+            y[i] = 0.;
+            for(j = 1; j <= ROE_NUM; j++) {
+                y[i] += Phi[i][j] * roe[j][k];
+            }
+        }
+        for(i = 1; i <= ROE_NUM; i++) {
+            roeOut[i][k] = y[i];
+        }
+    }
+
+    return;
+}
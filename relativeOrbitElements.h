@@ -0,0 +1,49 @@
+/*
+ *  relativeOrbitElements.h
+ *  OrbitalMotion
+ *
+ *  Quasi-nonsingular relative orbit elements (ROE)
+ *
+ *      roe = [da dlambda dex dey dix diy]
+ *
+ *  of a deputy with respect to a chief orbit, their mapping to
+ *  relative LVLH position and velocity, and the linear J2 and
+ *  differential drag state transition matrix of Koenig, Guffanti
+ *  and D'Amico.  The elements passed in are taken to be mean
+ *  elements.  The propagated state is the ROE vector augmented
+ *  with the constant relative decay rate dadot = d(da)/dt, i.e.
+ *  roe[1..7].
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "orbitalMotion.h"
+
+#ifndef _RELATIVE_ORBIT_ELEMENTS_H_
+#define _RELATIVE_ORBIT_ELEMENTS_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define ROE_NUM             7       /* ROE plus the relative decay rate */
+    #define ROE_PARALLEL_MIN    4096    /* smallest batch propagated with several threads */
+
+    void    elem2ROE(classicElements *chief, classicElements *deputy, double *roe);
+    void    ROE2elem(classicElements *chief, double *roe, classicElements *deputy);
+    void    ROE2RTNMatrix(double mu, classicElements *chief, double T[7][7]);
+    void    RTN2ROEMatrix(double mu, classicElements *chief, double T[7][7]);
+    void    J2SecularElements(double mu, classicElements *elem, double t, classicElements *out);
+    void    ROESTM(double mu, classicElements *chief, double t, double Phi[ROE_NUM+1][ROE_NUM+1]);
+
+    void    batchROE2RTN(double mu, classicElements *chief, int n, double *roe[ROE_NUM+1], double *x[6+1]);
+    void    batchRTN2ROE(double mu, classicElements *chief, int n, double *x[6+1], double *roe[ROE_NUM+1]);
+    void    batchROESTM(double Phi[ROE_NUM+1][ROE_NUM+1], int n, double *roe[ROE_NUM+1],
+                        double *roeOut[ROE_NUM+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
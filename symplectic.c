@@ -0,0 +1,444 @@
+/*
+ *  symplectic.c
+ *  OrbitalMotion
+ *
+ *  The Hamiltonian H = H_A + H_B is split into the Kepler part
+ *  H_A = v^2/2 - mu/r and the perturbing potential H_B (Wisdom-Holman)
+ *  or into H_A = v^2/2 and the full potential H_B (leapfrog).  The
+ *  second order map drifts with H_A for h/2, kicks with H_B for h at
+ *  the middle of the step and drifts for h/2 again.  The Yoshida
+ *  compositions apply this map with the substeps w_j h, where the
+ *  drifts of neighbouring substeps are merged so an order 2m step
+ *  costs as many kicks and one more drift than it has substeps.  The
+ *  third bodies make H_B time dependent; their kicks are evaluated at
+ *  the times the kicks act, so the map remains symplectic in the
+ *  extended phase space.
+ *
+ *  The Kepler drift solves the universal Kepler equation with Newton
+ *  iterations started from sqrt(mu) dt / r0, which converge in a few
+ *  iterations for steps up to a sizeable fraction of the period, and
+ *  applies the f and g functions.
+ *
+ *  References:
+ *  J. Wisdom and M. Holman, "Symplectic Maps for the N-Body Problem",
+ *  Astronomical Journal, 102(4), 1991.
+ *  H. Yoshida, "Construction of Higher Order Symplectic Integrators",
+ *  Physics Letters A, 150(5-7), 1990.
+ *  D. A. Vallado, "Fundamentals of Astrodynamics and Applications",
+ *  3rd ed., 2007, algorithm 8.
+ */
+
+#include <string.h>
+#include "symplectic.h"
+
+#define SYM_MAX_STAGES      15
+
+/* Yoshida substep weights w_m, ..., w_1 of the symmetric compositions, w_0 completes the sum */
+static const double symYoshida4[1] = {
+    1.35120719195965777
+};
+static const double symYoshida6[3] = {
+    0.784513610477560, 0.235573213359357, -1.17767998417887
+};
+static const double symYoshida8[7] = {
+    0.914844246229740, 0.253693336566229, -1.44485223686048, -0.158240635368243,
+    1.93813913762276, -1.96061023297549, 0.102799849391985
+};
+
+/*
+ *  num = symStages(order, w)
+ *
+ *  Fills w[0..num-1] with the substep weights of the composition of
+ *  the given order, -1 if the order is not supported.
+ */
+static int symStages(int order, double *w)
+{
+    const double *c;
+    double        s;
+    int           m;
+    int           j;
+
+    switch(order) {
+        case 2:
+            w[0] = 1.;
+            return 1;
+        case 4:
+            c = symYoshida4;
+            m = 1;
+            break;
+        case 6:
+            c = symYoshida6;
+            m = 3;
+            break;
+        case 8:
+            c = symYoshida8;
+            m = 7;
+            break;
+        default:
+            return -1;
+    }
+    s = 0.;
+    for(j = 0; j < m; j++) {
+        w[j]             = c[j];
+        w[2 * m - j]     = c[j];
+        s               += 2. * c[j];
+    }
+    w[m] = 1. - s;
+
+    return 2 * m + 1;
+}
+
+/*
+ *  symInitSettings(set)
+ *
+ *  Default settings: Earth point mass, fourth order Wisdom-Holman
+ *  map, no third bodies.
+ */
+void symInitSettings(symSettings *set)
+{
+    memset(set, 0, sizeof(symSettings));
+    set->mu        = MU_EARTH;
+    set->jnum      = 0;
+    set->split     = SYM_WISDOM_HOLMAN;
+    set->order     = 4;
+    set->numBodies = 0;
+
+    return;
+}
+
+/*
+ *  k = symAddBody(set, mu, radius, incl, phase)
+ *
+ *  Adds a third body of gravitational constant mu on a circular
+ *  orbit of the given radius (km) about the central body, inclined
+ *  by incl about the x axis and with argument of latitude phase at
+ *  t = 0.  Returns its index, -1 if the table is full.
+ */
+int symAddBody(symSettings *set, double mu, double radius, double incl, double phase)
+{
+    symBody *b;
+
+    if(set->numBodies >= SYM_MAX_BODIES) {
+        printf("ERROR: symAddBody() received more than %d bodies \n", SYM_MAX_BODIES);
+        return -1;
+    }
+    b = &set->body[set->numBodies];
+    b->mu     = mu;
+    b->radius = radius;
+    b->rate   = sqrt((set->mu + mu) / (radius * radius * radius));
+    b->incl   = incl;
+    b->phase  = phase;
+
+    return set->numBodies++;
+}
+
+/*
+ *  symBodyPosition(body, t, rb)
+ *
+ *  Position rb (km) of the third body at time t (sec).
+ */
+void symBodyPosition(symBody *body, double t, double *rb)
+{
+    double u;
+
+    u = body->phase + body->rate * t;
+    rb[1] = body->radius * cos(u);
+    rb[2] = body->radius * sin(u) * cos(body->incl);
+    rb[3] = body->radius * sin(u) * sin(body->incl);
+
+    return;
+}
+
+/*
+ *  symStumpff(z, C, S)
+ *
+ *  Returns the Stumpff functions C(z) and S(z).
+ */
+static void symStumpff(double z, double *C, double *S)
+{
+    double s;
+
+    if(z > 1e-2) {
+        s  = sqrt(z);
+        *C = (1. - cos(s)) / z;
+        *S = (s - sin(s)) / (s * z);
+    } else if(z < -1e-2) {
+        s  = sqrt(-z);
+        *C = (1. - cosh(s)) / z;
+        *S = (sinh(s) - s) / (s * -z);
+    } else {
+        *C = 1. / 2. - z * (1. / 24. - z * (1. / 720. - z * (1. / 40320. - z / 3628800.)));
+        *S = 1. / 6. - z * (1. / 120. - z * (1. / 5040. - z * (1. / 362880. - z / 39916800.)));
+    }
+
+    return;
+}
+
+/*
+ *  status = symKeplerDrift(mu, r, v, dt)
+ *
+ *  Advances the two-body state r, v (km, km/s) by dt seconds in
+ *  place.  Returns -1 and leaves the state unchanged if the
+ *  universal Kepler equation did not converge.
+ */
+int symKeplerDrift(double mu, double *r, double *v, double dt)
+{
+    double sqmu;
+    double r0;
+    double alpha;
+    double s0;
+    double chi;
+    double dchi;
+    double z;
+    double C;
+    double S;
+    double F;
+    double rr;
+    double f;
+    double g;
+    double fd;
+    double gd;
+    double r1[3+1];
+    int    k;
+    int    i;
+
+    sqmu  = sqrt(mu);
+    r0    = norm(r);
+    alpha = 2. / r0 - dot(v, v) / mu;
+    s0    = dot(r, v) / sqmu;
+
+    chi = sqmu * dt / r0;
+    for(k = 0; k < SYM_MAX_ITER; k++) {
+        z = alpha * chi * chi;
+        symStumpff(z, &C, &S);
+        F  = s0 * chi * chi * C + (1. - alpha * r0) * chi * chi * chi * S + r0 * chi - sqmu * dt;
+        rr = s0 * chi * (1. - z * S) + (1. - alpha * r0) * chi * chi * C + r0;
+        dchi = F / rr;
+        chi -= dchi;
+        if(fabs(dchi) <= 1e-14 * fabs(chi) + 1e-300) {
+            break;
+        }
+    }
+    if(k == SYM_MAX_ITER) {
+        return -1;
+    }
+
+    z = alpha * chi * chi;
+    symStumpff(z, &C, &S);
+    rr = s0 * chi * (1. - z * S) + (1. - alpha * r0) * chi * chi * C + r0;
+    f  = 1. - chi * chi * C / r0;
+    g  = dt - chi * chi * chi * S / sqmu;
+    fd = sqmu * chi * (z * S - 1.) / (rr * r0);
+    gd = 1. - chi * chi * C / rr;
+    for(i = 1; i <= 3; i++) {
+        r1[i] = f * r[i] + g * v[i];
+        v[i]  = fd * r[i] + gd * v[i];
+        r[i]  = r1[i];
+    }
+
+    return 0;
+}
+
+/*
+ *  symPerturbAccel(set, t, r, a)
+ *
+ *  Perturbing acceleration a (km/s^2) of the zonal harmonics and the
+ *  third bodies at time t and position r.
+ */
+void symPerturbAccel(symSettings *set, double t, double *r, double *a)
+{
+    double rb[3+1];
+    double d[3+1];
+    double ap[3+1];
+    double dn;
+    double bn;
+    int    j;
+    int    i;
+
+    setZero(a);
+    if(set->jnum) {
+        JPerturb(r, set->jnum, a);
+    }
+    for(j = 0; j < set->numBodies; j++) {
+        symBodyPosition(&set->body[j], t, rb);
+        sub(rb, r, d);
+        dn = norm(d);
+        bn = norm(rb);
+        for(i = 1; i <= 3; i++) {
+            ap[i] = set->body[j].mu * (d[i] / (dn * dn * dn) - rb[i] / (bn * bn * bn));
+        }
+        add(a, ap, a);
+    }
+
+    return;
+}
+
+/*
+ *  E = symEnergy(set, r, v)
+ *
+ *  Specific energy (km^2/s^2) of the central body and its zonal
+ *  harmonics, the integral conserved without third bodies.
+ */
+double symEnergy(symSettings *set, double *r, double *v)
+{
+    static const double Jn[6+1] = {0., 0., J2_EARTH, J3_EARTH, J4_EARTH, J5_EARTH, J6_EARTH};
+    double rn;
+    double u;
+    double P0;
+    double P1;
+    double P2;
+    double q;
+    double U;
+    int    n;
+
+    rn = norm(r);
+    U  = 0.;
+    if(set->jnum) {
+        u  = r[3] / rn;
+        P0 = 1.;
+        P1 = u;
+        q  = REQ_EARTH / rn;
+        for(n = 2; n <= set->jnum; n++) {
+            P2 = ((2. * n - 1.) * u * P1 - (n - 1.) * P0) / n;
+            U += Jn[n] * pow(q, n) * P2;
+            P0 = P1;
+            P1 = P2;
+        }
+    }
+
+    return dot(v, v) / 2. - set->mu / rn * (1. - U);
+}
+
+/*
+ *  status = symStep(set, t, h, w, num, r, v)
+ *
+ *  One composed step of h seconds from time t with the substep
+ *  weights w[0..num-1].
+ */
+static int symStep(symSettings *set, double t, double h, double *w, int num, double *r, double *v)
+{
+    double a[3+1];
+    double drift;
+    double rn;
+    int    j;
+    int    i;
+
+    drift = 0.;
+    for(j = 0; j < num; j++) {
+        drift += w[j] * h / 2.;
+        if(set->split == SYM_WISDOM_HOLMAN) {
+            if(symKeplerDrift(set->mu, r, v, drift) != 0) {
+                return -1;
+            }
+        } else {
+            for(i = 1; i <= 3; i++) {
+                r[i] += drift * v[i];
+            }
+        }
+        t += drift;
+
+        symPerturbAccel(set, t, r, a);
+        if(set->split != SYM_WISDOM_HOLMAN) {
+            rn = norm(r);
+            for(i = 1; i <= 3; i++) {
+                a[i] -= set->mu * r[i] / (rn * rn * rn);
+            }
+        }
+        for(i = 1; i <= 3; i++) {
+            v[i] += w[j] * h * a[i];
+        }
+        drift = w[j] * h / 2.;
+    }
+    if(set->split == SYM_WISDOM_HOLMAN) {
+        return symKeplerDrift(set->mu, r, v, drift);
+    }
+    for(i = 1; i <= 3; i++) {
+        r[i] += drift * v[i];
+    }
+
+    return 0;
+}
+
+/*
+ *  status = symPropagate(set, t0, h, numSteps, r, v)
+ *
+ *  Propagates the state r, v from time t0 by numSteps symplectic
+ *  steps of h seconds.  Returns -1 if the settings are invalid or
+ *  the Kepler drift failed, in which case the state is that of the
+ *  last completed step.
+ */
+int symPropagate(symSettings *set, double t0, double h, int numSteps, double *r, double *v)
+{
+    double w[SYM_MAX_STAGES];
+    double rs[3+1];
+    double vs[3+1];
+    int    num;
+    int    k;
+
+    num = symStages(set->order, w);
+    if(num < 0) {
+        printf("ERROR: symPropagate() received order = %d \n", set->order);
+        printf("The value of order should be 2, 4, 6 or 8. \n");
+        return -1;
+    }
+    if((set->split != SYM_WISDOM_HOLMAN) && (set->split != SYM_LEAPFROG)) {
+        printf("ERROR: symPropagate() received split = %d \n", set->split);
+        printf("The value of split should be SYM_WISDOM_HOLMAN or SYM_LEAPFROG. \n");
+        return -1;
+    }
+
+    for(k = 0; k < numSteps; k++) {
+        equal(r, rs);
+        equal(v, vs);
+        if(symStep(set, t0 + k * h, h, w, num, r, v) != 0) {
+            equal(rs, r);
+            equal(vs, v);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ *  failed = batchSymplectic(set, n, t0, h, numSteps, r, v)
+ *
+ *  Propagates the n objects of the SoA state r[1..3][k], v[1..3][k]
+ *  as in symPropagate(), in parallel.  Returns the number of objects
+ *  whose propagation failed.
+ */
+int batchSymplectic(symSettings *set, int n, double t0, double h, int numSteps,
+                    double *r[3+1], double *v[3+1])
+{
+    double w[SYM_MAX_STAGES];
+    int    failed;
+    int    k;
+
+    if(symStages(set->order, w) < 0) {
+        printf("ERROR: batchSymplectic() received order = %d \n", set->order);
+        printf("The value of order should be 2, 4, 6 or 8. \n");
+        return n;
+    }
+
+    failed = 0;
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+:failed)
+    for(k = 0; k < n; k++) {
+        double rk[3+1];
+        double vk[3+1];
+        int    i;
+
+        for(i = 1; i <= 3; i++) {
+            rk[i] = r[i][k];
+            vk[i] = v[i][k];
+        }
+        if(symPropagate(set, t0, h, numSteps, rk, vk) != 0) {
+            failed++;
+        }
+        for(i = 1; i <= 3; i++) {
+            r[i][k] = rk[i];
+            v[i][k] = vk[i];
+        }
+    }
+
+    return failed;
+}
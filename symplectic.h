@@ -0,0 +1,69 @@
+/*
+ *  symplectic.h
+ *  OrbitalMotion
+ *
+ *  Symplectic long-term propagation of orbits under conservative
+ *  forces.  The Wisdom-Holman map splits the motion into the exact
+ *  Kepler drift about the central body, solved with universal
+ *  variables, and velocity kicks from the zonal harmonics of
+ *  JPerturb() and from third bodies on circular orbits.  The plain
+ *  leapfrog split drifts in a straight line and kicks with the full
+ *  acceleration.  Both second order maps are raised to order 4, 6
+ *  or 8 with the compositions of Yoshida.  Dissipative forces (drag)
+ *  are not included.  The batch routine operates on SoA states
+ *  r[1..3][k] and v[1..3][k].
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "astroConstants.h"
+#include "vector3D.h"
+#include "orbitalMotion.h"
+
+#ifndef _SYMPLECTIC_H_
+#define _SYMPLECTIC_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif
+
+    #define SYM_WISDOM_HOLMAN   1       /* Kepler drift and perturbation kicks */
+    #define SYM_LEAPFROG        2       /* straight drift and full gravity kicks */
+
+    #define SYM_MAX_BODIES      4       /* third bodies of the force model */
+    #define SYM_MAX_ITER        50      /* Kepler solver iteration limit */
+
+    typedef struct symBodyStruct {
+        double mu;                      /* gravitational constant (km^3/s^2) */
+        double radius;                  /* radius of its circular orbit (km) */
+        double rate;                    /* angular rate of the orbit (rad/s) */
+        double incl;                    /* inclination of the orbit about the x axis (rad) */
+        double phase;                   /* argument of latitude at t = 0 (rad) */
+    } symBody;
+
+    typedef struct symSettingsStruct {
+        double  mu;                     /* central body gravitational constant (km^3/s^2) */
+        int     jnum;                   /* zonal harmonics as in JPerturb(), 0 to disable */
+        int     split;                  /* SYM_WISDOM_HOLMAN or SYM_LEAPFROG */
+        int     order;                  /* 2, 4, 6 or 8 */
+        int     numBodies;              /* third bodies in use */
+        symBody body[SYM_MAX_BODIES];
+    } symSettings;
+
+    void   symInitSettings(symSettings *set);
+    int    symAddBody(symSettings *set, double mu, double radius, double incl, double phase);
+    void   symBodyPosition(symBody *body, double t, double *rb);
+    int    symKeplerDrift(double mu, double *r, double *v, double dt);
+    void   symPerturbAccel(symSettings *set, double t, double *r, double *a);
+    double symEnergy(symSettings *set, double *r, double *v);
+    int    symPropagate(symSettings *set, double t0, double h, int numSteps, double *r, double *v);
+    int    batchSymplectic(symSettings *set, int n, double t0, double h, int numSteps,
+                           double *r[3+1], double *v[3+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif